@@ -0,0 +1,447 @@
+//  STL Import
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+//  Project Import
+#include <MIPSSimulator.hpp>
+#include <WorkloadGenerator.hpp>
+
+
+//  Size of every workload at scale 1, see generate_workload()
+constexpr int64_t DEFAULT_SIZES[WORKLOAD_COUNT]{
+    24'000'000,
+    20'000'000,
+    21'000'000,
+    100'000,
+    200'000
+};
+
+//  Names of the engines, indexed by ENGINE_*
+constexpr const char *ENGINE_NAMES[]{ "interpreter", "threaded", "jit" };
+
+
+/**
+ * @brief What to measure, from the command line.
+ */
+struct BenchmarkOptions
+{
+    std::vector<int32_t> workloads;
+    std::vector<int32_t> engines;
+    int32_t repetitions{ 5 };
+    //  Runs before the measured ones, to warm caches and the branch predictor
+    int32_t warmup{ 1 };
+    //  Processor to run on, -1 to leave it to the scheduler
+    int32_t cpu{ -1 };
+    double scale{ 1.0 };
+    //  File for the JSON results, empty for standard output
+    std::string output_path;
+    //  Where the generated programs are written
+    std::string workload_directory;
+};
+
+
+/**
+ * @brief Timings of one workload on one engine.
+ */
+struct Measurement
+{
+    int32_t workload;
+    int32_t engine;
+    int64_t lines;
+    int64_t instructions;
+    //  Time taken by load() and by run(), one entry per repetition
+    std::vector<int64_t> parse_nanoseconds;
+    std::vector<int64_t> run_nanoseconds;
+    //  Error that stopped the program, empty if it halted
+    std::string error;
+};
+
+
+/**
+ * @brief Keep the calling thread on one processor.
+ * @param cpu
+ * @return False if the host does not allow it.
+*/
+static bool pin_to_cpu(int32_t cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << cpu) != 0;
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * @brief Returns the nanoseconds since start.
+ * @param start
+*/
+static int64_t elapsed_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+}
+
+
+/**
+ * @brief Returns the median of some values.
+ * @param values
+*/
+static int64_t median(std::vector<int64_t> values)
+{
+    std::sort(values.begin(), values.end());
+    const size_t middle{ values.size() / 2 };
+
+    if (values.size() % 2 == 1)
+        return values[middle];
+
+    return (values[middle - 1] + values[middle]) / 2;
+}
+
+
+/**
+ * @brief Load and run a program repeatedly.
+ * @param path
+ * @param engine
+ * @param options
+ * @param measurement Filled with the timings.
+*/
+static void measure(
+    const std::string &path,
+    int32_t engine,
+    const BenchmarkOptions &options,
+    Measurement &measurement
+)
+{
+    //  Nothing is displayed
+    std::ostream discard{ nullptr };
+    MIPSSimulator simulator{ engine, discard };
+
+    for (int32_t i{}; i < options.warmup + options.repetitions; i++)
+    {
+        //  Lines are decoded lazily while running, so parsing includes
+        //  decoding all of them up front
+        auto start{ std::chrono::steady_clock::now() };
+        SimulationResult result{ simulator.load(path) };
+        if (result.status == STATUS_RUNNING)
+            result = simulator.decode_program();
+        const int64_t parse{ elapsed_since(start) };
+
+        start = std::chrono::steady_clock::now();
+        if (result.status == STATUS_RUNNING)
+            result = simulator.run();
+        const int64_t run{ elapsed_since(start) };
+
+        if (result.status == STATUS_ERROR)
+        {
+            measurement.error = result.error;
+            return;
+        }
+
+        if (i < options.warmup)
+            continue;
+
+        measurement.instructions = simulator.instruction_count();
+        measurement.parse_nanoseconds.push_back(parse);
+        measurement.run_nanoseconds.push_back(run);
+    }
+}
+
+
+/**
+ * @brief Write minimum, median, mean and maximum of some timings as a JSON
+ *        object.
+ * @param output
+ * @param values
+*/
+static void write_timings(std::ostream &output, const std::vector<int64_t> &values)
+{
+    if (values.empty())
+    {
+        output << "null";
+        return;
+    }
+
+    const int64_t total{ std::accumulate(values.begin(), values.end(), int64_t{}) };
+
+    output
+        << "{\"min\":" << *std::min_element(values.begin(), values.end())
+        << ",\"median\":" << median(values)
+        << ",\"mean\":" << total / static_cast<int64_t>(values.size())
+        << ",\"max\":" << *std::max_element(values.begin(), values.end())
+        << ",\"all\":[";
+
+    for (size_t i{}; i < values.size(); i++)
+        output << (i == 0 ? "" : ",") << values[i];
+
+    output << "]}";
+}
+
+
+/**
+ * @brief Write text as a JSON string, quoted and escaped.
+ * @param output
+ * @param text
+*/
+static void write_string(std::ostream &output, std::string_view text)
+{
+    output << '"';
+
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+            output << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+            output << escaped;
+        } else
+            output << c;
+    }
+
+    output << '"';
+}
+
+
+/**
+ * @brief Write all results as one JSON document.
+ * @param output
+ * @param options
+ * @param pinned Whether the benchmark runs on options.cpu.
+ * @param measurements
+*/
+static void write_results(
+    std::ostream &output,
+    const BenchmarkOptions &options,
+    bool pinned,
+    const std::vector<Measurement> &measurements
+)
+{
+    output << "{\n  \"compiler\": \"";
+#if defined(__clang__)
+    output << "clang " << __clang_version__;
+#elif defined(__GNUC__)
+    output << "gcc " << __VERSION__;
+#elif defined(_MSC_VER)
+    output << "msvc " << _MSC_VER;
+#endif
+    output << "\",\n";
+
+#if defined(NDEBUG)
+    output << "  \"assertions\": false,\n";
+#else
+    output << "  \"assertions\": true,\n";
+#endif
+
+    output
+        << "  \"repetitions\": " << options.repetitions << ",\n"
+        << "  \"warmup\": " << options.warmup << ",\n"
+        << "  \"scale\": " << options.scale << ",\n"
+        << "  \"cpu\": " << (pinned ? options.cpu : -1) << ",\n"
+        << "  \"results\": [";
+
+    for (size_t i{}; i < measurements.size(); i++)
+    {
+        const Measurement &measurement{ measurements[i] };
+
+        output
+            << (i == 0 ? "\n" : ",\n")
+            << "    {\"workload\": \"" << WORKLOAD_NAMES[measurement.workload] << '"'
+            << ", \"engine\": \"" << ENGINE_NAMES[measurement.engine] << '"'
+            << ", \"lines\": " << measurement.lines;
+
+        if (!measurement.error.empty())
+        {
+            output << ", \"error\": ";
+            write_string(output, measurement.error);
+            output << '}';
+            continue;
+        }
+
+        const int64_t run{ median(measurement.run_nanoseconds) };
+
+        output << ", \"instructions\": " << measurement.instructions;
+        output << ", \"parse_ns\": ";
+        write_timings(output, measurement.parse_nanoseconds);
+        output << ", \"run_ns\": ";
+        write_timings(output, measurement.run_nanoseconds);
+        output
+            << ", \"instructions_per_second\": "
+            << static_cast<int64_t>(measurement.instructions * 1e9 / std::max<int64_t>(run, 1))
+            << '}';
+    }
+
+    output << "\n  ]\n}\n";
+}
+
+
+/**
+ * @brief Print one line per result, with the medians.
+ * @param output
+ * @param measurements
+*/
+static void display_results(std::ostream &output, const std::vector<Measurement> &measurements)
+{
+    for (const Measurement &measurement : measurements)
+    {
+        output
+            << WORKLOAD_NAMES[measurement.workload] << ' '
+            << ENGINE_NAMES[measurement.engine] << ": ";
+
+        if (!measurement.error.empty())
+        {
+            output << "failed: " << measurement.error << '\n';
+            continue;
+        }
+
+        const int64_t run{ median(measurement.run_nanoseconds) };
+
+        output
+            << measurement.lines << " lines parsed in "
+            << median(measurement.parse_nanoseconds) / 1e6 << " ms, "
+            << measurement.instructions << " instructions in "
+            << run / 1e6 << " ms, "
+            << measurement.instructions * 1e3 / std::max<int64_t>(run, 1)
+            << " million instructions/s\n";
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    options.workload_directory =
+        (std::filesystem::temp_directory_path() / "mips_benchmark").string();
+
+    for (int32_t i{ 1 }; i < argc; i++)
+    {
+        const std::string argument{ argv[i] };
+
+        if (argument == "--workload" && i + 1 < argc)
+        {
+            const int32_t workload{ find_workload(argv[++i]) };
+            if (workload < 0)
+            {
+                std::cerr << "Error: Unknown workload " << argv[i] << ".\n";
+                return 1;
+            }
+            options.workloads.push_back(workload);
+        }
+        else if (argument == "--interpreter")
+            options.engines.push_back(ENGINE_INTERPRETER);
+        else if (argument == "--threaded")
+            options.engines.push_back(ENGINE_THREADED);
+        else if (argument == "--jit")
+            options.engines.push_back(ENGINE_JIT);
+        else if (argument == "--repetitions" && i + 1 < argc)
+            options.repetitions = std::max(std::atoi(argv[++i]), 1);
+        else if (argument == "--warmup" && i + 1 < argc)
+            options.warmup = std::max(std::atoi(argv[++i]), 0);
+        else if (argument == "--cpu" && i + 1 < argc)
+            options.cpu = std::atoi(argv[++i]);
+        else if (argument == "--scale" && i + 1 < argc)
+            options.scale = std::atof(argv[++i]);
+        else if (argument == "--output" && i + 1 < argc)
+            options.output_path = argv[++i];
+        else if (argument == "--workload-dir" && i + 1 < argc)
+            options.workload_directory = argv[++i];
+        else
+        {
+            std::cerr << "Error: Unknown option " << argument << ".\n";
+            return 1;
+        }
+    }
+
+    //  Everything, unless something was picked
+    if (options.workloads.empty())
+        for (int32_t i{}; i < WORKLOAD_COUNT; i++)
+            options.workloads.push_back(i);
+    if (options.engines.empty())
+        options.engines = { ENGINE_INTERPRETER, ENGINE_THREADED, ENGINE_JIT };
+
+    const bool pinned{ options.cpu >= 0 && pin_to_cpu(options.cpu) };
+    if (options.cpu >= 0 && !pinned)
+        std::cerr << "Warning: Could not run on processor " << options.cpu << ".\n";
+
+    std::error_code error;
+    std::filesystem::create_directories(options.workload_directory, error);
+
+    std::vector<Measurement> measurements;
+
+    for (const int32_t workload : options.workloads)
+    {
+        const int64_t size{
+            std::max<int64_t>(static_cast<int64_t>(DEFAULT_SIZES[workload] * options.scale), 1)
+        };
+        const std::string source{ generate_workload(workload, size) };
+        const std::string path{
+            (std::filesystem::path{ options.workload_directory }
+                / (std::string{ WORKLOAD_NAMES[workload] } + ".s")).string()
+        };
+
+        std::ofstream file{ path, std::ios::binary };
+        file << source;
+        file.close();
+        if (!file)
+        {
+            std::cerr << "Error: Could not write " << path << ".\n";
+            return 1;
+        }
+
+        for (const int32_t engine : options.engines)
+        {
+            Measurement measurement{};
+            measurement.workload = workload;
+            measurement.engine = engine;
+            measurement.lines = std::count(source.begin(), source.end(), '\n');
+
+            measure(path, engine, options, measurement);
+            measurements.push_back(std::move(measurement));
+            display_results(std::cerr, { measurements.back() });
+        }
+    }
+
+    if (options.output_path.empty())
+        write_results(std::cout, options, pinned, measurements);
+    else
+    {
+        std::ofstream output{ options.output_path };
+        write_results(output, options, pinned, measurements);
+
+        if (!output)
+        {
+            std::cerr << "Error: Could not write " << options.output_path << ".\n";
+            return 1;
+        }
+    }
+
+    for (const Measurement &measurement : measurements)
+        if (!measurement.error.empty())
+            return 1;
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <WorkloadGenerator.hpp>
+
+#include <algorithm>
+
+
+namespace
+{
+
+// Data labels the labels workload loads and stores in its loop
+constexpr int64_t LABELS_TOUCHED{ 64 };
+// Times the labels workload goes through the labels it touches
+constexpr int64_t LABELS_PASSES{ 1'000 };
+
+
+/**
+ * @brief Append the loop shared by the looping workloads: main loads the
+ *        iteration count into $s0 and clears $t0, the body is followed by
+ *        the increment and the branch back.
+ * @param text
+ * @param iterations
+ * @param setup Instructions before the loop, one per line.
+ * @param body
+*/
+void append_loop(
+    std::string &text,
+    int64_t iterations,
+    const std::string &setup,
+    const std::string &body
+)
+{
+    text += ".data\n";
+    text += "N: .word " + std::to_string(std::max<int64_t>(iterations, 1)) + '\n';
+    text += "result: .word 0\n\n";
+    text += ".text\n";
+    text += "main:\n";
+    text += "  lw $s0, N\n";
+    text += "  addi $t0, $zero, 0\n";
+    text += setup;
+    text += "Loop:\n";
+    text += body;
+    text += "  addi $t0, $t0, 1\n";
+    text += "  bne $t0, $s0, Loop\n";
+    text += "  sw $t1, result\n";
+    text += "  halt\n";
+}
+
+
+/**
+ * @brief Every register used by the stack workload, in the order they are
+ *        pushed.
+ */
+constexpr const char *STACK_REGISTERS[]{
+    "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7", "$t8"
+};
+
+
+/**
+ * @brief One cycle of straight-line instructions. Results are masked, so
+ *        that no value can overflow however long the file is.
+ */
+constexpr const char *STRAIGHT_LINE_CYCLE[]{
+    "  addi $t1, $t2, 7\n",
+    "  andi $t2, $t1, 1023\n",
+    "  add $t3, $t2, $t4\n",
+    "  andi $t4, $t3, 4095\n",
+    "  sub $t5, $t4, $t2\n",
+    "  or $t6, $t5, $t1\n",
+    "  slt $t7, $t6, $t3\n",
+    "  ori $t8, $t7, 12\n",
+    "  and $t9, $t8, $t6\n",
+    "  slti $s1, $t9, 50\n"
+};
+
+}
+
+
+int32_t find_workload(const std::string &name)
+{
+    for (int32_t i{}; i < WORKLOAD_COUNT; i++)
+        if (name == WORKLOAD_NAMES[i])
+            return i;
+
+    return -1;
+}
+
+
+std::string generate_workload(int32_t workload, int64_t size)
+{
+    std::string text;
+
+    switch (workload)
+    {
+    case WORKLOAD_ARITHMETIC:
+        // 12 instructions per iteration, all values stay small
+        append_loop(
+            text,
+            size / 12,
+            "  addi $t1, $zero, 1\n"
+            "  addi $t2, $zero, 3\n",
+            "  add $t3, $t1, $t2\n"
+            "  sub $t4, $t3, $t0\n"
+            "  mul $t5, $t4, $t2\n"
+            "  and $t6, $t5, $t3\n"
+            "  or $t7, $t6, $t1\n"
+            "  nor $t8, $t7, $t0\n"
+            "  slt $t9, $t8, $t5\n"
+            "  andi $s1, $t8, 255\n"
+            "  ori $s2, $s1, 16\n"
+            "  slti $s3, $s2, 100\n"
+        );
+        break;
+
+    case WORKLOAD_BRANCHES:
+        // A linear congruential generator modulo 1024 decides the branches,
+        // about 10 instructions per iteration
+        append_loop(
+            text,
+            size / 10,
+            "  addi $t1, $zero, 1\n"
+            "  addi $t5, $zero, 5\n",
+            "  mul $t1, $t1, $t5\n"
+            "  addi $t1, $t1, 3\n"
+            "  andi $t1, $t1, 1023\n"
+            "  andi $t2, $t1, 32\n"
+            "  beq $t2, $zero, Clear\n"
+            "  addi $t3, $t3, 1\n"
+            "  j Next\n"
+            "Clear:\n"
+            "  andi $t2, $t1, 128\n"
+            "  bne $t2, $zero, Next\n"
+            "  addi $t4, $t4, 1\n"
+            "Next:\n"
+        );
+        break;
+
+    case WORKLOAD_STACK:
+    {
+        // Push eight registers and pop them in reverse, 21 instructions per
+        // iteration
+        std::string body{ "  addi $sp, $sp, -32\n" };
+        for (int32_t i{}; i < 8; i++)
+            body += std::string{ "  sw " } + STACK_REGISTERS[i]
+                + ", " + std::to_string(4 * i) + "($sp)\n";
+        body += "  addi $t1, $t1, 1\n";
+        for (int32_t i{ 7 }; i >= 0; i--)
+            body += std::string{ "  lw " } + STACK_REGISTERS[i]
+                + ", " + std::to_string(4 * i) + "($sp)\n";
+        body += "  addi $sp, $sp, 32\n";
+
+        append_loop(text, size / 21, "", body);
+        break;
+    }
+
+    case WORKLOAD_LABELS:
+    {
+        const int64_t labels{ std::max<int64_t>(size, 1) };
+        const int64_t touched{ std::min(labels, LABELS_TOUCHED) };
+
+        text += ".data\n";
+        for (int64_t i{}; i < labels; i++)
+            text += "D" + std::to_string(i) + ": .word " + std::to_string(i % 1000) + '\n';
+        text += "N: .word " + std::to_string(LABELS_PASSES) + "\n\n";
+
+        text += ".text\n";
+        text += "main:\n";
+        text += "  lw $s0, N\n";
+        text += "  addi $t0, $zero, 0\n";
+        text += "Loop:\n";
+
+        // Labels spread over the whole data section
+        for (int64_t i{}; i < touched; i++)
+        {
+            const std::string label{ "D" + std::to_string(i * labels / touched) };
+            text += "  lw $t1, " + label + '\n';
+            text += "  andi $t2, $t1, 1023\n";
+            text += "  sw $t2, " + label + '\n';
+        }
+
+        text += "  addi $t0, $t0, 1\n";
+        text += "  bne $t0, $s0, Loop\n";
+        text += "  halt\n";
+        break;
+    }
+
+    case WORKLOAD_STRAIGHT_LINE:
+    {
+        const int64_t lines{ std::max<int64_t>(size, 1) };
+        const int64_t cycle{ sizeof(STRAIGHT_LINE_CYCLE) / sizeof(STRAIGHT_LINE_CYCLE[0]) };
+
+        text.reserve(lines * 20);
+        text += ".text\n";
+        text += "main:\n";
+        for (int64_t i{}; i < lines; i++)
+            text += STRAIGHT_LINE_CYCLE[i % cycle];
+        text += "  halt\n";
+        break;
+    }
+    }
+
+    return text;
+}
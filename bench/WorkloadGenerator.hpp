@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Kinds of generated programs, in the order of WORKLOAD_NAMES
+// Loop of R-format and I-format arithmetic
+constexpr int32_t WORKLOAD_ARITHMETIC{ 0 };
+// Loop with data-dependent beq, bne and j
+constexpr int32_t WORKLOAD_BRANCHES{ 1 };
+// Loop pushing and popping registers through $sp
+constexpr int32_t WORKLOAD_STACK{ 2 };
+// Large data section, with a loop loading and storing its labels
+constexpr int32_t WORKLOAD_LABELS{ 3 };
+// One long run of instructions without any branch
+constexpr int32_t WORKLOAD_STRAIGHT_LINE{ 4 };
+constexpr int32_t WORKLOAD_COUNT{ 5 };
+
+// Names used on the command line and in results
+constexpr const char *WORKLOAD_NAMES[WORKLOAD_COUNT]{
+    "arithmetic",
+    "branches",
+    "stack",
+    "labels",
+    "straight_line"
+};
+
+/**
+ * @brief Returns the workload with a name, or -1.
+ * @param name
+*/
+int32_t find_workload(const std::string &name);
+
+/**
+ * @brief Generate the source of a workload.
+ *
+ * The same workload and size always give the same program, and every
+ * program ends with halt.
+ *
+ * @param workload One of WORKLOAD_*.
+ * @param size Roughly the number of instructions executed, or for labels
+ *             the number of data labels, and for straight_line the number
+ *             of lines.
+ * @return
+*/
+std::string generate_workload(int32_t workload, int64_t size);
@@ -1,40 +1,892 @@
 //  STL Import
 #include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
 
 //  Project Import
-#include <LabelTable.hpp>
-#include <MemoryElement.hpp>
+#include <GuestMemory.hpp>
 #include <MIPSSimulator.hpp>
+#include <BatchRunner.hpp>
+#include <OutputBuffer.hpp>
+#include <TraceReader.hpp>
 
 
-int main()
+//  Ways to run a program
+//  State after each instruction, waiting for Enter in between
+constexpr int32_t MODE_STEP{ 1 };
+//  State before and after execution
+constexpr int32_t MODE_RUN{ 2 };
+//  State after each instruction, without waiting
+constexpr int32_t MODE_TRACE{ 3 };
+//  Nothing until the program stops
+constexpr int32_t MODE_HEADLESS{ 4 };
+
+//  History kept in step mode, for going back
+constexpr int64_t DEFAULT_CHECKPOINT_INTERVAL{ 100'000 };
+constexpr int64_t DEFAULT_HISTORY_LIMIT{ 64 };
+
+//  What headless mode prints once the program stops
+constexpr int32_t REPORT_STATE{ 0 };
+constexpr int32_t REPORT_SUMMARY{ 1 };
+constexpr int32_t REPORT_NONE{ 2 };
+
+
+/**
+ * @brief What to do with the program once it is loaded.
+ */
+struct ProgramOptions
 {
     std::string path;
-    int32_t mode;
+    //  One of MODE_*, and one of REPORT_* for headless mode
+    int32_t mode{ MODE_RUN };
+    int32_t report{ REPORT_STATE };
+    //  Whether the path and mode were asked for
+    bool prompted{};
+    //  Lines to stop at, and the snapshots to resume from and to save when
+    //  execution stops
+    std::vector<int32_t> breakpoints;
+    std::string restore_path;
+    std::string snapshot_path;
+    //  Annotated listing to print and folded stacks to write once the
+    //  program stops
+    bool profile{};
+    std::string flame_graph_path;
+    //  Pipeline timing to print once the program stops
+    bool pipeline{};
+    //  Cache hits and misses to print once the program stops
+    bool caches{};
+    //  Branch mispredictions to print once the program stops
+    bool branch_prediction{};
+};
+
+
+/**
+ * @brief Print an error returned by the simulator, with the line and the
+ *        state for errors found in a line.
+ * @param output
+ * @param simulator
+ * @param result
+ * @param with_state False to leave out the state.
+*/
+static void display_error(
+    std::ostream &output,
+    MIPSSimulator &simulator,
+    const SimulationResult &result,
+    bool with_state = true
+)
+{
+    output << "Error: " << result.error << '\n';
+
+    if (result.error_line < 0)
+        return;
+
+    output
+        << "Error found in line: " << result.error_line + 1
+        << ": " << simulator.source_line(result.error_line) << '\n';
+
+    if (with_state)
+        simulator.display_state();
+}
+
+
+/**
+ * @brief Print one line with the number of instructions executed and where
+ *        the program halted or stopped at a breakpoint.
+ * @param output
+ * @param simulator
+*/
+static void display_summary(std::ostream &output, const MIPSSimulator &simulator)
+{
+    if (!simulator.has_halted())
+    {
+        output
+            << "Stopped at breakpoint on line " << simulator.program_counter() + 1
+            << " after " << simulator.instruction_count() << " instructions.\n";
+        return;
+    }
+
+    output
+        << "Halted after " << simulator.instruction_count()
+        << " instructions at program counter "
+        << simulator.program_counter_address() << ".\n";
+}
+
+
+/**
+ * @brief Save a snapshot of the simulator, if a path is given.
+ * @param output
+ * @param simulator
+ * @param path
+ * @return False if the snapshot could not be written.
+*/
+static bool save_snapshot(std::ostream &output, MIPSSimulator &simulator, const std::string &path)
+{
+    if (path.empty() || simulator.save_snapshot(path))
+        return true;
+
+    output << "Error: Could not write snapshot " << path << ".\n";
+    return false;
+}
+
+
+/**
+ * @brief Print the profile, the pipeline timing, the cache statistics and the
+ *        branch mispredictions of the program, and write the profile as
+ *        folded stacks, for whichever the options ask for.
+ * @param output
+ * @param simulator
+ * @param options
+ * @return False if the folded stacks could not be written.
+*/
+static bool report_profile(
+    std::ostream &output,
+    MIPSSimulator &simulator,
+    const ProgramOptions &options
+)
+{
+    if (options.profile)
+        simulator.display_profile();
+    if (options.pipeline)
+        simulator.display_pipeline();
+    if (options.caches)
+        simulator.display_caches();
+    if (options.branch_prediction)
+        simulator.display_branch_prediction();
+
+    if (options.flame_graph_path.empty())
+        return true;
+
+    std::ofstream folded{ options.flame_graph_path };
+    simulator.write_folded_profile(folded, options.path);
+
+    if (folded)
+        return true;
+
+    output << "Error: Could not write profile " << options.flame_graph_path << ".\n";
+    return false;
+}
+
+
+/**
+ * @brief Read the geometry of a cache, written as size:associativity:line
+ *        in bytes, such as 32768:4:32.
+ * @param text
+ * @param config Set to the geometry, keeping the policies.
+ * @return False if the text is not a geometry.
+*/
+static bool parse_cache_geometry(const std::string &text, CacheConfig &config)
+{
+    char rest{};
+    return std::sscanf(
+        text.c_str(),
+        "%d:%d:%d%c",
+        &config.size,
+        &config.associativity,
+        &config.line_size,
+        &rest
+    ) == 3;
+}
+
+
+/**
+ * @brief Read a comma-separated list of predictor names, such as
+ *        2bit,gshare.
+ * @param text
+ * @param kinds Set to one of PREDICT_* per name.
+ * @return The first name that is not a predictor, or an empty string.
+*/
+static std::string parse_predictors(const std::string &text, std::vector<int32_t> &kinds)
+{
+    kinds.clear();
+    size_t start{};
+
+    while (start <= text.size())
+    {
+        const size_t end{ std::min(text.find(',', start), text.size()) };
+        const std::string name{ text.substr(start, end - start) };
+
+        int32_t kind{ PREDICT_TAKEN };
+        while (kind <= PREDICT_TOURNAMENT && name != BranchPredictor::kind_name(kind))
+            kind++;
+        if (kind > PREDICT_TOURNAMENT)
+            return name.empty() ? "\"" + text + "\"" : name;
+
+        kinds.push_back(kind);
+        start = end + 1;
+    }
+
+    return {};
+}
+
+
+/**
+ * @brief Wait for the Enter key, after making sure that everything printed
+ *        so far is visible.
+ * @param output
+*/
+static void wait_for_enter(std::ostream &output)
+{
+    output.flush();
+    std::getchar();
+}
+
+
+/**
+ * @brief Run a program in step mode: print the state after each instruction
+ *        and read a command before going on.
+ *
+ * An empty line or s executes the next instruction, b takes it back, c
+ * continues to the next breakpoint, r goes back to the previous one, and
+ * break <line> or clear <line> set and remove breakpoints, and save <file>
+ * saves a snapshot. Errors and halt reached with c can still be stepped
+ * back from.
+ *
+ * @param output
+ * @param simulator
+ * @return The result of the last instruction executed.
+*/
+static SimulationResult run_step_mode(std::ostream &output, MIPSSimulator &simulator)
+{
+    SimulationResult result{ simulator.step() };
+    bool changed{ true };
+    std::string command;
+
+    while (result.status == STATUS_RUNNING)
+    {
+        if (changed)
+            simulator.display_state();
+
+        changed = true;
+        output.flush();
+
+        if (!std::getline(std::cin, command))
+            command.clear();
+
+        if (command.empty() || command == "s")
+        {
+            result = simulator.step();
+            continue;
+        }
+
+        if (command == "b" || command == "r")
+        {
+            const bool moved{
+                command == "b" ? simulator.reverse_step() : simulator.reverse_continue()
+            };
+
+            if (!moved)
+            {
+                output << "No earlier state is kept.\n";
+                changed = false;
+            }
+
+            continue;
+        }
+
+        if (command == "c")
+        {
+            result = simulator.run();
+
+            if (result.status == STATUS_RUNNING)
+                continue;
+
+            //  Stay in step mode, so that execution can go back from here
+            if (result.status == STATUS_ERROR)
+                display_error(output, simulator, result, false);
+            else
+                output << "\nProgram halted.\n";
+
+            result.status = STATUS_RUNNING;
+            continue;
+        }
+
+        changed = false;
+        const size_t space{ command.find(' ') };
+        const std::string name{ command.substr(0, space) };
+        const int32_t line{
+            space == std::string::npos ? 0 : std::atoi(command.c_str() + space + 1)
+        };
+
+        if (name == "save" && space != std::string::npos)
+        {
+            if (save_snapshot(output, simulator, command.substr(space + 1)))
+                output << "Snapshot saved.\n";
+        }
+        else if (name != "break" && name != "clear")
+            output <<
+                "Commands: Enter or s to step, b to step back, c to continue, "
+                "r to go back to the previous breakpoint, break <line>, clear <line>, "
+                "save <file>.\n";
+        else if (!simulator.set_breakpoint(line - 1, name == "break"))
+            output << "There is no line " << line << ".\n";
+        else if (name == "break")
+            output << "Breakpoint set at line " << line << ".\n";
+        else
+            output << "Breakpoint cleared at line " << line << ".\n";
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief Print the state recorded in a trace after a number of
+ *        instructions.
+ * @param output
+ * @param path
+ * @param step The number of instructions, or -1 for the end of the trace.
+ * @return The exit status.
+*/
+static int decode_trace(std::ostream &output, const std::string &path, int64_t step)
+{
+    TraceReader reader;
+
+    if (!reader.open(path))
+    {
+        output << "Error: " << path << " is not a valid trace.\n";
+        return 1;
+    }
+
+    if (step < 0)
+        reader.seek_end();
+    else if (!reader.seek(step) && !reader.is_corrupt())
+    {
+        output << "Error: The trace ends after " << reader.step() << " steps.\n";
+        return 1;
+    }
+
+    if (reader.is_corrupt())
+    {
+        output << "Error: The trace is damaged after " << reader.step() << " steps.\n";
+        return 1;
+    }
+
+    reader.display_state(output);
+    return 0;
+}
+
+
+/**
+ * @brief Load an assembly program and write it as machine code.
+ * @param output
+ * @param simulator
+ * @param path
+ * @param executable_path
+ * @return The exit status.
+*/
+static int assemble_program(
+    std::ostream &output,
+    MIPSSimulator &simulator,
+    const std::string &path,
+    const std::string &executable_path
+)
+{
+    SimulationResult result{ simulator.load(path) };
+    if (result.status != STATUS_ERROR)
+        result = simulator.assemble(executable_path);
 
-    std::cout << "\nMIPS Simulator\n\n";
+    if (result.status == STATUS_ERROR)
+    {
+        display_error(output, simulator, result, false);
+        return 1;
+    }
+
+    output << "Assembled " << path << " into " << executable_path << ".\n";
+    return 0;
+}
 
-    std::cout <<
-        "Program to simulate execution in MIPS Assembly language!\n"
-        "Two modes are available:\n\n"
 
-        "1. Step by Step Mode - View state after each instruction\n"
-        "2. Execution Mode - View state after end of execution\n\n";
+/**
+ * @brief Load a program and run it in the mode the options ask for, printing
+ *        its state, errors and profile.
+ * @param output
+ * @param simulator
+ * @param options
+ * @return The exit status, which is the program's exit code if it halted.
+*/
+static int run_program(
+    std::ostream &output,
+    MIPSSimulator &simulator,
+    const ProgramOptions &options
+)
+{
+    SimulationResult result{ simulator.load(options.path) };
+    if (result.status == STATUS_ERROR)
+    {
+        display_error(output, simulator, result, options.report == REPORT_STATE);
+        return 1;
+    }
 
-    std::cout << "Enter the relative path of the input file and the mode number:\n";
+    for (const int32_t line : options.breakpoints)
+        if (!simulator.set_breakpoint(line - 1, true))
+        {
+            output << "Error: There is no line " << line << ".\n";
+            return 1;
+        }
 
-    std::cin >> path >> mode;
-    //  If mode is invalid
-    if (mode != 1 && mode != 2)
+    if (!options.restore_path.empty() && !simulator.restore_snapshot(options.restore_path))
     {
-        std::cout << "Error: Invalid Mode.\nExiting...\n";
+        output
+            << "Error: " << options.restore_path
+            << " is not a snapshot of " << options.path << ".\n";
         return 1;
     }
 
+    if (options.mode == MODE_HEADLESS)
+    {
+        result = simulator.run();
+
+        if (!report_profile(output, simulator, options))
+            return 1;
+
+        if (result.status == STATUS_ERROR)
+        {
+            display_error(output, simulator, result, options.report == REPORT_STATE);
+            return 1;
+        }
+
+        if (!save_snapshot(output, simulator, options.snapshot_path))
+            return 1;
+
+        if (options.report == REPORT_STATE)
+        {
+            simulator.display_state();
+            simulator.display_pair_statistics();
+        }
+        else if (options.report == REPORT_SUMMARY)
+            display_summary(output, simulator);
+
+        return simulator.exit_code();
+    }
+
+    //  To remove effect of pressing enter key while starting
+    if (options.prompted)
+        std::getchar();
+
+    output << "Initialized and ready to execute. ";
+    output << "Current state is as follows : \n";
+    simulator.display_state();
+    output << "\nStarting execution\n\n";
+
+    if (options.mode == MODE_STEP)
+        result = run_step_mode(output, simulator);
+    else if (options.mode == MODE_TRACE)
+    {
+        //  Display state after each instruction
+        while ((result = simulator.step()).status == STATUS_RUNNING)
+            simulator.display_state();
+    }
+    else
+        result = simulator.run();
+
+    if (!report_profile(output, simulator, options))
+        return 1;
+
+    //  Stopped at a breakpoint
+    if (result.status == STATUS_RUNNING)
+    {
+        simulator.display_state();
+        display_summary(output, simulator);
+        return save_snapshot(output, simulator, options.snapshot_path) ? 0 : 1;
+    }
+
+    //  Errors in a line are shown with the state at that line
+    if (result.status == STATUS_ERROR && result.error_line >= 0)
+    {
+        display_error(output, simulator, result);
+        return 1;
+    }
+
+    //  Display state at end
+    simulator.display_state();
+
+    if (result.status == STATUS_ERROR)
+    {
+        display_error(output, simulator, result);
+        return 1;
+    }
+
+    if (!save_snapshot(output, simulator, options.snapshot_path))
+        return 1;
+
+    simulator.display_pair_statistics();
+    output << "\nExecution completed successfully.\n\n";
+
+    if (options.prompted)
+        wait_for_enter(output);
+
+    return simulator.exit_code();
+}
+
+
+int main(int argc, char *argv[])
+{
+    ProgramOptions options{};
+    int32_t engine{ ENGINE_INTERPRETER };
+    bool pair_histogram{};
+    bool fusion{};
+    //  Program images are kept here unless disabled
+    std::string cache_directory{ ".mips_cache" };
+    bool rebuild_cache{};
+    //  List or directory of programs to run in parallel, if any
+    std::string batch_path;
+    int32_t thread_count{};
+    //  Trace to write while running, or to read instead of running
+    std::string trace_path;
+    std::string decode_path;
+    int64_t decode_step{ -1 };
+    int64_t checkpoint_interval{ DEFAULT_CHECKPOINT_INTERVAL };
+    int64_t history_limit{ DEFAULT_HISTORY_LIMIT };
+    //  Memory given to the program, in bytes
+    int64_t stack_size{ DEFAULT_STACK_SIZE };
+    int64_t heap_size{ DEFAULT_HEAP_SIZE };
+    //  Design point of the pipeline timing model
+    PipelineConfig pipeline_config{};
+    //  Geometry and policies of the simulated L1 caches, if enabled
+    CacheConfig instruction_cache{};
+    CacheConfig data_cache{};
+    bool instruction_cache_enabled{};
+    bool data_cache_enabled{};
+    //  Branch predictors to compare, all with the same sizes
+    std::vector<int32_t> predictor_kinds;
+    PredictorConfig predictor_config{};
+    //  Executable to write instead of running the program
+    std::string assemble_path;
+    //  Timing of the simulator itself, printed last or written to a file
+    bool statistics{};
+    std::string statistics_path;
+
+    //  All output is collected and written in large blocks
+    OutputBuffer buffer{ stdout };
+    std::ostream output{ &buffer };
+
+    for (int32_t i{ 1 }; i < argc; i++)
+    {
+        const std::string argument{ argv[i] };
+
+        if (argument == "--threaded")
+            engine = ENGINE_THREADED;
+        else if (argument == "--jit")
+            engine = ENGINE_JIT;
+        else if (argument == "--interpreter")
+            engine = ENGINE_INTERPRETER;
+        else if (argument == "--pair-histogram")
+            pair_histogram = true;
+        else if (argument == "--fuse")
+            fusion = true;
+        else if (argument == "--no-cache")
+            cache_directory.clear();
+        else if (argument == "--rebuild-cache")
+            rebuild_cache = true;
+        else if (argument == "--cache-dir" && i + 1 < argc)
+            cache_directory = argv[++i];
+        else if (argument == "--batch" && i + 1 < argc)
+            batch_path = argv[++i];
+        else if (argument == "--threads" && i + 1 < argc)
+            thread_count = std::atoi(argv[++i]);
+        else if (argument == "--record-trace" && i + 1 < argc)
+            trace_path = argv[++i];
+        else if (argument == "--decode-trace" && i + 1 < argc)
+            decode_path = argv[++i];
+        else if (argument == "--at" && i + 1 < argc)
+            decode_step = std::atoll(argv[++i]);
+        else if (argument == "--checkpoint-interval" && i + 1 < argc)
+            checkpoint_interval = std::atoll(argv[++i]);
+        else if (argument == "--history-limit" && i + 1 < argc)
+            history_limit = std::atoll(argv[++i]);
+        else if (argument == "--stack-size" && i + 1 < argc)
+            stack_size = std::atoll(argv[++i]);
+        else if (argument == "--heap-size" && i + 1 < argc)
+            heap_size = std::atoll(argv[++i]);
+        else if (argument == "--break" && i + 1 < argc)
+            options.breakpoints.push_back(std::atoi(argv[++i]));
+        else if (argument == "--restore-snapshot" && i + 1 < argc)
+            options.restore_path = argv[++i];
+        else if (argument == "--save-snapshot" && i + 1 < argc)
+            options.snapshot_path = argv[++i];
+        else if (argument == "--profile")
+            options.profile = true;
+        else if (argument == "--flame-graph" && i + 1 < argc)
+            options.flame_graph_path = argv[++i];
+        else if (argument == "--assemble" && i + 1 < argc)
+            assemble_path = argv[++i];
+        else if (argument == "--pipeline")
+            options.pipeline = true;
+        else if (argument == "--forwarding" && i + 1 < argc)
+        {
+            const std::string paths{ argv[++i] };
+            pipeline_config.forwarding =
+                paths == "none" ? FORWARD_NONE : paths == "mem" ? FORWARD_MEM : FORWARD_FULL;
+            if (paths != "none" && paths != "mem" && paths != "full")
+            {
+                output << "Error: Unknown forwarding " << paths << ".\n";
+                return 1;
+            }
+        }
+        else if (argument == "--branch-stage" && i + 1 < argc)
+        {
+            const std::string stage{ argv[++i] };
+            pipeline_config.branch_stage =
+                stage == "ex" ? STAGE_EX : stage == "mem" ? STAGE_MEM : STAGE_ID;
+            if (stage != "id" && stage != "ex" && stage != "mem")
+            {
+                output << "Error: Unknown branch stage " << stage << ".\n";
+                return 1;
+            }
+        }
+        else if ((argument == "--icache" || argument == "--dcache") && i + 1 < argc)
+        {
+            const std::string geometry{ argv[++i] };
+            const bool instruction{ argument == "--icache" };
+            CacheConfig &config{ instruction ? instruction_cache : data_cache };
+
+            if (!parse_cache_geometry(geometry, config))
+            {
+                output << "Error: Unknown cache geometry " << geometry << ".\n";
+                return 1;
+            }
+            if (const char *error{ CacheModel::validate(config) }; error != nullptr)
+            {
+                output << "Error: " << error << '\n';
+                return 1;
+            }
+
+            (instruction ? instruction_cache_enabled : data_cache_enabled) = true;
+            options.caches = true;
+        }
+        else if (argument == "--cache-replacement" && i + 1 < argc)
+        {
+            const std::string policy{ argv[++i] };
+            const int32_t replacement{
+                policy == "fifo" ? REPLACE_FIFO : policy == "random" ? REPLACE_RANDOM : REPLACE_LRU
+            };
+            if (policy != "lru" && policy != "fifo" && policy != "random")
+            {
+                output << "Error: Unknown replacement policy " << policy << ".\n";
+                return 1;
+            }
+            instruction_cache.replacement = data_cache.replacement = replacement;
+        }
+        else if (argument == "--cache-write" && i + 1 < argc)
+        {
+            const std::string policy{ argv[++i] };
+            data_cache.write_policy = policy == "through" ? WRITE_THROUGH : WRITE_BACK;
+            if (policy != "back" && policy != "through")
+            {
+                output << "Error: Unknown write policy " << policy << ".\n";
+                return 1;
+            }
+        }
+        else if (argument == "--predict" && i + 1 < argc)
+        {
+            const std::string unknown{ parse_predictors(argv[++i], predictor_kinds) };
+            if (!unknown.empty())
+            {
+                output << "Error: Unknown predictor " << unknown << ".\n";
+                return 1;
+            }
+            options.branch_prediction = true;
+        }
+        else if (argument == "--predictor-bits" && i + 1 < argc)
+            predictor_config.table_bits = std::atoi(argv[++i]);
+        else if (argument == "--history-bits" && i + 1 < argc)
+            predictor_config.history_bits = std::atoi(argv[++i]);
+        else if (argument == "--btb" && i + 1 < argc)
+            predictor_config.btb_entries = std::atoi(argv[++i]);
+        else if (argument == "--stats")
+            statistics = true;
+        else if (argument == "--stats-file" && i + 1 < argc)
+        {
+            statistics = true;
+            statistics_path = argv[++i];
+        }
+        else if (argument == "--step")
+            options.mode = MODE_STEP;
+        else if (argument == "--run")
+            options.mode = MODE_RUN;
+        else if (argument == "--trace")
+            options.mode = MODE_TRACE;
+        else if (argument == "--headless")
+        {
+            options.mode = MODE_HEADLESS;
+            options.report = REPORT_STATE;
+        }
+        else if (argument == "--summary")
+        {
+            options.mode = MODE_HEADLESS;
+            options.report = REPORT_SUMMARY;
+        }
+        else if (argument == "--quiet")
+        {
+            options.mode = MODE_HEADLESS;
+            options.report = REPORT_NONE;
+        }
+        else if ((argument.size() > 1 && argument[0] == '-') || !options.path.empty())
+        {
+            output << "Error: Unknown option " << argument << ".\n";
+            return 1;
+        }
+        else
+            options.path = argument;
+    }
+
+    if (!decode_path.empty())
+        return decode_trace(output, decode_path, decode_step);
+
+    //  Superinstructions only exist in the interpreter
+    if (fusion && engine != ENGINE_INTERPRETER)
+    {
+        output << "Error: --fuse cannot be combined with --threaded or --jit.\n";
+        return 1;
+    }
+
+    if (const char *error{ BranchPredictor::validate(predictor_config) }; error != nullptr)
+    {
+        output << "Error: " << error << '\n';
+        return 1;
+    }
+
+    if (
+        stack_size < 4 || stack_size + heap_size > MAX_MEMORY_SIZE
+        ||
+        heap_size < 0
+    )
+    {
+        output << "Error: Invalid memory size.\n";
+        return 1;
+    }
+
+    //  Batch mode runs without any interaction
+    if (!batch_path.empty())
+    {
+        std::vector<std::string> paths;
+        if (!BatchRunner::find_programs(batch_path, paths))
+        {
+            output << "Error: Could not read " << batch_path << ".\n";
+            return 1;
+        }
+
+        BatchRunner runner{ engine, thread_count };
+        if (!cache_directory.empty())
+            runner.enable_cache(cache_directory, rebuild_cache);
+        //  Stacks of all programs go to one file, under the program's path
+        if (!options.flame_graph_path.empty())
+            runner.enable_profile();
+        runner.set_memory_size(static_cast<int32_t>(stack_size), static_cast<int32_t>(heap_size));
+
+        const std::vector<BatchResult> results{ runner.run(paths) };
+        runner.display_results(results, output);
+
+        if (!options.flame_graph_path.empty())
+        {
+            std::ofstream folded{ options.flame_graph_path };
+            for (const BatchResult &result : results)
+                folded << result.folded_profile;
+
+            if (!folded)
+            {
+                output << "Error: Could not write profile " << options.flame_graph_path << ".\n";
+                return 1;
+            }
+        }
+
+        for (const BatchResult &result : results)
+            if (!result.halted)
+                return 1;
+
+        return 0;
+    }
+
+    //  Without a file on the command line, ask for it and for the mode
+    options.prompted = options.path.empty();
+    if (options.prompted)
+    {
+        output << "\nMIPS Simulator\n\n";
+
+        output <<
+            "Program to simulate execution in MIPS Assembly language!\n"
+            "Two modes are available:\n\n"
+
+            "1. Step by Step Mode - View state after each instruction\n"
+            "2. Execution Mode - View state after end of execution\n\n";
+
+        output << "Enter the relative path of the input file and the mode number:\n";
+        output.flush();
+
+        std::cin >> options.path >> options.mode;
+        //  If mode is invalid
+        if (options.mode != MODE_STEP && options.mode != MODE_RUN)
+        {
+            output << "Error: Invalid Mode.\nExiting...\n";
+            return 1;
+        }
+    }
+
     //  Create and initialize simulator
-    MIPSSimulator simulator{ mode - 1, path };
-    //  Execute simulator
-    simulator.execute();
+    MIPSSimulator simulator{ engine, output };
+    const bool stepping{ options.mode == MODE_STEP || options.mode == MODE_TRACE };
+
+    if (pair_histogram)
+        simulator.enable_pair_histogram();
+    //  Superinstructions would skip the state display between their lines
+    if (fusion && !stepping)
+        simulator.enable_fusion();
+    if (!cache_directory.empty())
+        simulator.enable_cache(cache_directory, rebuild_cache);
+    if (!trace_path.empty())
+        simulator.enable_trace(trace_path);
+    //  Step mode can go back, within the limit given in MiB
+    if (options.mode == MODE_STEP && history_limit > 0)
+        simulator.enable_history(checkpoint_interval, static_cast<size_t>(history_limit) << 20);
+    if (options.profile || !options.flame_graph_path.empty())
+        simulator.enable_profile();
+    if (options.pipeline)
+        simulator.enable_pipeline(pipeline_config);
+    if (instruction_cache_enabled)
+        simulator.enable_instruction_cache(instruction_cache);
+    if (data_cache_enabled)
+        simulator.enable_data_cache(data_cache);
+    if (options.branch_prediction)
+    {
+        std::vector<PredictorConfig> predictors;
+        for (const int32_t kind : predictor_kinds)
+        {
+            predictors.push_back(predictor_config);
+            predictors.back().kind = kind;
+        }
+        simulator.enable_branch_prediction(predictors);
+    }
+    if (statistics)
+        simulator.enable_statistics();
+    simulator.set_memory_size(static_cast<int32_t>(stack_size), static_cast<int32_t>(heap_size));
+    simulator.set_console(&output, &std::cin);
+
+    const int status{
+        assemble_path.empty()
+            ? run_program(output, simulator, options)
+            : assemble_program(output, simulator, options.path, assemble_path)
+    };
+
+    if (statistics)
+    {
+        if (statistics_path.empty())
+            simulator.write_statistics(output);
+        else
+        {
+            std::ofstream file{ statistics_path };
+            simulator.write_statistics(file);
+
+            if (!file)
+            {
+                output << "Error: Could not write statistics " << statistics_path << ".\n";
+                return 1;
+            }
+        }
+    }
 
-    auto _ignore{ std::getchar() };
+    return status;
 }
@@ -0,0 +1,203 @@
+#include <BatchRunner.hpp>
+#include <MIPSSimulator.hpp>
+#include <WorkStealingPool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string_view>
+#include <thread>
+
+
+BatchRunner::BatchRunner(int32_t engine, int32_t thread_count)
+    : m_engine{ engine }
+    , m_thread_count{ thread_count }
+    , m_rebuild_cache{}
+    , m_profile{}
+    , m_stack_size{ DEFAULT_STACK_SIZE }
+    , m_heap_size{ DEFAULT_HEAP_SIZE }
+    , m_elapsed_seconds{}
+{
+    if (m_thread_count <= 0)
+        m_thread_count = std::max(
+            static_cast<int32_t>(std::thread::hardware_concurrency()),
+            1
+        );
+}
+
+
+void BatchRunner::enable_cache(const std::string &directory, bool rebuild)
+{
+    m_cache_directory = directory;
+    m_rebuild_cache = rebuild;
+}
+
+
+void BatchRunner::enable_profile()
+{
+    m_profile = true;
+}
+
+
+void BatchRunner::set_memory_size(int32_t stack_size, int32_t heap_size)
+{
+    m_stack_size = stack_size;
+    m_heap_size = heap_size;
+}
+
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<std::string> &paths)
+{
+    std::vector<BatchResult> results(paths.size());
+    WorkStealingPool pool{ m_thread_count };
+
+    const auto start{ std::chrono::steady_clock::now() };
+
+    // One simulator per thread, reloaded for every program it runs
+    std::vector<std::unique_ptr<MIPSSimulator>> simulators;
+    for (int32_t i{}; i < pool.thread_count(); i++)
+    {
+        simulators.push_back(std::make_unique<MIPSSimulator>(m_engine));
+
+        if (!m_cache_directory.empty())
+            simulators.back()->enable_cache(m_cache_directory, m_rebuild_cache);
+        if (m_profile)
+            simulators.back()->enable_profile();
+        simulators.back()->set_memory_size(m_stack_size, m_heap_size);
+        // Programs run in parallel, so their output would be interleaved
+        simulators.back()->set_console(nullptr, nullptr);
+    }
+
+    pool.run(
+        paths.size(),
+        [this, &paths, &results, &simulators](size_t index, size_t thread)
+        {
+            MIPSSimulator &simulator{ *simulators[thread] };
+            BatchResult &result{ results[index] };
+            result.path = paths[index];
+
+            SimulationResult outcome{ simulator.load(paths[index]) };
+            if (outcome.status == STATUS_RUNNING)
+                outcome = simulator.run();
+
+            result.halted = outcome.status == STATUS_HALTED;
+            result.error = outcome.error;
+            result.error_line = outcome.error_line;
+            result.instruction_count = simulator.instruction_count();
+            for (int32_t i{}; i < 32; i++)
+                result.registers[i] = simulator.register_value(i);
+
+            if (m_profile)
+            {
+                std::ostringstream folded;
+                simulator.write_folded_profile(folded, result.path);
+                result.folded_profile = folded.str();
+            }
+        }
+    );
+
+    m_elapsed_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    return results;
+}
+
+
+void BatchRunner::display_results(
+    const std::vector<BatchResult> &results,
+    std::ostream &output
+) const
+{
+    int32_t halted{};
+    int64_t instructions{};
+
+    for (const BatchResult &result : results)
+    {
+        output << result.path << ": ";
+
+        // Messages end in a period, but the line goes on after them
+        std::string_view error{ result.error };
+        if (!error.empty() && error.back() == '.')
+            error.remove_suffix(1);
+
+        if (result.halted)
+            output << "halted";
+        else if (result.error_line >= 0)
+            output
+                << "failed at line " << result.error_line + 1
+                << ": " << error;
+        else
+            output << "failed: " << error;
+
+        output << ", " << result.instruction_count << " instructions, registers";
+        for (const int32_t value : result.registers)
+            output << ' ' << value;
+        output << '\n';
+
+        halted += result.halted;
+        instructions += result.instruction_count;
+    }
+
+    const double seconds{ std::max(m_elapsed_seconds, 1e-9) };
+
+    output
+        << "\nPrograms: " << results.size()
+        << ", halted: " << halted
+        << ", failed: " << results.size() - halted << '\n'
+        << "Instructions: " << instructions
+        << " in " << m_elapsed_seconds << " s on "
+        << m_thread_count << " threads\n"
+        << "Throughput: " << instructions / seconds / 1e6
+        << " million instructions/s, " << results.size() / seconds
+        << " programs/s\n";
+}
+
+
+bool BatchRunner::find_programs(
+    const std::string &path,
+    std::vector<std::string> &paths
+)
+{
+    std::error_code error;
+
+    if (std::filesystem::is_directory(path, error))
+    {
+        std::vector<std::string> found;
+        for (
+            const auto &entry
+            : std::filesystem::directory_iterator{ path, error }
+        )
+            if (entry.is_regular_file() && entry.path().extension() == ".s")
+                found.push_back(entry.path().string());
+
+        if (error)
+            return false;
+
+        // Directory order differs between file systems
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+        return true;
+    }
+
+    std::ifstream list_file{ path };
+    if (!list_file)
+        return false;
+
+    std::string line;
+    while (std::getline(list_file, line))
+    {
+        // Trim spaces and a carriage return
+        const size_t first{ line.find_first_not_of(" \t\r") };
+        if (first == std::string::npos)
+            continue;
+
+        const size_t last{ line.find_last_not_of(" \t\r") };
+        paths.push_back(line.substr(first, last - first + 1));
+    }
+
+    return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+/**
+ * @brief Outcome of running one program in a batch.
+ */
+class BatchResult
+{
+public:
+    std::string path;
+    // Whether the program executed halt
+    bool halted;
+    // Error that stopped the program, empty if it halted
+    std::string error;
+    // Line of the error, -1 if it is not tied to a line
+    int32_t error_line;
+    // Number of instructions executed
+    int64_t instruction_count;
+    // Registers when the program stopped
+    int32_t registers[32];
+    // Profile as folded stacks under the path of the program, if profiling
+    // is enabled
+    std::string folded_profile;
+};
+
+
+/**
+ * @brief Runs many programs in execution mode, in parallel.
+ *
+ * Every thread loads its programs into one simulator of its own, and a
+ * program's result depends on nothing but its source, so results are the
+ * same for any number of threads.
+ */
+class BatchRunner
+{
+    // Engine every program is run with, one of ENGINE_*
+    int32_t m_engine;
+    // Number of threads programs are run on
+    int32_t m_thread_count;
+    // Directory of program images, empty if they are not used
+    std::string m_cache_directory;
+    bool m_rebuild_cache;
+    // Whether every program is profiled
+    bool m_profile;
+    // Memory given to every program, in bytes
+    int32_t m_stack_size;
+    int32_t m_heap_size;
+    // Wall clock time taken by the last call to run(), in seconds
+    double m_elapsed_seconds;
+
+public:
+    /**
+     * @brief Create a runner.
+     *
+     * @param engine One of ENGINE_*.
+     * @param thread_count Number of threads, 0 for one per hardware thread.
+    */
+    BatchRunner(int32_t engine, int32_t thread_count);
+
+    /**
+     * @brief Use program images, as MIPSSimulator::enable_cache() does.
+     * @param directory
+     * @param rebuild
+    */
+    void enable_cache(const std::string &directory, bool rebuild);
+
+    /**
+     * @brief Profile every program, and return the profile with its result.
+    */
+    void enable_profile();
+
+    /**
+     * @brief Set the memory of every program, as
+     *        MIPSSimulator::set_memory_size() does.
+     * @param stack_size
+     * @param heap_size
+    */
+    void set_memory_size(int32_t stack_size, int32_t heap_size);
+
+    /**
+     * @brief Run every program.
+     *
+     * @param paths
+     * @return One result per program, in the order of paths.
+    */
+    std::vector<BatchResult> run(const std::vector<std::string> &paths);
+
+    /**
+     * @brief Print one line per result, followed by totals and throughput.
+     * @param results Results returned by the last call to run().
+     * @param output
+    */
+    void display_results(
+        const std::vector<BatchResult> &results,
+        std::ostream &output
+    ) const;
+
+    /**
+     * @brief List the programs of a batch.
+     *
+     * @param path A directory, whose .s files are listed in name order, or a
+     *             file with one path per line.
+     * @param paths
+     * @return False if path cannot be read.
+    */
+    static bool find_programs(const std::string &path, std::vector<std::string> &paths);
+};
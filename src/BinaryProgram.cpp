@@ -0,0 +1,696 @@
+#include <BinaryProgram.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+#include <ElfFormat.hpp>
+#include <GuestMemory.hpp>
+#include <Lexer.hpp>
+
+
+namespace
+{
+
+/**
+ * @brief Returns the big-endian word at an offset checked to be inside data.
+ * @param data
+ * @param offset
+*/
+uint32_t read_word(std::string_view data, size_t offset)
+{
+    const auto *bytes{ reinterpret_cast<const uint8_t *>(data.data() + offset) };
+    return uint32_t{ bytes[0] } << 24 | uint32_t{ bytes[1] } << 16
+        | uint32_t{ bytes[2] } << 8 | bytes[3];
+}
+
+
+/**
+ * @brief Returns the big-endian halfword at an offset checked to be inside
+ *        data.
+ * @param data
+ * @param offset
+*/
+uint16_t read_halfword(std::string_view data, size_t offset)
+{
+    const auto *bytes{ reinterpret_cast<const uint8_t *>(data.data() + offset) };
+    return static_cast<uint16_t>(bytes[0] << 8 | bytes[1]);
+}
+
+
+/**
+ * @brief Returns true if count items of size bytes from offset on are
+ *        inside data.
+ * @param data
+ * @param offset
+ * @param count
+ * @param size
+*/
+bool fits(std::string_view data, uint64_t offset, uint64_t count, uint64_t size)
+{
+    return offset <= data.size() && count * size <= data.size() - offset;
+}
+
+
+/**
+ * @brief Append an address as 0x and eight hexadecimal digits.
+ * @param text
+ * @param address
+*/
+void append_address(std::string &text, uint32_t address)
+{
+    char digits[8];
+    const char *end{ std::to_chars(digits, digits + sizeof(digits), address, 16).ptr };
+    const size_t length{ static_cast<size_t>(end - digits) };
+
+    text += "0x";
+    text.append(sizeof(digits) - length, '0');
+    text.append(digits, length);
+}
+
+
+/**
+ * @brief Append a register name with its $.
+ * @param text
+ * @param reg
+*/
+void append_register(std::string &text, int32_t reg)
+{
+    text += '$';
+    text += REGISTER_NAMES[reg];
+}
+
+
+/**
+ * @brief Append a number in decimal.
+ * @param text
+ * @param value
+*/
+void append_number(std::string &text, int32_t value)
+{
+    char digits[16];
+    text.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+}
+
+
+BinaryProgram::BinaryProgram()
+    : m_text_address{}
+    , m_entry_address{}
+    , m_data_address{}
+    , m_has_global_pointer{}
+    , m_global_pointer{}
+{
+}
+
+
+bool BinaryProgram::open(const std::string &path)
+{
+    close();
+
+    if (path.ends_with(".s") || !m_file.open(path))
+        return false;
+
+    const std::string_view image{ m_file.contents() };
+    if (path.ends_with(".bin")
+        || (image.size() >= sizeof(ELF_MAGIC)
+            && std::memcmp(image.data(), ELF_MAGIC, sizeof(ELF_MAGIC)) == 0))
+        return true;
+
+    m_file.close();
+    return false;
+}
+
+
+const char *BinaryProgram::read()
+{
+    const std::string_view image{ m_file.contents() };
+
+    m_text = {};
+    m_text_address = 0;
+    m_entry_address = 0;
+    m_data_address = 0;
+    m_data.clear();
+    m_has_global_pointer = false;
+    m_global_pointer = 0;
+    m_symbols.clear();
+
+    if (image.size() >= sizeof(ELF_MAGIC)
+        && std::memcmp(image.data(), ELF_MAGIC, sizeof(ELF_MAGIC)) == 0)
+        return read_elf();
+
+    // A raw image is nothing but code, starting at address 0
+    if (image.size() % 4 != 0)
+        return "Image size is not a multiple of 4.";
+    if (image.size() > MAX_MEMORY_SIZE)
+        return "Program does not fit in memory.";
+
+    m_text = image;
+    return nullptr;
+}
+
+
+const char *BinaryProgram::read_elf()
+{
+    const std::string_view image{ m_file.contents() };
+
+    if (image.size() < ELF_HEADER_SIZE)
+        return "Executable is truncated.";
+    if (static_cast<uint8_t>(image[4]) != ELF_CLASS_32)
+        return "Only 32-bit executables are supported.";
+    if (static_cast<uint8_t>(image[5]) != ELF_DATA_BIG_ENDIAN)
+        return "Only big-endian executables are supported.";
+    if (read_halfword(image, 18) != ELF_MACHINE_MIPS)
+        return "Executable is not for MIPS.";
+    if (read_halfword(image, 16) != ELF_TYPE_EXECUTABLE)
+        return "Only statically linked executables are supported.";
+
+    m_entry_address = read_word(image, 24);
+    const uint32_t header_offset{ read_word(image, 28) };
+    const uint16_t header_size{ read_halfword(image, 42) };
+    const uint16_t header_count{ read_halfword(image, 44) };
+
+    if (header_size < PROGRAM_HEADER_SIZE || !fits(image, header_offset, header_count, header_size))
+        return "Executable is truncated.";
+
+    // The executable segment is the code, every other one is data
+    bool has_text{};
+    uint64_t data_start{ UINT64_MAX };
+    uint64_t data_end{};
+
+    for (uint32_t i{}; i < header_count; i++)
+    {
+        const size_t header{ header_offset + size_t{ i } * header_size };
+        const uint32_t type{ read_word(image, header) };
+        const uint32_t offset{ read_word(image, header + 4) };
+        const uint32_t address{ read_word(image, header + 8) };
+        const uint32_t file_size{ read_word(image, header + 16) };
+        const uint32_t memory_size{ read_word(image, header + 20) };
+        const uint32_t flags{ read_word(image, header + 24) };
+
+        if (type == SEGMENT_DYNAMIC || type == SEGMENT_INTERPRETER)
+            return "Only statically linked executables are supported.";
+        if (type != SEGMENT_LOAD || memory_size == 0)
+            continue;
+        if (!fits(image, offset, file_size, 1) || file_size > memory_size)
+            return "Executable is truncated.";
+
+        if ((flags & SEGMENT_EXECUTABLE) != 0)
+        {
+            if (has_text)
+                return "Executable has more than one code segment.";
+            if (address % 4 != 0)
+                return "Code is not aligned to 4 bytes.";
+
+            has_text = true;
+            m_text = image.substr(offset, file_size & ~3u);
+            m_text_address = address;
+            continue;
+        }
+
+        data_start = std::min<uint64_t>(data_start, address & ~3u);
+        data_end = std::max<uint64_t>(data_end, (uint64_t{ address } + memory_size + 3) & ~uint64_t{ 3 });
+    }
+
+    if (!has_text)
+        return "Executable has no code.";
+    if (m_entry_address - m_text_address >= m_text.size() || m_entry_address % 4 != 0)
+        return "Entry point is outside the code.";
+
+    if (data_end > data_start)
+    {
+        if (data_end - data_start > MAX_MEMORY_SIZE || data_end > INT32_MAX)
+            return "Program does not fit in memory.";
+
+        m_data_address = static_cast<uint32_t>(data_start);
+        m_data.assign(static_cast<size_t>((data_end - data_start) / 4), 0);
+
+        // Bytes past the end of the file part of a segment stay 0, as .bss
+        auto *words{ reinterpret_cast<uint32_t *>(m_data.data()) };
+        for (uint32_t i{}; i < header_count; i++)
+        {
+            const size_t header{ header_offset + size_t{ i } * header_size };
+            if (read_word(image, header) != SEGMENT_LOAD
+                || (read_word(image, header + 24) & SEGMENT_EXECUTABLE) != 0)
+                continue;
+
+            const uint32_t offset{ read_word(image, header + 4) };
+            const uint32_t address{ read_word(image, header + 8) };
+            const uint32_t file_size{ read_word(image, header + 16) };
+
+            for (uint32_t byte{}; byte < file_size; byte++)
+            {
+                const uint32_t position{ address + byte - m_data_address };
+                words[position / 4] |= uint32_t{ static_cast<uint8_t>(image[offset + byte]) }
+                    << (8 * (3 - position % 4));
+            }
+        }
+    }
+
+    read_symbols();
+    return nullptr;
+}
+
+
+void BinaryProgram::read_symbols()
+{
+    const std::string_view image{ m_file.contents() };
+    const uint32_t header_offset{ read_word(image, 32) };
+    const uint16_t header_size{ read_halfword(image, 46) };
+    const uint16_t header_count{ read_halfword(image, 48) };
+
+    // Stripped executables have no symbols, which only cost the names
+    if (header_size < SECTION_HEADER_SIZE || !fits(image, header_offset, header_count, header_size))
+        return;
+
+    const uint64_t data_end{ uint64_t{ m_data_address } + 4 * m_data.size() };
+
+    for (uint32_t i{}; i < header_count; i++)
+    {
+        const size_t header{ header_offset + size_t{ i } * header_size };
+        if (read_word(image, header + 4) != SECTION_SYMBOL_TABLE)
+            continue;
+
+        const uint32_t offset{ read_word(image, header + 16) };
+        const uint32_t size{ read_word(image, header + 20) };
+        const uint32_t names_section{ read_word(image, header + 24) };
+        if (names_section >= header_count || !fits(image, offset, size / SYMBOL_SIZE, SYMBOL_SIZE))
+            return;
+
+        const size_t names_header{ header_offset + size_t{ names_section } * header_size };
+        const uint32_t names_offset{ read_word(image, names_header + 16) };
+        const uint32_t names_size{ read_word(image, names_header + 20) };
+        if (!fits(image, names_offset, names_size, 1))
+            return;
+        const std::string_view names{ image.substr(names_offset, names_size) };
+
+        for (uint32_t symbol{ offset }; symbol + SYMBOL_SIZE <= offset + size; symbol += SYMBOL_SIZE)
+        {
+            const uint32_t name_offset{ read_word(image, symbol) };
+            const uint32_t address{ read_word(image, symbol + 4) };
+            const uint8_t type{ static_cast<uint8_t>(image[symbol + 12] & 0xF) };
+            const uint16_t section{ read_halfword(image, symbol + 14) };
+
+            if (name_offset >= names.size())
+                continue;
+            std::string_view name{ names.substr(name_offset) };
+            name = name.substr(0, name.find('\0'));
+
+            if (name == "_gp")
+            {
+                m_has_global_pointer = true;
+                m_global_pointer = static_cast<int32_t>(address);
+            }
+
+            if (name.empty() || section == SECTION_UNDEFINED
+                || (type != SYMBOL_NO_TYPE && type != SYMBOL_OBJECT && type != SYMBOL_FUNCTION))
+                continue;
+
+            if (type != SYMBOL_OBJECT && line_of(address) >= 0 && address - m_text_address < m_text.size())
+                m_symbols.push_back(BinarySymbol{ name, address, true });
+            else if (type != SYMBOL_FUNCTION && address >= m_data_address && address < data_end)
+                m_symbols.push_back(BinarySymbol{ name, address, false });
+        }
+
+        std::stable_sort(
+            m_symbols.begin(),
+            m_symbols.end(),
+            [](const BinarySymbol &a, const BinarySymbol &b) { return a.address < b.address; }
+        );
+        return;
+    }
+}
+
+
+void BinaryProgram::close()
+{
+    m_file.close();
+    m_text = {};
+    m_data.clear();
+    m_symbols.clear();
+}
+
+
+std::string_view BinaryProgram::contents() const
+{
+    return m_file.contents();
+}
+
+
+int32_t BinaryProgram::line_count() const
+{
+    return static_cast<int32_t>(m_text.size() / 4);
+}
+
+
+uint32_t BinaryProgram::text_address() const
+{
+    return m_text_address;
+}
+
+
+int32_t BinaryProgram::entry_line() const
+{
+    return static_cast<int32_t>((m_entry_address - m_text_address) / 4);
+}
+
+
+uint32_t BinaryProgram::data_address() const
+{
+    return m_data_address;
+}
+
+
+const std::vector<int32_t> &BinaryProgram::data() const
+{
+    return m_data;
+}
+
+
+bool BinaryProgram::has_global_pointer() const
+{
+    return m_has_global_pointer;
+}
+
+
+int32_t BinaryProgram::global_pointer() const
+{
+    return m_global_pointer;
+}
+
+
+const std::vector<BinarySymbol> &BinaryProgram::symbols() const
+{
+    return m_symbols;
+}
+
+
+uint32_t BinaryProgram::word(int32_t line) const
+{
+    return read_word(m_text, 4 * static_cast<size_t>(line));
+}
+
+
+int32_t BinaryProgram::line_of(uint32_t address) const
+{
+    const uint32_t offset{ address - m_text_address };
+
+    if (offset % 4 != 0 || offset / 4 > static_cast<uint32_t>(line_count()))
+        return -1;
+
+    return static_cast<int32_t>(offset / 4);
+}
+
+
+int32_t BinaryProgram::fold_expansion(int32_t line, Instruction &instruction) const
+{
+    // Every expansion starts with lui $at, upper
+    if (line + 1 >= line_count() || word(line) >> 16 != (0x0Fu << 10 | ASSEMBLER_REGISTER))
+        return 0;
+
+    const uint32_t upper{ word(line) << 16 };
+    const uint32_t second{ word(line + 1) };
+    Instruction last{};
+
+    // ori $at, $at, lower, then an R-format operation reading $at as rt
+    if (second >> 16 == (0x0Du << 10 | ASSEMBLER_REGISTER << 5 | ASSEMBLER_REGISTER))
+    {
+        if (line + 2 >= line_count() || decode_word(line + 2, last) != nullptr
+            || last.r[0] == ASSEMBLER_REGISTER || last.r[1] == ASSEMBLER_REGISTER
+            || last.r[2] != ASSEMBLER_REGISTER)
+            return 0;
+
+        const int32_t value{ static_cast<int32_t>(upper | (second & 0xFFFF)) };
+        constexpr int32_t EXPANDED[][2]{
+            { OPERATION_ADD, OPERATION_ADDI }, { OPERATION_AND, OPERATION_ANDI },
+            { OPERATION_OR, OPERATION_ORI }, { OPERATION_SLT, OPERATION_SLTI },
+            { OPERATION_ADDU, OPERATION_ADDIU }, { OPERATION_XOR, OPERATION_XORI },
+            { OPERATION_SLTU, OPERATION_SLTIU }
+        };
+        for (const auto &[expanded, operation] : EXPANDED)
+            if (last.operation == expanded)
+            {
+                instruction = Instruction{ operation, { last.r[0], last.r[1], value } };
+                return 3;
+            }
+        return 0;
+    }
+
+    // addu $at, $at, base, then a load or store through $at
+    int32_t base{};
+    int32_t length{ 2 };
+    if (second >> 26 == 0 && (second & 0xFFFF) == (ASSEMBLER_REGISTER << 11 | 0x21)
+        && (second >> 21 & 31) == ASSEMBLER_REGISTER)
+    {
+        base = static_cast<int32_t>(second >> 16 & 31);
+        length = 3;
+        if (base == 0 || base == ASSEMBLER_REGISTER)
+            return 0;
+    }
+
+    if (line + length > line_count() || decode_word(line + length - 1, last) != nullptr)
+        return 0;
+
+    const int32_t operation{ last.operation };
+    if (!is_memory_access(operation)
+        || last.r[0] == ASSEMBLER_REGISTER || last.r[1] != ASSEMBLER_REGISTER)
+        return 0;
+
+    instruction = Instruction{
+        operation,
+        { last.r[0], base, static_cast<int32_t>(upper + static_cast<uint32_t>(last.r[2])) }
+    };
+    return length;
+}
+
+
+const char *BinaryProgram::decode(int32_t line, Instruction &instruction) const
+{
+    // A line may be the end of an expansion that started up to two lines
+    // earlier, or a word before its end, which is left blank
+    for (int32_t start{ std::max(line - 2, 0) }; start <= line; start++)
+    {
+        Instruction folded{};
+        const int32_t length{ fold_expansion(start, folded) };
+
+        if (start + length - 1 == line)
+        {
+            instruction = folded;
+            return nullptr;
+        }
+        if (start + length > line)
+        {
+            instruction = Instruction{ .operation = OPERATION_BLANK, .r = {} };
+            return nullptr;
+        }
+    }
+
+    return decode_word(line, instruction);
+}
+
+
+const char *BinaryProgram::decode_word(int32_t line, Instruction &instruction) const
+{
+    const uint32_t word{ this->word(line) };
+    const int32_t rs{ static_cast<int32_t>(word >> 21 & 31) };
+    const int32_t rt{ static_cast<int32_t>(word >> 16 & 31) };
+    const int32_t rd{ static_cast<int32_t>(word >> 11 & 31) };
+    const int32_t shift{ static_cast<int32_t>(word >> 6 & 31) };
+    const int32_t immediate{ static_cast<int16_t>(word & 0xFFFF) };
+    const int32_t unsigned_immediate{ static_cast<int32_t>(word & 0xFFFF) };
+
+    // Without delay slots, branches are relative to the next word
+    const int32_t branch_line{ line + 1 + immediate };
+    const bool valid_branch{ 0 <= branch_line && branch_line <= line_count() };
+    // Jumps keep the top four bits of the address of the next word
+    const uint32_t jump_address{
+        ((m_text_address + 4 * static_cast<uint32_t>(line) + 4) & 0xF000'0000u)
+        | (word & 0x03FF'FFFFu) << 2
+    };
+
+    auto set = [&instruction](int32_t operation, int32_t r0, int32_t r1, int32_t r2)
+    {
+        instruction = Instruction{ operation, { r0, r1, r2 } };
+        return nullptr;
+    };
+
+    switch (word >> 26)
+    {
+    // SPECIAL, chosen by the function field
+    case 0x00:
+        switch (word & 63)
+        {
+        case 0x00:
+            // sll $zero, $zero, n are nop, ssnop and ehb
+            if (rd == 0 && rt == 0)
+                return set(OPERATION_NOP, 0, 0, 0);
+            return set(OPERATION_SLL, rd, rt, shift);
+        case 0x02: return set(OPERATION_SRL, rd, rt, shift);
+        case 0x03: return set(OPERATION_SRA, rd, rt, shift);
+        case 0x04: return set(OPERATION_SLLV, rd, rt, rs);
+        case 0x06: return set(OPERATION_SRLV, rd, rt, rs);
+        case 0x07: return set(OPERATION_SRAV, rd, rt, rs);
+        case 0x08: return set(OPERATION_JR, rs, 0, 0);
+        case 0x09:
+            if (rd != 31)
+                return "Only jalr with $ra is supported.";
+            return set(OPERATION_JALR, rs, 0, 0);
+        case 0x0C: return set(OPERATION_SYSCALL, 0, 0, 0);
+        // break stops the program like halt
+        case 0x0D: return set(OPERATION_HALT, 0, 0, 0);
+        case 0x10: return set(OPERATION_MFHI, rd, 0, 0);
+        case 0x11: return set(OPERATION_MTHI, rs, 0, 0);
+        case 0x12: return set(OPERATION_MFLO, rd, 0, 0);
+        case 0x13: return set(OPERATION_MTLO, rs, 0, 0);
+        case 0x18: return set(OPERATION_MULT, rs, rt, 0);
+        case 0x19: return set(OPERATION_MULTU, rs, rt, 0);
+        case 0x1A: return set(OPERATION_DIV, rs, rt, 0);
+        case 0x1B: return set(OPERATION_DIVU, rs, rt, 0);
+        case 0x20: return set(OPERATION_ADD, rd, rs, rt);
+        case 0x21: return set(OPERATION_ADDU, rd, rs, rt);
+        case 0x22: return set(OPERATION_SUB, rd, rs, rt);
+        case 0x23: return set(OPERATION_SUBU, rd, rs, rt);
+        case 0x24: return set(OPERATION_AND, rd, rs, rt);
+        case 0x25: return set(OPERATION_OR, rd, rs, rt);
+        case 0x26: return set(OPERATION_XOR, rd, rs, rt);
+        case 0x27: return set(OPERATION_NOR, rd, rs, rt);
+        case 0x2A: return set(OPERATION_SLT, rd, rs, rt);
+        case 0x2B: return set(OPERATION_SLTU, rd, rs, rt);
+        }
+        break;
+    // REGIMM, chosen by the rt field
+    case 0x01:
+        if (rt > 1)
+            break;
+        if (!valid_branch)
+            return "Branch target is outside the code.";
+        return set(rt == 0 ? OPERATION_BLTZ : OPERATION_BGEZ, rs, 0, branch_line);
+    case 0x02:
+    case 0x03:
+        if (line_of(jump_address) < 0)
+            return "Jump target is outside the code.";
+        return set(word >> 26 == 0x02 ? OPERATION_J : OPERATION_JAL, line_of(jump_address), 0, 0);
+    case 0x04:
+    case 0x05:
+    case 0x06:
+    case 0x07:
+        if (!valid_branch)
+            return "Branch target is outside the code.";
+        if (word >> 26 == 0x04)
+            return set(OPERATION_BEQ, rs, rt, branch_line);
+        if (word >> 26 == 0x05)
+            return set(OPERATION_BNE, rs, rt, branch_line);
+        return set(word >> 26 == 0x06 ? OPERATION_BLEZ : OPERATION_BGTZ, rs, 0, branch_line);
+    case 0x08: return set(OPERATION_ADDI, rt, rs, immediate);
+    case 0x09: return set(OPERATION_ADDIU, rt, rs, immediate);
+    case 0x0A: return set(OPERATION_SLTI, rt, rs, immediate);
+    case 0x0B: return set(OPERATION_SLTIU, rt, rs, immediate);
+    // Logical immediates are zero-extended
+    case 0x0C: return set(OPERATION_ANDI, rt, rs, unsigned_immediate);
+    case 0x0D: return set(OPERATION_ORI, rt, rs, unsigned_immediate);
+    case 0x0E: return set(OPERATION_XORI, rt, rs, unsigned_immediate);
+    case 0x0F: return set(OPERATION_LUI, rt, 0, unsigned_immediate);
+    // SPECIAL2, of which only mul is supported
+    case 0x1C:
+        if ((word & 63) == 0x02)
+            return set(OPERATION_MUL, rd, rs, rt);
+        break;
+    case 0x20: return set(OPERATION_LB, rt, rs, immediate);
+    case 0x21: return set(OPERATION_LH, rt, rs, immediate);
+    case 0x23: return set(OPERATION_LW, rt, rs, immediate);
+    case 0x24: return set(OPERATION_LBU, rt, rs, immediate);
+    case 0x25: return set(OPERATION_LHU, rt, rs, immediate);
+    case 0x28: return set(OPERATION_SB, rt, rs, immediate);
+    case 0x29: return set(OPERATION_SH, rt, rs, immediate);
+    case 0x2B: return set(OPERATION_SW, rt, rs, immediate);
+    }
+
+    return "Unsupported instruction word.";
+}
+
+
+std::string BinaryProgram::disassemble() const
+{
+    std::string text;
+    text.reserve(static_cast<size_t>(line_count()) * 24);
+
+    for (int32_t line{}; line < line_count(); line++)
+    {
+        Instruction instruction{};
+        if (decode_word(line, instruction) != nullptr)
+        {
+            text += ".word ";
+            append_address(text, word(line));
+            text += '\n';
+            continue;
+        }
+
+        const int32_t operation{ instruction.operation };
+        const int32_t *r{ instruction.r };
+        const uint32_t target{ m_text_address + 4 * static_cast<uint32_t>(r[2]) };
+
+        text += INSTRUCTION_NAMES[operation];
+        text += ' ';
+
+        // Same operand order as the assembler
+        if (is_register_format(operation))
+        {
+            append_register(text, r[0]);
+            text += ", ";
+            append_register(text, r[1]);
+            text += ", ";
+            append_register(text, r[2]);
+        } else if (is_immediate_format(operation))
+        {
+            append_register(text, r[0]);
+            text += ", ";
+            append_register(text, r[1]);
+            text += ", ";
+            append_number(text, r[2]);
+        } else if (is_memory_access(operation))
+        {
+            append_register(text, r[0]);
+            text += ", ";
+            append_number(text, r[2]);
+            text += '(';
+            append_register(text, r[1]);
+            text += ')';
+        } else if (operation == OPERATION_BEQ || operation == OPERATION_BNE)
+        {
+            append_register(text, r[0]);
+            text += ", ";
+            append_register(text, r[1]);
+            text += ", ";
+            append_address(text, target);
+        } else if (operation == OPERATION_J || operation == OPERATION_JAL)
+        {
+            append_address(text, m_text_address + 4 * static_cast<uint32_t>(r[0]));
+        } else if (operation == OPERATION_LUI)
+        {
+            append_register(text, r[0]);
+            text += ", ";
+            append_number(text, r[2]);
+        } else if (is_multiply_divide(operation))
+        {
+            append_register(text, r[0]);
+            text += ", ";
+            append_register(text, r[1]);
+        } else if ((OPERATION_MFHI <= operation && operation <= OPERATION_MTLO) || is_register_jump(operation))
+        {
+            append_register(text, r[0]);
+        } else if (is_zero_branch(operation))
+        {
+            append_register(text, r[0]);
+            text += ", ";
+            append_address(text, target);
+        }
+
+        // halt, syscall and nop have no operands
+        if (text.back() == ' ')
+            text.pop_back();
+        text += '\n';
+    }
+
+    return text;
+}
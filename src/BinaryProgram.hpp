@@ -0,0 +1,197 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include <Instruction.hpp>
+#include <MappedFile.hpp>
+
+/**
+ * @brief A symbol of an ELF executable: a function or label in the code, or
+ *        a variable in the data section.
+ */
+struct BinarySymbol
+{
+    // View into the file
+    std::string_view name;
+    uint32_t address;
+    // Whether the symbol is in the code rather than the data section
+    bool code;
+};
+
+/**
+ * @brief Machine-code program: a raw image of big-endian instruction words
+ *        starting at address 0, or a statically linked big-endian MIPS32 ELF
+ *        executable.
+ *
+ * The file is memory mapped and instruction words are read from it in
+ * place. Words are decoded straight into Instruction records, with line i
+ * holding the word at text_address() + 4 * i. There are no branch delay
+ * slots: branches and jumps take effect before the next word, so code must
+ * be built with nothing but nops in its delay slots.
+ */
+class BinaryProgram
+{
+    // Contents of the file
+    MappedFile m_file;
+    // Instruction words, big-endian, a view into the file
+    std::string_view m_text;
+    // Address of the first instruction word and of the entry point
+    uint32_t m_text_address;
+    uint32_t m_entry_address;
+    // Address of the data section and its words in host byte order, with
+    // bytes big-endian within each word
+    uint32_t m_data_address;
+    std::vector<int32_t> m_data;
+    // Value of _gp, if the executable defines it
+    bool m_has_global_pointer;
+    int32_t m_global_pointer;
+    // Functions, labels and variables, from the symbol table
+    std::vector<BinarySymbol> m_symbols;
+
+    /**
+     * @brief Read the segments and symbols of an ELF executable.
+     * @return nullptr, or why the file cannot be loaded.
+    */
+    const char *read_elf();
+
+    /**
+     * @brief Read the symbol table of an ELF executable, if it has one.
+    */
+    void read_symbols();
+
+    /**
+     * @brief Returns the line of an address in the code, or -1 if the
+     *        address is not an aligned word of the code, nor the address
+     *        right after it.
+     * @param address
+    */
+    int32_t line_of(uint32_t address) const;
+
+    /**
+     * @brief Decode the instruction word at a line on its own.
+     *
+     * @param line
+     * @param instruction
+     * @return nullptr, or why the word cannot be executed, in which case
+     *         instruction is left as it was.
+    */
+    const char *decode_word(int32_t line, Instruction &instruction) const;
+
+    /**
+     * @brief Recognize the sequence ProgramAssembler expands an instruction
+     *        to through $at, when its immediate or offset does not fit in 16
+     *        bits: lui $at and ori $at followed by an R-format operation
+     *        reading $at, or lui $at and possibly addu $at followed by a
+     *        load or store through $at.
+     *
+     * @param line First line of the sequence.
+     * @param instruction Set to the instruction the sequence stands for.
+     * @return The number of words in the sequence, or 0 if there is none.
+    */
+    int32_t fold_expansion(int32_t line, Instruction &instruction) const;
+
+public:
+    BinaryProgram();
+
+    BinaryProgram(const BinaryProgram&) = delete;
+    BinaryProgram& operator=(const BinaryProgram&) = delete;
+
+    /**
+     * @brief Map a file, replacing the current program, if it holds machine
+     *        code: if it starts with the ELF magic number or its name ends
+     *        in ".bin". Assembly files ending in ".s" are never opened.
+     *
+     * @param path
+     * @return False if the file could not be read or holds assembly.
+    */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Read the code, data and entry point of the opened file.
+     * @return nullptr, or why the file cannot be loaded.
+    */
+    const char *read();
+
+    /**
+     * @brief Release the file.
+    */
+    void close();
+
+    /**
+     * @brief Returns the whole file.
+    */
+    std::string_view contents() const;
+
+    /**
+     * @brief Returns the number of instruction words.
+    */
+    int32_t line_count() const;
+
+    /**
+     * @brief Returns the address of the first instruction word.
+    */
+    uint32_t text_address() const;
+
+    /**
+     * @brief Returns the line execution starts at.
+    */
+    int32_t entry_line() const;
+
+    /**
+     * @brief Returns the address of the data section, 0 if there is none.
+    */
+    uint32_t data_address() const;
+
+    /**
+     * @brief Returns the words of the data section.
+    */
+    const std::vector<int32_t> &data() const;
+
+    /**
+     * @brief Returns true if the executable defines _gp, the value of $gp.
+    */
+    bool has_global_pointer() const;
+
+    /**
+     * @brief Returns the value of _gp.
+    */
+    int32_t global_pointer() const;
+
+    /**
+     * @brief Returns every symbol with a name, sorted by address.
+    */
+    const std::vector<BinarySymbol> &symbols() const;
+
+    /**
+     * @brief Returns the instruction word at a line.
+     * @param line
+    */
+    uint32_t word(int32_t line) const;
+
+    /**
+     * @brief Decode the instruction word at a line into the record the
+     *        assembler would produce for the same instruction.
+     *
+     * A sequence that builds an immediate or an address in $at decodes as
+     * the single instruction it stands for, on its last line, with blank
+     * lines before it. Programs cannot use $at otherwise, so this changes
+     * nothing but the instruction count, which then matches the assembly.
+     *
+     * @param line
+     * @param instruction
+     * @return nullptr, or why the word cannot be executed, in which case
+     *         instruction is left as it was.
+    */
+    const char *decode(int32_t line, Instruction &instruction) const;
+
+    /**
+     * @brief Returns the assembly text of every line, one per line, with
+     *        branch and jump targets as addresses. Words that cannot be
+     *        decoded are shown as .word directives, and sequences through
+     *        $at word by word.
+    */
+    std::string disassemble() const;
+};
@@ -0,0 +1,331 @@
+#include <BranchPredictor.hpp>
+#include <ReportFormat.hpp>
+
+#include <algorithm>
+#include <string>
+
+
+namespace
+{
+
+// Names of the predictors, as the command line and display() write them
+constexpr const char *KIND_NAMES[]{ "taken", "btfn", "1bit", "2bit", "gshare", "tournament" };
+
+// Largest tables and history, 16 MiB of counters
+constexpr int32_t MAX_TABLE_BITS{ 24 };
+
+// Two-bit counters predict taken from this value up, and start one below
+constexpr uint8_t COUNTER_TAKEN{ 2 };
+constexpr uint8_t COUNTER_MAX{ 3 };
+
+
+/**
+ * @brief Move a two-bit saturating counter towards a direction.
+ * @param counter
+ * @param taken
+*/
+void train(uint8_t &counter, bool taken)
+{
+    if (taken && counter < COUNTER_MAX)
+        counter++;
+    else if (!taken && counter > 0)
+        counter--;
+}
+
+}
+
+
+BranchPredictor::BranchPredictor(const PredictorConfig &config)
+    : m_config{ config }
+    , m_table_mask{ (uint32_t{ 1 } << config.table_bits) - 1 }
+    , m_history_mask{ (uint32_t{ 1 } << config.history_bits) - 1 }
+    , m_history{}
+    , m_direction_misses{}
+    , m_target_misses{}
+{
+    const size_t entries{ size_t{ 1 } << config.table_bits };
+
+    if (config.kind >= PREDICT_ONE_BIT)
+        m_local.resize(entries);
+    if (config.kind >= PREDICT_GSHARE)
+        m_global.resize(entries);
+    if (config.kind == PREDICT_TOURNAMENT)
+        m_chooser.resize(entries);
+    m_btb_tags.resize(config.btb_entries);
+    m_btb_targets.resize(config.btb_entries);
+    reset(0);
+}
+
+
+const char *BranchPredictor::validate(const PredictorConfig &config)
+{
+    if (config.table_bits < 1 || config.table_bits > MAX_TABLE_BITS)
+        return "Predictor tables must have 2 to 2^24 entries.";
+    // Older branches would not change the index
+    if (config.history_bits < 0 || config.history_bits > config.table_bits)
+        return "Global history cannot be longer than the table index.";
+    if (config.btb_entries < 0 || (config.btb_entries & (config.btb_entries - 1)) != 0)
+        return "Branch target buffer entries must be 0 or a power of two.";
+
+    return nullptr;
+}
+
+
+const char *BranchPredictor::kind_name(int32_t kind)
+{
+    return KIND_NAMES[kind];
+}
+
+
+void BranchPredictor::reset(int32_t line_count)
+{
+    // Counters start weakly not taken, the chooser weakly for the
+    // two-bit table, which learns faster
+    const uint8_t initial{ m_config.kind == PREDICT_ONE_BIT ? uint8_t{} : uint8_t{ COUNTER_TAKEN - 1 } };
+    std::fill(m_local.begin(), m_local.end(), initial);
+    std::fill(m_global.begin(), m_global.end(), uint8_t{ COUNTER_TAKEN - 1 });
+    std::fill(m_chooser.begin(), m_chooser.end(), uint8_t{ COUNTER_TAKEN - 1 });
+    m_history = 0;
+
+    std::fill(m_btb_tags.begin(), m_btb_tags.end(), 0);
+    std::fill(m_btb_targets.begin(), m_btb_targets.end(), 0);
+
+    m_lines.assign(line_count, PredictorLine{});
+    m_direction_misses = 0;
+    m_target_misses = 0;
+}
+
+
+bool BranchPredictor::predict_direction(uint32_t address, bool backward, bool taken)
+{
+    const uint32_t index{ (address >> 2) & m_table_mask };
+    const uint32_t shared{ ((address >> 2) ^ m_history) & m_table_mask };
+    bool prediction{};
+
+    switch (m_config.kind)
+    {
+    case PREDICT_TAKEN:
+        prediction = true;
+        break;
+    case PREDICT_BTFN:
+        prediction = backward;
+        break;
+    case PREDICT_ONE_BIT:
+        prediction = m_local[index] != 0;
+        m_local[index] = taken ? 1 : 0;
+        break;
+    case PREDICT_TWO_BIT:
+        prediction = m_local[index] >= COUNTER_TAKEN;
+        train(m_local[index], taken);
+        break;
+    case PREDICT_GSHARE:
+        prediction = m_global[shared] >= COUNTER_TAKEN;
+        train(m_global[shared], taken);
+        break;
+    case PREDICT_TOURNAMENT:
+    {
+        const bool local{ m_local[index] >= COUNTER_TAKEN };
+        const bool global{ m_global[shared] >= COUNTER_TAKEN };
+        prediction = m_chooser[index] >= COUNTER_TAKEN ? global : local;
+
+        // The chooser only learns from branches the two disagree on
+        if (local != global)
+            train(m_chooser[index], global == taken);
+        train(m_local[index], taken);
+        train(m_global[shared], taken);
+        break;
+    }
+    }
+
+    m_history = ((m_history << 1) | (taken ? 1 : 0)) & m_history_mask;
+    return prediction;
+}
+
+
+bool BranchPredictor::predict_target(uint32_t address, uint32_t target)
+{
+    if (m_btb_tags.empty())
+        return true;
+
+    const size_t entry{ (address >> 2) & (m_btb_tags.size() - 1) };
+    const bool hit{ m_btb_tags[entry] == address + 1 && m_btb_targets[entry] == target };
+
+    m_btb_tags[entry] = address + 1;
+    m_btb_targets[entry] = target;
+    return hit;
+}
+
+
+void BranchPredictor::add(
+    int32_t line,
+    const Instruction &instruction,
+    int32_t next_line,
+    uint32_t address,
+    uint32_t target
+)
+{
+    const bool taken{ next_line != line + 1 };
+    PredictorLine &misses{ m_lines[line] };
+    bool predicted_taken{ true };
+
+    if (is_conditional_branch(instruction.operation))
+    {
+        predicted_taken = predict_direction(address, instruction.r[2] <= line, taken);
+        if (predicted_taken != taken)
+        {
+            misses.direction_misses++;
+            m_direction_misses++;
+        }
+    }
+
+    // Only taken transfers need a target, and the buffer only learns
+    // those. One predicted taken without its target is a misprediction.
+    if (taken && !predict_target(address, target) && predicted_taken)
+    {
+        misses.target_misses++;
+        m_target_misses++;
+    }
+}
+
+
+const PredictorConfig &BranchPredictor::config() const
+{
+    return m_config;
+}
+
+
+const std::vector<PredictorLine> &BranchPredictor::lines() const
+{
+    return m_lines;
+}
+
+
+int64_t BranchPredictor::direction_misses() const
+{
+    return m_direction_misses;
+}
+
+
+int64_t BranchPredictor::target_misses() const
+{
+    return m_target_misses;
+}
+
+
+BranchPredictorSet::BranchPredictorSet(const std::vector<PredictorConfig> &configs)
+    : m_conditional{}
+    , m_conditional_taken{}
+    , m_jumps{}
+{
+    for (const PredictorConfig &config : configs)
+        m_predictors.emplace_back(config);
+}
+
+
+void BranchPredictorSet::reset(int32_t line_count)
+{
+    for (BranchPredictor &predictor : m_predictors)
+        predictor.reset(line_count);
+
+    m_executions.assign(line_count, 0);
+    m_taken.assign(line_count, 0);
+    m_conditional = 0;
+    m_conditional_taken = 0;
+    m_jumps = 0;
+}
+
+
+void BranchPredictorSet::add(
+    int32_t line,
+    const Instruction &instruction,
+    int32_t next_line,
+    uint32_t address,
+    uint32_t target
+)
+{
+    const bool taken{ next_line != line + 1 };
+
+    m_executions[line]++;
+    if (taken)
+        m_taken[line]++;
+
+    if (is_conditional_branch(instruction.operation))
+    {
+        m_conditional++;
+        if (taken)
+            m_conditional_taken++;
+    } else
+        m_jumps++;
+
+    for (BranchPredictor &predictor : m_predictors)
+        predictor.add(line, instruction, next_line, address, target);
+}
+
+
+const std::vector<BranchPredictor> &BranchPredictorSet::predictors() const
+{
+    return m_predictors;
+}
+
+
+void BranchPredictorSet::display(
+    std::ostream &output,
+    const SourceFile &source,
+    const std::vector<Instruction> &program
+) const
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+    const int64_t transfers{ m_conditional + m_jumps };
+
+    output
+        << "Branch prediction of " << m_conditional << " conditional branches, "
+        << percentage(m_conditional_taken, m_conditional) << " taken, and "
+        << m_jumps << " jumps\n\n";
+    output << "Predictor                               Direction      Target       Total  Accuracy  BTB\n";
+
+    for (const BranchPredictor &predictor : m_predictors)
+    {
+        const PredictorConfig &config{ predictor.config() };
+        std::string name{ BranchPredictor::kind_name(config.kind) };
+        if (config.kind >= PREDICT_ONE_BIT)
+            name += ", " + std::to_string(1 << config.table_bits) + " entries";
+        if (config.kind >= PREDICT_GSHARE)
+            name += ", " + std::to_string(config.history_bits) + " history";
+
+        const int64_t misses{ predictor.direction_misses() + predictor.target_misses() };
+        output << name << std::string(std::max(38 - static_cast<int32_t>(name.size()), 1), ' ');
+        print_column(output, predictor.direction_misses(), 12);
+        print_column(output, predictor.target_misses(), 12);
+        print_column(output, misses, 12);
+        print_column(output, percentage(transfers - misses, transfers), 10);
+        output << "  ";
+        if (config.btb_entries > 0)
+            output << config.btb_entries << " entries\n";
+        else
+            output << "ideal\n";
+    }
+
+    // One accuracy column per predictor, counting both kinds of misses
+    output << "\n       Count    Taken";
+    for (const BranchPredictor &predictor : m_predictors)
+        print_column(output, BranchPredictor::kind_name(predictor.config().kind), 12);
+    output << "   Line  Source\n";
+
+    for (int32_t line{}; line < line_count; line++)
+    {
+        const int64_t executions{ m_executions[line] };
+        if (executions == 0)
+            continue;
+
+        print_column(output, executions, 12);
+        print_column(output, percentage(m_taken[line], executions), 9);
+        for (const BranchPredictor &predictor : m_predictors)
+        {
+            const PredictorLine &misses{ predictor.lines()[line] };
+            const int64_t correct{ executions - misses.direction_misses - misses.target_misses };
+            print_column(output, percentage(correct, executions), 12);
+        }
+        print_column(output, line + 1, 7);
+        output << "  " << source[line] << '\n';
+    }
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <Instruction.hpp>
+#include <SourceFile.hpp>
+
+// Ways to predict the direction of conditional branches
+// Static: always taken
+constexpr int32_t PREDICT_TAKEN{ 0 };
+// Static: backward branches taken, forward branches not taken
+constexpr int32_t PREDICT_BTFN{ 1 };
+// The last direction of the branch, one bit per table entry
+constexpr int32_t PREDICT_ONE_BIT{ 2 };
+// Two-bit saturating counters indexed by the address of the branch
+constexpr int32_t PREDICT_TWO_BIT{ 3 };
+// Two-bit counters indexed by the address xor the global history
+constexpr int32_t PREDICT_GSHARE{ 4 };
+// Two-bit and gshare, with two-bit counters choosing between them for
+// every branch
+constexpr int32_t PREDICT_TOURNAMENT{ 5 };
+
+/**
+ * @brief Kind and sizes of a predictor.
+ */
+struct PredictorConfig
+{
+    // One of PREDICT_*
+    int32_t kind{ PREDICT_TWO_BIT };
+    // Log2 of the entries of each table
+    int32_t table_bits{ 12 };
+    // Conditional branches kept in the global history, for gshare and
+    // tournament
+    int32_t history_bits{ 12 };
+    // Entries of the direct-mapped branch target buffer, a power of two, or
+    // 0 to predict every target correctly
+    int32_t btb_entries{ 512 };
+};
+
+/**
+ * @brief Mispredictions of one line of the program.
+ */
+struct PredictorLine
+{
+    // Conditional branches predicted in the wrong direction
+    int64_t direction_misses;
+    // Transfers correctly predicted taken whose target was not in the
+    // branch target buffer, or was not the one taken
+    int64_t target_misses;
+};
+
+/**
+ * @brief A branch predictor with a branch target buffer, fed with every
+ *        branch and jump the simulator executes.
+ *
+ * Direction is predicted for conditional branches only, jumps are always
+ * taken. The target of a transfer predicted taken comes from the branch
+ * target buffer, which learns the target of every taken one, so jr and
+ * jalr are right when they go where they went the last time.
+ */
+class BranchPredictor
+{
+    PredictorConfig m_config;
+    uint32_t m_table_mask;
+    uint32_t m_history_mask;
+    // Counters indexed by address, which hold single bits for
+    // PREDICT_ONE_BIT, gshare counters, and the counters choosing gshare
+    // over the first table
+    std::vector<uint8_t> m_local;
+    std::vector<uint8_t> m_global;
+    std::vector<uint8_t> m_chooser;
+    // Directions of the last conditional branches, the last one lowest
+    uint32_t m_history;
+    // Address of the transfer in every entry plus one, zero when empty, and
+    // its target
+    std::vector<uint32_t> m_btb_tags;
+    std::vector<uint32_t> m_btb_targets;
+    std::vector<PredictorLine> m_lines;
+    int64_t m_direction_misses;
+    int64_t m_target_misses;
+
+    /**
+     * @brief Returns the predicted direction of a conditional branch, then
+     *        learns the actual one.
+     *
+     * @param address
+     * @param backward Whether the branch goes to an earlier line.
+     * @param taken
+    */
+    bool predict_direction(uint32_t address, bool backward, bool taken);
+
+    /**
+     * @brief Returns true if the branch target buffer holds the target of a
+     *        transfer, then learns it.
+     * @param address
+     * @param target
+    */
+    bool predict_target(uint32_t address, uint32_t target);
+
+public:
+    explicit BranchPredictor(const PredictorConfig &config);
+
+    /**
+     * @brief Returns nullptr if the sizes are valid, otherwise what is wrong.
+     * @param config
+    */
+    static const char *validate(const PredictorConfig &config);
+
+    /**
+     * @brief Returns the name of a kind of predictor, as the command line
+     *        and the report write it.
+     * @param kind One of PREDICT_*.
+    */
+    static const char *kind_name(int32_t kind);
+
+    /**
+     * @brief Forget all history and counts and size them for a program.
+     * @param line_count
+    */
+    void reset(int32_t line_count);
+
+    /**
+     * @brief Predict an executed branch or jump, then learn its outcome.
+     *
+     * @param line
+     * @param instruction Branch or jump.
+     * @param next_line Line executed next.
+     * @param address Address of the line.
+     * @param target Address of the next line.
+    */
+    void add(
+        int32_t line,
+        const Instruction &instruction,
+        int32_t next_line,
+        uint32_t address,
+        uint32_t target
+    );
+
+    /**
+     * @brief Returns the kind and sizes of the predictor.
+    */
+    const PredictorConfig &config() const;
+
+    /**
+     * @brief Returns the mispredictions of every line.
+    */
+    const std::vector<PredictorLine> &lines() const;
+
+    /**
+     * @brief Returns the conditional branches predicted in the wrong
+     *        direction.
+    */
+    int64_t direction_misses() const;
+
+    /**
+     * @brief Returns the transfers predicted taken without their target.
+    */
+    int64_t target_misses() const;
+};
+
+/**
+ * @brief Several predictors fed with the same branches, to compare them in
+ *        one run.
+ */
+class BranchPredictorSet
+{
+    std::vector<BranchPredictor> m_predictors;
+    // Executions of every line that is a branch or jump, and the times it
+    // was taken
+    std::vector<int64_t> m_executions;
+    std::vector<int64_t> m_taken;
+    int64_t m_conditional;
+    int64_t m_conditional_taken;
+    int64_t m_jumps;
+
+public:
+    /**
+     * @param configs Valid configurations, one per predictor.
+    */
+    explicit BranchPredictorSet(const std::vector<PredictorConfig> &configs);
+
+    /**
+     * @brief Forget all history and counts and size them for a program.
+     * @param line_count
+    */
+    void reset(int32_t line_count);
+
+    /**
+     * @brief Pass an executed branch or jump to every predictor.
+     *
+     * @param line
+     * @param instruction Branch or jump.
+     * @param next_line Line executed next.
+     * @param address Address of the line.
+     * @param target Address of the next line.
+    */
+    void add(
+        int32_t line,
+        const Instruction &instruction,
+        int32_t next_line,
+        uint32_t address,
+        uint32_t target
+    );
+
+    /**
+     * @brief Returns the predictors, in the order they were configured.
+    */
+    const std::vector<BranchPredictor> &predictors() const;
+
+    /**
+     * @brief Print the mispredictions and accuracy of every predictor, then
+     *        the accuracy of every predictor on every branch and jump that
+     *        executed.
+     *
+     * @param output
+     * @param source
+     * @param program
+    */
+    void display(
+        std::ostream &output,
+        const SourceFile &source,
+        const std::vector<Instruction> &program
+    ) const;
+};
@@ -0,0 +1,506 @@
+#include <CacheModel.hpp>
+#include <ReportFormat.hpp>
+
+#include <algorithm>
+#include <string>
+
+
+namespace
+{
+
+// Names of the policies, as display() shows them
+constexpr const char *REPLACEMENT_NAMES[]{ "LRU", "FIFO", "random" };
+constexpr const char *WRITE_POLICY_NAMES[]{
+    "write-back, write-allocate",
+    "write-through, no write-allocate"
+};
+
+// Seed of the random replacement sequence
+constexpr uint32_t RANDOM_SEED{ 0x2545'F491 };
+
+
+/**
+ * @brief Returns true if value is a power of two.
+ * @param value
+*/
+bool is_power_of_two(int32_t value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+
+/**
+ * @brief Returns the base two logarithm of a power of two.
+ * @param value
+*/
+int32_t log2(int32_t value)
+{
+    int32_t bits{};
+    while ((1 << bits) < value)
+        bits++;
+    return bits;
+}
+
+
+/**
+ * @brief Print the accesses, misses and miss rate of every region that was
+ *        accessed, most misses first.
+ * @param output
+ * @param counts
+ * @param names Name of every region.
+*/
+void print_regions(
+    std::ostream &output,
+    const std::vector<CacheLine> &counts,
+    const std::vector<std::string> &names
+)
+{
+    std::vector<size_t> order;
+    for (size_t i{}; i < counts.size(); i++)
+        if (counts[i].accesses > 0)
+            order.push_back(i);
+
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [&counts](size_t a, size_t b)
+        {
+            return counts[a].misses > counts[b].misses;
+        }
+    );
+
+    output << "    Accesses      Misses  Miss rate  Label\n";
+    for (const size_t i : order)
+    {
+        print_column(output, counts[i].accesses, 12);
+        print_column(output, counts[i].misses, 12);
+        print_column(output, percentage(counts[i].misses, counts[i].accesses), 11);
+        output << "  " << names[i] << '\n';
+    }
+}
+
+}
+
+
+CacheModel::CacheModel(const CacheConfig &config)
+    : m_config{ config }
+    , m_line_bits{ log2(config.line_size) }
+    , m_set_mask{ config.size / (config.associativity * config.line_size) - 1 }
+    , m_clock{}
+    , m_random{ RANDOM_SEED }
+    , m_shadow_hash_bits{}
+    , m_shadow_used{}
+    , m_shadow_head{ -1 }
+    , m_shadow_tail{ -1 }
+    , m_statistics{}
+{
+    const int32_t line_count{ config.size / config.line_size };
+
+    // At most half of the table is used, which keeps probe sequences short
+    m_shadow_hash_bits = log2(line_count) + 1;
+
+    m_blocks.resize(line_count);
+    m_stamps.resize(line_count);
+    m_dirty.resize(line_count);
+    m_shadow_blocks.resize(line_count);
+    m_shadow_previous.resize(line_count);
+    m_shadow_next.resize(line_count);
+    m_shadow_table.resize(size_t{ 1 } << m_shadow_hash_bits);
+    reset(0);
+}
+
+
+const char *CacheModel::validate(const CacheConfig &config)
+{
+    if (!is_power_of_two(config.size) || !is_power_of_two(config.associativity)
+        || !is_power_of_two(config.line_size))
+        return "Cache sizes must be powers of two.";
+    if (config.line_size < 4)
+        return "Cache lines must hold at least a word.";
+    if (config.associativity > config.size / config.line_size)
+        return "Cache is smaller than one set.";
+
+    return nullptr;
+}
+
+
+void CacheModel::reset(int32_t line_count)
+{
+    std::fill(m_blocks.begin(), m_blocks.end(), 0);
+    std::fill(m_stamps.begin(), m_stamps.end(), 0);
+    std::fill(m_dirty.begin(), m_dirty.end(), 0);
+    m_clock = 0;
+    m_random = RANDOM_SEED;
+    m_seen.clear();
+
+    std::fill(m_shadow_table.begin(), m_shadow_table.end(), 0);
+    m_shadow_used = 0;
+    m_shadow_head = -1;
+    m_shadow_tail = -1;
+
+    m_statistics = CacheStatistics{};
+    m_lines.assign(line_count, CacheLine{});
+    std::fill(m_regions.begin(), m_regions.end(), CacheLine{});
+}
+
+
+void CacheModel::set_regions(const std::vector<ProfileRegion> &regions)
+{
+    std::vector<ProfileRegion> sorted{ regions };
+    std::stable_sort(
+        sorted.begin(),
+        sorted.end(),
+        [](const ProfileRegion &a, const ProfileRegion &b)
+        {
+            return a.first < b.first;
+        }
+    );
+
+    m_region_addresses.clear();
+    m_region_names.clear();
+    for (const auto &[address, name] : sorted)
+    {
+        m_region_addresses.push_back(static_cast<uint32_t>(address));
+        m_region_names.emplace_back(name);
+    }
+    m_regions.assign(sorted.size(), CacheLine{});
+}
+
+
+uint32_t CacheModel::shadow_hash(uint32_t block) const
+{
+    // Fibonacci hashing spreads consecutive blocks over the table
+    return (block * 0x9E37'79B1u) >> (32 - m_shadow_hash_bits);
+}
+
+
+int32_t CacheModel::shadow_find(uint32_t block) const
+{
+    const uint32_t mask{ static_cast<uint32_t>(m_shadow_table.size() - 1) };
+
+    for (uint32_t entry{ shadow_hash(block) }; m_shadow_table[entry] != 0; entry = (entry + 1) & mask)
+        if (m_shadow_blocks[m_shadow_table[entry] - 1] == block)
+            return static_cast<int32_t>(entry);
+
+    return -1;
+}
+
+
+void CacheModel::shadow_erase(int32_t entry)
+{
+    const uint32_t mask{ static_cast<uint32_t>(m_shadow_table.size() - 1) };
+    uint32_t hole{ static_cast<uint32_t>(entry) };
+
+    // An entry may fill the hole unless its probe sequence starts after the
+    // hole, cyclically, up to where it is now
+    for (uint32_t next{ (hole + 1) & mask }; m_shadow_table[next] != 0; next = (next + 1) & mask)
+    {
+        const uint32_t home{ shadow_hash(m_shadow_blocks[m_shadow_table[next] - 1]) };
+        const bool stays{
+            next > hole ? hole < home && home <= next : hole < home || home <= next
+        };
+
+        if (!stays)
+        {
+            m_shadow_table[hole] = m_shadow_table[next];
+            hole = next;
+        }
+    }
+
+    m_shadow_table[hole] = 0;
+}
+
+
+void CacheModel::shadow_touch(int32_t slot)
+{
+    if (slot == m_shadow_head)
+        return;
+
+    // Unlink, then insert at the front
+    const int32_t previous{ m_shadow_previous[slot] };
+    const int32_t next{ m_shadow_next[slot] };
+    if (previous >= 0)
+        m_shadow_next[previous] = next;
+    if (next >= 0)
+        m_shadow_previous[next] = previous;
+    else if (slot == m_shadow_tail)
+        m_shadow_tail = previous;
+
+    m_shadow_previous[slot] = -1;
+    m_shadow_next[slot] = m_shadow_head;
+    if (m_shadow_head >= 0)
+        m_shadow_previous[m_shadow_head] = slot;
+    m_shadow_head = slot;
+    if (m_shadow_tail < 0)
+        m_shadow_tail = slot;
+}
+
+
+bool CacheModel::shadow_access(uint32_t block, bool allocate)
+{
+    const int32_t entry{ shadow_find(block) };
+    if (entry >= 0)
+    {
+        shadow_touch(m_shadow_table[entry] - 1);
+        return true;
+    }
+
+    if (!allocate)
+        return false;
+
+    int32_t slot{};
+    if (m_shadow_used < static_cast<int32_t>(m_shadow_blocks.size()))
+    {
+        // A new slot goes in at the back, and is moved to the front below
+        slot = m_shadow_used++;
+        m_shadow_previous[slot] = m_shadow_tail;
+        m_shadow_next[slot] = -1;
+        if (m_shadow_tail >= 0)
+            m_shadow_next[m_shadow_tail] = slot;
+        m_shadow_tail = slot;
+        if (m_shadow_head < 0)
+            m_shadow_head = slot;
+    } else
+    {
+        slot = m_shadow_tail;
+        shadow_erase(shadow_find(m_shadow_blocks[slot]));
+    }
+
+    m_shadow_blocks[slot] = block;
+    const uint32_t mask{ static_cast<uint32_t>(m_shadow_table.size() - 1) };
+    uint32_t free_entry{ shadow_hash(block) };
+    while (m_shadow_table[free_entry] != 0)
+        free_entry = (free_entry + 1) & mask;
+    m_shadow_table[free_entry] = slot + 1;
+
+    shadow_touch(slot);
+    return false;
+}
+
+
+bool CacheModel::seen(uint32_t block)
+{
+    const size_t word{ block >> 6 };
+    const uint64_t bit{ uint64_t{ 1 } << (block & 63) };
+
+    if (word >= m_seen.size())
+        m_seen.resize(std::max(word + 1, 2 * m_seen.size()));
+
+    const bool before{ (m_seen[word] & bit) != 0 };
+    m_seen[word] |= bit;
+    return before;
+}
+
+
+void CacheModel::access(uint32_t address, bool write, int32_t line)
+{
+    const uint32_t block{ address >> m_line_bits };
+    const uint32_t tag{ block + 1 };
+    const int32_t ways{ m_config.associativity };
+    const size_t first{ static_cast<size_t>(block & m_set_mask) * ways };
+    const bool write_through{ m_config.write_policy == WRITE_THROUGH };
+
+    // Addresses below the first region belong to none
+    CacheLine *region{};
+    const auto next_region{
+        std::upper_bound(m_region_addresses.begin(), m_region_addresses.end(), address)
+    };
+    if (next_region != m_region_addresses.begin())
+    {
+        region = &m_regions[next_region - m_region_addresses.begin() - 1];
+        region->accesses++;
+    }
+
+    m_clock++;
+    m_lines[line].accesses++;
+    if (write)
+        m_statistics.writes++;
+    else
+        m_statistics.reads++;
+    if (write && write_through)
+        m_statistics.memory_writes++;
+
+    for (size_t way{ first }; way < first + ways; way++)
+    {
+        if (m_blocks[way] != tag)
+            continue;
+
+        if (m_config.replacement == REPLACE_LRU)
+            m_stamps[way] = m_clock;
+        if (write && !write_through)
+            m_dirty[way] = 1;
+
+        shadow_access(block, true);
+        return;
+    }
+
+    // Stores that miss a write-through cache go to memory only
+    const bool allocate{ !write || !write_through };
+
+    m_lines[line].misses++;
+    if (region != nullptr)
+        region->misses++;
+    if (write)
+        m_statistics.write_misses++;
+    else
+        m_statistics.read_misses++;
+
+    const bool shadow_hit{ shadow_access(block, allocate) };
+    if (!seen(block))
+        m_statistics.compulsory++;
+    else if (shadow_hit)
+        m_statistics.conflict++;
+    else
+        m_statistics.capacity++;
+
+    if (!allocate)
+        return;
+
+    // An empty way if there is one, otherwise the oldest stamp or a random
+    // way
+    size_t victim{ first };
+    bool empty{};
+    for (size_t way{ first }; way < first + ways; way++)
+    {
+        if (m_blocks[way] == 0)
+        {
+            victim = way;
+            empty = true;
+            break;
+        }
+        if (m_stamps[way] < m_stamps[victim])
+            victim = way;
+    }
+
+    if (!empty && m_config.replacement == REPLACE_RANDOM)
+    {
+        // xorshift32
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 17;
+        m_random ^= m_random << 5;
+        victim = first + (m_random & (ways - 1));
+    }
+
+    if (m_dirty[victim] != 0)
+        m_statistics.write_backs++;
+
+    m_blocks[victim] = tag;
+    m_stamps[victim] = m_clock;
+    m_dirty[victim] = write ? 1 : 0;
+}
+
+
+const CacheStatistics &CacheModel::statistics() const
+{
+    return m_statistics;
+}
+
+
+const std::vector<CacheLine> &CacheModel::lines() const
+{
+    return m_lines;
+}
+
+
+void CacheModel::display(
+    std::ostream &output,
+    std::string_view name,
+    const SourceFile &source,
+    const std::vector<Instruction> &program,
+    const std::vector<ProfileRegion> &regions
+) const
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+    const CacheStatistics &totals{ m_statistics };
+    const int64_t accesses{ totals.reads + totals.writes };
+    const int64_t misses{ totals.read_misses + totals.write_misses };
+
+    output
+        << name << ": " << m_config.size << " bytes, "
+        << m_config.associativity << "-way, "
+        << m_config.line_size << "-byte lines, "
+        << REPLACEMENT_NAMES[m_config.replacement];
+    // Instruction caches are never written
+    if (totals.writes > 0)
+        output << ", " << WRITE_POLICY_NAMES[m_config.write_policy];
+    output << "\n\n";
+
+    output << "    Accesses      Misses  Miss rate\n";
+    print_column(output, totals.reads, 12);
+    print_column(output, totals.read_misses, 12);
+    print_column(output, percentage(totals.read_misses, totals.reads), 11);
+    output << "  reads\n";
+    if (totals.writes > 0)
+    {
+        print_column(output, totals.writes, 12);
+        print_column(output, totals.write_misses, 12);
+        print_column(output, percentage(totals.write_misses, totals.writes), 11);
+        output << "  writes\n";
+    }
+    print_column(output, accesses, 12);
+    print_column(output, misses, 12);
+    print_column(output, percentage(misses, accesses), 11);
+    output << "  total\n";
+
+    output << "\nMisses\n";
+    print_column(output, totals.compulsory, 12);
+    print_column(output, percentage(totals.compulsory, misses), 11);
+    output << "  compulsory\n";
+    print_column(output, totals.capacity, 12);
+    print_column(output, percentage(totals.capacity, misses), 11);
+    output << "  capacity\n";
+    print_column(output, totals.conflict, 12);
+    print_column(output, percentage(totals.conflict, misses), 11);
+    output << "  conflict\n";
+    if (totals.writes > 0)
+    {
+        print_column(output, totals.write_backs, 12);
+        output << "  lines written back\n";
+        print_column(output, totals.memory_writes, 12);
+        output << "  stores written through\n";
+    }
+
+    // Accesses made by the code under every label, the lines before the
+    // first label are last
+    const std::vector<int32_t> region_of{
+        ExecutionProfile::find_regions(line_count, regions)
+    };
+    std::vector<CacheLine> region_totals(regions.size() + 1);
+    std::vector<std::string> region_names;
+    for (const auto &[first_line, label] : regions)
+        region_names.push_back(std::string{ label } + " (line " + std::to_string(first_line + 1) + ")");
+    region_names.emplace_back("(before the first label)");
+    for (int32_t line{}; line < line_count; line++)
+    {
+        CacheLine &region{
+            region_totals[region_of[line] >= 0 ? region_of[line] : regions.size()]
+        };
+        region.accesses += m_lines[line].accesses;
+        region.misses += m_lines[line].misses;
+    }
+
+    output << "\nCode regions\n";
+    print_regions(output, region_totals, region_names);
+
+    // Accesses to every region of memory
+    if (!m_regions.empty())
+    {
+        output << "\nMemory regions\n";
+        print_regions(output, m_regions, m_region_names);
+    }
+
+    output << "\nLines\n";
+    output << "    Accesses      Misses  Miss rate   Line  Source\n";
+    for (int32_t line{}; line < line_count; line++)
+    {
+        const CacheLine &counts{ m_lines[line] };
+        if (counts.accesses == 0)
+            continue;
+
+        print_column(output, counts.accesses, 12);
+        print_column(output, counts.misses, 12);
+        print_column(output, percentage(counts.misses, counts.accesses), 11);
+        print_column(output, line + 1, 7);
+        output << "  " << source[line] << '\n';
+    }
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ExecutionProfile.hpp>
+#include <Instruction.hpp>
+#include <SourceFile.hpp>
+
+// Lines a full set gives up for a new one
+// The least recently used
+constexpr int32_t REPLACE_LRU{ 0 };
+// The one filled first
+constexpr int32_t REPLACE_FIFO{ 1 };
+// Any, from a fixed pseudo-random sequence so that runs repeat
+constexpr int32_t REPLACE_RANDOM{ 2 };
+
+// What stores do
+// Write the line only, and write it to memory when it is replaced. Store
+// misses fill the line first.
+constexpr int32_t WRITE_BACK{ 0 };
+// Write memory every time, and the line only if it is cached. Store misses
+// do not fill a line.
+constexpr int32_t WRITE_THROUGH{ 1 };
+
+/**
+ * @brief Geometry and policies of a cache.
+ */
+struct CacheConfig
+{
+    // Capacity in bytes
+    int32_t size{ 16384 };
+    // Lines per set, 1 for a direct-mapped cache
+    int32_t associativity{ 4 };
+    // Bytes per line
+    int32_t line_size{ 32 };
+    // One of REPLACE_*
+    int32_t replacement{ REPLACE_LRU };
+    // One of WRITE_*
+    int32_t write_policy{ WRITE_BACK };
+};
+
+/**
+ * @brief Totals of a cache. Misses are classified as compulsory, the first
+ *        access to a line, capacity, those a fully associative LRU cache of
+ *        the same size would miss as well, and conflict, the others.
+ */
+struct CacheStatistics
+{
+    int64_t reads;
+    int64_t writes;
+    int64_t read_misses;
+    int64_t write_misses;
+    int64_t compulsory;
+    int64_t capacity;
+    int64_t conflict;
+    // Dirty lines written to memory when replaced
+    int64_t write_backs;
+    // Stores written to memory, with write-through
+    int64_t memory_writes;
+};
+
+/**
+ * @brief Accesses made by one line of the program, or made to one region of
+ *        memory.
+ */
+struct CacheLine
+{
+    int64_t accesses;
+    int64_t misses;
+};
+
+/**
+ * @brief A set-associative cache, fed with the addresses the simulator reads
+ *        and writes, that counts hits and misses per line of the program.
+ *
+ * Only tags are kept, the data stays in guest memory. Every line is tagged
+ * with its block number, the address divided by the line size, plus one so
+ * that zero marks an empty way. A fully associative LRU cache of the same
+ * number of lines runs alongside, with a hash table over a recency list, to
+ * tell capacity misses from conflict misses.
+ */
+class CacheModel
+{
+    CacheConfig m_config;
+    int32_t m_line_bits;
+    int32_t m_set_mask;
+    // Block plus one, when each line was last used or filled, and whether
+    // it was written since, by set and then way
+    std::vector<uint32_t> m_blocks;
+    std::vector<uint64_t> m_stamps;
+    std::vector<uint8_t> m_dirty;
+    uint64_t m_clock;
+    uint32_t m_random;
+    // One bit per block that was ever accessed
+    std::vector<uint64_t> m_seen;
+    // Fully associative LRU cache: the block in every slot, a list of the
+    // slots from the most recently used, and a table of slot plus one by
+    // the hash of the block, with open addressing
+    std::vector<uint32_t> m_shadow_blocks;
+    std::vector<int32_t> m_shadow_previous;
+    std::vector<int32_t> m_shadow_next;
+    std::vector<int32_t> m_shadow_table;
+    int32_t m_shadow_hash_bits;
+    int32_t m_shadow_used;
+    int32_t m_shadow_head;
+    int32_t m_shadow_tail;
+
+    CacheStatistics m_statistics;
+    // Accesses of every line of the program
+    std::vector<CacheLine> m_lines;
+    // Start address and name of every region of memory, by address, and the
+    // accesses to it
+    std::vector<uint32_t> m_region_addresses;
+    std::vector<std::string> m_region_names;
+    std::vector<CacheLine> m_regions;
+
+    /**
+     * @brief Returns the entry of m_shadow_table a block hashes to.
+     * @param block
+    */
+    uint32_t shadow_hash(uint32_t block) const;
+
+    /**
+     * @brief Returns the entry of m_shadow_table holding a block, or -1.
+     * @param block
+    */
+    int32_t shadow_find(uint32_t block) const;
+
+    /**
+     * @brief Remove the block at an entry of m_shadow_table, moving back the
+     *        entries after it that would no longer be found.
+     * @param entry
+    */
+    void shadow_erase(int32_t entry);
+
+    /**
+     * @brief Move a slot to the front of the recency list.
+     * @param slot
+    */
+    void shadow_touch(int32_t slot);
+
+    /**
+     * @brief Access a block in the fully associative cache.
+     *
+     * @param block
+     * @param allocate Whether a miss fills a slot.
+     * @return True on a hit.
+    */
+    bool shadow_access(uint32_t block, bool allocate);
+
+    /**
+     * @brief Mark a block as accessed.
+     * @param block
+     * @return True if it was accessed before.
+    */
+    bool seen(uint32_t block);
+
+public:
+    explicit CacheModel(const CacheConfig &config);
+
+    /**
+     * @brief Returns nullptr if the geometry is valid: sizes that are powers
+     *        of two, lines of 4 bytes or more and at least one set.
+     *        Otherwise returns what is wrong.
+     * @param config
+    */
+    static const char *validate(const CacheConfig &config);
+
+    /**
+     * @brief Empty the cache, forget all counts and size them for a program.
+     * @param line_count
+    */
+    void reset(int32_t line_count);
+
+    /**
+     * @brief Count accesses per region of memory as well, from now on. An
+     *        address belongs to the last region starting at or below it.
+     * @param regions Start address and name of every region.
+    */
+    void set_regions(const std::vector<ProfileRegion> &regions);
+
+    /**
+     * @brief Read or write an address.
+     *
+     * @param address
+     * @param write
+     * @param line Line of the program that made the access.
+    */
+    void access(uint32_t address, bool write, int32_t line);
+
+    /**
+     * @brief Returns the totals.
+    */
+    const CacheStatistics &statistics() const;
+
+    /**
+     * @brief Returns the accesses of every line.
+    */
+    const std::vector<CacheLine> &lines() const;
+
+    /**
+     * @brief Print the configuration and totals, then the misses per region
+     *        of code and per line, for the lines that made accesses, and the
+     *        misses per region of memory given to set_regions().
+     *
+     * @param output
+     * @param name Which cache this is, to start the report with.
+     * @param source
+     * @param program
+     * @param regions Labels sorted by line.
+    */
+    void display(
+        std::ostream &output,
+        std::string_view name,
+        const SourceFile &source,
+        const std::vector<Instruction> &program,
+        const std::vector<ProfileRegion> &regions
+    ) const;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+//  Statically linked executables are 32-bit big-endian MIPS ELF files:
+//
+//      ELF header                  52 bytes, at offset 0
+//      program headers             32 bytes each, one LOAD segment for the
+//                                  code and one for the data section
+//      section headers             40 bytes each, for the symbol table
+//      symbols                     16 bytes each
+//
+//  Only the fields below are read or written. Everything is big-endian.
+
+// Start of every ELF file
+constexpr char ELF_MAGIC[4]{ '\x7F', 'E', 'L', 'F' };
+
+// Values of the ELF header and of program and section headers
+constexpr uint8_t ELF_CLASS_32{ 1 };
+constexpr uint8_t ELF_DATA_BIG_ENDIAN{ 2 };
+constexpr uint8_t ELF_CURRENT_VERSION{ 1 };
+constexpr uint16_t ELF_TYPE_EXECUTABLE{ 2 };
+constexpr uint16_t ELF_MACHINE_MIPS{ 8 };
+// MIPS32, O32 calling convention, assembled without reordering
+constexpr uint32_t ELF_FLAGS_MIPS32{ 0x5000'1001 };
+constexpr uint32_t SEGMENT_LOAD{ 1 };
+constexpr uint32_t SEGMENT_DYNAMIC{ 2 };
+constexpr uint32_t SEGMENT_INTERPRETER{ 3 };
+constexpr uint32_t SEGMENT_EXECUTABLE{ 1 };
+constexpr uint32_t SEGMENT_WRITABLE{ 2 };
+constexpr uint32_t SEGMENT_READABLE{ 4 };
+constexpr uint32_t SECTION_PROGRAM_BITS{ 1 };
+constexpr uint32_t SECTION_SYMBOL_TABLE{ 2 };
+constexpr uint32_t SECTION_STRING_TABLE{ 3 };
+constexpr uint32_t SECTION_WRITE{ 1 };
+constexpr uint32_t SECTION_ALLOCATE{ 2 };
+constexpr uint32_t SECTION_EXECUTE{ 4 };
+constexpr uint16_t SECTION_UNDEFINED{ 0 };
+constexpr uint16_t SECTION_ABSOLUTE{ 0xFFF1 };
+constexpr uint8_t SYMBOL_NO_TYPE{ 0 };
+constexpr uint8_t SYMBOL_OBJECT{ 1 };
+constexpr uint8_t SYMBOL_FUNCTION{ 2 };
+constexpr uint8_t SYMBOL_GLOBAL{ 1 };
+
+// Sizes of the headers and of a symbol
+constexpr size_t ELF_HEADER_SIZE{ 52 };
+constexpr size_t PROGRAM_HEADER_SIZE{ 32 };
+constexpr size_t SECTION_HEADER_SIZE{ 40 };
+constexpr size_t SYMBOL_SIZE{ 16 };
+
+// Register the assembler expands instructions with, whose immediate or
+// offset does not fit in 16 bits
+constexpr int32_t ASSEMBLER_REGISTER{ 1 };
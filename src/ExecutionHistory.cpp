@@ -0,0 +1,121 @@
+#include <ExecutionHistory.hpp>
+
+#include <algorithm>
+
+
+ExecutionHistory::ExecutionHistory(int64_t interval, size_t limit)
+    : m_interval{ std::max<int64_t>(interval, 1) }
+    , m_limit{ limit }
+    , m_usage{}
+    , m_next_checkpoint{}
+{
+}
+
+
+size_t ExecutionHistory::checkpoint_size(const Checkpoint &checkpoint)
+{
+    return sizeof(Checkpoint) + sizeof(int32_t) * checkpoint.memory.size();
+}
+
+
+void ExecutionHistory::clear()
+{
+    m_checkpoints.clear();
+    m_undo.clear();
+    m_usage = 0;
+    m_next_checkpoint = 0;
+}
+
+
+void ExecutionHistory::add_checkpoint(Checkpoint &&checkpoint)
+{
+    m_next_checkpoint = checkpoint.instruction_count + m_interval;
+    m_usage += checkpoint_size(checkpoint);
+    m_checkpoints.push_back(std::move(checkpoint));
+
+    while (m_usage > m_limit && m_checkpoints.size() > 1)
+    {
+        m_usage -= checkpoint_size(m_checkpoints.front());
+        m_checkpoints.pop_front();
+
+        // Records before the new oldest checkpoint can no longer be reached
+        const int64_t dropped{
+            m_checkpoints.front().instruction_count
+            - (m_checkpoints.back().instruction_count - static_cast<int64_t>(m_undo.size()))
+        };
+        m_undo.erase(m_undo.begin(), m_undo.begin() + dropped);
+        m_usage -= sizeof(UndoRecord) * dropped;
+    }
+}
+
+
+bool ExecutionHistory::pop(UndoRecord &record)
+{
+    if (m_undo.empty())
+        return false;
+
+    record = m_undo.back();
+    m_undo.pop_back();
+    m_usage -= sizeof(UndoRecord);
+
+    const int64_t instruction_count{
+        m_checkpoints.front().instruction_count + static_cast<int64_t>(m_undo.size())
+    };
+
+    // Checkpoints after this point are taken again when execution resumes
+    while (m_checkpoints.back().instruction_count > instruction_count)
+    {
+        m_usage -= checkpoint_size(m_checkpoints.back());
+        m_checkpoints.pop_back();
+    }
+
+    m_next_checkpoint = m_checkpoints.back().instruction_count + m_interval;
+    return true;
+}
+
+
+const Checkpoint *ExecutionHistory::find_checkpoint(int64_t instruction_count) const
+{
+    for (auto checkpoint{ m_checkpoints.rbegin() }; checkpoint != m_checkpoints.rend(); ++checkpoint)
+        if (checkpoint->instruction_count <= instruction_count)
+            return &*checkpoint;
+
+    return nullptr;
+}
+
+
+void ExecutionHistory::truncate(int64_t instruction_count)
+{
+    if (m_checkpoints.empty())
+        return;
+
+    while (m_checkpoints.back().instruction_count > instruction_count)
+    {
+        m_usage -= checkpoint_size(m_checkpoints.back());
+        m_checkpoints.pop_back();
+    }
+
+    const size_t kept{
+        static_cast<size_t>(instruction_count - m_checkpoints.front().instruction_count)
+    };
+
+    if (kept < m_undo.size())
+    {
+        m_usage -= sizeof(UndoRecord) * (m_undo.size() - kept);
+        m_undo.resize(kept);
+    }
+
+    m_next_checkpoint = m_checkpoints.back().instruction_count + m_interval;
+}
+
+
+int64_t ExecutionHistory::earliest() const
+{
+    return m_checkpoints.empty() ? -1 : m_checkpoints.front().instruction_count;
+}
+
+
+size_t ExecutionHistory::usage() const
+{
+    return m_usage;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <Instruction.hpp>
+
+// What an undo record restores
+constexpr int32_t UNDO_NONE{ 0 };
+constexpr int32_t UNDO_REGISTER{ 1 };
+constexpr int32_t UNDO_MEMORY{ 2 };
+// A system call that wrote output, whose position before is split over
+// index (high half) and value (low half)
+constexpr int32_t UNDO_OUTPUT{ 3 };
+// A system call that read input into $v0
+constexpr int32_t UNDO_INPUT{ 4 };
+// sbrk, which moved the program break and wrote $v0
+constexpr int32_t UNDO_BREAK{ 5 };
+// mult or div, which wrote HI (held in index) and LO (held in value)
+constexpr int32_t UNDO_HI_LO{ 6 };
+
+/**
+ * @brief What one instruction overwrote, to take it back.
+ */
+struct UndoRecord
+{
+    // Line of the instruction
+    int32_t program_counter;
+    // One of UNDO_*
+    int32_t kind;
+    // Register written, or index of the memory word written
+    int32_t index;
+    // Value before the instruction
+    int32_t value;
+};
+
+/**
+ * @brief Complete state of the simulator at some instruction count.
+ */
+struct Checkpoint
+{
+    int64_t instruction_count;
+    int32_t program_counter;
+    int32_t registers[REGISTER_COUNT];
+    // Every word of guest memory
+    std::vector<int32_t> memory;
+    int32_t program_break;
+    // Progress of the program's console
+    int64_t output_position;
+    int64_t input_position;
+};
+
+/**
+ * @brief Past states of a run, kept as periodic checkpoints plus one undo
+ *        record per instruction since the oldest checkpoint.
+ *
+ * Any instruction count from the oldest checkpoint on can be reached, either
+ * by undoing instructions one at a time, or by restoring the closest
+ * earlier checkpoint and executing forward from it. When the history grows
+ * past its limit, a new checkpoint is requested and the oldest checkpoint is
+ * dropped together with the undo records before the next one.
+ */
+class ExecutionHistory
+{
+    // Instructions between checkpoints
+    int64_t m_interval;
+    // Bytes the history may use, checkpoints and undo records together
+    size_t m_limit;
+    size_t m_usage;
+
+    std::deque<Checkpoint> m_checkpoints;
+    // m_undo[i] takes back instruction m_checkpoints.front().instruction_count + i
+    std::deque<UndoRecord> m_undo;
+    // Instruction count at which the next checkpoint is due
+    int64_t m_next_checkpoint;
+
+    /**
+     * @brief Returns the number of bytes used by a checkpoint.
+     * @param checkpoint
+    */
+    static size_t checkpoint_size(const Checkpoint &checkpoint);
+
+public:
+    /**
+     * @brief Create an empty history.
+     *
+     * @param interval Instructions between checkpoints.
+     * @param limit Bytes the history may use. At least one checkpoint is
+     *              always kept.
+    */
+    ExecutionHistory(int64_t interval, size_t limit);
+
+    /**
+     * @brief Forget everything.
+    */
+    void clear();
+
+    /**
+     * @brief Returns true if a checkpoint should be added before executing
+     *        the next instruction.
+     * @param instruction_count
+    */
+    bool is_checkpoint_due(int64_t instruction_count) const
+    {
+        return instruction_count >= m_next_checkpoint;
+    }
+
+    /**
+     * @brief Add a checkpoint for the current state, dropping the oldest
+     *        ones while the history is over its limit.
+     * @param checkpoint
+    */
+    void add_checkpoint(Checkpoint &&checkpoint);
+
+    /**
+     * @brief Add the undo record of the instruction just executed.
+     * @param record
+    */
+    void push(const UndoRecord &record)
+    {
+        m_undo.push_back(record);
+        m_usage += sizeof(UndoRecord);
+
+        // Make room at the next instruction
+        if (m_usage > m_limit)
+            m_next_checkpoint = 0;
+    }
+
+    /**
+     * @brief Remove the undo record of the last instruction executed, and
+     *        the checkpoints taken after it.
+     *
+     * @param record
+     * @return False if there is no earlier instruction in the history.
+    */
+    bool pop(UndoRecord &record);
+
+    /**
+     * @brief Returns the latest checkpoint at or before an instruction count,
+     *        or nullptr if there is none.
+     * @param instruction_count
+    */
+    const Checkpoint *find_checkpoint(int64_t instruction_count) const;
+
+    /**
+     * @brief Drop the undo records and checkpoints after an instruction
+     *        count, before going back to it from a checkpoint.
+     * @param instruction_count
+    */
+    void truncate(int64_t instruction_count);
+
+    /**
+     * @brief Returns the first instruction count that can be reached, or -1
+     *        if the history is empty.
+    */
+    int64_t earliest() const;
+
+    /**
+     * @brief Returns the number of bytes used.
+    */
+    size_t usage() const;
+};
@@ -0,0 +1,353 @@
+#include <ExecutionProfile.hpp>
+#include <ReportFormat.hpp>
+
+#include <algorithm>
+#include <string>
+
+
+namespace
+{
+
+// Number of loops listed by display()
+constexpr size_t PROFILE_LOOPS_SHOWN{ 10 };
+
+
+/**
+ * @brief Returns true if the line holds an instruction, possibly the first
+ *        of a superinstruction.
+ * @param instruction
+*/
+bool is_instruction(const Instruction &instruction)
+{
+    return instruction.operation >= 0;
+}
+
+
+/**
+ * @brief Returns the line a branch or jump goes to, or -1 if the instruction
+ *        is neither or jumps to an address in a register.
+ * @param instruction
+*/
+int32_t branch_target(const Instruction &instruction)
+{
+    const int32_t operation{ instruction.operation };
+
+    if (is_conditional_branch(operation))
+        return instruction.r[2];
+    if (operation == OPERATION_J || operation == OPERATION_JAL)
+        return instruction.r[0];
+
+    return -1;
+}
+
+
+/**
+ * @brief Append a source line to a folded stack frame, with the spacing
+ *        collapsed and without the ';' that separates frames.
+ * @param frame
+ * @param line
+*/
+void append_source(std::string &frame, std::string_view line)
+{
+    bool space{};
+
+    for (const char c : line)
+    {
+        if (c == ' ' || c == '\t' || c == '\r')
+        {
+            space = true;
+            continue;
+        }
+
+        if (space && !frame.empty() && frame.back() != ' ')
+            frame += ' ';
+        space = false;
+        frame += c == ';' ? ',' : c;
+    }
+}
+
+}
+
+
+void ExecutionProfile::reset(int32_t line_count)
+{
+    // One more for execution that stops past the last line
+    m_taken.assign(line_count + 1, 0);
+    m_entries.assign(line_count + 1, 0);
+}
+
+
+int64_t *ExecutionProfile::taken_counts()
+{
+    return m_taken.data();
+}
+
+
+std::vector<int64_t> ExecutionProfile::line_counts(
+    const std::vector<Instruction> &program
+) const
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+
+    // Taken branches and jumps arriving at every line
+    std::vector<int64_t> arriving(line_count);
+    for (int32_t line{}; line < line_count; line++)
+    {
+        const int32_t target{ branch_target(program[line]) };
+        if (target >= 0 && target < line_count)
+            arriving[target] += m_taken[line];
+    }
+
+    std::vector<int64_t> counts(line_count);
+    // Executions falling through from the line before
+    int64_t flow{};
+
+    for (int32_t line{}; line < line_count; line++)
+    {
+        counts[line] = flow + arriving[line] + m_entries[line];
+
+        const int32_t operation{ program[line].operation };
+        // Conditional branches, and jr and jalr, which count as taken unless
+        // they fail
+        if (is_conditional_branch(operation) || is_register_jump(operation))
+            flow = counts[line] - m_taken[line];
+        // Nothing falls through a jump or halt
+        else if (operation == OPERATION_J || operation == OPERATION_HALT || operation == OPERATION_JAL)
+            flow = 0;
+        else
+            flow = counts[line];
+    }
+
+    return counts;
+}
+
+
+std::vector<ProfileLoop> ExecutionProfile::find_loops(
+    const std::vector<Instruction> &program,
+    const std::vector<int64_t> &counts
+) const
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+
+    // Loop starting at every line, iterations are 0 if there is none
+    std::vector<ProfileLoop> heads(line_count, ProfileLoop{ 0, 0, 0, 0 });
+    for (int32_t line{}; line < line_count; line++)
+    {
+        const int32_t target{ branch_target(program[line]) };
+        // Calls to a function further up are no loop
+        if (target < 0 || target > line || m_taken[line] == 0
+            || program[line].operation == OPERATION_JAL)
+            continue;
+
+        ProfileLoop &loop{ heads[target] };
+        loop.first_line = target;
+        loop.last_line = std::max(loop.last_line, line);
+        loop.iterations += m_taken[line];
+    }
+
+    // Instructions executed before every line
+    std::vector<int64_t> executed(line_count + 1);
+    for (int32_t line{}; line < line_count; line++)
+        executed[line + 1] = executed[line]
+            + (is_instruction(program[line]) ? counts[line] : 0);
+
+    std::vector<ProfileLoop> loops;
+    for (ProfileLoop &loop : heads)
+    {
+        if (loop.iterations == 0)
+            continue;
+
+        loop.instructions = executed[loop.last_line + 1] - executed[loop.first_line];
+        loops.push_back(loop);
+    }
+
+    // Loops starting on the same line cannot exist, so this puts every loop
+    // after the loops around it
+    std::sort(
+        loops.begin(),
+        loops.end(),
+        [](const ProfileLoop &a, const ProfileLoop &b)
+        {
+            return a.first_line < b.first_line;
+        }
+    );
+
+    return loops;
+}
+
+
+std::vector<int32_t> ExecutionProfile::find_regions(
+    int32_t line_count,
+    const std::vector<ProfileRegion> &regions
+)
+{
+    std::vector<int32_t> region_of(line_count, -1);
+    int32_t region{ -1 };
+
+    for (int32_t line{}; line < line_count; line++)
+    {
+        if (region + 1 < static_cast<int32_t>(regions.size())
+            && regions[region + 1].first == line)
+            region++;
+
+        region_of[line] = region;
+    }
+
+    return region_of;
+}
+
+
+void ExecutionProfile::display(
+    std::ostream &output,
+    const SourceFile &source,
+    const std::vector<Instruction> &program,
+    const std::vector<ProfileRegion> &regions
+) const
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+    const std::vector<int64_t> counts{ line_counts(program) };
+
+    int64_t total{};
+    for (int32_t line{}; line < line_count; line++)
+        if (is_instruction(program[line]))
+            total += counts[line];
+
+    output << "Profile of " << total << " instructions\n\n";
+    output << "       Count   Line  Source\n";
+
+    for (int32_t line{}; line < line_count; line++)
+    {
+        if (is_instruction(program[line]))
+            print_column(output, counts[line], 12);
+        else
+            output << std::string(12, ' ');
+
+        print_column(output, line + 1, 7);
+        output << "  " << source[line];
+
+        if (is_conditional_branch(program[line].operation) && counts[line] > 0)
+            output
+                << "  # taken " << m_taken[line]
+                << " of " << counts[line];
+
+        output << '\n';
+    }
+
+    // Instructions per region, the lines before the first label are last
+    const std::vector<int32_t> region_of{ find_regions(line_count, regions) };
+    std::vector<int64_t> region_totals(regions.size() + 1);
+    for (int32_t line{}; line < line_count; line++)
+        if (is_instruction(program[line]))
+            region_totals[region_of[line] >= 0 ? region_of[line] : regions.size()]
+                += counts[line];
+
+    std::vector<size_t> order;
+    for (size_t i{}; i < region_totals.size(); i++)
+        if (region_totals[i] > 0)
+            order.push_back(i);
+
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [&region_totals](size_t a, size_t b)
+        {
+            return region_totals[a] > region_totals[b];
+        }
+    );
+
+    output << "\nRegions\n";
+    output << "Instructions         %  Label\n";
+    for (const size_t i : order)
+    {
+        print_column(output, region_totals[i], 12);
+        print_column(output, percentage(region_totals[i], total), 9);
+        output << "  ";
+        if (i < regions.size())
+            output << regions[i].second << " (line " << regions[i].first + 1 << ")\n";
+        else
+            output << "(before the first label)\n";
+    }
+
+    std::vector<ProfileLoop> loops{ find_loops(program, counts) };
+    std::stable_sort(
+        loops.begin(),
+        loops.end(),
+        [](const ProfileLoop &a, const ProfileLoop &b)
+        {
+            return a.instructions > b.instructions;
+        }
+    );
+
+    output << "\nLoops\n";
+    output << "Instructions         %    Iterations  Lines\n";
+    for (size_t i{}; i < loops.size() && i < PROFILE_LOOPS_SHOWN; i++)
+    {
+        const ProfileLoop &loop{ loops[i] };
+        print_column(output, loop.instructions, 12);
+        print_column(output, percentage(loop.instructions, total), 9);
+        output << "  ";
+        print_column(output, loop.iterations, 12);
+        output << "  " << loop.first_line + 1 << '-' << loop.last_line + 1;
+
+        const int32_t region{ region_of[loop.first_line] };
+        if (region >= 0 && regions[region].first == loop.first_line)
+            output << " (" << regions[region].second << ')';
+        output << '\n';
+    }
+
+    if (loops.size() > PROFILE_LOOPS_SHOWN)
+        output << "... and " << loops.size() - PROFILE_LOOPS_SHOWN << " more\n";
+}
+
+
+void ExecutionProfile::write_folded(
+    std::ostream &output,
+    std::string_view root,
+    const SourceFile &source,
+    const std::vector<Instruction> &program,
+    const std::vector<ProfileRegion> &regions
+) const
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+    const std::vector<int64_t> counts{ line_counts(program) };
+    const std::vector<ProfileLoop> loops{ find_loops(program, counts) };
+    const std::vector<int32_t> region_of{ find_regions(line_count, regions) };
+
+    std::string stack;
+
+    for (int32_t line{}; line < line_count; line++)
+    {
+        if (!is_instruction(program[line]) || counts[line] <= 0)
+            continue;
+
+        stack.clear();
+        append_source(stack, root);
+
+        stack += ';';
+        const int32_t region{ region_of[line] };
+        if (region >= 0)
+            stack += regions[region].second;
+        else
+            stack += "(before the first label)";
+
+        for (const ProfileLoop &loop : loops)
+        {
+            if (loop.first_line > line)
+                break;
+            if (loop.last_line < line)
+                continue;
+
+            stack += ";loop ";
+            const int32_t head_region{ region_of[loop.first_line] };
+            if (head_region >= 0 && regions[head_region].first == loop.first_line)
+                stack += regions[head_region].second;
+            else
+                stack += "at line " + std::to_string(loop.first_line + 1);
+        }
+
+        stack += ";line " + std::to_string(line + 1) + ": ";
+        append_source(stack, source[line]);
+
+        output << stack << ' ' << counts[line] << '\n';
+    }
+}
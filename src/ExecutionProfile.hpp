@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <Instruction.hpp>
+#include <SourceFile.hpp>
+
+/**
+ * @brief A label and the line it is on. Every label starts a region that
+ *        runs until the next label.
+ */
+using ProfileRegion = std::pair<int32_t, std::string_view>;
+
+/**
+ * @brief A loop, found from the branches that went back to its first line.
+ */
+struct ProfileLoop
+{
+    int32_t first_line;
+    int32_t last_line;
+    // Taken back edges
+    int64_t iterations;
+    // Instructions executed on the lines of the loop
+    int64_t instructions;
+};
+
+/**
+ * @brief Execution counts of a run, per line and per branch.
+ *
+ * Only events that change the flow of control are counted while the program
+ * runs: taken branches and jumps, plus the lines where execution started and
+ * stopped. How often every other line executed follows from these, as a line
+ * is reached by falling through from the line before it or by a taken branch
+ * to it. This keeps the cost in the engines to one increment per taken
+ * branch.
+ */
+class ExecutionProfile
+{
+    // Taken branches and jumps, by the line of the branch
+    std::vector<int64_t> m_taken;
+    // Times execution started at a line, or arrived there by jr or jalr,
+    // less the times it stopped there without executing it
+    std::vector<int64_t> m_entries;
+
+public:
+    /**
+     * @brief Returns the region of every line, as an index into regions, or
+     *        -1 for lines before the first label.
+     * @param line_count
+     * @param regions Sorted by line.
+    */
+    static std::vector<int32_t> find_regions(
+        int32_t line_count,
+        const std::vector<ProfileRegion> &regions
+    );
+
+    /**
+     * @brief Forget all counts and size the profile for a program.
+     * @param line_count
+    */
+    void reset(int32_t line_count);
+
+    /**
+     * @brief Count a taken branch or jump.
+     * @param line
+    */
+    void count_taken(int32_t line)
+    {
+        m_taken[line]++;
+    }
+
+    /**
+     * @brief Returns the taken branch counters, indexed by line, for engines
+     *        that update them directly.
+    */
+    int64_t *taken_counts();
+
+    /**
+     * @brief Record that execution starts at line.
+     * @param line
+    */
+    void enter(int32_t line)
+    {
+        m_entries[line]++;
+    }
+
+    /**
+     * @brief Record that execution stopped before executing line.
+     * @param line
+    */
+    void leave(int32_t line)
+    {
+        m_entries[line]--;
+    }
+
+    /**
+     * @brief Returns the number of times every line was reached.
+     * @param program The decoded program.
+    */
+    std::vector<int64_t> line_counts(const std::vector<Instruction> &program) const;
+
+    /**
+     * @brief Returns the loops of the program that ran, outermost first.
+     *
+     * Branches back to the same line are one loop, ending at the last of
+     * them.
+     *
+     * @param program
+     * @param counts Returned by line_counts().
+    */
+    std::vector<ProfileLoop> find_loops(
+        const std::vector<Instruction> &program,
+        const std::vector<int64_t> &counts
+    ) const;
+
+    /**
+     * @brief Print the source annotated with execution counts, followed by
+     *        the regions and loops that executed the most instructions.
+     *
+     * @param output
+     * @param source
+     * @param program
+     * @param regions Labels sorted by line.
+    */
+    void display(
+        std::ostream &output,
+        const SourceFile &source,
+        const std::vector<Instruction> &program,
+        const std::vector<ProfileRegion> &regions
+    ) const;
+
+    /**
+     * @brief Write one folded stack per executed line, as read by flame graph
+     *        tools: the root frame, the region, every loop around the line
+     *        from the outermost, then the line itself, followed by its count.
+     *
+     * @param output
+     * @param root Name of the bottom frame, usually the program.
+     * @param source
+     * @param program
+     * @param regions Labels sorted by line.
+    */
+    void write_folded(
+        std::ostream &output,
+        std::string_view root,
+        const SourceFile &source,
+        const std::vector<Instruction> &program,
+        const std::vector<ProfileRegion> &regions
+    ) const;
+};
@@ -0,0 +1,157 @@
+#include <GuestConsole.hpp>
+
+#include <algorithm>
+#include <charconv>
+
+
+GuestConsole::GuestConsole()
+    : m_output{}
+    , m_input{}
+    , m_output_position{}
+    , m_output_end{}
+    , m_input_position{}
+{
+    m_pending.reserve(CONSOLE_BUFFER_SIZE);
+}
+
+
+void GuestConsole::connect(std::ostream *output, std::istream *input)
+{
+    flush();
+    m_output = output;
+    m_input = input;
+}
+
+
+void GuestConsole::clear()
+{
+    flush();
+    m_output_position = 0;
+    m_output_end = 0;
+    m_input_log.clear();
+    m_input_position = 0;
+}
+
+
+void GuestConsole::write(std::string_view text)
+{
+    // Output written before going back is not repeated
+    const int64_t repeated{
+        std::clamp<int64_t>(m_output_end - m_output_position, 0, text.size())
+    };
+
+    m_output_position += text.size();
+    m_output_end = std::max(m_output_end, m_output_position);
+    text.remove_prefix(static_cast<size_t>(repeated));
+
+    if (m_output == nullptr || text.empty())
+        return;
+
+    m_pending.append(text);
+
+    if (m_pending.size() >= CONSOLE_BUFFER_SIZE)
+        flush();
+}
+
+
+void GuestConsole::write_int(int32_t value)
+{
+    char digits[16];
+    write(std::string_view{
+        digits,
+        static_cast<size_t>(std::to_chars(digits, digits + sizeof(digits), value).ptr - digits)
+    });
+}
+
+
+bool GuestConsole::read_logged(int32_t &value)
+{
+    if (m_input_position >= static_cast<int64_t>(m_input_log.size()))
+        return false;
+
+    value = m_input_log[m_input_position++];
+    return true;
+}
+
+
+bool GuestConsole::read_int(int32_t &value)
+{
+    if (read_logged(value))
+        return true;
+
+    // Whatever was printed as a prompt is shown first
+    flush();
+
+    std::string line;
+    if (m_input == nullptr || !std::getline(*m_input, line))
+        return false;
+
+    const size_t first{ line.find_first_not_of(" \t\r") };
+    const size_t last{ line.find_last_not_of(" \t\r") };
+    if (first == std::string::npos)
+        return false;
+
+    const char *end{ line.data() + last + 1 };
+    const std::from_chars_result result{ std::from_chars(line.data() + first, end, value) };
+    if (result.ec != std::errc{} || result.ptr != end)
+        return false;
+
+    m_input_log.push_back(value);
+    m_input_position++;
+    return true;
+}
+
+
+bool GuestConsole::read_char(int32_t &value)
+{
+    if (read_logged(value))
+        return true;
+
+    flush();
+
+    if (m_input == nullptr)
+        return false;
+
+    const std::istream::int_type character{ m_input->get() };
+    if (character == std::istream::traits_type::eof())
+        return false;
+
+    value = static_cast<uint8_t>(character);
+    m_input_log.push_back(value);
+    m_input_position++;
+    return true;
+}
+
+
+void GuestConsole::flush()
+{
+    if (m_pending.empty())
+        return;
+
+    if (m_output != nullptr)
+    {
+        m_output->write(m_pending.data(), m_pending.size());
+        m_output->flush();
+    }
+
+    m_pending.clear();
+}
+
+
+int64_t GuestConsole::output_position() const
+{
+    return m_output_position;
+}
+
+
+int64_t GuestConsole::input_position() const
+{
+    return m_input_position;
+}
+
+
+void GuestConsole::seek(int64_t output_position, int64_t input_position)
+{
+    m_output_position = output_position;
+    m_input_position = input_position;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Output collected before it is written, in bytes
+constexpr size_t CONSOLE_BUFFER_SIZE{ 1 << 16 };
+
+/**
+ * @brief Console of the guest program, used by its system calls.
+ *
+ * Output is collected in one large block and written when the block is
+ * full or on flush(), which the simulator calls when execution stops, so a
+ * program printing one character at a time still makes few writes.
+ *
+ * Going back in the history moves the console back too. Output is never
+ * taken back, but output the program writes again is not repeated, and
+ * values read again are taken from a log of the values read before.
+ */
+class GuestConsole
+{
+    // Where output goes, nullptr to discard it
+    std::ostream *m_output;
+    // Where input comes from, nullptr if there is none
+    std::istream *m_input;
+    // Output not written yet
+    std::string m_pending;
+    // Bytes written by the program so far, and the most it has ever
+    // written, which differ after going back
+    int64_t m_output_position;
+    int64_t m_output_end;
+    // Every value read so far, in order, and how many of them the program
+    // has read since it started
+    std::vector<int32_t> m_input_log;
+    int64_t m_input_position;
+
+    /**
+     * @brief Returns the next value from the log, if the program already
+     *        read it before going back.
+     * @param value
+    */
+    bool read_logged(int32_t &value);
+
+public:
+    GuestConsole();
+
+    /**
+     * @brief Set where output goes and where input comes from.
+     *
+     * @param output nullptr to discard output.
+     * @param input nullptr if there is no input.
+    */
+    void connect(std::ostream *output, std::istream *input);
+
+    /**
+     * @brief Write pending output, then forget all output and input, for a
+     *        program starting again.
+    */
+    void clear();
+
+    /**
+     * @brief Write text as the program's output.
+     * @param text
+    */
+    void write(std::string_view text);
+
+    /**
+     * @brief Write an integer in decimal.
+     * @param value
+    */
+    void write_int(int32_t value);
+
+    /**
+     * @brief Read a line holding a decimal integer.
+     *
+     * @param value
+     * @return False if there is no input left or the line is not a number.
+    */
+    bool read_int(int32_t &value);
+
+    /**
+     * @brief Read one character.
+     *
+     * @param value
+     * @return False if there is no input left.
+    */
+    bool read_char(int32_t &value);
+
+    /**
+     * @brief Write pending output.
+    */
+    void flush();
+
+    /**
+     * @brief Returns the number of bytes the program has written.
+    */
+    int64_t output_position() const;
+
+    /**
+     * @brief Returns the number of values the program has read.
+    */
+    int64_t input_position() const;
+
+    /**
+     * @brief Go back to an earlier point of the program's input and output.
+     *
+     * @param output_position Not greater than output_position().
+     * @param input_position Not greater than input_position().
+    */
+    void seek(int64_t output_position, int64_t input_position);
+};
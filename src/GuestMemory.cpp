@@ -0,0 +1,120 @@
+#include <GuestMemory.hpp>
+
+#include <algorithm>
+
+
+GuestMemory::GuestMemory()
+    : m_base{ MEMORY_BASE }
+    , m_stack_size{ DEFAULT_STACK_SIZE }
+    , m_data_size{}
+    , m_heap_size{}
+{
+}
+
+
+void GuestMemory::configure(int32_t stack_size, int32_t heap_size)
+{
+    constexpr int32_t largest{ static_cast<int32_t>(MAX_MEMORY_SIZE) };
+
+    m_stack_size = (std::clamp(stack_size, 4, largest) + 3) & ~3;
+    m_heap_size = (std::clamp(heap_size, 0, largest) + 3) & ~3;
+    m_data_size = 0;
+    m_base = MEMORY_BASE;
+    m_words.clear();
+}
+
+
+bool GuestMemory::place_data(int32_t data_address)
+{
+    if (data_address < m_stack_size)
+        return false;
+
+    m_base = data_address - m_stack_size;
+    return true;
+}
+
+
+bool GuestMemory::allocate(int32_t data_size)
+{
+    const int64_t size{ int64_t{ m_stack_size } + data_size + m_heap_size };
+
+    // Addresses must stay positive
+    if (size > MAX_MEMORY_SIZE || m_base + size > INT32_MAX)
+        return false;
+
+    m_data_size = data_size;
+    m_words.assign(static_cast<size_t>(size / 4), 0);
+    return true;
+}
+
+
+void GuestMemory::clear()
+{
+    std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+
+int32_t *GuestMemory::words()
+{
+    return m_words.data();
+}
+
+
+const int32_t *GuestMemory::words() const
+{
+    return m_words.data();
+}
+
+
+uint32_t GuestMemory::word_count() const
+{
+    return static_cast<uint32_t>(m_words.size());
+}
+
+
+int32_t GuestMemory::stack_address() const
+{
+    return m_base;
+}
+
+
+int32_t GuestMemory::stack_top() const
+{
+    return m_base + m_stack_size - 4;
+}
+
+
+int32_t GuestMemory::stack_size() const
+{
+    return m_stack_size;
+}
+
+
+int32_t GuestMemory::data_address() const
+{
+    return m_base + m_stack_size;
+}
+
+
+int32_t GuestMemory::data_size() const
+{
+    return m_data_size;
+}
+
+
+int32_t GuestMemory::heap_address() const
+{
+    return data_address() + m_data_size;
+}
+
+
+int32_t GuestMemory::heap_size() const
+{
+    return m_heap_size;
+}
+
+
+int32_t GuestMemory::end_address() const
+{
+    return heap_address() + m_heap_size;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Address of the first byte of guest memory, where the stack starts, unless
+// the program places its data section elsewhere
+constexpr int32_t MEMORY_BASE{ 40'000 };
+// Size of the stack in bytes, unless set otherwise
+constexpr int32_t DEFAULT_STACK_SIZE{ 400 };
+// Size of the free memory after the data section in bytes, unless set
+// otherwise, which sbrk hands out
+constexpr int32_t DEFAULT_HEAP_SIZE{ 1 << 16 };
+// Largest size of guest memory in bytes
+constexpr int64_t MAX_MEMORY_SIZE{ int64_t{ 1 } << 30 };
+
+/**
+ * @brief Flat, byte-addressed guest memory. From its base address up, it
+ *        holds the stack, the data section and free memory after the data
+ *        section.
+ *
+ * Memory is stored as words in host byte order, so that engines and
+ * translated code can load and store them directly. Words must be aligned
+ * to 4 bytes.
+ */
+class GuestMemory
+{
+    // Every word of memory, the first one at m_base
+    std::vector<int32_t> m_words;
+    // Address of the first word
+    int32_t m_base;
+    // Sizes of the three parts, in bytes and multiples of 4
+    int32_t m_stack_size;
+    int32_t m_data_size;
+    int32_t m_heap_size;
+
+public:
+    GuestMemory();
+
+    /**
+     * @brief Set the sizes of the stack and of the free memory after the
+     *        data section, leaving no data section, and release the words.
+     *
+     * Sizes are rounded up to a multiple of 4. Memory starts at MEMORY_BASE
+     * until place_data() moves it.
+     *
+     * @param stack_size In bytes, at least 4.
+     * @param heap_size In bytes.
+    */
+    void configure(int32_t stack_size, int32_t heap_size);
+
+    /**
+     * @brief Move memory so that the data section starts at an address, with
+     *        the stack right below it.
+     *
+     * @param data_address A multiple of 4.
+     * @return False if the stack would start below address 0, in which case
+     *         nothing changes.
+    */
+    bool place_data(int32_t data_address);
+
+    /**
+     * @brief Set the size of the data section and allocate every word, all
+     *        set to 0.
+     *
+     * @param data_size In bytes, a multiple of 4.
+     * @return False if memory would be larger than MAX_MEMORY_SIZE or reach
+     *         past the largest positive address, in which case nothing
+     *         changes.
+    */
+    bool allocate(int32_t data_size);
+
+    /**
+     * @brief Set every word to 0.
+    */
+    void clear();
+
+    /**
+     * @brief Returns the index of the word at an address, in memory
+     *        starting at base, which is not smaller than the number of words
+     *        if the address is outside memory or not aligned.
+     *
+     * Rotating moves the two low bits of the offset to the top, so one
+     * comparison with the number of words checks both bounds and alignment.
+     *
+     * @param address
+     * @param base
+    */
+    static uint32_t word_index(int32_t address, int32_t base)
+    {
+        return std::rotr(static_cast<uint32_t>(address) - static_cast<uint32_t>(base), 2);
+    }
+
+    /**
+     * @brief Returns the index of the word at an address, which is not
+     *        smaller than word_count() if the address is outside memory or
+     *        not aligned.
+     * @param address
+    */
+    uint32_t word_index(int32_t address) const
+    {
+        return word_index(address, m_base);
+    }
+
+    /**
+     * @brief Returns true if address is an aligned word inside memory.
+     * @param address
+    */
+    bool is_word_address(int32_t address) const
+    {
+        return word_index(address) < m_words.size();
+    }
+
+    /**
+     * @brief Returns true if address is inside memory, aligned or not.
+     * @param address
+    */
+    bool contains(int32_t address) const
+    {
+        return static_cast<uint32_t>(address) - static_cast<uint32_t>(m_base) < 4 * m_words.size();
+    }
+
+    /**
+     * @brief Returns the word at an address checked by is_word_address().
+     * @param address
+    */
+    int32_t load_word(int32_t address) const
+    {
+        return m_words[word_index(address)];
+    }
+
+    /**
+     * @brief Write the word at an address checked by is_word_address().
+     * @param address
+     * @param value
+    */
+    void store_word(int32_t address, int32_t value)
+    {
+        m_words[word_index(address)] = value;
+    }
+
+    /**
+     * @brief Returns the byte at an address checked by contains(). Bytes are
+     *        big-endian within their word, as on MIPS.
+     * @param address
+    */
+    uint8_t load_byte(int32_t address) const
+    {
+        const int32_t word{ m_words[word_index(address & ~3)] };
+        return static_cast<uint8_t>(word >> (8 * (3 - (address & 3))));
+    }
+
+    /**
+     * @brief Returns the halfword at an even address checked by contains(),
+     *        big-endian within its word.
+     * @param address
+    */
+    uint16_t load_halfword(int32_t address) const
+    {
+        const int32_t word{ m_words[word_index(address & ~3)] };
+        return static_cast<uint16_t>(word >> (8 * (2 - (address & 2))));
+    }
+
+    /**
+     * @brief Write the byte at an address checked by contains(), leaving the
+     *        rest of its word as it was.
+     * @param address
+     * @param value
+    */
+    void store_byte(int32_t address, uint8_t value)
+    {
+        const int32_t shift{ 8 * (3 - (address & 3)) };
+        uint32_t &word{ reinterpret_cast<uint32_t &>(m_words[word_index(address & ~3)]) };
+        word = (word & ~(0xFFu << shift)) | uint32_t{ value } << shift;
+    }
+
+    /**
+     * @brief Write the halfword at an even address checked by contains(),
+     *        leaving the rest of its word as it was.
+     * @param address
+     * @param value
+    */
+    void store_halfword(int32_t address, uint16_t value)
+    {
+        const int32_t shift{ 8 * (2 - (address & 2)) };
+        uint32_t &word{ reinterpret_cast<uint32_t &>(m_words[word_index(address & ~3)]) };
+        word = (word & ~(0xFFFFu << shift)) | uint32_t{ value } << shift;
+    }
+
+    /**
+     * @brief Returns every word, the first one at stack_address().
+    */
+    int32_t *words();
+    const int32_t *words() const;
+
+    /**
+     * @brief Returns the number of words.
+    */
+    uint32_t word_count() const;
+
+    /**
+     * @brief Returns the address of the lowest stack word, the first word of
+     *        memory.
+    */
+    int32_t stack_address() const;
+
+    /**
+     * @brief Returns the address of the highest stack word, where $sp starts.
+    */
+    int32_t stack_top() const;
+
+    /**
+     * @brief Returns the size of the stack in bytes.
+    */
+    int32_t stack_size() const;
+
+    /**
+     * @brief Returns the address of the first word of the data section.
+    */
+    int32_t data_address() const;
+
+    /**
+     * @brief Returns the size of the data section in bytes.
+    */
+    int32_t data_size() const;
+
+    /**
+     * @brief Returns the address of the free memory after the data section.
+    */
+    int32_t heap_address() const;
+
+    /**
+     * @brief Returns the size of the free memory in bytes.
+    */
+    int32_t heap_size() const;
+
+    /**
+     * @brief Returns the address after the last word.
+    */
+    int32_t end_address() const;
+};
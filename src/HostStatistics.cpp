@@ -0,0 +1,98 @@
+#include <HostStatistics.hpp>
+
+
+HostStatistics::HostStatistics()
+    : m_nanoseconds{}
+    , m_calls{}
+    , m_active{}
+    , m_depth{}
+    , m_resumed{ Clock::now() }
+    , m_created{ m_resumed }
+{
+}
+
+
+void HostStatistics::charge(Clock::time_point now)
+{
+    if (m_depth > 0)
+        m_nanoseconds[m_active[m_depth - 1]] +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_resumed).count();
+
+    m_resumed = now;
+}
+
+
+void HostStatistics::begin(int32_t phase)
+{
+    charge(Clock::now());
+
+    // Phases do not nest deeper than one of each
+    if (m_depth < PHASE_COUNT)
+        m_active[m_depth++] = phase;
+    m_calls[phase]++;
+
+    if (phase == PHASE_RUN)
+        m_counters.start();
+}
+
+
+void HostStatistics::end()
+{
+    if (m_depth == 0)
+        return;
+
+    if (m_active[m_depth - 1] == PHASE_RUN)
+        m_counters.stop();
+
+    charge(Clock::now());
+    m_depth--;
+}
+
+
+void HostStatistics::write_json(
+    std::ostream &output,
+    const char *engine,
+    int64_t instruction_count
+)
+{
+    charge(Clock::now());
+
+    const int64_t total{
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - m_created
+        ).count()
+    };
+
+    output
+        << "{\"engine\":\"" << engine << '"'
+        << ",\"instructions\":" << instruction_count
+        << ",\"total_ns\":" << total
+        << ",\"phases\":{";
+
+    for (int32_t i{}; i < PHASE_COUNT; i++)
+        output
+            << (i == 0 ? "" : ",")
+            << '"' << PHASE_NAMES[i] << "\":{\"ns\":" << m_nanoseconds[i]
+            << ",\"calls\":" << m_calls[i] << '}';
+
+    output << "},\"run_ns_per_instruction\":";
+    if (instruction_count > 0)
+        output << static_cast<double>(m_nanoseconds[PHASE_RUN]) / instruction_count;
+    else
+        output << "null";
+
+    // Counters the host does not offer are null
+    output << ",\"counters\":{";
+    for (int32_t i{}; i < PERF_COUNTER_COUNT; i++)
+    {
+        output << (i == 0 ? "" : ",") << '"' << PERF_COUNTER_NAMES[i] << "\":";
+
+        const int64_t value{ m_counters.read(i) };
+        if (value >= 0)
+            output << value;
+        else
+            output << "null";
+    }
+
+    output << "}}\n";
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include <PerfCounters.hpp>
+
+// Phases of the simulator's own work, in the order of PHASE_NAMES
+// Mapping and indexing the source file, or loading its program image
+constexpr int32_t PHASE_LOAD{ 0 };
+// Finding labels and data in pre_process()
+constexpr int32_t PHASE_PRE_PROCESS{ 1 };
+// step() and run(), including lines decoded as they are first reached
+constexpr int32_t PHASE_RUN{ 2 };
+// Writing the program image once the program halts
+constexpr int32_t PHASE_SAVE_IMAGE{ 3 };
+// display_state()
+constexpr int32_t PHASE_DISPLAY{ 4 };
+// Decoding and encoding every line in assemble()
+constexpr int32_t PHASE_ASSEMBLE{ 5 };
+constexpr int32_t PHASE_COUNT{ 6 };
+
+// Names used when the phases are reported
+constexpr const char *PHASE_NAMES[PHASE_COUNT]{
+    "load",
+    "pre_process",
+    "run",
+    "save_image",
+    "display",
+    "assemble"
+};
+
+/**
+ * @brief Wall clock time the simulator spends in each phase of its work, and
+ *        hardware counters for the run phase.
+ *
+ * Phases may nest, for example saving the program image when run() reaches
+ * halt. Time spent in a nested phase only counts for that phase.
+ */
+class HostStatistics
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Total time and number of times every phase was entered
+    int64_t m_nanoseconds[PHASE_COUNT];
+    int64_t m_calls[PHASE_COUNT];
+    // Phases entered and not left yet, innermost last
+    int32_t m_active[PHASE_COUNT];
+    int32_t m_depth;
+    // When the innermost active phase last started or resumed
+    Clock::time_point m_resumed;
+    // When statistics were enabled
+    Clock::time_point m_created;
+
+    PerfCounters m_counters;
+
+    /**
+     * @brief Add the time since m_resumed to the innermost active phase.
+     * @param now
+    */
+    void charge(Clock::time_point now);
+
+public:
+    HostStatistics();
+
+    /**
+     * @brief Start timing a phase, pausing the phase it is nested in.
+     * @param phase One of PHASE_*.
+    */
+    void begin(int32_t phase);
+
+    /**
+     * @brief Stop timing the innermost phase and resume the one around it.
+    */
+    void end();
+
+    /**
+     * @brief Write everything as one JSON object on one line.
+     *
+     * @param output
+     * @param engine Name of the execution engine.
+     * @param instruction_count Guest instructions executed.
+    */
+    void write_json(std::ostream &output, const char *engine, int64_t instruction_count);
+};
+
+
+/**
+ * @brief Times a phase for as long as it exists, if statistics are enabled.
+ */
+class PhaseTimer
+{
+    HostStatistics *m_statistics;
+
+public:
+    /**
+     * @brief Start timing.
+     * @param statistics The statistics to add to, or nullptr.
+     * @param phase One of PHASE_*.
+    */
+    PhaseTimer(HostStatistics *statistics, int32_t phase)
+        : m_statistics{ statistics }
+    {
+        if (m_statistics != nullptr)
+            m_statistics->begin(phase);
+    }
+
+    ~PhaseTimer()
+    {
+        if (m_statistics != nullptr)
+            m_statistics->end();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
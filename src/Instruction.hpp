@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cstdint>
+
+// Operation IDs 0 to OPERATION_COUNT - 1 index INSTRUCTION_NAMES. The
+// negative IDs below mark lines that do not hold an executable instruction.
+constexpr int32_t OPERATION_COUNT{ 54 };
+
+// Operation IDs, in the order of INSTRUCTION_NAMES
+constexpr int32_t OPERATION_ADD{ 0 };
+constexpr int32_t OPERATION_SUB{ 1 };
+constexpr int32_t OPERATION_MUL{ 2 };
+constexpr int32_t OPERATION_AND{ 3 };
+constexpr int32_t OPERATION_OR{ 4 };
+constexpr int32_t OPERATION_NOR{ 5 };
+constexpr int32_t OPERATION_SLT{ 6 };
+constexpr int32_t OPERATION_ADDI{ 7 };
+constexpr int32_t OPERATION_ANDI{ 8 };
+constexpr int32_t OPERATION_ORI{ 9 };
+constexpr int32_t OPERATION_SLTI{ 10 };
+constexpr int32_t OPERATION_LW{ 11 };
+constexpr int32_t OPERATION_SW{ 12 };
+constexpr int32_t OPERATION_BEQ{ 13 };
+constexpr int32_t OPERATION_BNE{ 14 };
+constexpr int32_t OPERATION_J{ 15 };
+constexpr int32_t OPERATION_HALT{ 16 };
+constexpr int32_t OPERATION_SYSCALL{ 17 };
+constexpr int32_t OPERATION_ADDU{ 18 };
+constexpr int32_t OPERATION_SUBU{ 19 };
+constexpr int32_t OPERATION_XOR{ 20 };
+constexpr int32_t OPERATION_SLTU{ 21 };
+constexpr int32_t OPERATION_SLLV{ 22 };
+constexpr int32_t OPERATION_SRLV{ 23 };
+constexpr int32_t OPERATION_SRAV{ 24 };
+constexpr int32_t OPERATION_SLL{ 25 };
+constexpr int32_t OPERATION_SRL{ 26 };
+constexpr int32_t OPERATION_SRA{ 27 };
+constexpr int32_t OPERATION_ADDIU{ 28 };
+constexpr int32_t OPERATION_XORI{ 29 };
+constexpr int32_t OPERATION_SLTIU{ 30 };
+constexpr int32_t OPERATION_LUI{ 31 };
+constexpr int32_t OPERATION_MULT{ 32 };
+constexpr int32_t OPERATION_MULTU{ 33 };
+constexpr int32_t OPERATION_DIV{ 34 };
+constexpr int32_t OPERATION_DIVU{ 35 };
+constexpr int32_t OPERATION_MFHI{ 36 };
+constexpr int32_t OPERATION_MFLO{ 37 };
+constexpr int32_t OPERATION_MTHI{ 38 };
+constexpr int32_t OPERATION_MTLO{ 39 };
+constexpr int32_t OPERATION_LB{ 40 };
+constexpr int32_t OPERATION_LBU{ 41 };
+constexpr int32_t OPERATION_LH{ 42 };
+constexpr int32_t OPERATION_LHU{ 43 };
+constexpr int32_t OPERATION_SB{ 44 };
+constexpr int32_t OPERATION_SH{ 45 };
+constexpr int32_t OPERATION_BLEZ{ 46 };
+constexpr int32_t OPERATION_BGTZ{ 47 };
+constexpr int32_t OPERATION_BLTZ{ 48 };
+constexpr int32_t OPERATION_BGEZ{ 49 };
+constexpr int32_t OPERATION_JAL{ 50 };
+constexpr int32_t OPERATION_JR{ 51 };
+constexpr int32_t OPERATION_JALR{ 52 };
+constexpr int32_t OPERATION_NOP{ 53 };
+
+// Line holds a label only
+constexpr int32_t OPERATION_LABEL{ -2 };
+// Line is empty or holds a comment only
+constexpr int32_t OPERATION_BLANK{ -3 };
+// Line has not been decoded yet
+constexpr int32_t OPERATION_UNDECODED{ -4 };
+// Operation IDs from here on are superinstructions, which execute the line
+// and the line after it in one step
+constexpr int32_t OPERATION_FUSED{ 1'000 };
+
+// HI and LO, written by mult and div, are kept after the 32 general
+// registers
+constexpr int32_t REGISTER_HI{ 32 };
+constexpr int32_t REGISTER_LO{ 33 };
+constexpr int32_t REGISTER_COUNT{ 34 };
+
+/**
+ * @brief Structure for storing a decoded instruction.
+ *
+ * Operands are stored exactly as parse_instruction() leaves them in r[], so
+ * that a line only has to be parsed once, no matter how often it executes.
+ */
+class Instruction
+{
+public:
+    int32_t operation;
+    int32_t r[3];
+};
+
+
+/**
+ * @brief Returns true for R-format arithmetic and shifts by a register:
+ *        add to slt and addu to srav, which read r[1] and r[2].
+ * @param operation
+ * @return
+*/
+constexpr bool is_register_format(int32_t operation)
+{
+    return (OPERATION_ADD <= operation && operation <= OPERATION_SLT)
+        || (OPERATION_ADDU <= operation && operation <= OPERATION_SRAV);
+}
+
+
+/**
+ * @brief Returns true for I-format arithmetic and shifts by a constant:
+ *        addi to slti and sll to sltiu, which read r[1] and take r[2] as
+ *        is.
+ * @param operation
+ * @return
+*/
+constexpr bool is_immediate_format(int32_t operation)
+{
+    return (OPERATION_ADDI <= operation && operation <= OPERATION_SLTI)
+        || (OPERATION_SLL <= operation && operation <= OPERATION_SLTIU);
+}
+
+
+/**
+ * @brief Returns true for loads: lw, lb, lbu, lh and lhu.
+ * @param operation
+ * @return
+*/
+constexpr bool is_load(int32_t operation)
+{
+    return operation == OPERATION_LW || (OPERATION_LB <= operation && operation <= OPERATION_LHU);
+}
+
+
+/**
+ * @brief Returns true for stores: sw, sb and sh.
+ * @param operation
+ * @return
+*/
+constexpr bool is_store(int32_t operation)
+{
+    return operation == OPERATION_SW || operation == OPERATION_SB || operation == OPERATION_SH;
+}
+
+
+/**
+ * @brief Returns true for loads and stores, which address memory at r[1]
+ *        plus r[2].
+ * @param operation
+ * @return
+*/
+constexpr bool is_memory_access(int32_t operation)
+{
+    return is_load(operation) || is_store(operation);
+}
+
+
+/**
+ * @brief Returns true for mult, multu, div and divu, which write HI and LO.
+ * @param operation
+ * @return
+*/
+constexpr bool is_multiply_divide(int32_t operation)
+{
+    return OPERATION_MULT <= operation && operation <= OPERATION_DIVU;
+}
+
+
+/**
+ * @brief Returns true for branches on one register: blez, bgtz, bltz and
+ *        bgez.
+ * @param operation
+ * @return
+*/
+constexpr bool is_zero_branch(int32_t operation)
+{
+    return OPERATION_BLEZ <= operation && operation <= OPERATION_BGEZ;
+}
+
+
+/**
+ * @brief Returns true for branches whose direction depends on registers:
+ *        beq, bne, blez, bgtz, bltz and bgez.
+ * @param operation
+ * @return
+*/
+constexpr bool is_conditional_branch(int32_t operation)
+{
+    return operation == OPERATION_BEQ || operation == OPERATION_BNE || is_zero_branch(operation);
+}
+
+
+/**
+ * @brief Returns true for jumps to the address in a register: jr and jalr.
+ * @param operation
+ * @return
+*/
+constexpr bool is_register_jump(int32_t operation)
+{
+    return operation == OPERATION_JR || operation == OPERATION_JALR;
+}
+
+
+/**
+ * @brief Returns true if the instruction sets the program counter itself,
+ *        rather than moving on to the next line: branches and jumps.
+ * @param operation
+ * @return
+*/
+constexpr bool is_jump(int32_t operation)
+{
+    return is_conditional_branch(operation) || operation == OPERATION_J
+        || operation == OPERATION_JAL || is_register_jump(operation);
+}
+
+
+/**
+ * @brief Returns false if the instruction modifies $zero or $at or reads $at,
+ *        which the handlers of the simulator report as an error.
+ * @param instruction
+ * @return
+*/
+inline bool has_valid_registers(const Instruction &instruction)
+{
+    const int32_t operation{ instruction.operation };
+    const int32_t *r{ instruction.r };
+
+    if (is_register_format(operation))
+        return r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1;
+    if (is_immediate_format(operation))
+        return r[0] != 0 && r[0] != 1 && r[1] != 1;
+    // Loads, lui, mfhi, mflo
+    if (is_load(operation) || operation == OPERATION_LUI
+        || operation == OPERATION_MFHI || operation == OPERATION_MFLO)
+        return r[0] != 0 && r[0] != 1;
+    // Stores, mthi, mtlo, branches on one register, jr, jalr
+    if (is_store(operation) || operation == OPERATION_MTHI || operation == OPERATION_MTLO
+        || is_zero_branch(operation) || is_register_jump(operation))
+        return r[0] != 1;
+    // beq, bne, mult, multu, div, divu
+    if (operation == OPERATION_BEQ || operation == OPERATION_BNE || is_multiply_divide(operation))
+        return r[0] != 1 && r[1] != 1;
+
+    return true;
+}
+
+
+/**
+ * @brief Returns the register the instruction writes, or -1 if it writes
+ *        none or writes both HI and LO.
+ * @param instruction
+ * @return
+*/
+inline int32_t written_register(const Instruction &instruction)
+{
+    const int32_t operation{ instruction.operation };
+
+    // R-format, I-format, shifts, mul, lui, mfhi, mflo and loads write r[0]
+    if (is_register_format(operation) || is_immediate_format(operation)
+        || is_load(operation) || operation == OPERATION_LUI
+        || operation == OPERATION_MFHI || operation == OPERATION_MFLO)
+        return instruction.r[0];
+    if (operation == OPERATION_MTHI)
+        return REGISTER_HI;
+    if (operation == OPERATION_MTLO)
+        return REGISTER_LO;
+    // jal, jalr leave the return address in $ra
+    if (operation == OPERATION_JAL || operation == OPERATION_JALR)
+        return 31;
+
+    return -1;
+}
+
+
+/**
+ * @brief Store the registers the instruction reads, HI and LO included.
+ * @param instruction
+ * @param registers Room for two registers.
+ * @return The number of registers stored.
+*/
+inline int32_t read_registers(const Instruction &instruction, int32_t registers[2])
+{
+    const int32_t operation{ instruction.operation };
+    const int32_t *r{ instruction.r };
+
+    // R-format and shifts by a register read r[1] and r[2]
+    if (is_register_format(operation))
+    {
+        registers[0] = r[1];
+        registers[1] = r[2];
+        return 2;
+    }
+    // I-format, shifts by a constant and loads read r[1]
+    if (is_immediate_format(operation) || is_load(operation))
+    {
+        registers[0] = r[1];
+        return 1;
+    }
+    // Stores, beq, bne, mult, multu, div and divu read r[0] and r[1]
+    if (is_store(operation) || operation == OPERATION_BEQ || operation == OPERATION_BNE
+        || is_multiply_divide(operation))
+    {
+        registers[0] = r[0];
+        registers[1] = r[1];
+        return 2;
+    }
+    // mthi, mtlo, branches on one register, jr and jalr read r[0]
+    if (operation == OPERATION_MTHI || operation == OPERATION_MTLO
+        || is_zero_branch(operation) || is_register_jump(operation))
+    {
+        registers[0] = r[0];
+        return 1;
+    }
+    if (operation == OPERATION_MFHI || operation == OPERATION_MFLO)
+    {
+        registers[0] = operation == OPERATION_MFHI ? REGISTER_HI : REGISTER_LO;
+        return 1;
+    }
+    // System calls read the service in $v0 and the argument in $a0
+    if (operation == OPERATION_SYSCALL)
+    {
+        registers[0] = 2;
+        registers[1] = 4;
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,523 @@
+#include <JitCompiler.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#if MIPS_JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+
+namespace
+{
+
+// Size of the executable buffer
+constexpr size_t JIT_BUFFER_SIZE{ 1 << 20 };
+// Maximum number of instructions in one block
+constexpr int32_t JIT_MAX_BLOCK_LENGTH{ 128 };
+// Upper bound on the code emitted for one instruction, including its exits
+constexpr size_t JIT_MAX_INSTRUCTION_SIZE{ 192 };
+
+// x86-64 register numbers
+constexpr uint8_t RAX{ 0 };
+constexpr uint8_t RCX{ 1 };
+
+// Opcodes of 'op r32, r/m32'
+constexpr uint8_t OP_ADD{ 0x03 };
+constexpr uint8_t OP_SUB{ 0x2B };
+constexpr uint8_t OP_AND{ 0x23 };
+constexpr uint8_t OP_OR{ 0x0B };
+constexpr uint8_t OP_CMP{ 0x3B };
+constexpr uint8_t OP_MOV_LOAD{ 0x8B };
+constexpr uint8_t OP_MOV_STORE{ 0x89 };
+
+// Condition codes for jcc
+constexpr uint8_t CC_AE{ 0x3 };
+constexpr uint8_t CC_E{ 0x4 };
+constexpr uint8_t CC_NE{ 0x5 };
+constexpr uint8_t CC_A{ 0x7 };
+
+}
+
+
+JitCompiler::JitCompiler(
+    const std::vector<Instruction> &program,
+    const GuestMemory &memory,
+    int64_t *taken_counts
+)
+    : m_program{ program }
+    , m_stack_address{ memory.stack_address() }
+    , m_stack_size{ memory.stack_size() }
+    , m_word_count{ memory.word_count() }
+    , m_taken_counts{ taken_counts }
+    , m_buffer{}
+    , m_capacity{}
+    , m_cursor{}
+    , m_entry{}
+    , m_exit{}
+    , m_blocks(program.size(), nullptr)
+{
+#if MIPS_JIT_SUPPORTED
+    void *buffer{
+        mmap(
+            nullptr,
+            JIT_BUFFER_SIZE,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0
+        )
+    };
+
+    if (buffer == MAP_FAILED)
+        return;
+
+    m_buffer   = static_cast<uint8_t *>(buffer);
+    m_capacity = JIT_BUFFER_SIZE;
+    invalidate();
+#endif
+}
+
+
+JitCompiler::~JitCompiler()
+{
+#if MIPS_JIT_SUPPORTED
+    if (m_buffer != nullptr)
+        munmap(m_buffer, m_capacity);
+#endif
+}
+
+
+bool JitCompiler::is_available() const
+{
+    return m_buffer != nullptr;
+}
+
+
+const uint8_t *JitCompiler::find_block(int32_t line) const
+{
+    return m_blocks[line];
+}
+
+
+void JitCompiler::invalidate()
+{
+    std::fill(m_blocks.begin(), m_blocks.end(), nullptr);
+    m_pending_exits.clear();
+
+    protect(true);
+    m_cursor = m_buffer;
+    emit_entry_and_exit();
+    protect(false);
+}
+
+
+void JitCompiler::protect(bool writable)
+{
+#if MIPS_JIT_SUPPORTED
+    mprotect(
+        m_buffer,
+        m_capacity,
+        writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC
+    );
+#endif
+}
+
+
+void JitCompiler::emit_byte(uint8_t value)
+{
+    *m_cursor++ = value;
+}
+
+
+void JitCompiler::emit_word(int32_t value)
+{
+    std::memcpy(m_cursor, &value, sizeof(value));
+    m_cursor += sizeof(value);
+}
+
+
+void JitCompiler::patch_relative(uint8_t *position, const uint8_t *target)
+{
+    const int32_t displacement{
+        static_cast<int32_t>(target - (position + 4))
+    };
+    std::memcpy(position, &displacement, sizeof(displacement));
+}
+
+
+void JitCompiler::emit_entry_and_exit()
+{
+    // Entry: enter(block, registers, memory, count) arrives with the block
+    // in rdi, registers in rsi, memory in rdx and the instruction count in
+    // rcx
+    m_entry = m_cursor;
+    emit_byte(0x53);                                // push rbx
+    emit_byte(0x41); emit_byte(0x54);               // push r12
+    emit_byte(0x41); emit_byte(0x56);               // push r14
+    emit_byte(0x48); emit_byte(0x89); emit_byte(0xF3); // mov rbx, rsi
+    emit_byte(0x49); emit_byte(0x89); emit_byte(0xD4); // mov r12, rdx
+    emit_byte(0x49); emit_byte(0x89); emit_byte(0xCE); // mov r14, rcx
+    emit_byte(0xFF); emit_byte(0xE7);               // jmp rdi
+
+    // Exit: the next line is already in eax
+    m_exit = m_cursor;
+    emit_byte(0x41); emit_byte(0x5E);               // pop r14
+    emit_byte(0x41); emit_byte(0x5C);               // pop r12
+    emit_byte(0x5B);                                // pop rbx
+    emit_byte(0xC3);                                // ret
+}
+
+
+void JitCompiler::emit_count(int32_t executed)
+{
+    if (executed == 0)
+        return;
+
+    emit_byte(0x49); emit_byte(0x81);               // add qword [r14], executed
+    emit_byte(0x06);
+    emit_word(executed);
+}
+
+
+void JitCompiler::emit_count_taken(int32_t line)
+{
+    if (m_taken_counts == nullptr)
+        return;
+
+    emit_byte(0x48); emit_byte(0xB8);               // mov rax, &counts[line]
+    const uint64_t address{ reinterpret_cast<uint64_t>(m_taken_counts + line) };
+    std::memcpy(m_cursor, &address, sizeof(address));
+    m_cursor += sizeof(address);
+    emit_byte(0x48); emit_byte(0xFF); emit_byte(0x00); // inc qword [rax]
+}
+
+
+void JitCompiler::emit_exit(int32_t value)
+{
+    emit_byte(0xB8);                                // mov eax, value
+    emit_word(value);
+    emit_byte(0xE9);                                // jmp exit
+    emit_word(0);
+    patch_relative(m_cursor - 4, m_exit);
+}
+
+
+void JitCompiler::emit_chained_exit(int32_t line)
+{
+    // Jump straight to the target if it is already translated
+    if (line < static_cast<int32_t>(m_blocks.size()) && m_blocks[line])
+    {
+        emit_byte(0xE9);                            // jmp block
+        emit_word(0);
+        patch_relative(m_cursor - 4, m_blocks[line]);
+        // Pad to the size of an exit, so all exits have the same size
+        for (int32_t i{}; i < 5; i++)
+            emit_byte(0x90);                        // nop
+        return;
+    }
+
+    if (line < static_cast<int32_t>(m_blocks.size()))
+        m_pending_exits[line].push_back(m_cursor);
+
+    emit_exit(line);
+}
+
+
+const uint8_t *JitCompiler::compile(int32_t line)
+{
+    if (!is_available())
+        return nullptr;
+
+    const int32_t length{ static_cast<int32_t>(m_program.size()) };
+
+    // Start over when a full block might not fit
+    const size_t worst_case{
+        (JIT_MAX_BLOCK_LENGTH + 1) * JIT_MAX_INSTRUCTION_SIZE
+    };
+    if (m_cursor + worst_case > m_buffer + m_capacity)
+        invalidate();
+
+    protect(true);
+
+    uint8_t *block{ m_cursor };
+    // Positions of the jumps to the fallback exits of this block, their line
+    // and the number of instructions executed before them
+    std::vector<std::tuple<uint8_t *, int32_t, int32_t>> fallbacks;
+    int32_t translated{};
+    int32_t i{ line };
+    bool ended{};
+
+    // Emit 'op reg, [rbx + 4 * guest]'
+    auto register_operation = [this](uint8_t opcode, uint8_t reg, int32_t guest)
+    {
+        emit_byte(opcode);
+        emit_byte(0x83 | (reg << 3));
+        emit_word(4 * guest);
+    };
+
+    // Check that the value about to be written to $sp, in eax, points into
+    // the stack
+    auto check_stack_pointer = [this, &fallbacks, &translated](int32_t current)
+    {
+        emit_byte(0x8D); emit_byte(0x88);           // lea ecx, [rax - stack]
+        emit_word(-m_stack_address);
+        emit_byte(0x81); emit_byte(0xF9);           // cmp ecx, size - 4
+        emit_word(m_stack_size - 4);
+        emit_byte(0x0F); emit_byte(0x80 | CC_A);    // ja fallback
+        emit_word(0);
+        fallbacks.emplace_back(m_cursor - 4, current, translated);
+        emit_byte(0xF6); emit_byte(0xC1);           // test cl, 3
+        emit_byte(0x03);
+        emit_byte(0x0F); emit_byte(0x80 | CC_NE);   // jnz fallback
+        emit_word(0);
+        fallbacks.emplace_back(m_cursor - 4, current, translated);
+    };
+
+    // Leave the index of the word at [base] + offset in rcx, as
+    // GuestMemory::word_index() does, falling back if it is outside memory
+    // or not aligned
+    auto load_word_index = [this, &fallbacks, &translated, &register_operation](
+        int32_t base,
+        int32_t offset,
+        int32_t current
+    )
+    {
+        register_operation(OP_MOV_LOAD, RCX, base);
+        emit_byte(0x81); emit_byte(0xC1);           // add ecx, offset - base
+        emit_word(static_cast<int32_t>(
+            static_cast<uint32_t>(offset) - static_cast<uint32_t>(m_stack_address)
+        ));
+        emit_byte(0xC1); emit_byte(0xC9);           // ror ecx, 2
+        emit_byte(0x02);
+        emit_byte(0x81); emit_byte(0xF9);           // cmp ecx, words
+        emit_word(static_cast<int32_t>(m_word_count));
+        emit_byte(0x0F); emit_byte(0x80 | CC_AE);   // jae fallback
+        emit_word(0);
+        fallbacks.emplace_back(m_cursor - 4, current, translated);
+    };
+
+    // Addresses relative to $zero are known now, and need no check
+    auto is_fixed_word = [this](int32_t base, int32_t offset)
+    {
+        return base == 0 && GuestMemory::word_index(offset, m_stack_address) < m_word_count;
+    };
+
+    while (!ended && i < length && translated < JIT_MAX_BLOCK_LENGTH)
+    {
+        const Instruction &instruction{ m_program[i] };
+        const int32_t *r{ instruction.r };
+        const int32_t operation{ instruction.operation };
+
+        if (operation == OPERATION_BLANK || operation == OPERATION_LABEL)
+        {
+            i++;
+            continue;
+        }
+
+        // Leave these to the interpreter, system calls included
+        if (
+            operation == OPERATION_UNDECODED
+            ||
+            operation < 0
+            ||
+            operation > OPERATION_HALT
+            ||
+            !has_valid_registers(instruction)
+        )
+            break;
+
+        switch (operation)
+        {
+        case OPERATION_ADD:
+        case OPERATION_SUB:
+        case OPERATION_MUL:
+        case OPERATION_AND:
+        case OPERATION_OR:
+        case OPERATION_NOR:
+            register_operation(OP_MOV_LOAD, RAX, r[1]);
+            switch (operation)
+            {
+            case OPERATION_ADD: register_operation(OP_ADD, RAX, r[2]); break;
+            case OPERATION_SUB: register_operation(OP_SUB, RAX, r[2]); break;
+            case OPERATION_MUL:
+                emit_byte(0x0F);                    // imul eax, [rbx + ...]
+                register_operation(0xAF, RAX, r[2]);
+                break;
+            case OPERATION_AND: register_operation(OP_AND, RAX, r[2]); break;
+            case OPERATION_OR: register_operation(OP_OR, RAX, r[2]); break;
+            case OPERATION_NOR:
+                register_operation(OP_OR, RAX, r[2]);
+                emit_byte(0xF7); emit_byte(0xD0);   // not eax
+                break;
+            }
+
+            if (r[0] == 29)
+                check_stack_pointer(i);
+
+            register_operation(OP_MOV_STORE, RAX, r[0]);
+            break;
+
+        case OPERATION_SLT:
+        case OPERATION_SLTI:
+            register_operation(OP_MOV_LOAD, RCX, r[1]);
+            emit_byte(0x31); emit_byte(0xC0);       // xor eax, eax
+            if (operation == OPERATION_SLT)
+                register_operation(OP_CMP, RCX, r[2]);
+            else
+            {
+                emit_byte(0x81); emit_byte(0xF9);   // cmp ecx, imm
+                emit_word(r[2]);
+            }
+            emit_byte(0x0F); emit_byte(0x9C);       // setl al
+            emit_byte(0xC0);
+            register_operation(OP_MOV_STORE, RAX, r[0]);
+            break;
+
+        case OPERATION_ADDI:
+        case OPERATION_ANDI:
+        case OPERATION_ORI:
+            register_operation(OP_MOV_LOAD, RAX, r[1]);
+            // add/and/or eax, imm
+            emit_byte(operation == OPERATION_ADDI ? 0x05 : operation == OPERATION_ANDI ? 0x25 : 0x0D);
+            emit_word(r[2]);
+
+            if (r[0] == 29)
+                check_stack_pointer(i);
+
+            register_operation(OP_MOV_STORE, RAX, r[0]);
+            break;
+
+        case OPERATION_LW:
+            if (is_fixed_word(r[1], r[2]))
+            {
+                emit_byte(0x41); emit_byte(0x8B);   // mov eax, [r12 + offset]
+                emit_byte(0x84); emit_byte(0x24);
+                emit_word(4 * GuestMemory::word_index(r[2], m_stack_address));
+            } else
+            {
+                load_word_index(r[1], r[2], i);
+                emit_byte(0x41); emit_byte(0x8B);   // mov eax, [r12 + 4 * rcx]
+                emit_byte(0x04); emit_byte(0x8C);
+            }
+
+            if (r[0] == 29)
+                check_stack_pointer(i);
+
+            register_operation(OP_MOV_STORE, RAX, r[0]);
+            break;
+
+        case OPERATION_SW:
+            if (is_fixed_word(r[1], r[2]))
+            {
+                register_operation(OP_MOV_LOAD, RAX, r[0]);
+                emit_byte(0x41); emit_byte(0x89);   // mov [r12 + offset], eax
+                emit_byte(0x84); emit_byte(0x24);
+                emit_word(4 * GuestMemory::word_index(r[2], m_stack_address));
+            } else
+            {
+                load_word_index(r[1], r[2], i);
+                register_operation(OP_MOV_LOAD, RAX, r[0]);
+                emit_byte(0x41); emit_byte(0x89);   // mov [r12 + 4 * rcx], eax
+                emit_byte(0x04); emit_byte(0x8C);
+            }
+            break;
+
+        case OPERATION_BEQ:
+        case OPERATION_BNE:
+        {
+            register_operation(OP_MOV_LOAD, RAX, r[0]);
+            register_operation(OP_CMP, RAX, r[1]);
+            // Skip the taken exit if the branch is not taken
+            emit_byte(0x0F);
+            emit_byte(0x80 | (operation == OPERATION_BEQ ? CC_NE : CC_E));
+            emit_word(0);
+            uint8_t *not_taken{ m_cursor - 4 };
+            emit_count(translated + 1);
+            emit_count_taken(i);
+            emit_chained_exit(r[2]);
+            patch_relative(not_taken, m_cursor);
+            emit_count(translated + 1);
+            emit_chained_exit(i + 1);
+            ended = true;
+            break;
+        }
+
+        case OPERATION_J:
+            emit_count(translated + 1);
+            emit_count_taken(i);
+            emit_chained_exit(r[0]);
+            ended = true;
+            break;
+
+        case OPERATION_HALT:
+            emit_count(translated + 1);
+            emit_exit((i + 1) | JIT_EXIT_HALT);
+            ended = true;
+            break;
+        }
+
+        translated++;
+        i++;
+    }
+
+    // Nothing to run
+    if (translated == 0)
+    {
+        m_cursor = block;
+        protect(false);
+        return nullptr;
+    }
+
+    // Fall through to the line after the block
+    if (!ended)
+    {
+        emit_count(translated);
+        emit_chained_exit(i);
+    }
+
+    for (const auto &[position, current, executed] : fallbacks)
+    {
+        patch_relative(position, m_cursor);
+        emit_count(executed);
+        emit_exit(current | JIT_EXIT_FALLBACK);
+    }
+
+    m_blocks[line] = block;
+
+    // Link exits that were waiting for this block
+    const auto pending{ m_pending_exits.find(line) };
+    if (pending != m_pending_exits.end())
+    {
+        for (uint8_t *exit : pending->second)
+        {
+            exit[0] = 0xE9;                         // jmp block
+            patch_relative(exit + 1, block);
+        }
+
+        m_pending_exits.erase(pending);
+    }
+
+    protect(false);
+    return block;
+}
+
+
+int32_t JitCompiler::enter(
+    const uint8_t *block,
+    int32_t *registers,
+    int32_t *memory,
+    int64_t *instruction_count
+) const
+{
+    using Entry = int32_t (*)(
+        const uint8_t *,
+        int32_t *,
+        int32_t *,
+        int64_t *
+    );
+
+    const Entry entry{ reinterpret_cast<Entry>(m_entry) };
+    return entry(block, registers, memory, instruction_count);
+}
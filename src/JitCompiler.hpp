@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+#include <Instruction.hpp>
+#include <GuestMemory.hpp>
+
+//  Block translation needs the System V calling convention and mmap.
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define MIPS_JIT_SUPPORTED 1
+#else
+#define MIPS_JIT_SUPPORTED 0
+#endif
+
+// Number of times a line has to be reached before its block is translated
+constexpr int32_t JIT_THRESHOLD{ 16 };
+// Set in the value returned by enter() when the block executed halt
+constexpr int32_t JIT_EXIT_HALT{ 1 << 29 };
+// Set in the value returned by enter() when the instruction at the returned
+// line must be executed by the interpreter, as a run time check failed
+constexpr int32_t JIT_EXIT_FALLBACK{ 1 << 30 };
+
+/**
+ * @brief Translates basic blocks of decoded instructions to x86-64.
+ *
+ * Blocks start at any line and run until the first branch, jump or halt, or
+ * until an instruction the compiler does not handle, in which case the block
+ * returns to the caller so that the interpreter can execute it. Block exits
+ * to lines that have already been translated jump straight to that block;
+ * exits to other lines are patched once the target is translated.
+ *
+ * Generated code keeps the guest registers in memory, addressed through rbx,
+ * with guest memory in r12 and the instruction count in r14.
+ */
+class JitCompiler
+{
+    // Program being translated
+    const std::vector<Instruction> &m_program;
+    // Layout of guest memory when the compiler was created. Memory that
+    // grows later is left to the interpreter.
+    int32_t m_stack_address;
+    int32_t m_stack_size;
+    uint32_t m_word_count;
+    // Taken branch counters indexed by line, or nullptr if not counted
+    int64_t *m_taken_counts;
+
+    // Executable buffer
+    uint8_t *m_buffer;
+    size_t   m_capacity;
+    // Start of the unused part of the buffer
+    uint8_t *m_cursor;
+    // Shared entry and exit code at the start of the buffer
+    uint8_t *m_entry;
+    uint8_t *m_exit;
+
+    // Translated block for every line, or nullptr
+    std::vector<uint8_t *> m_blocks;
+    // Exits waiting for their target line to be translated
+    std::unordered_map<int32_t, std::vector<uint8_t *>> m_pending_exits;
+
+    void emit_byte(uint8_t value);
+    void emit_word(int32_t value);
+
+    /**
+     * @brief Emit a 'mov eax, line; jmp exit' sequence, which can later be
+     *        overwritten with a direct jump to the block for line.
+     * @param line
+    */
+    void emit_chained_exit(int32_t line);
+
+    /**
+     * @brief Emit code adding executed to the instruction count, if it is
+     *        not 0.
+     * @param executed
+    */
+    void emit_count(int32_t executed);
+
+    /**
+     * @brief Emit code counting the branch or jump at line as taken, if
+     *        taken branches are counted.
+     * @param line
+    */
+    void emit_count_taken(int32_t line);
+
+    /**
+     * @brief Emit a 'mov eax, value; jmp exit' sequence which is never linked.
+     * @param value
+    */
+    void emit_exit(int32_t value);
+
+    /**
+     * @brief Point the 32-bit relative displacement at position to target.
+     * @param position
+     * @param target
+    */
+    static void patch_relative(uint8_t *position, const uint8_t *target);
+
+    /**
+     * @brief Make the buffer writable or executable.
+     * @param writable
+    */
+    void protect(bool writable);
+
+    /**
+     * @brief Emit the code shared by all blocks.
+    */
+    void emit_entry_and_exit();
+
+public:
+    /**
+     * @brief Create a compiler for a decoded program.
+     *
+     * @param program The decoded program. Records may be decoded later, but
+     *                must not change once decoded.
+     * @param memory Guest memory, whose layout is built into the code.
+     * @param taken_counts Counters incremented by every taken branch and
+     *                     jump, indexed by line, or nullptr.
+    */
+    JitCompiler(
+        const std::vector<Instruction> &program,
+        const GuestMemory &memory,
+        int64_t *taken_counts = nullptr
+    );
+
+    ~JitCompiler();
+
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    /**
+     * @brief Returns true if blocks can be translated on this host.
+    */
+    bool is_available() const;
+
+    /**
+     * @brief Returns the block starting at line, or nullptr.
+     * @param line
+    */
+    const uint8_t *find_block(int32_t line) const;
+
+    /**
+     * @brief Translate the block starting at line.
+     *
+     * @param line
+     * @return The block, or nullptr if the instruction at line cannot be
+     *         translated.
+    */
+    const uint8_t *compile(int32_t line);
+
+    /**
+     * @brief Run translated code until it leaves the translated blocks.
+     *
+     * @param block The block to start at.
+     * @param registers The 32 guest registers.
+     * @param memory The words of guest memory.
+     * @param instruction_count Incremented by the number of instructions
+     *                          executed.
+     * @return The next line to execute, combined with JIT_EXIT_HALT or
+     *         JIT_EXIT_FALLBACK.
+    */
+    int32_t enter(
+        const uint8_t *block,
+        int32_t *registers,
+        int32_t *memory,
+        int64_t *instruction_count
+    ) const;
+
+    /**
+     * @brief Drop all translated blocks.
+    */
+    void invalidate();
+};
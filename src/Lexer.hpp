@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#include <Instruction.hpp>
+
+// Names of instructions allowed, indexed by operation ID
+constexpr const char *INSTRUCTION_NAMES[]{
+    "add",  "sub",   "mul",
+    "and",  "or",    "nor",
+    "slt",  "addi",  "andi",
+    "ori",  "slti",  "lw",
+    "sw",   "beq",   "bne",
+    "j",    "halt",  "syscall",
+    "addu", "subu",  "xor",
+    "sltu", "sllv",  "srlv",
+    "srav", "sll",   "srl",
+    "sra",  "addiu", "xori",
+    "sltiu", "lui",  "mult",
+    "multu", "div",  "divu",
+    "mfhi", "mflo",  "mthi",
+    "mtlo", "lb",    "lbu",
+    "lh",   "lhu",   "sb",
+    "sh",   "blez",  "bgtz",
+    "bltz", "bgez",  "jal",
+    "jr",   "jalr",  "nop"
+};
+
+// Length of the longest instruction name
+constexpr size_t LONGEST_INSTRUCTION_NAME{ 7 };
+
+// Names of registers, indexed by register number
+constexpr const char *REGISTER_NAMES[]{
+    "zero", "at", "v0", "v1",
+    "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9",
+    "k0", "k1",
+    "gp", "sp", "s8", "ra"
+};
+
+
+/**
+ * @brief Hash a name for PerfectHashTable.
+ * @param name
+ * @param seed
+ * @return
+*/
+constexpr uint32_t hash_name(std::string_view name, uint32_t seed)
+{
+    uint32_t hash{ seed };
+
+    for (const char character : name)
+        hash = (hash ^ static_cast<uint8_t>(character)) * 0x0100'0193u;
+
+    hash ^= hash >> 15;
+    hash *= 0x2C1B'3C6Du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+
+/**
+ * @brief Hash table without collisions for a fixed set of names, built at
+ *        compile time.
+ *
+ * The seed has to be chosen so that no two names share a slot, which
+ * is_perfect() checks.
+ *
+ * @tparam COUNT Number of names.
+ * @tparam SIZE Number of slots, a power of two.
+ */
+template <size_t COUNT, size_t SIZE>
+class PerfectHashTable
+{
+    const char *const *m_names;
+    uint32_t m_seed;
+    // Index of the name in every slot plus one, 0 for empty slots
+    uint8_t m_slots[SIZE];
+    bool m_perfect;
+
+public:
+    constexpr PerfectHashTable(const char *const (&names)[COUNT], uint32_t seed)
+        : m_names{ names }
+        , m_seed{ seed }
+        , m_slots{}
+        , m_perfect{ true }
+    {
+        for (size_t i{}; i < COUNT; i++)
+        {
+            uint8_t &slot{ m_slots[hash_name(names[i], seed) % SIZE] };
+
+            if (slot != 0)
+                m_perfect = false;
+
+            slot = static_cast<uint8_t>(i + 1);
+        }
+    }
+
+    /**
+     * @brief Returns true if every name has its own slot.
+    */
+    constexpr bool is_perfect() const
+    {
+        return m_perfect;
+    }
+
+    /**
+     * @brief Find the index of a name.
+     *
+     * @param name
+     * @return The index, or -1 if the name is not in the table.
+    */
+    constexpr int32_t find(std::string_view name) const
+    {
+        const uint8_t slot{ m_slots[hash_name(name, m_seed) % SIZE] };
+
+        if (slot == 0 || name != m_names[slot - 1])
+            return -1;
+
+        return slot - 1;
+    }
+};
+
+
+constexpr PerfectHashTable<OPERATION_COUNT, 128> INSTRUCTION_TABLE{ INSTRUCTION_NAMES, 37385 };
+constexpr PerfectHashTable<32, 64> REGISTER_TABLE{ REGISTER_NAMES, 3437 };
+
+static_assert(INSTRUCTION_TABLE.is_perfect(), "Instruction names collide");
+static_assert(REGISTER_TABLE.is_perfect(), "Register names collide");
+
+
+/**
+ * @brief Returns true for the characters that separate tokens.
+ * @param character
+ * @return
+*/
+constexpr bool is_space(char character)
+{
+    return character == ' ' || character == '\t';
+}
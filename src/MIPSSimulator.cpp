@@ -1,1280 +1,3453 @@
 #include <MIPSSimulator.hpp>
+#include <JitCompiler.hpp>
+#include <ProgramCache.hpp>
+#include <Lexer.hpp>
+#include <Snapshot.hpp>
+#include <ProgramAssembler.hpp>
 
 #include <iostream>
-#include <fstream>
 #include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdio>
 
 
-MIPSSimulator::MIPSSimulator(
-    int32_t mode,
-    const std::string &file_name
-)
-    : m_max_length{ 10'000 }
-    , m_number_of_instructions{}
-    , m_program_counter{}
-    , m_halt_value{}
+namespace
 {
-    m_memory.clear();
-    m_table_of_labels.clear();
-
-    // Names of registers
-    const std::string temp_registers[]{
-        "zero", "at", "v0", "v1",
-        "a0", "a1", "a2", "a3",
-        "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
-        "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
-        "t8", "t9",
-        "k0", "k1",
-        "gp", "sp", "s8", "ra"
-    };
 
-    for (int32_t i{}; i < 32; i++)
-        m_registers[i] = temp_registers[i];
+/**
+ * @brief Pair of operations that can be fused into a superinstruction.
+ */
+struct FusionCandidate
+{
+    int32_t first;
+    int32_t second;
+};
+
+// Pairs that can be fused. Superinstruction OPERATION_FUSED + i executes
+// FUSION_CANDIDATES[i].
+constexpr FusionCandidate FUSION_CANDIDATES[]{
+    { OPERATION_SLT, OPERATION_BNE },
+    { OPERATION_SLT, OPERATION_BEQ },
+    { OPERATION_SLTI, OPERATION_BNE },
+    { OPERATION_SLTI, OPERATION_BEQ },
+    { OPERATION_ADDI, OPERATION_BNE },
+    { OPERATION_ADDI, OPERATION_BEQ },
+    { OPERATION_ADDI, OPERATION_SLT },
+    { OPERATION_ADDI, OPERATION_J },
+};
+constexpr int32_t FUSION_CANDIDATE_COUNT{
+    sizeof(FUSION_CANDIDATES) / sizeof(FUSION_CANDIDATES[0])
+};
+
+// Number of dispatches counted before choosing the pairs to fuse
+constexpr int64_t FUSION_WARMUP{ 10'000 };
+// Maximum number of candidates fused
+constexpr int32_t FUSION_MAX_PAIRS{ 4 };
+// Number of pairs shown by display_pair_statistics()
+constexpr int32_t HISTOGRAM_LENGTH{ 10 };
+// Value of $gp, unless an executable defines _gp
+constexpr int32_t DEFAULT_GLOBAL_POINTER{ 100'000'000 };
+
+/**
+ * @brief Append text right-aligned in a field, like printf("%*s").
+ * @param text
+ * @param field
+ * @param width Minimum width, longer fields are not cut.
+*/
+void append_field(std::string &text, std::string_view field, size_t width)
+{
+    if (field.size() < width)
+        text.append(width - field.size(), ' ');
+
+    text += field;
+}
+
 
-    // Initialize registers to 0
-    for (int32_t i{}; i < 32; i++)
-        m_register_values[i] = 0;
+/**
+ * @brief Append a number right-aligned in a field, like printf("%*d").
+ * @param text
+ * @param value
+ * @param width
+*/
+void append_decimal(std::string &text, int32_t value, size_t width)
+{
+    char digits[16];
+    const char *end{ std::to_chars(digits, digits + sizeof(digits), value).ptr };
+    append_field(text, { digits, static_cast<size_t>(end - digits) }, width);
+}
 
-    // Names of instructions allowed
-    const std::string temp_instruction_set[]{
-        "add", "sub",  "mul",
-        "and", "or",   "nor",
-        "slt", "addi", "andi",
-        "ori", "slti", "lw",
-        "sw",  "beq",  "bne",
-        "j",   "halt"
+
+/**
+ * @brief Append a non-negative number in lowercase hexadecimal, right-aligned
+ *        in a field, like printf("%*x").
+ * @param text
+ * @param value
+ * @param width
+*/
+void append_hex(std::string &text, int32_t value, size_t width)
+{
+    char digits[16];
+    const char *end{
+        std::to_chars(digits, digits + sizeof(digits), static_cast<uint32_t>(value), 16).ptr
     };
+    append_field(text, { digits, static_cast<size_t>(end - digits) }, width);
+}
+
 
-    for (int32_t i{}; i < 17; i++)
-        m_instruction_set[i] = temp_instruction_set[i];
+}
 
-    // Initialize stack elements to 0
-    for (int32_t i{}; i < STACK_SIZE; i++)
-        m_stack[i] = 0;
 
-    // Stack pointer at bottom element
-    m_register_values[29] =      40'396;
-    m_register_values[28] = 100'000'000;
-    // Set mode
-    m_mode = mode;
+template <typename... Args>
+void MIPSSimulator::print(const char *format, Args... args)
+{
+    char line[256];
+    const int32_t length{ std::snprintf(line, sizeof(line), format, args...) };
 
-    std::ifstream input_file{};
-    input_file.open(file_name.c_str(), std::ios::in);
+    if (length < 0)
+        return;
 
-    // If open failed
-    if (!input_file)
+    if (length < static_cast<int32_t>(sizeof(line)))
     {
-        std::cout << "Error: File does not exist or could not be opened.\n";
-        exit(1);
+        m_output.write(line, length);
+        return;
     }
 
-    std::string temp_string;
-    // Read line by line
-    while (getline(input_file, temp_string))
-    {
-        m_number_of_instructions++;
-        // Check number of instructions with maximum allowed
-        if (m_number_of_instructions>m_max_length)
-        {
-            std::cout << "Error: Number of lines in input too large, maximum "
-                "allowed is " << m_max_length << " lines.\n";
-            exit(1);
-        }
+    // Long labels do not fit
+    std::string long_line(length + 1, '\0');
+    std::snprintf(long_line.data(), long_line.size(), format, args...);
+    m_output.write(long_line.data(), length);
+}
 
-        // Store in m_input_program.
-        m_input_program.push_back(temp_string);
-    }
 
-    input_file.close();
+MIPSSimulator::MIPSSimulator(int32_t engine, std::ostream &output)
+    : m_engine{ engine }
+    , m_output{ output }
+    , m_status{ STATUS_ERROR }
+    , m_error{ "No program loaded." }
+    , m_error_line{ -1 }
+    , m_machine_code{}
+    , m_disassembled{}
+    , m_text_address{}
+    , m_global_pointer{ DEFAULT_GLOBAL_POINTER }
+    , m_number_of_instructions{}
+    , m_program_counter{}
+    , m_halt_value{}
+    , m_instruction_count{}
+    , m_count_pairs{}
+    , m_fusion{}
+    , m_fusion_selected{}
+    , m_fusion_order{}
+    , m_pair_counts{}
+    , m_previous_operation{ -1 }
+    , m_dispatch_count{}
+    , m_fused_dispatch_count{}
+    , m_stack_size{ DEFAULT_STACK_SIZE }
+    , m_heap_size{ DEFAULT_HEAP_SIZE }
+    , m_program_break{ MEMORY_BASE }
+    , m_exit_code{}
+    , m_main_line{}
+    , m_rebuild_cache{}
+    , m_cached_lines{ -1 }
+    , m_history_line{}
+    , m_breakpoint_count{}
+    , m_source_hash{}
+    , m_source_hashed{}
+{
+    reset_registers();
+    m_console.connect(&m_output, nullptr);
 }
 
 
-void MIPSSimulator::execute()
+void MIPSSimulator::enable_pair_histogram()
 {
-    // To remove effect of pressing enter key while starting
-    getchar();
-    // Populate list of memory elements and labels
-    pre_process();
-    // Traverse instructions till end or till halt
-    while (m_program_counter < m_number_of_instructions && m_halt_value == 0)
-    {
-        read_instruction(m_program_counter);
-        remove_spaces(m_current_instruction);
+    m_count_pairs = true;
+}
 
-        // Ignore blank instructions
-        if (m_current_instruction == "")
-        {
-            m_program_counter++;
-            continue;
-        }
 
-        // Get operationID
-        int32_t instruction{ parse_instruction() };
-        execute_instruction(instruction);
+void MIPSSimulator::enable_fusion()
+{
+    if (m_engine == ENGINE_INTERPRETER && m_trace == nullptr && m_history == nullptr)
+        m_fusion = true;
+}
 
-        // If not jump, update ProgramCounter here
-        if (instruction < 13 || instruction > 15)
-            m_program_counter++;
 
-        // If step by step mode, display state and wait
-        if (m_mode == 0 && m_halt_value == 0)
-        {
-            display_state();
-            getchar();
-        }
-    }
-    // Display state at end.
-    display_state();
-    // If program ended without halt
-    if (m_halt_value == 0)
+void MIPSSimulator::enable_cache(const std::string &directory, bool rebuild)
+{
+    m_cache_directory = directory;
+    m_rebuild_cache = rebuild;
+}
+
+
+void MIPSSimulator::enable_trace(const std::string &path)
+{
+    // Superinstructions would hide one of their two steps
+    m_fusion = false;
+    m_trace = std::make_unique<TraceRecorder>();
+    m_trace_path = path;
+}
+
+
+void MIPSSimulator::enable_history(int64_t checkpoint_interval, size_t memory_limit)
+{
+    // Superinstructions cannot be taken back one step at a time
+    m_fusion = false;
+    m_history = std::make_unique<ExecutionHistory>(checkpoint_interval, memory_limit);
+}
+
+
+void MIPSSimulator::enable_profile()
+{
+    m_profile = std::make_unique<ExecutionProfile>();
+    m_profile->reset(m_number_of_instructions);
+}
+
+
+void MIPSSimulator::enable_pipeline(const PipelineConfig &config)
+{
+    // Superinstructions would hide the instructions they combine
+    m_fusion = false;
+    m_pipeline = std::make_unique<PipelineModel>(config);
+    m_pipeline->reset(m_number_of_instructions);
+}
+
+
+void MIPSSimulator::enable_instruction_cache(const CacheConfig &config)
+{
+    m_fusion = false;
+    m_instruction_cache = std::make_unique<CacheModel>(config);
+    m_instruction_cache->reset(m_number_of_instructions);
+}
+
+
+void MIPSSimulator::enable_data_cache(const CacheConfig &config)
+{
+    m_fusion = false;
+    m_data_cache = std::make_unique<CacheModel>(config);
+    m_data_cache->reset(m_number_of_instructions);
+    m_data_cache->set_regions(data_regions());
+}
+
+
+void MIPSSimulator::enable_branch_prediction(const std::vector<PredictorConfig> &configs)
+{
+    m_fusion = false;
+    m_branch_predictors = std::make_unique<BranchPredictorSet>(configs);
+    m_branch_predictors->reset(m_number_of_instructions);
+}
+
+
+void MIPSSimulator::enable_statistics()
+{
+    m_statistics = std::make_unique<HostStatistics>();
+}
+
+
+void MIPSSimulator::set_memory_size(int32_t stack_size, int32_t heap_size)
+{
+    m_stack_size = stack_size;
+    m_heap_size = heap_size;
+}
+
+
+void MIPSSimulator::set_console(std::ostream *output, std::istream *input)
+{
+    m_console.connect(output, input);
+}
+
+
+bool MIPSSimulator::set_breakpoint(int32_t line, bool enabled)
+{
+    if (line < 0 || static_cast<size_t>(line) >= m_breakpoints.size())
+        return false;
+
+    if ((m_breakpoints[line] != 0) != enabled)
     {
-        std::cout << "Error: Program ended without halt.\n";
-        exit(1);
+        m_breakpoints[line] = enabled;
+        m_breakpoint_count += enabled ? 1 : -1;
     }
 
-    std::cout << "\nExecution completed successfully.\n\n";
+    // A superinstruction runs both of its lines in one step, so one that
+    // ends on the line would never stop there. Split it again.
+    if (enabled && line > 0 && m_program[line - 1].operation >= OPERATION_FUSED)
+        m_program[line - 1].operation =
+            FUSION_CANDIDATES[m_program[line - 1].operation - OPERATION_FUSED].first;
+
+    return true;
 }
 
 
-void MIPSSimulator::pre_process()
+void MIPSSimulator::reset_registers()
 {
-    int32_t i;
-    int32_t j;
+    // Initialize registers to 0, HI and LO included
+    for (int32_t i{}; i < REGISTER_COUNT; i++)
+        m_register_values[i] = 0;
 
-    // current_section == 0 -> data section
-    // current_section == 1 -> text section
-    int32_t current_section{ -1 };
-    // To hold index of ".data"
-    int32_t index;
-    int32_t comment_index;
-    // Whether "..data" found
-    int32_t flag{};
-    std::string temp_string{};
-    int	is_label{};
-    int	done_flag{};
-    // Line number for start of data section
-    int32_t data_start{};
-    int32_t text_start{};
+    // Stack pointer at bottom element
+    m_register_values[29] = m_memory.stack_top();
+    m_register_values[28] = m_global_pointer;
+}
 
-    for (i = 0; i < m_number_of_instructions; i++)
-    {
-        read_instruction(i);
-        if (m_current_instruction.empty())
-            continue;
 
-        // Search for beginning of data section
-        index = m_current_instruction.find(".data");
+void MIPSSimulator::reset_memory()
+{
+    m_memory.clear();
+    std::copy(
+        m_initial_data.begin(),
+        m_initial_data.end(),
+        m_memory.words() + m_memory.stack_size() / 4
+    );
+    m_program_break = m_memory.heap_address();
+}
 
-        // Not found
-        if (index == -1)
-            continue;
-        // Found .data
-        else if (flag == 0)
+
+SimulationResult MIPSSimulator::load(const std::string &file_name)
+{
+    // Forget everything about the previous program
+    m_memory.configure(m_stack_size, m_heap_size);
+    m_text_address = 0;
+    m_global_pointer = DEFAULT_GLOBAL_POINTER;
+    reset_registers();
+    m_program.clear();
+    m_initial_data.clear();
+    m_labels.clear();
+    m_data_labels.clear();
+    m_program_counter = 0;
+    m_halt_value = 0;
+    m_exit_code = 0;
+    m_console.clear();
+    m_instruction_count = 0;
+    m_fusion_selected = false;
+    m_fusion_order.clear();
+    std::fill(&m_pair_counts[0][0], &m_pair_counts[0][0] + OPERATION_COUNT * OPERATION_COUNT, 0);
+    m_previous_operation = -1;
+    m_dispatch_count = 0;
+    m_fused_dispatch_count = 0;
+    m_cached_lines = -1;
+    m_status = STATUS_RUNNING;
+    m_error.clear();
+    m_error_line = -1;
+    m_breakpoints.clear();
+    m_breakpoint_count = 0;
+    m_source_hashed = false;
+    m_disassembled = false;
+
+    if (m_history != nullptr)
+        m_history->clear();
+
+    PhaseTimer timer{ m_statistics.get(), PHASE_LOAD };
+
+    try
+    {
+        m_number_of_instructions = 0;
+        m_machine_code = m_binary.open(file_name);
+
+        if (m_machine_code)
         {
-            // Set as found
-            flag = 1;
-            // Assert that nothing is before
-            only_spaces(0, index, m_current_instruction);
-            // Assert that nothing is after
-            only_spaces(
-                index + 5,
-                m_current_instruction.size(),
-                m_current_instruction
-            );
+            load_machine_code();
+        } else
+        {
+            // Map the file and index its lines
+            if (!m_input_program.open(file_name))
+                report_program_error("File does not exist or could not be opened.");
 
-            // Set section
-            current_section = 0;
-            // Set location where section starts
-            data_start = i;
+            m_number_of_instructions = m_input_program.size();
+
+            // Reuse the work of an earlier run on the same source, if possible
+            if (!load_program_image())
+            {
+                // Populate the data section and labels
+                pre_process();
+                // Allocate the decoded form of the program
+                pre_decode();
+            }
         }
-        // For multiple findings of ".data"
-        else if (flag == 1)
+
+        m_breakpoints.assign(m_number_of_instructions, 0);
+
+        if (m_profile != nullptr)
+            m_profile->reset(m_number_of_instructions);
+        if (m_pipeline != nullptr)
+            m_pipeline->reset(m_number_of_instructions);
+        if (m_instruction_cache != nullptr)
+            m_instruction_cache->reset(m_number_of_instructions);
+        if (m_data_cache != nullptr)
+            m_data_cache->reset(m_number_of_instructions);
+        if (m_branch_predictors != nullptr)
+            m_branch_predictors->reset(m_number_of_instructions);
+
+        // Execution changes memory, but reset() and the image need the
+        // initial data section
+        if (!m_memory.allocate(4 * static_cast<int32_t>(m_initial_data.size())))
+            report_program_error("Program does not fit in memory.");
+        reset_memory();
+        // Data regions end where free memory starts, known from here on
+        if (m_data_cache != nullptr)
+            m_data_cache->set_regions(data_regions());
+        m_history_line = m_program_counter;
+        begin_trace();
+    }
+    catch (const SimulationError &error)
+    {
+        // Still show the stack and the data read before the error
+        if (m_memory.word_count() == 0)
         {
-            std::cout << "Error: Multiple instances of .data.\n";
-            report_error();
+            if (!m_memory.allocate(4 * static_cast<int32_t>(m_initial_data.size())))
+                m_initial_data.clear();
+            if (m_memory.word_count() == 0)
+                m_memory.allocate(0);
+            reset_memory();
         }
+
+        fail(error);
     }
 
-    // To store index of ":"
-    int32_t label_index;
+    return result();
+}
 
-    // In data section
-    if (current_section == 0)
-    {
-        for (i = data_start + 1; i < m_number_of_instructions; i++)
-        {
-            read_instruction(i);
-            remove_spaces(m_current_instruction);
 
-            if (m_current_instruction.empty())
-                continue;
+SimulationResult MIPSSimulator::decode_program()
+{
+    if (m_status == STATUS_ERROR || m_machine_code)
+        return result();
 
-            label_index = m_current_instruction.find(":");
-            // If ":" not found
-            if (label_index == -1)
-            {
-                // f text section has not started
-                if (m_current_instruction.find(".text") == -1)
-                {
-                    std::cout << "Error: Unexpected symbol in data section.\n";
-                    report_error();
-                } else
-                    break;
-            }
+    const int32_t program_counter{ m_program_counter };
+    try
+    {
+        for (int32_t line{ find_text_line() + 1 }; line < m_number_of_instructions; line++)
+            if (m_program[line].operation == OPERATION_UNDECODED)
+                decode_instruction(line);
+    }
+    catch (const SimulationError &error)
+    {
+        m_program_counter = program_counter;
+        return SimulationResult{ STATUS_ERROR, error.what(), error.line() };
+    }
+    m_program_counter = program_counter;
 
-            // If found at first place
-            if (label_index == 0)
-            {
-                std::cout << "Error: Label name expected.\n";
-                report_error();
-            }
+    return result();
+}
 
-            // Ignore spaces before ":" till label
-            j = label_index - 1;
-            while (
-                j >= 0
-                &&
-                m_current_instruction[j] ==' '
-                || 
-                m_current_instruction[j] =='\t'
-            )
-                j--;
 
-            //To store label name
-            temp_string = "";
-            // Label name complete
-            int32_t done_flag{};
-            for (j = 0; j >= 0; j--)
-            {
-                // Till label name characters are being found
-                if (
-                    m_current_instruction[j] !=' '
-                    &&
-                    m_current_instruction[j] != '\t'
-                    &&
-                    done_flag == 0
-                )
-                    temp_string = m_current_instruction[j]+temp_string;
-                // If something found after name ends
-                else if (
-                    m_current_instruction[j] != ' '
-                    &&
-                    m_current_instruction[j] != '\t'
-                    &&
-                    done_flag == 1
-                )
-                {
-                    std::cout << "Error: Unexpected text before label name.\n";
-                    report_error();
-                }
-                // Name ended
-                else
-                    done_flag = 1;
-            }
+SimulationResult MIPSSimulator::assemble(const std::string &path)
+{
+    if (m_status == STATUS_ERROR)
+        return result();
+    if (m_machine_code)
+        return SimulationResult{ STATUS_ERROR, "Program is already machine code.", -1 };
+
+    PhaseTimer timer{ m_statistics.get(), PHASE_ASSEMBLE };
+
+    // Lines are normally decoded when first reached, but every line needs
+    // its address
+    const SimulationResult decoded{ decode_program() };
+    if (decoded.status == STATUS_ERROR)
+        return decoded;
+
+    const int32_t text_start{ find_text_line() };
+
+    // The data section takes no code, and superinstructions are encoded as
+    // the lines they were made from
+    std::vector<Instruction> program{ m_program };
+    std::fill_n(program.begin(), text_start + 1, Instruction{ .operation = OPERATION_BLANK, .r = {} });
+    for (Instruction &instruction : program)
+        if (instruction.operation >= OPERATION_FUSED)
+            instruction.operation =
+                FUSION_CANDIDATES[instruction.operation - OPERATION_FUSED].first;
+
+    ProgramAssembler assembler;
+    int32_t error_line{ -1 };
+    const char *error{ assembler.assemble(program, m_main_line, m_labels, error_line) };
+    if (error != nullptr)
+        return SimulationResult{ STATUS_ERROR, error, error_line };
+
+    assembler.set_data(m_memory.data_address(), m_initial_data, m_data_labels, m_global_pointer);
+
+    if (!assembler.write(path))
+        return SimulationResult{ STATUS_ERROR, "Could not write " + path + ".", -1 };
+
+    return result();
+}
 
-            // Check validity of name
-            assert_label_allowed(temp_string);
 
-            // Create memory and store memory element
-            MemoryElement temp_memory{ .label = temp_string };
+void MIPSSimulator::reset()
+{
+    // A program that failed to load cannot be restarted
+    if (m_program.empty())
+        return;
+
+    reset_registers();
+    reset_memory();
+
+    m_program_counter = m_main_line;
+    m_history_line = m_main_line;
+    m_halt_value = 0;
+    m_exit_code = 0;
+    m_console.clear();
+    m_instruction_count = 0;
+    std::fill(&m_pair_counts[0][0], &m_pair_counts[0][0] + OPERATION_COUNT * OPERATION_COUNT, 0);
+    m_previous_operation = -1;
+    m_dispatch_count = 0;
+    m_fused_dispatch_count = 0;
+    m_status = STATUS_RUNNING;
+    m_error.clear();
+    m_error_line = -1;
+
+    if (m_history != nullptr)
+        m_history->clear();
+
+    if (m_profile != nullptr)
+        m_profile->reset(m_number_of_instructions);
+    if (m_pipeline != nullptr)
+        m_pipeline->reset(m_number_of_instructions);
+    if (m_instruction_cache != nullptr)
+        m_instruction_cache->reset(m_number_of_instructions);
+    if (m_data_cache != nullptr)
+        m_data_cache->reset(m_number_of_instructions);
+    if (m_branch_predictors != nullptr)
+        m_branch_predictors->reset(m_number_of_instructions);
+
+    try
+    {
+        begin_trace();
+    }
+    catch (const SimulationError &error)
+    {
+        fail(error);
+    }
+}
 
-            // Search for ".word" in the same way
-            uint64_t word_index{ m_current_instruction.find(".word") };
-            if (word_index == -1)
-            {
-                std::cout << "Error: .word not found.\n";
-                report_error();
-            }
 
-            only_spaces(label_index + 1, word_index, m_current_instruction);
+SimulationResult MIPSSimulator::step()
+{
+    if (m_status != STATUS_RUNNING)
+        return result();
 
-            int32_t found_value{};
-            int32_t done_finding{};
-            temp_string = "";
-            for (j = word_index + 5; j < m_current_instruction.size(); j++)
-            {
-                if (
-                    found_value == 1
-                    &&
-                    (
-                        m_current_instruction[j] == ' '
-                        ||
-                        m_current_instruction[j] == '\t'
-                    )
-                    &&
-                    done_finding == 0
-                )
-                    done_finding = 1;
-
-                else if (
-                    found_value == 1
-                    &&
-                    m_current_instruction[j] != ' '
-                    &&
-                    m_current_instruction[j] != '\t'
-                    &&
-                    done_finding == 1
-                )
-                {
-                    std::cout << "Error: Unexpected text after value.\n";
-                    report_error();
-                } else if (
-                    found_value == 0
-                    &&
-                    m_current_instruction[j] != ' '
-                    &&
-                    m_current_instruction[j] != '\t'
-                )
-                {
-                    found_value = 1;
-                    temp_string = temp_string + m_current_instruction[j];
-                } else if (
-                    found_value == 1
-                    &&
-                    m_current_instruction[j] != ' '
-                    &&
-                    m_current_instruction[j] != '\t'
-                )
-                    temp_string = temp_string + m_current_instruction[j];
-            }
+    PhaseTimer timer{ m_statistics.get(), PHASE_RUN };
 
-            // Check that number found is a valid integer
-            assert_number(temp_string);
-            // Change type and store
-            temp_memory.value = stoi(temp_string);
-            // Add to list
-            m_memory.push_back(temp_memory);
-        }
-    }
+    if (m_profile != nullptr)
+        m_profile->enter(m_program_counter);
+
+    try
+    {
+        bool executed{};
 
-    // Sort for easy comparison
-    sort(m_memory.begin(), m_memory.end(), MemoryElement::sort_memory);
+        // Ignore blank instructions
+        while (!executed && m_program_counter < m_number_of_instructions)
+            executed = run_instruction() != OPERATION_BLANK;
 
-    // Check for duplicates
-    for (i = 0; m_memory.size() > 0 && i < m_memory.size() - 1; i++)
+        // Running past the last line is only reported by the step after it,
+        // so that the state after the last instruction can still be seen
+        if (m_halt_value != 0 || !executed)
+            finish();
+    }
+    catch (const SimulationError &error)
     {
-        if (m_memory[i].label == m_memory[i + 1].label)
-        {
-            std::cout << "Error: One or more labels are repeated.\n";
-            exit(1);
-        }
+        fail(error);
     }
 
-    int32_t text_flag{};
-    int32_t text_index{};
-    
-    for (i = m_program_counter; i < m_number_of_instructions; i++)
+    leave_profile();
+    m_console.flush();
+    return result();
+}
+
+
+SimulationResult MIPSSimulator::run()
+{
+    if (m_status != STATUS_RUNNING)
+        return result();
+
+    PhaseTimer timer{ m_statistics.get(), PHASE_RUN };
+
+    if (m_profile != nullptr)
+        m_profile->enter(m_program_counter);
+
+    try
     {
-        read_instruction(i);
-        if (m_current_instruction.empty())
-            continue;
+        if (!needs_interpreter() && m_engine == ENGINE_THREADED)
+            run_threaded();
+        else if (!needs_interpreter() && m_engine == ENGINE_JIT)
+            run_jit();
 
-        // Find text section similar as above
-        text_index = m_current_instruction.find(".text");
-        if (text_index == -1)
-            continue;
-        else if (text_flag == 0)
-        {
-            text_flag = 1;
-            only_spaces(0, text_index, m_current_instruction);
-            only_spaces(
-                text_index + 5,
-                m_current_instruction.size(),
-                m_current_instruction
-            );
-            current_section = 1;
-            text_start = i;
-        } else if (text_flag == 1)
+        if (m_breakpoint_count > 0)
         {
-            std::cout << "Error: Multiple instances of .text.\n";
-            report_error();
+            // Leave the breakpoint execution may have stopped at
+            if (m_program_counter < m_number_of_instructions && m_halt_value == 0)
+                run_instruction();
+
+            while (m_program_counter < m_number_of_instructions
+                && m_halt_value == 0
+                && m_breakpoints[m_program_counter] == 0)
+                run_instruction();
+
+            if (m_program_counter < m_number_of_instructions && m_halt_value == 0)
+            {
+                leave_profile();
+                m_console.flush();
+                return result();
+            }
         }
-    }
 
-    // If text section not found
-    if (current_section != 1)
+        // Traverse instructions till end or till halt
+        while (m_program_counter < m_number_of_instructions && m_halt_value == 0)
+            run_instruction();
+
+        finish();
+    }
+    catch (const SimulationError &error)
     {
-        std::cout << "Error: Text section does not exist or found unknown string.\n";
-        exit(1);
+        fail(error);
     }
 
-    // Location of main label
-    int32_t main_index{};
+    leave_profile();
+    m_console.flush();
+    return result();
+}
+
+
+void MIPSSimulator::finish()
+{
+    // If program ended without halt
+    if (m_halt_value == 0)
+        report_program_error("Program ended without halt.");
+
+    m_status = STATUS_HALTED;
+    save_program_image();
+
+    if (m_trace != nullptr && !m_trace->end())
+        report_program_error("Trace could not be written.");
+}
+
+
+void MIPSSimulator::fail(const SimulationError &error)
+{
+    m_status = STATUS_ERROR;
+    m_error = error.what();
+    m_error_line = error.line();
+
+    // The trace ends with the last instruction that completed
+    if (m_trace != nullptr)
+        m_trace->end();
+}
+
+
+void MIPSSimulator::leave_profile()
+{
+    if (m_profile == nullptr)
+        return;
+
+    // Stopped before the instruction at the program counter
+    if (m_status == STATUS_RUNNING)
+        m_profile->leave(m_program_counter);
+    // Failed in the instruction at the program counter, so execution did
+    // not go on to the line after it
+    else if (m_status == STATUS_ERROR
+        && m_halt_value == 0
+        && m_program_counter < m_number_of_instructions)
+        m_profile->leave(m_program_counter + 1);
+}
+
+
+void MIPSSimulator::begin_trace()
+{
+    if (m_trace == nullptr)
+        return;
+
+    const bool started{
+        m_trace->begin(
+            m_trace_path,
+            m_program_counter,
+            m_text_address,
+            m_register_values,
+            m_memory,
+            m_data_labels
+        )
+    };
+
+    if (!started)
+        report_program_error("Trace file could not be created.");
+}
+
+
+void MIPSSimulator::trace_instruction(int32_t operation)
+{
+    // The trace ends when execution goes back
+    if (!m_trace->is_recording())
+        return;
+
+    const int32_t written{ written_register(current_instruction(operation)) };
+
+    if (written >= REGISTER_HI || is_multiply_divide(operation))
+        m_trace->record_hi_lo(
+            m_program_counter,
+            m_register_values[REGISTER_HI],
+            m_register_values[REGISTER_LO]
+        );
+    else if (written >= 0)
+        m_trace->record_register(m_program_counter, written, m_register_values[written]);
+    // sw, sb and sh, which write part of a word
+    else if (is_store(operation))
+    {
+        const int32_t address{ (m_register_values[r[1]] + r[2]) & ~3 };
+        m_trace->record_memory(
+            m_program_counter,
+            m_memory.word_index(address),
+            m_memory.load_word(address)
+        );
+    }
+    // Reads and sbrk write $v0, other system calls leave it as it was
+    else if (operation == OPERATION_SYSCALL)
+        m_trace->record_register(m_program_counter, 2, m_register_values[2]);
+    else
+        m_trace->record_step(m_program_counter);
+}
+
+
+bool MIPSSimulator::needs_interpreter() const
+{
+    return m_trace != nullptr || m_history != nullptr || m_pipeline != nullptr
+        || m_instruction_cache != nullptr || m_data_cache != nullptr
+        || m_branch_predictors != nullptr
+        || m_breakpoint_count > 0;
+}
+
+
+bool MIPSSimulator::rewind_to(int64_t instruction_count)
+{
+    if (m_history == nullptr
+        || m_history->earliest() < 0
+        || instruction_count < m_history->earliest()
+        || instruction_count > m_instruction_count)
+        return false;
+
+    if (instruction_count == m_instruction_count)
+        return true;
+
+    // A trace only describes one run forward
+    if (m_trace != nullptr)
+        m_trace->end();
+
+    const Checkpoint &checkpoint{ *m_history->find_checkpoint(instruction_count) };
+
+    // Executing forward from the checkpoint is shorter than undoing
+    if (instruction_count - checkpoint.instruction_count
+        < m_instruction_count - instruction_count)
+    {
+        m_program_counter = checkpoint.program_counter;
+        m_history_line = checkpoint.program_counter;
+        m_instruction_count = checkpoint.instruction_count;
+        std::copy(checkpoint.registers, checkpoint.registers + REGISTER_COUNT, m_register_values);
+        std::copy(checkpoint.memory.begin(), checkpoint.memory.end(), m_memory.words());
+        m_program_break = checkpoint.program_break;
+        m_console.seek(checkpoint.output_position, checkpoint.input_position);
+
+        m_history->truncate(checkpoint.instruction_count);
+    }
+
+    while (m_instruction_count > instruction_count)
+        undo_instruction();
+
+    m_halt_value = 0;
+    m_exit_code = 0;
+    m_status = STATUS_RUNNING;
+    m_error.clear();
+    m_error_line = -1;
+
+    if (m_profile != nullptr)
+        m_profile->enter(m_program_counter);
+
+    try
+    {
+        // These instructions ran before, so they cannot fail
+        while (m_instruction_count < instruction_count)
+            run_instruction();
+    }
+    catch (const SimulationError &error)
+    {
+        fail(error);
+    }
+
+    leave_profile();
+
+    return true;
+}
+
+
+bool MIPSSimulator::reverse_step()
+{
+    return m_instruction_count > 0 && rewind_to(m_instruction_count - 1);
+}
+
+
+bool MIPSSimulator::reverse_continue()
+{
+    if (!reverse_step())
+        return false;
+
+    while (!move_to_breakpoint() && m_instruction_count > m_history->earliest())
+        undo_instruction();
+
+    return true;
+}
+
+
+bool MIPSSimulator::move_to_breakpoint()
+{
+    if (m_breakpoint_count == 0)
+        return false;
+
+    // Blank and label lines before the next instruction change nothing, so
+    // execution can stand at any of them
+    for (int32_t line{ m_program_counter }; line < m_number_of_instructions; line++)
+    {
+        if (m_breakpoints[line] != 0)
+        {
+            m_program_counter = line;
+            return true;
+        }
+
+        const int32_t operation{ m_program[line].operation };
+        if (operation != OPERATION_BLANK && operation != OPERATION_LABEL)
+            return false;
+    }
+
+    return false;
+}
+
+
+uint64_t MIPSSimulator::source_hash()
+{
+    if (!m_source_hashed)
+    {
+        m_source_hash = ProgramCache::hash(program_contents());
+        m_source_hashed = true;
+    }
+
+    return m_source_hash;
+}
+
+
+bool MIPSSimulator::save_snapshot(const std::string &path)
+{
+    if (m_program.empty())
+        return false;
+
+    SnapshotHeader header{};
+    header.source_hash       = source_hash();
+    header.source_size       = program_contents().size();
+    header.instruction_count = m_instruction_count;
+    header.program_counter   = m_program_counter;
+    header.halt_value        = m_halt_value;
+    header.exit_code         = m_exit_code;
+    header.program_break     = m_program_break;
+    header.stack_size        = m_memory.stack_size();
+    header.memory_size       = 4 * m_memory.word_count();
+
+    return Snapshot::save(path, header, m_register_values, m_memory.words());
+}
+
+
+bool MIPSSimulator::restore_snapshot(const std::string &path)
+{
+    Snapshot snapshot;
+
+    if (m_program.empty() || !snapshot.open(path))
+        return false;
+
+    const SnapshotHeader &header{ snapshot.header() };
+
+    if (
+        header.source_size != program_contents().size()
+        ||
+        header.source_hash != source_hash()
+        ||
+        header.stack_size != static_cast<uint32_t>(m_memory.stack_size())
+        ||
+        header.memory_size != 4 * m_memory.word_count()
+        ||
+        header.program_counter < 0
+        ||
+        header.program_counter > m_number_of_instructions
+        ||
+        header.program_break < m_memory.heap_address()
+        ||
+        header.program_break > m_memory.end_address()
+    )
+        return false;
+
+    snapshot.copy_registers(m_register_values);
+    snapshot.copy_memory(m_memory.words());
+    m_program_counter = header.program_counter;
+    m_history_line = header.program_counter;
+    m_halt_value = header.halt_value;
+    m_exit_code = header.exit_code;
+    m_program_break = header.program_break;
+    m_instruction_count = header.instruction_count;
+    m_status = m_halt_value != 0 ? STATUS_HALTED : STATUS_RUNNING;
+    m_error.clear();
+    m_error_line = -1;
+
+    // The past before the snapshot is not known
+    if (m_history != nullptr)
+        m_history->clear();
+    m_console.clear();
+
+    try
+    {
+        begin_trace();
+    }
+    catch (const SimulationError &error)
+    {
+        fail(error);
+    }
+
+    return true;
+}
+
+
+int64_t MIPSSimulator::earliest_instruction_count() const
+{
+    return m_history == nullptr ? -1 : m_history->earliest();
+}
+
+
+UndoRecord MIPSSimulator::make_undo_record(int32_t operation) const
+{
+    UndoRecord record{
+        .program_counter = m_history_line,
+        .kind = UNDO_NONE,
+        .index = 0,
+        .value = 0
+    };
+
+    const int32_t written{ written_register(current_instruction(operation)) };
+
+    if (written >= 0)
+    {
+        record.kind = UNDO_REGISTER;
+        record.index = written;
+        record.value = m_register_values[written];
+    }
+    else if (is_multiply_divide(operation))
+    {
+        record.kind = UNDO_HI_LO;
+        record.index = m_register_values[REGISTER_HI];
+        record.value = m_register_values[REGISTER_LO];
+    }
+    else if (is_store(operation))
+    {
+        const int32_t address{ m_register_values[r[1]] + r[2] };
+
+        // Other addresses fail without writing anything
+        if (m_memory.contains(address))
+        {
+            record.kind = UNDO_MEMORY;
+            record.index = static_cast<int32_t>(m_memory.word_index(address & ~3));
+            record.value = m_memory.load_word(address & ~3);
+        }
+    }
+    else if (operation == OPERATION_SYSCALL)
+    {
+        const int32_t service{ m_register_values[2] };
+        const int64_t position{ m_console.output_position() };
+
+        // Reads and sbrk write $v0, which holds the service before
+        if (service == 5 || service == 12 || service == 9)
+        {
+            record.kind = service == 9 ? UNDO_BREAK : UNDO_INPUT;
+            record.value = service;
+        }
+        else if (service == 1 || service == 4 || service == 11)
+        {
+            record.kind = UNDO_OUTPUT;
+            record.index = static_cast<int32_t>(position >> 32);
+            record.value = static_cast<int32_t>(position);
+        }
+    }
+
+    return record;
+}
+
+
+void MIPSSimulator::save_checkpoint()
+{
+    Checkpoint checkpoint{
+        .instruction_count = m_instruction_count,
+        .program_counter = m_history_line,
+        .registers = {},
+        .memory = std::vector<int32_t>(m_memory.words(), m_memory.words() + m_memory.word_count()),
+        .program_break = m_program_break,
+        .output_position = m_console.output_position(),
+        .input_position = m_console.input_position()
+    };
+    std::copy(m_register_values, m_register_values + REGISTER_COUNT, checkpoint.registers);
+
+    m_history->add_checkpoint(std::move(checkpoint));
+}
+
+
+bool MIPSSimulator::undo_instruction()
+{
+    UndoRecord record;
+    if (!m_history->pop(record))
+        return false;
+
+    if (record.kind == UNDO_REGISTER)
+        m_register_values[record.index] = record.value;
+    else if (record.kind == UNDO_MEMORY)
+        m_memory.words()[record.index] = record.value;
+    else if (record.kind == UNDO_OUTPUT)
+        m_console.seek(
+            (int64_t{ record.index } << 32) | static_cast<uint32_t>(record.value),
+            m_console.input_position()
+        );
+    else if (record.kind == UNDO_INPUT)
+    {
+        m_register_values[2] = record.value;
+        m_console.seek(m_console.output_position(), m_console.input_position() - 1);
+    }
+    else if (record.kind == UNDO_BREAK)
+    {
+        // sbrk returned the break before it
+        m_program_break = m_register_values[2];
+        m_register_values[2] = record.value;
+    }
+    else if (record.kind == UNDO_HI_LO)
+    {
+        m_register_values[REGISTER_HI] = record.index;
+        m_register_values[REGISTER_LO] = record.value;
+    }
+
+    m_program_counter = record.program_counter;
+    m_history_line = record.program_counter;
+    m_instruction_count--;
+    m_halt_value = 0;
+    m_exit_code = 0;
+    return true;
+}
+
+
+SimulationResult MIPSSimulator::result() const
+{
+    return SimulationResult{
+        .status = m_status,
+        .error = m_error,
+        .error_line = m_error_line
+    };
+}
+
+
+bool MIPSSimulator::has_halted() const
+{
+    return m_halt_value != 0;
+}
+
+
+int32_t MIPSSimulator::exit_code() const
+{
+    return m_exit_code;
+}
+
+
+int64_t MIPSSimulator::instruction_count() const
+{
+    return m_instruction_count;
+}
+
+
+int32_t MIPSSimulator::program_counter() const
+{
+    return m_program_counter;
+}
+
+
+int32_t MIPSSimulator::program_counter_address() const
+{
+    return m_text_address + 4 * m_program_counter;
+}
+
+
+int32_t MIPSSimulator::register_value(int32_t index) const
+{
+    return m_register_values[index];
+}
+
+
+const GuestMemory &MIPSSimulator::memory() const
+{
+    return m_memory;
+}
+
+
+int32_t MIPSSimulator::data_address(std::string_view label) const
+{
+    return m_data_labels.find(label);
+}
+
+
+std::string_view MIPSSimulator::source_line(int32_t line) const
+{
+    return program_text()[line];
+}
+
+
+int32_t MIPSSimulator::run_instruction()
+{
+    const Instruction &current{ m_program[m_program_counter] };
+
+    // Parse the line the first time it is reached
+    if (current.operation == OPERATION_UNDECODED)
+        decode_instruction(m_program_counter);
+
+    if (current.operation == OPERATION_BLANK)
+    {
+        m_program_counter++;
+        return OPERATION_BLANK;
+    }
+
+    // Get operationID and operands
+    const int32_t instruction{ current.operation };
+
+    if (instruction >= OPERATION_FUSED)
+    {
+        m_instruction_count += 2;
+        m_dispatch_count++;
+        m_fused_dispatch_count++;
+
+        if (m_count_pairs)
+            count_dispatch(instruction);
+
+        execute_fused();
+        return instruction;
+    }
+
+    r[0] = current.r[0];
+    r[1] = current.r[1];
+    r[2] = current.r[2];
+
+    UndoRecord undo{};
+    if (m_history != nullptr && instruction >= 0)
+    {
+        if (m_history->is_checkpoint_due(m_instruction_count))
+            save_checkpoint();
+
+        undo = make_undo_record(instruction);
+    }
+
+    const int32_t line{ m_program_counter };
+
+    // The base register of a load may be the one it loads, so the address
+    // is taken before executing. Accesses that fail are not counted.
+    int32_t data_address{};
+    const bool data_access{ m_data_cache != nullptr && is_memory_access(instruction) };
+    if (data_access)
+        data_address = m_register_values[r[1]] + r[2];
+
+    execute_instruction(instruction);
+
+    if (m_instruction_cache != nullptr && instruction >= 0)
+        m_instruction_cache->access(
+            static_cast<uint32_t>(m_text_address + 4 * line), false, line
+        );
+    if (data_access)
+        m_data_cache->access(static_cast<uint32_t>(data_address), is_store(instruction), line);
+
+    // Label lines do not count
+    if (instruction >= 0)
+        m_instruction_count++;
+
+    // If not jump, update ProgramCounter here
+    if (!is_jump(instruction))
+        m_program_counter++;
+
+    if (m_pipeline != nullptr && instruction >= 0)
+        m_pipeline->add(line, current, m_program_counter);
+
+    if (m_branch_predictors != nullptr && is_jump(instruction))
+        m_branch_predictors->add(
+            line,
+            current,
+            m_program_counter,
+            static_cast<uint32_t>(m_text_address + 4 * line),
+            static_cast<uint32_t>(m_text_address + 4 * m_program_counter)
+        );
+
+    if (m_trace != nullptr && instruction >= 0)
+        trace_instruction(instruction);
+
+    if (m_history != nullptr && instruction >= 0)
+    {
+        m_history->push(undo);
+        m_history_line = m_program_counter;
+    }
+
+    if (m_count_pairs || m_fusion)
+    {
+        m_dispatch_count++;
+
+        // Fusion only needs the pairs seen before choosing what to fuse
+        if (m_count_pairs || !m_fusion_selected)
+            count_dispatch(instruction);
+    }
+
+    return instruction;
+}
+
+
+void MIPSSimulator::count_dispatch(int32_t operation)
+{
+    if (operation >= OPERATION_FUSED)
+    {
+        const FusionCandidate &pair{
+            FUSION_CANDIDATES[operation - OPERATION_FUSED]
+        };
+        count_pair(pair.first);
+        count_pair(pair.second);
+        return;
+    }
+
+    count_pair(operation);
+
+    if (m_fusion && !m_fusion_selected && m_dispatch_count >= FUSION_WARMUP)
+        select_fusions();
+}
+
+
+void MIPSSimulator::count_pair(int32_t operation)
+{
+    // Labels do not take part in pairs
+    if (operation < 0)
+        return;
+
+    if (m_previous_operation >= 0)
+        m_pair_counts[m_previous_operation][operation]++;
+
+    m_previous_operation = operation;
+}
+
+
+void MIPSSimulator::select_fusions()
+{
+    int32_t order[FUSION_CANDIDATE_COUNT];
+
+    for (int32_t i{}; i < FUSION_CANDIDATE_COUNT; i++)
+        order[i] = i;
+
+    // Most frequent candidates first
+    std::stable_sort(
+        order,
+        order + FUSION_CANDIDATE_COUNT,
+        [this](int32_t a, int32_t b)
+        {
+            const FusionCandidate &x{ FUSION_CANDIDATES[a] };
+            const FusionCandidate &y{ FUSION_CANDIDATES[b] };
+            return m_pair_counts[x.first][x.second]
+                > m_pair_counts[y.first][y.second];
+        }
+    );
+
+    for (int32_t i{}; i < FUSION_MAX_PAIRS; i++)
+    {
+        const FusionCandidate &pair{ FUSION_CANDIDATES[order[i]] };
+        if (m_pair_counts[pair.first][pair.second] > 0)
+            m_fusion_order.push_back(order[i]);
+    }
+
+    m_fusion_selected = true;
+
+    // Fuse the most frequent pair first where pairs overlap
+    const std::vector<int32_t> order_by_count{ m_fusion_order };
+    for (const int32_t candidate : order_by_count)
+    {
+        m_fusion_order.assign(1, candidate);
+        for (int32_t line{}; line < m_number_of_instructions; line++)
+            fuse_instruction(line);
+    }
+
+    m_fusion_order = order_by_count;
+}
+
+
+void MIPSSimulator::fuse_instruction(int32_t line)
+{
+    if (line < 0 || line + 1 >= m_number_of_instructions)
+        return;
+
+    Instruction &first{ m_program[line] };
+    const Instruction &second{ m_program[line + 1] };
+
+    // A line is part of at most one superinstruction, and the second line
+    // must not have a breakpoint, which the superinstruction would skip
+    if (
+        first.operation >= OPERATION_FUSED
+        ||
+        second.operation >= OPERATION_FUSED
+        ||
+        (line > 0 && m_program[line - 1].operation >= OPERATION_FUSED)
+        ||
+        m_breakpoints[line + 1] != 0
+    )
+        return;
+
+    // Superinstructions skip all checks, so only fuse instructions which
+    // cannot fail them
+    if (
+        first.operation < 0
+        ||
+        second.operation < 0
+        ||
+        !has_valid_registers(first)
+        ||
+        !has_valid_registers(second)
+        ||
+        first.r[0] == 29
+        ||
+        (second.operation == OPERATION_SLT && second.r[0] == 29)
+    )
+        return;
+
+    for (const int32_t i : m_fusion_order)
+    {
+        if (
+            FUSION_CANDIDATES[i].first == first.operation
+            &&
+            FUSION_CANDIDATES[i].second == second.operation
+        )
+        {
+            first.operation = OPERATION_FUSED + i;
+            return;
+        }
+    }
+}
+
+
+void MIPSSimulator::execute_fused()
+{
+    const int32_t line{ m_program_counter };
+    const Instruction &first{ m_program[line] };
+    const int32_t *a{ first.r };
+    const int32_t *b{ m_program[line + 1].r };
+    int32_t *values{ m_register_values };
+    // Whether the branch or jump in the second line is taken
+    bool taken{};
+
+    switch (first.operation - OPERATION_FUSED)
+    {
+    case 0: // slt, bne
+        values[a[0]] = values[a[1]] < values[a[2]];
+        taken = values[b[0]] != values[b[1]];
+        break;
+    case 1: // slt, beq
+        values[a[0]] = values[a[1]] < values[a[2]];
+        taken = values[b[0]] == values[b[1]];
+        break;
+    case 2: // slti, bne
+        values[a[0]] = values[a[1]] < a[2];
+        taken = values[b[0]] != values[b[1]];
+        break;
+    case 3: // slti, beq
+        values[a[0]] = values[a[1]] < a[2];
+        taken = values[b[0]] == values[b[1]];
+        break;
+    case 4: // addi, bne
+        values[a[0]] = values[a[1]] + a[2];
+        taken = values[b[0]] != values[b[1]];
+        break;
+    case 5: // addi, beq
+        values[a[0]] = values[a[1]] + a[2];
+        taken = values[b[0]] == values[b[1]];
+        break;
+    case 6: // addi, slt
+        values[a[0]] = values[a[1]] + a[2];
+        values[b[0]] = values[b[1]] < values[b[2]];
+        m_program_counter = line + 2;
+        return;
+    case 7: // addi, j
+        values[a[0]] = values[a[1]] + a[2];
+        if (m_profile != nullptr)
+            m_profile->count_taken(line + 1);
+        m_program_counter = b[0];
+        return;
+    }
+
+    if (taken && m_profile != nullptr)
+        m_profile->count_taken(line + 1);
+    m_program_counter = taken ? b[2] : line + 2;
+}
+
+
+void MIPSSimulator::display_pair_statistics()
+{
+    if (!m_count_pairs && !m_fusion)
+        return;
+
+    // Collect the pairs that occurred, most frequent first
+    std::vector<std::pair<int64_t, int32_t>> pairs;
+
+    for (int32_t i{}; i < OPERATION_COUNT; i++)
+        for (int32_t j{}; j < OPERATION_COUNT; j++)
+            if (m_pair_counts[i][j] > 0)
+                pairs.emplace_back(m_pair_counts[i][j], OPERATION_COUNT * i + j);
+
+    std::stable_sort(
+        pairs.begin(),
+        pairs.end(),
+        [](const auto &a, const auto &b) { return a.first > b.first; }
+    );
+
+    if (m_count_pairs)
+    {
+        m_output << "Most frequent operation pairs:\n";
+        for (size_t i{}; i < pairs.size() && i < HISTOGRAM_LENGTH; i++)
+            print(
+                "%6s -> %-6s%12lld\n",
+                INSTRUCTION_NAMES[pairs[i].second / OPERATION_COUNT],
+                INSTRUCTION_NAMES[pairs[i].second % OPERATION_COUNT],
+                static_cast<long long>(pairs[i].first)
+            );
+        m_output << '\n';
+    }
+
+    if (m_fusion)
+    {
+        m_output << "Fused pairs:";
+        for (const int32_t i : m_fusion_order)
+            m_output
+                << ' ' << INSTRUCTION_NAMES[FUSION_CANDIDATES[i].first]
+                << '+' << INSTRUCTION_NAMES[FUSION_CANDIDATES[i].second];
+        m_output << '\n';
+    }
+
+    m_output
+        << "Dispatches: " << m_dispatch_count
+        << ", removed by fusion: " << m_fused_dispatch_count << "\n\n";
+}
+
+
+std::vector<ProfileRegion> MIPSSimulator::profile_regions() const
+{
+    std::vector<ProfileRegion> regions;
+
+    m_labels.for_each(
+        [&regions](std::string_view name, int32_t line)
+        {
+            regions.emplace_back(line, name);
+        }
+    );
+    // main is kept apart from the other labels, on the line before m_main_line.
+    // Machine code has symbols for every function instead.
+    if (!m_machine_code)
+        regions.emplace_back(m_main_line - 1, "main");
+
+    std::sort(regions.begin(), regions.end());
+    return regions;
+}
+
+
+std::vector<ProfileRegion> MIPSSimulator::data_regions() const
+{
+    std::vector<ProfileRegion> regions;
+
+    regions.emplace_back(m_memory.stack_address(), "(stack)");
+    m_data_labels.for_each(
+        [&regions](std::string_view name, int32_t address)
+        {
+            regions.emplace_back(address, name);
+        }
+    );
+    regions.emplace_back(m_memory.heap_address(), "(free memory)");
+
+    return regions;
+}
+
+
+void MIPSSimulator::display_profile()
+{
+    if (m_profile == nullptr || m_program.empty())
+        return;
+
+    m_profile->display(m_output, program_text(), m_program, profile_regions());
+    m_output << '\n';
+}
+
+
+void MIPSSimulator::display_pipeline()
+{
+    if (m_pipeline == nullptr || m_program.empty())
+        return;
+
+    m_pipeline->display(m_output, program_text(), m_program);
+    m_output << '\n';
+}
+
+
+void MIPSSimulator::display_branch_prediction()
+{
+    if (m_branch_predictors == nullptr || m_program.empty())
+        return;
+
+    m_branch_predictors->display(m_output, program_text(), m_program);
+    m_output << '\n';
+}
+
+
+void MIPSSimulator::display_caches()
+{
+    if (m_program.empty())
+        return;
+
+    if (m_instruction_cache != nullptr)
+    {
+        m_instruction_cache->display(
+            m_output, "Instruction cache", program_text(), m_program, profile_regions()
+        );
+        m_output << '\n';
+    }
+    if (m_data_cache != nullptr)
+    {
+        m_data_cache->display(
+            m_output, "Data cache", program_text(), m_program, profile_regions()
+        );
+        m_output << '\n';
+    }
+}
+
+
+void MIPSSimulator::write_folded_profile(std::ostream &output, std::string_view root) const
+{
+    if (m_profile == nullptr || m_program.empty())
+        return;
+
+    m_profile->write_folded(output, root, program_text(), m_program, profile_regions());
+}
+
+
+void MIPSSimulator::write_statistics(std::ostream &output)
+{
+    if (m_statistics == nullptr)
+        return;
+
+    static const char *const engine_names[]{ "interpreter", "threaded", "jit" };
+    // Features that need every instruction run everything in the interpreter
+    const int32_t engine{ needs_interpreter() ? ENGINE_INTERPRETER : m_engine };
+
+    m_statistics->write_json(output, engine_names[engine], m_instruction_count);
+}
+
+
+void MIPSSimulator::run_jit()
+{
+    JitCompiler compiler{
+        m_program,
+        m_memory,
+        m_profile != nullptr ? m_profile->taken_counts() : nullptr
+    };
+
+    // Leave everything to the interpreter loop
+    if (!compiler.is_available())
+        return;
+
+    // Number of times each line was reached outside translated code
+    std::vector<int32_t> heat(m_number_of_instructions);
+
+    while (m_program_counter < m_number_of_instructions && m_halt_value == 0)
+    {
+        const uint8_t *block{ compiler.find_block(m_program_counter) };
+
+        if (block == nullptr && ++heat[m_program_counter] >= JIT_THRESHOLD)
+        {
+            block = compiler.compile(m_program_counter);
+
+            // Try again once the line is decoded, but never retry lines
+            // that cannot be translated
+            if (block == nullptr)
+                heat[m_program_counter] =
+                    m_program[m_program_counter].operation == OPERATION_UNDECODED
+                    ? 0
+                    : INT32_MIN;
+        }
+
+        if (block == nullptr)
+        {
+            run_instruction();
+            continue;
+        }
+
+        const int32_t exit{
+            compiler.enter(
+                block,
+                m_register_values,
+                m_memory.words(),
+                &m_instruction_count
+            )
+        };
+        m_program_counter = exit & ~(JIT_EXIT_HALT | JIT_EXIT_FALLBACK);
+
+        if (exit & JIT_EXIT_HALT)
+            m_halt_value = 1;
+        // Let the interpreter report the error
+        else if (exit & JIT_EXIT_FALLBACK)
+            run_instruction();
+    }
+}
+
+
+void MIPSSimulator::pre_process()
+{
+    PhaseTimer timer{ m_statistics.get(), PHASE_PRE_PROCESS };
+    int32_t i;
+
+    // current_section == 0 -> data section
+    // current_section == 1 -> text section
+    int32_t current_section{ -1 };
+    // To hold index of ".data"
+    int32_t index;
+    // Whether "..data" found
+    int32_t flag{};
+    // Line number for start of data section
+    int32_t data_start{};
+    int32_t text_start{};
+
+    for (i = 0; i < m_number_of_instructions; i++)
+    {
+        read_instruction(i);
+        if (m_current_instruction.empty())
+            continue;
+
+        // Search for beginning of data section
+        index = m_current_instruction.find(".data");
+
+        // Not found
+        if (index == -1)
+            continue;
+        // Found .data
+        else if (flag == 0)
+        {
+            // Set as found
+            flag = 1;
+            // Assert that nothing is before
+            only_spaces(0, index, m_current_instruction);
+            // Assert that nothing is after
+            only_spaces(
+                index + 5,
+                m_current_instruction.size(),
+                m_current_instruction
+            );
+
+            // Set section
+            current_section = 0;
+            // Set location where section starts
+            data_start = i;
+        }
+        // For multiple findings of ".data"
+        else if (flag == 1)
+        {
+            report_error("Multiple instances of .data.");
+        }
+    }
+
+    // To store index of ":"
+    int32_t label_index;
+
+    // In data section
+    if (current_section == 0)
+    {
+        for (i = data_start + 1; i < m_number_of_instructions; i++)
+        {
+            read_instruction(i);
+            remove_spaces(m_current_instruction);
+
+            if (m_current_instruction.empty())
+                continue;
+
+            label_index = m_current_instruction.find(":");
+            // If ":" not found
+            if (label_index == -1)
+            {
+                // f text section has not started
+                if (m_current_instruction.find(".text") == std::string_view::npos)
+                {
+                    report_error("Unexpected symbol in data section.");
+                } else
+                    break;
+            }
+
+            // If found at first place
+            if (label_index == 0)
+            {
+                report_error("Label name expected.");
+            }
+
+            // Check validity of name
+            const std::string_view label{ find_label_name(label_index) };
+            assert_label_allowed(label);
+
+            // The directive follows the label
+            std::string_view directive{ m_current_instruction.substr(label_index + 1) };
+            remove_spaces(directive);
+            if (
+                directive.substr(0, 5) != ".word"
+                &&
+                directive.substr(0, 6) != ".space"
+                &&
+                directive.substr(0, 6) != ".ascii"
+            )
+            {
+                report_error(".word not found.");
+            }
+
+            // Link the label to the address of its first word, checking for
+            // duplicates
+            const int32_t address{
+                m_memory.data_address() + 4 * static_cast<int32_t>(m_initial_data.size())
+            };
+            if (!m_data_labels.insert(label, address))
+            {
+                report_program_error("One or more labels are repeated.");
+            }
+
+            parse_data(directive);
+        }
+    }
+
+    int32_t text_flag{};
+    int32_t text_index{};
+    
+    for (i = 0; i < m_number_of_instructions; i++)
+    {
+        read_instruction(i);
+        if (m_current_instruction.empty())
+            continue;
+
+        // Find text section similar as above
+        text_index = m_current_instruction.find(".text");
+        if (text_index == -1)
+            continue;
+        else if (text_flag == 0)
+        {
+            text_flag = 1;
+            only_spaces(0, text_index, m_current_instruction);
+            only_spaces(
+                text_index + 5,
+                m_current_instruction.size(),
+                m_current_instruction
+            );
+            current_section = 1;
+            text_start = i;
+        } else if (text_flag == 1)
+        {
+            report_error("Multiple instances of .text.");
+        }
+    }
+
+    // If text section not found
+    if (current_section != 1)
+    {
+        report_program_error("Text section does not exist or found unknown string.");
+    }
+
+    // Location of main label
+    int32_t main_index{};
     // Whether main label found
     int32_t found_main{};
     label_index = 0;
     for (i = text_start + 1; i < m_number_of_instructions; i++)
     {
-        read_instruction(i);
-        if (m_current_instruction.empty())
-            continue;
+        read_instruction(i);
+        if (m_current_instruction.empty())
+            continue;
+
+        // Find labels similar as above
+        label_index = m_current_instruction.find(":");
+        if (label_index == 0)
+        {
+            report_error("Label name expected.");
+        }
+
+        if (label_index == -1)
+            continue;
+
+        const std::string_view label{ find_label_name(label_index) };
+        assert_label_allowed(label);
+        // Check that nothing is after label
+        only_spaces(
+            label_index + 1,
+            m_current_instruction.size(),
+            m_current_instruction
+        );
+
+        // For main, set variables as needed
+        if (label == "main")
+        {
+            found_main = 1;
+            main_index = m_program_counter + 1;
+        }
+        // Store labels, checking for duplicates
+        else if (!m_labels.insert(label, m_program_counter))
+        {
+            report_program_error("One or more labels are repeated.");
+        }
+    }
+
+    // If main label not found
+    if (found_main == 0)
+    {
+        report_program_error("Could not find main.");
+    }
+
+    // Set program counter.
+    m_program_counter = main_index;
+    m_main_line = main_index;
+}
+
+
+bool MIPSSimulator::load_program_image()
+{
+    if (m_cache_directory.empty() || m_rebuild_cache)
+        return false;
+
+    const ProgramCache cache{ m_cache_directory };
+
+    if (
+        !cache.load(
+            m_input_program.contents(),
+            m_memory.data_address(),
+            m_main_line,
+            m_program,
+            m_labels,
+            m_data_labels,
+            m_initial_data
+        )
+        ||
+        m_number_of_instructions < 0
+        ||
+        m_program.size() != static_cast<size_t>(m_number_of_instructions)
+    )
+    {
+        m_program.clear();
+        m_labels.clear();
+        m_data_labels.clear();
+        m_initial_data.clear();
+        return false;
+    }
+
+    m_cached_lines = 0;
+    for (const Instruction &instruction : m_program)
+        if (instruction.operation != OPERATION_UNDECODED)
+            m_cached_lines++;
+
+    m_program_counter = m_main_line;
+    return true;
+}
+
+
+void MIPSSimulator::save_program_image()
+{
+    // Machine code is decoded without parsing, so there is nothing to save
+    if (m_cache_directory.empty() || m_machine_code)
+        return;
+
+    PhaseTimer timer{ m_statistics.get(), PHASE_SAVE_IMAGE };
+
+    int32_t decoded_lines{};
+    for (const Instruction &instruction : m_program)
+        if (instruction.operation != OPERATION_UNDECODED)
+            decoded_lines++;
+
+    // Nothing new to store
+    if (decoded_lines == m_cached_lines)
+        return;
+
+    m_cached_lines = decoded_lines;
+
+    // Fusion depends on the run, so store the lines as they were decoded
+    std::vector<Instruction> program{ m_program };
+    for (Instruction &instruction : program)
+        if (instruction.operation >= OPERATION_FUSED)
+            instruction.operation =
+                FUSION_CANDIDATES[instruction.operation - OPERATION_FUSED].first;
+
+    const ProgramCache cache{ m_cache_directory };
+    cache.save(
+        m_input_program.contents(),
+        m_memory.data_address(),
+        m_main_line,
+        program,
+        m_labels,
+        m_data_labels,
+        m_initial_data
+    );
+}
+
+
+void MIPSSimulator::load_machine_code()
+{
+    const char *error{ m_binary.read() };
+    if (error != nullptr)
+        report_program_error(error);
+
+    m_number_of_instructions = m_binary.line_count();
+    m_text_address = static_cast<int32_t>(m_binary.text_address());
+
+    // The data section stays where it was linked, with the stack below it
+    if (!m_binary.data().empty()
+        && !m_memory.place_data(static_cast<int32_t>(m_binary.data_address())))
+        report_program_error("Program does not fit in memory.");
+    m_initial_data = m_binary.data();
+
+    if (m_binary.has_global_pointer())
+        m_global_pointer = m_binary.global_pointer();
+    reset_registers();
+
+    for (const BinarySymbol &symbol : m_binary.symbols())
+    {
+        if (symbol.code)
+            m_labels.insert(symbol.name, static_cast<int32_t>((symbol.address - m_binary.text_address()) / 4));
+        else
+            m_data_labels.insert(symbol.name, static_cast<int32_t>(symbol.address));
+    }
+
+    // Words that cannot be decoded stay undecoded, and are only reported if
+    // they are reached, like lines of assembly that do not parse
+    m_program.assign(
+        m_number_of_instructions,
+        Instruction{ .operation = OPERATION_UNDECODED, .r = {} }
+    );
+    for (int32_t line{}; line < m_number_of_instructions; line++)
+        m_binary.decode(line, m_program[line]);
+
+    m_main_line = m_binary.entry_line();
+    m_program_counter = m_main_line;
+}
+
+
+const SourceFile &MIPSSimulator::program_text() const
+{
+    if (!m_machine_code)
+        return m_input_program;
+
+    if (!m_disassembled)
+    {
+        m_disassembly.assign(m_binary.disassemble());
+        m_disassembled = true;
+    }
+
+    return m_disassembly;
+}
+
+
+std::string_view MIPSSimulator::program_contents() const
+{
+    return m_machine_code ? m_binary.contents() : m_input_program.contents();
+}
+
+
+void MIPSSimulator::pre_decode()
+{
+    m_program.assign(
+        m_number_of_instructions,
+        Instruction{ .operation = OPERATION_UNDECODED, .r = {} }
+    );
+}
+
+
+int32_t MIPSSimulator::find_text_line()
+{
+    // pre_process() checked that .text appears once
+    const int32_t program_counter{ m_program_counter };
+    int32_t text_line{};
+
+    for (int32_t line{}; line < m_number_of_instructions; line++)
+    {
+        read_instruction(line);
+        if (m_current_instruction.find(".text") != std::string_view::npos)
+        {
+            text_line = line;
+            break;
+        }
+    }
+
+    m_program_counter = program_counter;
+    return text_line;
+}
+
+
+void MIPSSimulator::decode_instruction(int32_t line)
+{
+    Instruction &instruction{ m_program[line] };
+
+    // Machine code was decoded when loading, so only words that could not be
+    // decoded are left, and they are reported once reached
+    if (m_machine_code)
+    {
+        m_program_counter = line;
+        const char *error{ m_binary.decode(line, instruction) };
+        report_error(error != nullptr ? error : "Unsupported instruction word.");
+    }
+
+    read_instruction(line);
+    remove_spaces(m_current_instruction);
+
+    if (m_current_instruction.empty())
+    {
+        instruction.operation = OPERATION_BLANK;
+        return;
+    }
+
+    instruction.operation = parse_instruction();
+    instruction.r[0] = r[0];
+    instruction.r[1] = r[1];
+    instruction.r[2] = r[2];
+
+    // Lines decoded after the fusion pass are fused as they appear
+    if (m_fusion_selected)
+    {
+        fuse_instruction(line - 1);
+        fuse_instruction(line);
+    }
+}
+
+
+void MIPSSimulator::report_error(std::string_view message)
+{
+    throw SimulationError{ std::string{ message }, m_program_counter };
+}
+
+
+void MIPSSimulator::report_program_error(std::string_view message)
+{
+    throw SimulationError{ std::string{ message }, -1 };
+}
+
+
+void MIPSSimulator::read_instruction(int32_t line)
+{
+    // Set current_instruction
+    m_current_instruction = m_input_program[line];
+    // Remove comments
+    size_t comment_index{ m_current_instruction.find('#') };
+
+    // Unless the '#' is inside a string
+    if (
+        comment_index != std::string_view::npos
+        &&
+        m_current_instruction.substr(0, comment_index).find('"') != std::string_view::npos
+    )
+    {
+        bool quoted{};
+        for (comment_index = 0; comment_index < m_current_instruction.size(); comment_index++)
+        {
+            const char character{ m_current_instruction[comment_index] };
+
+            if (character == '\\' && quoted)
+                comment_index++;
+            else if (character == '"')
+                quoted = !quoted;
+            else if (character == '#' && !quoted)
+                break;
+        }
+    }
+
+    if (comment_index < m_current_instruction.size())
+        m_current_instruction = m_current_instruction.substr(0, comment_index);
+
+    // Set m_program_counter
+    m_program_counter = line;
+}
+
+
+int32_t MIPSSimulator::parse_instruction()
+{
+    // Trim line.
+    remove_spaces(m_current_instruction);
+
+    // If label encountered
+    if (m_current_instruction.find(":") != std::string_view::npos)
+        return -2;
+
+    // No valid instruction is this small
+    if (m_current_instruction.size() < 3)
+    {
+        report_error("Unknown operation.");
+    }
+
+    size_t j;
+    // Find length of operation
+    const size_t longest{ std::min(LONGEST_INSTRUCTION_NAME, m_current_instruction.size()) };
+    for (j = 0; j < longest; j++)
+        if (is_space(m_current_instruction[j]))
+            break;
+
+    // Cut the operation out
+    const std::string_view operation{ m_current_instruction.substr(0, j) };
+    if (
+        m_current_instruction.size() > 0
+        &&
+        j < m_current_instruction.size() - 1
+    )
+        m_current_instruction.remove_prefix(j + 1);
+
+    // Check operation with allowed operations
+    const int32_t operation_ID{ INSTRUCTION_TABLE.find(operation) };
+
+    // If not valid
+    if (operation_ID == -1)
+    {
+        report_error("Unknown operation.");
+    }
+
+    // For R-format instructions, and shifts by a register
+    if (is_register_format(operation_ID))
+    {
+        // Find three registers separated by commas and put them in r[]
+        for (int32_t count{}; count <3 ; count++)
+        {
+            remove_spaces(m_current_instruction);
+            find_register(count);
+            remove_spaces(m_current_instruction);
+
+            if (count == 2)
+                break;
+
+            assert_remove_comma();
+        }
+
+        // If something more found
+        if (!m_current_instruction.empty())
+        {
+            report_error("Extra arguments provided.");
+        }
+    }
+    // For I-format instructions, and shifts by a constant
+    else if (is_immediate_format(operation_ID))
+    {
+        // Find two registers separated by commas
+        for (int32_t count{}; count < 2; count++)
+        {
+            remove_spaces(m_current_instruction);
+            find_register(count);
+            remove_spaces(m_current_instruction);
+            assert_remove_comma();
+        }
+
+        remove_spaces(m_current_instruction);
+        // Find third argument, a number
+        const std::string_view value{ find_label() };
+        // Check validity
+        assert_number(value);
+        // Convert and store
+        r[2] = to_number(value);
+
+        // sll, srl, sra
+        if (OPERATION_SLL <= operation_ID && operation_ID <= OPERATION_SRA && (r[2] < 0 || r[2] > 31))
+        {
+            report_error("Invalid shift amount.");
+        }
+    }
+    // For lw, sw, and the byte and halfword loads and stores
+    else if (is_memory_access(operation_ID))
+    {
+        remove_spaces(m_current_instruction);
+        // Find source/destination register
+        find_register(0);
+        remove_spaces(m_current_instruction);
+        // Find comma, ignoring extra spaces
+        assert_remove_comma();
+        remove_spaces(m_current_instruction);
+        // Find the address
+        parse_address();
+    } 
+    // For beq, bne
+    else if (operation_ID == OPERATION_BEQ || operation_ID == OPERATION_BNE)
+    {
+        // Find two registers separated by commas
+        for (int32_t count{}; count < 2; count++)
+        {
+            remove_spaces(m_current_instruction);
+            find_register(count);
+            remove_spaces(m_current_instruction);
+            assert_remove_comma();
+        }
+
+        remove_spaces(m_current_instruction);
+        // Find label and set r[2]
+        r[2] = m_labels.find(find_label());
+
+        // If label not found
+        if (r[2] == -1)
+        {
+            report_error("Invalid label.");
+        }
+    }
+    // For j, jal
+    else if (operation_ID == OPERATION_J || operation_ID == OPERATION_JAL)
+    {
+        remove_spaces(m_current_instruction);
+        // Find jump label and set r[0]
+        r[0] = m_labels.find(find_label());
+
+        // If label not found
+        if (r[0] == -1)
+        {
+            report_error("Invalid label.");
+        }
+    }
+    // For lui
+    else if (operation_ID == OPERATION_LUI)
+    {
+        remove_spaces(m_current_instruction);
+        find_register(0);
+        remove_spaces(m_current_instruction);
+        assert_remove_comma();
+
+        // Find the constant for the upper half
+        const std::string_view value{ find_label() };
+        assert_number(value);
+        r[1] = 0;
+        r[2] = to_number(value);
+    }
+    // For mult, multu, div, divu
+    else if (is_multiply_divide(operation_ID))
+        parse_registers(2);
+    // For mfhi, mflo, mthi, mtlo, jr, jalr
+    else if ((OPERATION_MFHI <= operation_ID && operation_ID <= OPERATION_MTLO) || is_register_jump(operation_ID))
+        parse_registers(1);
+    // For blez, bgtz, bltz, bgez
+    else if (is_zero_branch(operation_ID))
+    {
+        remove_spaces(m_current_instruction);
+        find_register(0);
+        remove_spaces(m_current_instruction);
+        assert_remove_comma();
+
+        // Find label and set r[2]
+        r[1] = 0;
+        r[2] = m_labels.find(find_label());
+
+        // If label not found
+        if (r[2] == -1)
+        {
+            report_error("Invalid label.");
+        }
+    }
+    // For halt, syscall and nop.
+    else
+        remove_spaces(m_current_instruction);
+
+    return operation_ID;
+}
+
+
+void MIPSSimulator::parse_address()
+{
+    // Find the offset or label, up to the base register
+    size_t j{};
+    while (
+        j < m_current_instruction.size()
+        &&
+        !is_space(m_current_instruction[j])
+        &&
+        m_current_instruction[j] != '('
+    )
+        j++;
+
+    const std::string_view offset{ m_current_instruction.substr(0, j) };
+    const bool is_label{
+        !offset.empty() && offset[0] != '-' && (offset[0] < '0' || offset[0] > '9')
+    };
+
+    if (is_label)
+    {
+        // The offset is the address of the label
+        r[2] = m_data_labels.find(offset);
+
+        // If label not found
+        if (r[2] == -1)
+        {
+            report_error("Invalid label.");
+        }
+    }
+    // If instruction ends there
+    else if (j == m_current_instruction.size())
+    {
+        report_error("'(' expected.");
+    }
+    // No offset means 0
+    else if (offset.empty())
+        r[2] = 0;
+    else
+    {
+        // Check validity of offset
+        assert_number(offset);
+        // Convert and store
+        r[2] = to_number(offset);
+    }
+
+    m_current_instruction.remove_prefix(j);
+    remove_spaces(m_current_instruction);
+
+    // A label alone is an address relative to $zero
+    if (is_label && m_current_instruction.empty())
+    {
+        r[1] = 0;
+        return;
+    }
+
+    if (
+        m_current_instruction.empty()
+        ||
+        m_current_instruction[0] != '('
+        ||
+        m_current_instruction.size() < 2
+    )
+    {
+        report_error("'(' expected.");
+    }
+
+    m_current_instruction.remove_prefix(1);
+    remove_spaces(m_current_instruction);
+    // Find register containing address
+    find_register(1);
+    remove_spaces(m_current_instruction);
+
+    if (
+        m_current_instruction.empty()
+        ||
+        m_current_instruction[0] != ')'
+    )
+    {
+        report_error("')' expected.");
+    }
+
+    m_current_instruction.remove_prefix(1);
+    only_spaces(0, m_current_instruction.size(), m_current_instruction);
+}
+
+
+void MIPSSimulator::parse_registers(int32_t count)
+{
+    for (int32_t i{}; i < count; i++)
+    {
+        remove_spaces(m_current_instruction);
+        find_register(i);
+        remove_spaces(m_current_instruction);
+
+        if (i + 1 < count)
+            assert_remove_comma();
+    }
+
+    // If something more found
+    if (!m_current_instruction.empty())
+    {
+        report_error("Extra arguments provided.");
+    }
+}
+
+
+void MIPSSimulator::parse_data(std::string_view directive)
+{
+    // Data section, stack and free memory together
+    const int64_t limit{ MAX_MEMORY_SIZE - m_memory.stack_size() - m_memory.heap_size() };
+
+    // Reserve a number of bytes, set to 0
+    if (directive.substr(0, 6) == ".space")
+    {
+        const std::string_view size{ find_word(directive.substr(6)) };
+        assert_number(size);
+        const int64_t bytes{ to_number(size) };
+
+        if (bytes <= 0)
+        {
+            report_error("Invalid size.");
+        }
+
+        // Keep the words after it aligned
+        const int64_t words{ static_cast<int64_t>(m_initial_data.size()) + (bytes + 3) / 4 };
+        if (4 * words > limit)
+        {
+            report_program_error("Program does not fit in memory.");
+        }
+
+        m_initial_data.resize(words);
+        return;
+    }
+
+    // Characters in double quotes, followed by a 0 byte for .asciiz, packed
+    // four to a word
+    if (directive.substr(0, 6) == ".ascii")
+    {
+        const bool terminated{ directive.substr(0, 7) == ".asciiz" };
+        std::string_view text{ directive.substr(terminated ? 7 : 6) };
+        remove_spaces(text);
+
+        if (text.empty() || text[0] != '"')
+        {
+            report_error("String expected.");
+        }
+
+        int64_t bytes{};
+        const auto append_byte{
+            [&](char character)
+            {
+                if (bytes % 4 == 0)
+                    m_initial_data.push_back(0);
+
+                m_initial_data.back() |=
+                    static_cast<int32_t>(static_cast<uint8_t>(character)) << (8 * (3 - bytes % 4));
+                bytes++;
+            }
+        };
+
+        size_t i{ 1 };
+        for (; i < text.size() && text[i] != '"'; i++)
+        {
+            if (text[i] != '\\')
+            {
+                append_byte(text[i]);
+                continue;
+            }
+
+            if (++i == text.size())
+                break;
+
+            switch (text[i])
+            {
+            case 'n': append_byte('\n'); break;
+            case 't': append_byte('\t'); break;
+            case '0': append_byte('\0'); break;
+            case '\\': case '"': append_byte(text[i]); break;
+            default:
+                report_error("Unknown escape sequence.");
+            }
+        }
+
+        if (i >= text.size())
+        {
+            report_error("'\"' expected.");
+        }
+
+        only_spaces(i + 1, text.size(), text);
+
+        if (terminated)
+            append_byte('\0');
+        // An empty .ascii still takes a word, like every label
+        else if (bytes == 0)
+            m_initial_data.push_back(0);
+    }
+    else
+    {
+        // Values separated by commas
+        std::string_view values{ directive.substr(5) };
+
+        for (;;)
+        {
+            const size_t comma{ values.find(',') };
+            const std::string_view value{ find_word(values.substr(0, comma)) };
+
+            // Check that number found is a valid integer
+            assert_number(value);
+            // Change type and store
+            m_initial_data.push_back(to_number(value));
+
+            if (comma == std::string_view::npos)
+                break;
+
+            values.remove_prefix(comma + 1);
+        }
+    }
+
+    if (4 * static_cast<int64_t>(m_initial_data.size()) > limit)
+    {
+        report_program_error("Program does not fit in memory.");
+    }
+}
+
+
+void MIPSSimulator::only_spaces(
+    int32_t lower,
+    int32_t upper,
+    std::string_view str
+)
+{
+    for (int32_t i{ lower }; i < upper; i++)
+    {
+        // Check that only ' ' and '\t' characters exist
+        if (!is_space(str[i]))
+        {
+            report_error("Unexpected character.");
+        }
+    }
+}
+
+
+void MIPSSimulator::execute_instruction(int32_t instruction)
+{
+    // Call appropriate function based on the value of instruction
+    switch (instruction)
+    {
+    case OPERATION_ADD:     add();     break;
+    case OPERATION_SUB:     sub();     break;
+    case OPERATION_MUL:     mul();     break;
+    case OPERATION_AND:     andf();    break;
+    case OPERATION_OR:      orf();     break;
+    case OPERATION_NOR:     nor();     break;
+    case OPERATION_SLT:     slt();     break;
+    case OPERATION_ADDI:    addi();    break;
+    case OPERATION_ANDI:    andi();    break;
+    case OPERATION_ORI:     ori();     break;
+    case OPERATION_SLTI:    slti();    break;
+    case OPERATION_LW:      lw();      break;
+    case OPERATION_SW:      sw();      break;
+    case OPERATION_BEQ:     beq();     break;
+    case OPERATION_BNE:     bne();     break;
+    case OPERATION_J:       j();       break;
+    case OPERATION_HALT:    halt();    break;
+    case OPERATION_SYSCALL: syscall(); break;
+    case OPERATION_ADDU:    addu();    break;
+    case OPERATION_SUBU:    subu();    break;
+    case OPERATION_XOR:     xorf();    break;
+    case OPERATION_SLTU:    sltu();    break;
+    case OPERATION_SLLV:    sllv();    break;
+    case OPERATION_SRLV:    srlv();    break;
+    case OPERATION_SRAV:    srav();    break;
+    case OPERATION_SLL:     sll();     break;
+    case OPERATION_SRL:     srl();     break;
+    case OPERATION_SRA:     sra();     break;
+    case OPERATION_ADDIU:   addiu();   break;
+    case OPERATION_XORI:    xori();    break;
+    case OPERATION_SLTIU:   sltiu();   break;
+    case OPERATION_LUI:     lui();     break;
+    case OPERATION_MULT:    mult();    break;
+    case OPERATION_MULTU:   multu();   break;
+    case OPERATION_DIV:     div();     break;
+    case OPERATION_DIVU:    divu();    break;
+    case OPERATION_MFHI:    mfhi();    break;
+    case OPERATION_MFLO:    mflo();    break;
+    case OPERATION_MTHI:    mthi();    break;
+    case OPERATION_MTLO:    mtlo();    break;
+    case OPERATION_LB:      lb();      break;
+    case OPERATION_LBU:     lbu();     break;
+    case OPERATION_LH:      lh();      break;
+    case OPERATION_LHU:     lhu();     break;
+    case OPERATION_SB:      sb();      break;
+    case OPERATION_SH:      sh();      break;
+    case OPERATION_BLEZ:    blez();    break;
+    case OPERATION_BGTZ:    bgtz();    break;
+    case OPERATION_BLTZ:    bltz();    break;
+    case OPERATION_BGEZ:    bgez();    break;
+    case OPERATION_JAL:     jal();     break;
+    case OPERATION_JR:      jr();      break;
+    case OPERATION_JALR:    jalr();    break;
+    case OPERATION_NOP:     nop();     break;
+
+    case OPERATION_LABEL:
+        // If instruction containing label, ignore
+        break;
+    default:
+        report_error("Invalid instruction received.");
+    }
+}
 
-        // Find labels similar as above
-        label_index = m_current_instruction.find(":");
-        if (label_index == 0)
+
+void MIPSSimulator::remove_spaces(std::string_view &str)
+{
+    size_t j{};
+
+    // Till only ' ' or '\t' found
+    while (j < str.size() && is_space(str[j]))
+        j++;
+
+    // Remove all of those
+    str.remove_prefix(j);
+}
+
+
+void MIPSSimulator::add()
+{
+    // Check that value of stack pointer is within bounds
+    if (r[0] == 29)
+        check_stack_bounds(m_register_values[r[1]] + m_register_values[r[2]]);
+
+    // Cannot modify $zero or use $at
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
+    {
+        // Execute
+        m_register_values[r[0]] =
+            m_register_values[r[1]] + m_register_values[r[2]];
+    } else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::addi()
+{
+    if (r[0] == 29)
+        check_stack_bounds(m_register_values[r[1]] + r[2]);
+
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
+    {
+        m_register_values[r[0]] = m_register_values[r[1]] + r[2];
+    } else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::sub()
+{
+    if (r[0] == 29)
+        check_stack_bounds(m_register_values[r[1]]-m_register_values[r[2]]);
+
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
+        m_register_values[r[0]] =
+            m_register_values[r[1]] - m_register_values[r[2]];
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::mul() // last 32 bits?
+{
+    if (r[0] == 29)
+        check_stack_bounds(m_register_values[r[1]] * m_register_values[r[2]]);
+
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
+        m_register_values[r[0]] =
+            m_register_values[r[1]] * m_register_values[r[2]];
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::andf()
+{
+    if (r[0] == 29)
+        check_stack_bounds(m_register_values[r[1]] & m_register_values[r[2]]);
+
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
+        m_register_values[r[0]] =
+            m_register_values[r[1]] & m_register_values[r[2]];
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::andi()
+{
+    if (r[0] == 29)
+    {
+        check_stack_bounds(m_register_values[r[1]]&r[2]);
+    }
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
+    {
+        m_register_values[r[0]] = m_register_values[r[1]]&r[2];
+    } else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::orf()
+{
+    if (r[0] == 29)
+        check_stack_bounds(m_register_values[r[1]] | m_register_values[r[2]]);
+
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
+        m_register_values[r[0]] =
+            m_register_values[r[1]] | m_register_values[r[2]];
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::ori()
+{
+    if (r[0] == 29)
+        check_stack_bounds(m_register_values[r[1]] | r[2]);
+
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
+        m_register_values[r[0]] = m_register_values[r[1]] | r[2];
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::nor()
+{
+    if (r[0] == 29)
+        check_stack_bounds(
+            ~(m_register_values[r[1]] | m_register_values[r[2]])
+        );
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
+        m_register_values[r[0]] =
+            ~(m_register_values[r[1]] | m_register_values[r[2]]);
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::slt()
+{
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
+        m_register_values[r[0]] =
+            m_register_values[r[1]] < m_register_values[r[2]];
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::slti()
+{
+    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
+        m_register_values[r[0]] = m_register_values[r[1]] < r[2];
+    else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::lw()
+{
+    if (r[0] != 0 && r[0] != 1)
+    {
+        // Check validity of address
+        const int32_t address{ m_register_values[r[1]] + r[2] };
+        check_address(address, 4);
+        const int32_t value{ m_memory.load_word(address) };
+
+        if (r[0] == 29)
+            check_stack_bounds(value);
+
+        m_register_values[r[0]] = value;
+    } else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::sw()
+{
+    if (r[0] != 1)
+    {
+        // Check validity of address
+        const int32_t address{ m_register_values[r[1]] + r[2] };
+        check_address(address, 4);
+        m_memory.store_word(address, m_register_values[r[0]]);
+    } else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::beq()
+{
+    if (r[0] != 1 && r[1] != 1)
+    {
+        if (m_register_values[r[0]] == m_register_values[r[1]])
+        {
+            // If branch taken, update ProgramCounter with new address
+            count_taken();
+            m_program_counter = r[2];
+        } else
         {
-            std::cout << "Error: Label name expected.\n";
-            report_error();
+            // Else increment as usual
+            m_program_counter++;
         }
+    } else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
 
-        if (label_index == -1)
-            continue;
 
-        j = label_index - 1;
-        while (
-            j >= 0 && m_current_instruction[j] == ' '
-            ||
-            m_current_instruction[j] == '\t'
-        )
-            j--;
+void MIPSSimulator::bne()
+{
+    if (r[0] != 1 && r[1] != 1)
+    {
+        if (m_register_values[r[0]] != m_register_values[r[1]])
+        {
+            count_taken();
+            m_program_counter = r[2];
+        } else
+        {
+            m_program_counter++;
+        }
+    } else
+    {
+        report_error("Invalid usage of registers.");
+    }
+}
+
+
+void MIPSSimulator::j()
+{
+    count_taken();
+    // Update ProgramCounter to address
+    m_program_counter = r[0];
+}
+
+
+void MIPSSimulator::halt()
+{
+    // Set halt value to halt the program
+    m_halt_value = 1;
+}
+
+
+void MIPSSimulator::syscall()
+{
+    int32_t &result{ m_register_values[2] };
+    const int32_t argument{ m_register_values[4] };
+
+    switch (result)
+    {
+    // print_int
+    case 1:
+        m_console.write_int(argument);
+        break;
 
-        temp_string = "";
-        is_label    = 0;
-        done_flag   = 0;
+    // print_string, up to the first 0 byte
+    case 4:
+    {
+        char text[256];
+        size_t length{};
 
-        for (; j >= 0; j--)
+        for (int32_t address{ argument }; ; address++)
         {
-            if (
-                m_current_instruction[j] != ' '
-                &&
-                m_current_instruction[j] != '\t'
-                &&
-                done_flag == 0
-            )
-            {
-                is_label    = 1;
-                temp_string = m_current_instruction[j] + temp_string;
-            } else if (
-                m_current_instruction[j] != ' '
-                &&
-                m_current_instruction[j] != '\t'
-                &&
-                done_flag == 1
-            )
+            if (!m_memory.contains(address))
             {
-                std::cout << "Error: Unexpected text before label name.\n";
-                report_error();
-            } else if (is_label == 0)
+                report_error("Address out of bounds.");
+            }
+
+            const char character{ static_cast<char>(m_memory.load_byte(address)) };
+            if (character == '\0')
+                break;
+
+            text[length++] = character;
+            if (length == sizeof(text))
             {
-                std::cout << "Error: Label name expected.\n";
-                report_error();
-            } else
-                done_flag = 1;
+                m_console.write(std::string_view{ text, length });
+                length = 0;
+            }
         }
 
-        assert_label_allowed(temp_string);
-        // Check that nothing is after label
-        only_spaces(
-            label_index + 1,
-            m_current_instruction.size(),
-            m_current_instruction
-        );
+        m_console.write(std::string_view{ text, length });
+        break;
+    }
 
-        // For main, set variables as needed
-        if (temp_string == "main")
-        {
-            found_main = 1;
-            main_index = m_program_counter + 1;
-        } else
+    // read_int
+    case 5:
+    {
+        int32_t value;
+        if (!m_console.read_int(value))
         {
-            LabelTable temp_label_table{
-                .label   = temp_string,
-                .address = m_program_counter
-            };
-
-            // Store labels
-            m_table_of_labels.push_back(temp_label_table);
+            report_error("No integer to read.");
         }
-    }
 
-    // Sort labels
-    sort(
-        m_table_of_labels.begin(),
-        m_table_of_labels.end(),
-        LabelTable::sort_table
-    );
+        result = value;
+        break;
+    }
 
-    // Check for duplicates
-    for (
-        i = 0;
-        m_table_of_labels.size() > 0 && i < m_table_of_labels.size() - 1;
-        i++
-    )
+    // sbrk, which returns the start of the memory handed out
+    case 9:
     {
-        if (m_table_of_labels[i].label==m_table_of_labels[i + 1].label)
+        // Keep the break aligned
+        const int64_t size{ (int64_t{ argument } + 3) & ~int64_t{ 3 } };
+
+        if (argument < 0)
         {
-            std::cout << "Error: One or more labels are repeated.\n";
-            exit(1);
+            report_error("Invalid size.");
         }
+        if (m_program_break + size > m_memory.end_address())
+        {
+            report_error("Out of memory.");
+        }
+
+        result = m_program_break;
+        m_program_break += static_cast<int32_t>(size);
+        break;
     }
 
-    // If main label not found
-    if (found_main == 0)
+    // exit
+    case 10:
+        m_halt_value = 1;
+        break;
+
+    // print_char
+    case 11:
     {
-        std::cout << "Error: Could not find main.\n";
-        exit(1);
+        const char character{ static_cast<char>(argument) };
+        m_console.write(std::string_view{ &character, 1 });
+        break;
     }
 
-    // Set program counter.
-    m_program_counter = main_index;
+    // read_char
+    case 12:
+    {
+        int32_t value;
+        if (!m_console.read_char(value))
+        {
+            report_error("No character to read.");
+        }
+
+        result = value;
+        break;
+    }
+
+    // exit2
+    case 17:
+        m_exit_code = argument;
+        m_halt_value = 1;
+        break;
 
-    std::cout << "Initialized and ready to execute. ";
-    std::cout << "Current state is as follows : \n";
-    display_state();
-    std::cout <<"\nStarting execution\n\n";
+    default:
+        report_error("Unknown system call.");
+    }
 }
 
 
-void MIPSSimulator::report_error()
+void MIPSSimulator::addu()
 {
-    const int32_t line_number{ m_program_counter + 1 };
-    const std::string instruction_line{ m_input_program[m_program_counter] };
+    // Wraps around without overflow, like add
+    write_result(
+        OPERATION_ADDU,
+        static_cast<int32_t>(
+            static_cast<uint32_t>(m_register_values[r[1]])
+            + static_cast<uint32_t>(m_register_values[r[2]])
+        )
+    );
+}
 
-    std::cout
-        << "Error found in line: " << line_number
-        << ": " << instruction_line << '\n';
 
-    display_state();
-    exit(1);
+void MIPSSimulator::subu()
+{
+    write_result(
+        OPERATION_SUBU,
+        static_cast<int32_t>(
+            static_cast<uint32_t>(m_register_values[r[1]])
+            - static_cast<uint32_t>(m_register_values[r[2]])
+        )
+    );
 }
 
 
-void MIPSSimulator::read_instruction(int32_t line)
+void MIPSSimulator::xorf()
 {
-    // Set current_instruction
-    m_current_instruction = m_input_program[line];
-    // Remove comments
-    if (m_current_instruction.find("#") != -1)
-    {
-        const auto new_instr{
-            m_current_instruction.substr(
-                0, m_current_instruction.find('#')
-            )
-        };
+    write_result(OPERATION_XOR, m_register_values[r[1]] ^ m_register_values[r[2]]);
+}
 
-        m_current_instruction = new_instr;
-    }
 
-    // Set m_program_counter
-    m_program_counter = line;
+void MIPSSimulator::sltu()
+{
+    write_result(
+        OPERATION_SLTU,
+        static_cast<uint32_t>(m_register_values[r[1]])
+            < static_cast<uint32_t>(m_register_values[r[2]])
+    );
 }
 
 
-int32_t MIPSSimulator::parse_instruction()
+void MIPSSimulator::sllv()
 {
-    // Trim line.
-    remove_spaces(m_current_instruction);
+    // Only the low five bits of the shift amount count
+    write_result(
+        OPERATION_SLLV,
+        static_cast<int32_t>(
+            static_cast<uint32_t>(m_register_values[r[1]]) << (m_register_values[r[2]] & 31)
+        )
+    );
+}
 
-    // If label encountered
-    if (m_current_instruction.find(":") != -1)
-        return -2;
 
-    // No valid instruction is this small
-    if (m_current_instruction.size() < 4)
-    {
-        std::cout << "Error: Unknown operation.\n";
-        report_error();
-    }
+void MIPSSimulator::srlv()
+{
+    write_result(
+        OPERATION_SRLV,
+        static_cast<int32_t>(
+            static_cast<uint32_t>(m_register_values[r[1]]) >> (m_register_values[r[2]] & 31)
+        )
+    );
+}
 
-    int32_t j;
-    // Find length of operation
-    for (j = 0; j < 4; j++)
-        if (m_current_instruction[j] == ' ' || m_current_instruction[j] == '\t')
-            break;
 
-    // Cut the operation out
-    std::string operation{ m_current_instruction.substr(0, j) };
-    if (
-        m_current_instruction.size() > 0
-        &&
-        j < m_current_instruction.size() - 1
-    )
-        m_current_instruction = m_current_instruction.substr(j + 1);
+void MIPSSimulator::srav()
+{
+    write_result(OPERATION_SRAV, m_register_values[r[1]] >> (m_register_values[r[2]] & 31));
+}
 
-    int32_t found_op{};         // Whether valid operation or not
-    int32_t operation_ID{ -1 }; // Set operation index from array
 
-    int32_t i;
-    // Check operation with allowed operations
-    for (i = 0; i < 17; i++)
-        if (operation == m_instruction_set[i])
-        {
-            operation_ID = i;
-            break;
-        }
+void MIPSSimulator::sll()
+{
+    // The shift amount was checked to be 0 to 31 when parsing
+    write_result(
+        OPERATION_SLL,
+        static_cast<int32_t>(static_cast<uint32_t>(m_register_values[r[1]]) << r[2])
+    );
+}
 
-    // If not valid
-    if (operation_ID == -1)
-    {
-        std::cout << "Error: Unknown operation.\n";
-        report_error();
-    }
 
-    // For R-format instructions
-    if (operation_ID < 7)
-    {
-        // Find three registers separated by commas and put them in r[]
-        for (int32_t count{}; count <3 ; count++)
-        {
-            remove_spaces(m_current_instruction);
-            find_register(count);
-            remove_spaces(m_current_instruction);
+void MIPSSimulator::srl()
+{
+    write_result(
+        OPERATION_SRL,
+        static_cast<int32_t>(static_cast<uint32_t>(m_register_values[r[1]]) >> r[2])
+    );
+}
 
-            if (count == 2)
-                break;
 
-            assert_remove_comma();
-        }
+void MIPSSimulator::sra()
+{
+    write_result(OPERATION_SRA, m_register_values[r[1]] >> r[2]);
+}
 
-        // If something more found
-        if (!m_current_instruction.empty())
-        {
-            std::cout << "Error: Extra arguments provided.\n";
-            report_error();
-        }
-    }
-    // For I-format instructions
-    else if (operation_ID < 11)
-    {
-        // Find two registers separated by commas
-        for (int32_t count{}; count < 2; count++)
-        {
-            remove_spaces(m_current_instruction);
-            find_register(count);
-            remove_spaces(m_current_instruction);
-            assert_remove_comma();
-        }
 
-        remove_spaces(m_current_instruction);
-        // Find third argument, a number
-        std::string temp_string{ find_label() };
-        // Check validity
-        assert_number(temp_string);
-        // Convert and store
-        r[2] = stoi(temp_string);
-    }
-    // For lw, sw
-    else if (operation_ID < 13)
-    {
-        std::string temp_string{};
-        int32_t offset;
+void MIPSSimulator::addiu()
+{
+    write_result(
+        OPERATION_ADDIU,
+        static_cast<int32_t>(
+            static_cast<uint32_t>(m_register_values[r[1]]) + static_cast<uint32_t>(r[2])
+        )
+    );
+}
 
-        remove_spaces(m_current_instruction);
-        // Find source/destination register
-        find_register(0);
-        remove_spaces(m_current_instruction);
-        // Find comma, ignoring extra spaces
-        assert_remove_comma();
-        remove_spaces(m_current_instruction);
 
-        // If offset type
-        if (
-            (
-                m_current_instruction[0] > 47
-                &&
-                m_current_instruction[0] < 58
-            )
-            ||
-            m_current_instruction[0] == '-'
-        )
-        {
-            j = 0;
-            while (
-                j < m_current_instruction.size()
-                &&
-                m_current_instruction[j] != ' '
-                &&
-                m_current_instruction[j] != '\t'
-                &&
-                m_current_instruction[j] != '('
-            )
-            {
-                // Find offset
-                temp_string = temp_string+m_current_instruction[j];
-                j++;
-            }
+void MIPSSimulator::xori()
+{
+    write_result(OPERATION_XORI, m_register_values[r[1]] ^ r[2]);
+}
 
-            // If instruction ends there
-            if (j == m_current_instruction.size())
-            {
-                std::cout << "Error: '(' expected.\n";
-                report_error();
-            }
 
-            // Check validity of offset
-            assert_number(temp_string);
-            // Convert and store
-            offset = stoi(temp_string);
-            m_current_instruction = m_current_instruction.substr(j);
-            remove_spaces(m_current_instruction);
+void MIPSSimulator::sltiu()
+{
+    write_result(
+        OPERATION_SLTIU,
+        static_cast<uint32_t>(m_register_values[r[1]]) < static_cast<uint32_t>(r[2])
+    );
+}
 
-            if (
-                m_current_instruction.empty()
-                ||
-                m_current_instruction[0] != '('
-                ||
-                m_current_instruction.size() < 2
-            )
-            {
-                std::cout << "Error: '(' expected.\n";
-                report_error();
-            }
 
-            m_current_instruction = m_current_instruction.substr(1);
-            remove_spaces(m_current_instruction);
-            // Find register containing address
-            find_register(1);
-            remove_spaces(m_current_instruction);
+void MIPSSimulator::lui()
+{
+    write_result(OPERATION_LUI, static_cast<int32_t>(static_cast<uint32_t>(r[2]) << 16));
+}
 
-            if (
-                m_current_instruction.empty()
-                ||
-                m_current_instruction[0] != ')'
-            )
-            {
-                std::cout << "Error: ')' expected.\n";
-                report_error();
-            }
 
-            m_current_instruction = m_current_instruction.substr(1);
-            only_spaces(0, m_current_instruction.size(), m_current_instruction);
-            r[2] = offset;
+void MIPSSimulator::mult()
+{
+    assert_valid_registers(OPERATION_MULT);
 
-            // -1 reserved for non offset type, anyway an invalid offset,
-            // others checked later
-            if (r[2] == -1)
-            {
-                std::cout << "Error: Invalid offset.\n";
-                report_error();
-            }
+    const int64_t product{
+        int64_t{ m_register_values[r[0]] } * m_register_values[r[1]]
+    };
+    m_register_values[REGISTER_HI] = static_cast<int32_t>(product >> 32);
+    m_register_values[REGISTER_LO] = static_cast<int32_t>(product);
+}
 
-        }
-        // If label type
-        else
-        {
-            // Find label
-            temp_string = find_label();
-            int32_t found_location;
 
-            for (j = 0; j < m_memory.size(); j++)
-            {
-                // Check for label from memory
-                if (temp_string == m_memory[j].label)
-                {
-                    // Label found
-                    found_location = 1;
-                    if (operation_ID == 11)
-                        // For lw, send value
-                        r[1] = m_memory[j].value;
-                    else
-                        // For sw, send index in memory
-                        r[1] = j;
-                    break;
-                }
-            }
+void MIPSSimulator::multu()
+{
+    assert_valid_registers(OPERATION_MULTU);
 
-            // If label not found
-            if (found_location == 0)
-            {
-                std::cout << "Error: Invalid label.\n";
-                report_error();
-            }
+    const uint64_t product{
+        uint64_t{ static_cast<uint32_t>(m_register_values[r[0]]) }
+            * static_cast<uint32_t>(m_register_values[r[1]])
+    };
+    m_register_values[REGISTER_HI] = static_cast<int32_t>(product >> 32);
+    m_register_values[REGISTER_LO] = static_cast<int32_t>(product);
+}
 
-            // To indicate that it is not offset type
-            r[2] = -1;
-        }
-    } 
-    // For beq, bne
-    else if (operation_ID < 15)
-    {
-        // Find two registers separated by commas
-        for (int32_t count{}; count < 2; count++)
-        {
-            remove_spaces(m_current_instruction);
-            find_register(count);
-            remove_spaces(m_current_instruction);
-            assert_remove_comma();
-        }
 
-        remove_spaces(m_current_instruction);
-        // Find label
-        std::string tempString = find_label();
-        int32_t foundAddress{};
+void MIPSSimulator::div()
+{
+    assert_valid_registers(OPERATION_DIV);
 
-        // Search for label
-        for (j = 0; j < m_table_of_labels.size(); j++)
-        {
-            // If label found
-            if (tempString == m_table_of_labels[j].label)
-            {
-                foundAddress = 1;
-                // Set r[2]
-                r[2] = m_table_of_labels[j].address;
-                break;
-            }
-        }
+    const int32_t dividend{ m_register_values[r[0]] };
+    const int32_t divisor{ m_register_values[r[1]] };
 
-        // If label not found
-        if (foundAddress == 0)
-        {
-            std::cout << "Error: Invalid label.\n";
-            report_error();
-        }
-    }
-    // For j
-    else if (operation_ID == 15)
+    if (divisor == 0)
     {
-        remove_spaces(m_current_instruction);
-        int32_t foundAddress{};
-        // Find jump label
-        std::string tempString = find_label();
-        // Search for label
-        for (j = 0; j < m_table_of_labels.size(); j++)
-        {
-            if (tempString == m_table_of_labels[j].label)
-            {
-                // If label found
-                foundAddress = 1;
-                // Set r[0]
-                r[0] = m_table_of_labels[j].address;
-            }
-        }
+        report_error("Division by zero.");
+    }
 
-        // If label not found
-        if (foundAddress == 0)
-        {
-            std::cout << "Error: Invalid label.\n";
-            report_error();
-        }
+    // The one quotient that does not fit wraps around
+    if (dividend == INT32_MIN && divisor == -1)
+    {
+        m_register_values[REGISTER_HI] = 0;
+        m_register_values[REGISTER_LO] = INT32_MIN;
+        return;
     }
-    // For halt.
-    else if (operation_ID == 16)
-        remove_spaces(m_current_instruction);
 
-    return operation_ID;
+    m_register_values[REGISTER_HI] = dividend % divisor;
+    m_register_values[REGISTER_LO] = dividend / divisor;
 }
 
 
-void MIPSSimulator::only_spaces(
-    int32_t lower,
-    int32_t upper,
-    std::string str
-)
+void MIPSSimulator::divu()
 {
-    for (int32_t i{ lower }; i < upper; i++)
+    assert_valid_registers(OPERATION_DIVU);
+
+    const uint32_t dividend{ static_cast<uint32_t>(m_register_values[r[0]]) };
+    const uint32_t divisor{ static_cast<uint32_t>(m_register_values[r[1]]) };
+
+    if (divisor == 0)
     {
-        // Check that only ' ' and '\t' characters exist
-        if (str[i] != ' ' && str[i] != '\t')
-        {
-            std::cout << "Error: Unexpected character.\n";
-            report_error();
-        }
+        report_error("Division by zero.");
     }
+
+    m_register_values[REGISTER_HI] = static_cast<int32_t>(dividend % divisor);
+    m_register_values[REGISTER_LO] = static_cast<int32_t>(dividend / divisor);
 }
 
 
-void MIPSSimulator::execute_instruction(int32_t instruction)
+void MIPSSimulator::mfhi()
 {
-    // Call appropriate function based on the value of instruction
-    switch (instruction)
-    {
-    case  0: add();  break;
-    case  1: sub();  break;
-    case  2: mul();  break;
-    case  3: andf(); break;
-    case  4: orf();  break;
-    case  5: nor();  break;
-    case  6: slt();  break;
-    case  7: addi(); break;
-    case  8: andi(); break;
-    case  9: ori();  break;
-    case 10: slti(); break;
-    case 11: lw();   break;
-    case 12: sw();   break;
-    case 13: beq();  break;
-    case 14: bne();  break;
-    case 15: j();    break;
-    case 16: halt(); break;
-
-    case -2:
-        // If instruction containing label, ignore
-        break;
-    default:
-        std::cout << "Error: Invalid instruction received.\n";
-        report_error();
-    }
+    write_result(OPERATION_MFHI, m_register_values[REGISTER_HI]);
 }
 
 
-void MIPSSimulator::remove_spaces(std::string &str)
+void MIPSSimulator::mflo()
 {
-    int32_t j{};
+    write_result(OPERATION_MFLO, m_register_values[REGISTER_LO]);
+}
 
-    // Till only ' ' or '\t' found
-    while (
-        j < str.size()
-        &&
-        (
-            str[j] == ' '
-            ||
-            str[j] == '\t'
-        )
-    ) j++;
 
-    // Remove all of those
-    str = str.substr(j);
+void MIPSSimulator::mthi()
+{
+    assert_valid_registers(OPERATION_MTHI);
+    m_register_values[REGISTER_HI] = m_register_values[r[0]];
 }
 
 
-void MIPSSimulator::add()
+void MIPSSimulator::mtlo()
 {
-    // Check that value of stack pointer is within bounds
-    if (r[0] == 29)
-        check_stack_bounds(m_register_values[r[1]] + m_register_values[r[2]]);
-
-    // Cannot modify $zero or use $at
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
-    {
-        // Execute
-        m_register_values[r[0]] =
-            m_register_values[r[1]] + m_register_values[r[2]];
-    } else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    assert_valid_registers(OPERATION_MTLO);
+    m_register_values[REGISTER_LO] = m_register_values[r[0]];
 }
 
 
-void MIPSSimulator::addi()
+void MIPSSimulator::lb()
 {
-    if (r[0] == 29)
-        check_stack_bounds(m_register_values[r[1]] + r[2]);
+    assert_valid_registers(OPERATION_LB);
 
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
-    {
-        m_register_values[r[0]] = m_register_values[r[1]] + r[2];
-    } else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    const int32_t address{ m_register_values[r[1]] + r[2] };
+    check_address(address, 1);
+    write_result(OPERATION_LB, static_cast<int8_t>(m_memory.load_byte(address)));
 }
 
 
-void MIPSSimulator::sub()
+void MIPSSimulator::lbu()
 {
-    if (r[0] == 29)
-        check_stack_bounds(m_register_values[r[1]]-m_register_values[r[2]]);
+    assert_valid_registers(OPERATION_LBU);
 
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
-        m_register_values[r[0]] =
-            m_register_values[r[1]] - m_register_values[r[2]];
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    const int32_t address{ m_register_values[r[1]] + r[2] };
+    check_address(address, 1);
+    write_result(OPERATION_LBU, m_memory.load_byte(address));
 }
 
 
-void MIPSSimulator::mul() // last 32 bits?
+void MIPSSimulator::lh()
 {
-    if (r[0] == 29)
-        check_stack_bounds(m_register_values[r[1]] * m_register_values[r[2]]);
+    assert_valid_registers(OPERATION_LH);
 
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
-        m_register_values[r[0]] =
-            m_register_values[r[1]] * m_register_values[r[2]];
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    const int32_t address{ m_register_values[r[1]] + r[2] };
+    check_address(address, 2);
+    write_result(OPERATION_LH, static_cast<int16_t>(m_memory.load_halfword(address)));
 }
 
 
-void MIPSSimulator::andf()
+void MIPSSimulator::lhu()
 {
-    if (r[0] == 29)
-        check_stack_bounds(m_register_values[r[1]] & m_register_values[r[2]]);
+    assert_valid_registers(OPERATION_LHU);
 
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
-        m_register_values[r[0]] =
-            m_register_values[r[1]] & m_register_values[r[2]];
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    const int32_t address{ m_register_values[r[1]] + r[2] };
+    check_address(address, 2);
+    write_result(OPERATION_LHU, m_memory.load_halfword(address));
 }
 
 
-void MIPSSimulator::andi()
+void MIPSSimulator::sb()
 {
-    if (r[0] == 29)
-    {
-        check_stack_bounds(m_register_values[r[1]]&r[2]);
-    }
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
-    {
-        m_register_values[r[0]] = m_register_values[r[1]]&r[2];
-    } else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    assert_valid_registers(OPERATION_SB);
+
+    const int32_t address{ m_register_values[r[1]] + r[2] };
+    check_address(address, 1);
+    m_memory.store_byte(address, static_cast<uint8_t>(m_register_values[r[0]]));
 }
 
 
-void MIPSSimulator::orf()
+void MIPSSimulator::sh()
 {
-    if (r[0] == 29)
-        check_stack_bounds(m_register_values[r[1]] | m_register_values[r[2]]);
+    assert_valid_registers(OPERATION_SH);
 
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
-        m_register_values[r[0]] =
-            m_register_values[r[1]] | m_register_values[r[2]];
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    const int32_t address{ m_register_values[r[1]] + r[2] };
+    check_address(address, 2);
+    m_memory.store_halfword(address, static_cast<uint16_t>(m_register_values[r[0]]));
 }
 
 
-void MIPSSimulator::ori()
+void MIPSSimulator::blez()
 {
-    if (r[0] == 29)
-        check_stack_bounds(m_register_values[r[1]] | r[2]);
+    branch_if(OPERATION_BLEZ, m_register_values[r[0]] <= 0);
+}
 
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
-        m_register_values[r[0]] = m_register_values[r[1]] | r[2];
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+
+void MIPSSimulator::bgtz()
+{
+    branch_if(OPERATION_BGTZ, m_register_values[r[0]] > 0);
 }
 
 
-void MIPSSimulator::nor()
+void MIPSSimulator::bltz()
 {
-    if (r[0] == 29)
-        check_stack_bounds(
-            ~(m_register_values[r[1]] | m_register_values[r[2]])
-        );
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
-        m_register_values[r[0]] =
-            ~(m_register_values[r[1]] | m_register_values[r[2]]);
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    branch_if(OPERATION_BLTZ, m_register_values[r[0]] < 0);
 }
 
 
-void MIPSSimulator::slt()
+void MIPSSimulator::bgez()
 {
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1 && r[2] != 1)
-        m_register_values[r[0]] =
-            m_register_values[r[1]] < m_register_values[r[2]];
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    branch_if(OPERATION_BGEZ, m_register_values[r[0]] >= 0);
 }
 
 
-void MIPSSimulator::slti()
+void MIPSSimulator::jal()
 {
-    if (r[0] != 0 && r[0] != 1 && r[1] != 1)
-        m_register_values[r[0]] = m_register_values[r[1]] < r[2];
-    else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+    // Return to the line after the call
+    m_register_values[31] = m_text_address + 4 * (m_program_counter + 1);
+    count_taken();
+    m_program_counter = r[0];
 }
 
 
-void MIPSSimulator::lw()
+void MIPSSimulator::jr()
 {
-    if (r[0] == 29)
-        check_stack_bounds(r[1]);
+    assert_valid_registers(OPERATION_JR);
+    jump_to_address(m_register_values[r[0]]);
+}
 
-    // If label type
-    if (r[0] != 0 && r[0] != 1 && r[2]==-1)
-        m_register_values[r[0]] = r[1];
-    // if offset type
-    else if (r[0] != 0 && r[0] != 1)
-    {
-        // check validity of offset
-        check_stack_bounds(m_register_values[r[1]]+r[2]);
-        m_register_values[r[0]] =
-            m_stack[(m_register_values[r[1]] + r[2] - 40000) / 4];
-    } else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
+
+void MIPSSimulator::jalr()
+{
+    assert_valid_registers(OPERATION_JALR);
+
+    // $ra is written last, for jalr $ra
+    const int32_t return_address{ m_text_address + 4 * (m_program_counter + 1) };
+    jump_to_address(m_register_values[r[0]]);
+    m_register_values[31] = return_address;
 }
 
 
-void MIPSSimulator::sw()
+void MIPSSimulator::nop()
 {
-    // If label type
-    if (r[0] != 1 && r[2]==-1)
-        m_memory[r[1]].value = m_register_values[r[0]];
-    // If offset type
-    else if (r[0] != 1)
-    {
-        // Check validity of offset
-        check_stack_bounds(m_register_values[r[1]] + r[2]);
-        m_stack[(m_register_values[r[1]] + r[2] - 40000) / 4] =
-            m_register_values[r[0]];
-    } else
-    {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
-    }
 }
 
 
-void MIPSSimulator::beq()
+void MIPSSimulator::assert_valid_registers(int32_t operation)
 {
-    if (r[0] != 1 && r[1] != 1)
-    {
-        if (m_register_values[r[0]] == m_register_values[r[1]])
-            // If branch taken, update ProgramCounter with new address
-            m_program_counter = r[2]; 
-        else
-            // Else increment as usual
-            m_program_counter++;
-    } else
+    // Cannot modify $zero or use $at
+    if (!has_valid_registers(current_instruction(operation)))
     {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
+        report_error("Invalid usage of registers.");
     }
 }
 
 
-void MIPSSimulator::bne()
+void MIPSSimulator::write_result(int32_t operation, int32_t value)
 {
-    if (r[0] != 1 && r[1] != 1)
+    // Check that value of stack pointer is within bounds
+    if (r[0] == 29)
+        check_stack_bounds(value);
+
+    assert_valid_registers(operation);
+    m_register_values[r[0]] = value;
+}
+
+
+void MIPSSimulator::branch_if(int32_t operation, bool condition)
+{
+    assert_valid_registers(operation);
+
+    if (condition)
     {
-        if (m_register_values[r[0]] != m_register_values[r[1]])
-            m_program_counter = r[2];
-        else
-            m_program_counter++;
+        count_taken();
+        m_program_counter = r[2];
     } else
     {
-        std::cout << "Error: Invalid usage of registers.\n";
-        report_error();
+        m_program_counter++;
     }
 }
 
 
-void MIPSSimulator::j()
+void MIPSSimulator::jump_to_address(int32_t address)
 {
-    // Update ProgramCounter to address
-    m_program_counter = r[0];
-}
+    // Going past the last line ends the program like falling off it
+    const uint32_t offset{ static_cast<uint32_t>(address) - static_cast<uint32_t>(m_text_address) };
+    if (offset % 4 != 0 || offset / 4 > static_cast<uint32_t>(m_number_of_instructions))
+    {
+        report_error("Invalid jump address.");
+    }
 
+    // The target is only known now, so the profile counts the jump as taken
+    // and execution as starting over at the target
+    count_taken();
+    m_program_counter = static_cast<int32_t>(offset / 4);
 
-void MIPSSimulator::halt()
-{
-    // Set halt value to halt the program
-    m_halt_value = 1;
+    if (m_profile != nullptr)
+        m_profile->enter(m_program_counter);
 }
 
 
 void MIPSSimulator::display_state()
 {
-    // starting address of memory
-    int32_t current_address{ 40'000 };
+    PhaseTimer timer{ m_statistics.get(), PHASE_DISPLAY };
+
+    std::string &text{ m_state_text };
+    text.clear();
 
     // Display current instruction
+    text += "\nExecuting instruction: ";
+    const SourceFile &program{ program_text() };
     if (m_program_counter < m_number_of_instructions)
-        std::cout
-            << "\nExecuting instruction: "
-            << m_input_program[m_program_counter]
-            << '\n';
-    else
+        text += program[m_program_counter];
+    else if (m_program_counter > 0)
         // To display at the end, where
         // m_program_counter == m_number_of_instructions and is out of bounds
-        std::cout
-            << "\nExecuting instruction: "
-            << m_input_program[m_program_counter - 1]
-            << '\n';
+        text += program[m_program_counter - 1];
+    text += '\n';
 
     // Display ProgramCounter
-    std::cout << "\nProgram Counter: " << (4 * m_program_counter) << "\n\n";
-    std::cout << "Registers:\n\n";
+    text += "\nProgram Counter: ";
+    append_decimal(text, m_text_address + 4 * m_program_counter, 0);
+    text += "\n\nRegisters:\n\n";
 
-    printf(
-        "%11s%12s\t\t%10s%12s\n",
-        "Register", "Value", "Register", "Value"
-    );
+    append_field(text, "Register", 11);
+    append_field(text, "Value", 12);
+    text += "\t\t";
+    append_field(text, "Register", 10);
+    append_field(text, "Value", 12);
+    text += '\n';
 
     // Display registers
     for (int32_t i{}; i < 16; i++)
-        printf(
-            "%6s[%2d]:%12d\t\t%5s[%2d]:%12d\n", 
-            m_registers[i].c_str(),
-            i,
-            m_register_values[i],
-            m_registers[i + 16].c_str(),
-            i + 16,
-            m_register_values[i+16]
-        );
+    {
+        append_field(text, REGISTER_NAMES[i], 6);
+        text += '[';
+        append_decimal(text, i, 2);
+        text += "]:";
+        append_decimal(text, m_register_values[i], 12);
+        text += "\t\t";
+        append_field(text, REGISTER_NAMES[i + 16], 5);
+        text += '[';
+        append_decimal(text, i + 16, 2);
+        text += "]:";
+        append_decimal(text, m_register_values[i + 16], 12);
+        text += '\n';
+    }
+
+    // HI and LO, written by mult, div, mthi and mtlo
+    append_field(text, "hi", 10);
+    text += ':';
+    append_decimal(text, m_register_values[REGISTER_HI], 12);
+    text += "\t\t";
+    append_field(text, "lo", 9);
+    text += ':';
+    append_decimal(text, m_register_values[REGISTER_LO], 12);
+    text += '\n';
 
     // Display memory
-    std::cout << "\nMemory:.\n";
-    std::cout << "Address    Label   Value      Address    Label   Value    Address    Label   Value     Address    Label   Value     Address    Label   Value    .\n";
-    // Stack
-    for (int32_t i{}; i < 20; i++)
-        printf(
-            "%7x%8s:%8d\t%5x%8s:%8d\t%9x%8s:%8d\t%6x%8s:%8d\t%11x%8s:%8d\n",
-
-            current_address + 4 * i,
-            "<Stack>",
-            m_stack[i],
-            current_address + 4 * (i + 20),
-            "<Stack>",
-            m_stack[i + 20],
-            current_address + 4 * (i + 40),
-            "<Stack>",
-            m_stack[i + 40],
-            current_address + 4 * (i + 60),
-            "<Stack>",
-            m_stack[i + 60],
-            current_address + 4 * (i + 80),
-            "<Stack>",
-            m_stack[i + 80]
-        );
+    text += "\nMemory:.\n";
+    text += "Address    Label   Value      Address    Label   Value    Address    Label   Value     Address    Label   Value     Address    Label   Value    .\n";
+    // No words before a program is loaded
+    const int32_t *words{ m_memory.words() };
+    const int32_t word_count{ static_cast<int32_t>(m_memory.word_count()) };
+
+    // Stack, in five columns
+    constexpr int32_t address_widths[]{ 7, 5, 9, 6, 11 };
+    const int32_t stack_words{ std::min(m_memory.stack_size() / 4, word_count) };
+    const int32_t rows{ (stack_words + 4) / 5 };
+    for (int32_t i{}; i < rows; i++)
+        for (int32_t column{}; column < 5; column++)
+        {
+            const int32_t index{ i + rows * column };
+            if (index >= stack_words)
+            {
+                text += '\n';
+                break;
+            }
 
-    current_address += 400;
-    // Labels
-    for (int32_t i{}; i < m_memory.size(); i++)
-        printf(
-            "%7x%8s:%8d\n",
+            append_hex(text, m_memory.stack_address() + 4 * index, address_widths[column]);
+            append_field(text, "<Stack>", 8);
+            text += ':';
+            append_decimal(text, words[index], 8);
+            text += column < 4 ? '\t' : '\n';
+        }
 
-            40'400 + 4 * i,
-            m_memory[i].label.c_str(),
-            m_memory[i].value
-        );
+    // Data section, with the label of each first word
+    int32_t address{ m_memory.data_address() };
+    const auto append_data{
+        [&](std::string_view label, int32_t end)
+        {
+            for (; address < end; address += 4)
+            {
+                const uint32_t index{ m_memory.word_index(address) };
+                if (index >= m_memory.word_count())
+                    return;
+
+                append_hex(text, address, 7);
+                append_field(text, label, 8);
+                text += ':';
+                append_decimal(text, words[index], 8);
+                text += '\n';
+                label = "";
+            }
+        }
+    };
+
+    m_data_labels.for_each(
+        [&](std::string_view label, int32_t label_address)
+        {
+            append_data("", label_address);
+            append_data(label, label_address + 4);
+        }
+    );
+    append_data("", m_memory.heap_address());
 
-    std::cout << '\n';
+    text += '\n';
+    m_output.write(text.data(), text.size());
 }
 
 
-void MIPSSimulator::assert_number(const std::string &str)
+void MIPSSimulator::assert_number(std::string_view str)
 {
+    // Check that there is at least one digit
+    if (str.empty() || str == "-")
+    {
+        report_error("Specified value is not a number.");
+    }
+
     // Check that each character is a digit.
-    for (int32_t j{}; j < str.size(); j++)
+    for (size_t j{}; j < str.size(); j++)
     {
         // Ignore minus sign
         if (j == 0 && str[j] == '-')
@@ -1282,8 +3455,7 @@ void MIPSSimulator::assert_number(const std::string &str)
 
         if (str[j] < 48 || str[j] > 57)
         {
-            std::cout << "Error: Specified value is not a number.\n";
-            report_error();
+            report_error("Specified value is not a number.");
         }
     }
 
@@ -1302,8 +3474,7 @@ void MIPSSimulator::assert_number(const std::string &str)
         )
     )
     {
-        std::cout << "Error: Number out of range.\n";
-        report_error();
+        report_error("Number out of range.");
     }
     // Same check as above for negative integers
     else if (
@@ -1320,129 +3491,111 @@ void MIPSSimulator::assert_number(const std::string &str)
         )
     )
     {
-        std::cout << "Error: Number out of range.\n";
-        report_error();
+        report_error("Number out of range.");
     }
 }
 
 
+int32_t MIPSSimulator::to_number(std::string_view str)
+{
+    int32_t value{};
+    std::from_chars(str.data(), str.data() + str.size(), value);
+    return value;
+}
+
+
 void MIPSSimulator::find_register(int32_t number)
 {
-    int32_t found_register{};
     // Find '$' sign
     if (
-        m_current_instruction[0] != '$'
-        ||
         m_current_instruction.size() < 2
+        ||
+        m_current_instruction[0] != '$'
     )
     {
-        std::cout << "Error: Register expected.\n";
-        report_error();
+        report_error("Register expected.");
     }
 
     // Remove '$' sign
-    m_current_instruction = m_current_instruction.substr(1);
+    m_current_instruction.remove_prefix(1);
     // Next two characters to match
-    std::string register_ID{ m_current_instruction.substr(0, 2) };
+    std::string_view register_ID{ m_current_instruction.substr(0, 2) };
 
     // For $zero, need four characters
     if (register_ID == "ze" && m_current_instruction.size() >= 4)
-        register_ID += m_current_instruction.substr(2, 2);
+        register_ID = m_current_instruction.substr(0, 4);
     else if (register_ID == "ze")
     {
-        std::cout << "Error: Register expected.\n";
-        report_error();
+        report_error("Register expected.");
     }
 
-    for (int32_t i{}; i < 32; i++)
-    {
-        // Find register from list
-        if (register_ID == m_registers[i])
-        {
-            // Populate r[number]
-            r[number] = i;
-            // Set flag as found
-            found_register = 1;
-            // Remove name based on whether $zero or something else
-            if (i != 0)
-                m_current_instruction = m_current_instruction.substr(2);
-            else
-                m_current_instruction = m_current_instruction.substr(4);
-        }
-    }
+    // Find register from list
+    const int32_t register_number{ REGISTER_TABLE.find(register_ID) };
 
     // If register not found
-    if (found_register == 0)
+    if (register_number == -1)
     {
-        std::cout << "Error: Invalid register.\n";
-        report_error();
+        report_error("Invalid register.");
     }
+
+    // Populate r[number] and remove the name
+    r[number] = register_number;
+    m_current_instruction.remove_prefix(register_ID.size());
 }
 
 
-std::string MIPSSimulator::find_label()
+std::string_view MIPSSimulator::find_label()
 {
     // Remove spaces
     remove_spaces(m_current_instruction);
-    // To store label
-    std::string temp_string{};
-    // Found
-    int32_t found_value{};
-    // Completed finding
-    int32_t done_finding{};
-    for (int32_t j{}; j < m_current_instruction.size(); j++)
-    {
-        if (
-            found_value == 1
-            &&
-            (
-                m_current_instruction[j] == ' '
-                ||
-                m_current_instruction[j] == '\t'
-            )
-            &&
-            done_finding == 0
-        )
-            // When space encountered after start, label finding done
-            done_finding = 1;
-        else if (
-            found_value == 1
-            &&
-            m_current_instruction[j] != ' '
-            &&
-            m_current_instruction[j] != '\t'
-            &&
-            done_finding == 1
-        )
+    return find_word(m_current_instruction);
+}
+
+
+std::string_view MIPSSimulator::find_word(std::string_view str)
+{
+    size_t start{};
+    // Skip spaces before the word
+    while (start < str.size() && is_space(str[start]))
+        start++;
+
+    size_t end{ start };
+    // Find where the word ends
+    while (end < str.size() && !is_space(str[end]))
+        end++;
+
+    // If non space encountered after the word, some incorrect character
+    // found
+    for (size_t j{ end }; j < str.size(); j++)
+        if (!is_space(str[j]))
         {
-            // If non space encountered after done, some incorrect character
-            // found
-            std::cout << "Error: Unexpected text after value.\n";
-            report_error();
-        } else if (
-            found_value == 0
-            &&
-            m_current_instruction[j] != ' '
-            &&
-            m_current_instruction[j] != '\t'
-        )
+            report_error("Unexpected text after value.");
+        }
+
+    return str.substr(start, end - start);
+}
+
+
+std::string_view MIPSSimulator::find_label_name(int32_t label_index)
+{
+    // Ignore spaces before ":" till label
+    int32_t end{ label_index };
+    while (end > 0 && is_space(m_current_instruction[end - 1]))
+        end--;
+
+    // Find where the label name starts
+    int32_t start{ end };
+    while (start > 0 && !is_space(m_current_instruction[start - 1]))
+        start--;
+
+    // If something found before the name
+    for (int32_t j{}; j < start; j++)
+        if (!is_space(m_current_instruction[j]))
         {
-            // When first non space found, finding starts
-            found_value = 1;
-            temp_string = temp_string + m_current_instruction[j];
-        } else if (
-            found_value == 1
-            &&
-            m_current_instruction[j] != ' '
-            &&
-            m_current_instruction[j] != '\t'
-        )
-            // Continue finding
-            temp_string = temp_string + m_current_instruction[j];
-    }
+            report_error("Unexpected text before label name.");
+        }
 
-    // Return found label
-    return temp_string;
+    return m_current_instruction.substr(start, end - start);
 }
 
 
@@ -1455,12 +3608,11 @@ void MIPSSimulator::assert_remove_comma()
         m_current_instruction[0] != ','
     )
     {
-        std::cout << "Error: Comma expected.\n";
-        report_error();
+        report_error("Comma expected.");
     }
 
     // Remove it
-    m_current_instruction = m_current_instruction.substr(1);
+    m_current_instruction.remove_prefix(1);
 }
 
 
@@ -1469,38 +3621,55 @@ void MIPSSimulator::check_stack_bounds(int32_t index)
     // Check that address is within stack bounds and a multiple of 4
     if (
         !(
-            index <= 40'396
+            index <= m_memory.stack_top()
             &&
-            index >= 40'000
+            index >= m_memory.stack_address()
             &&
             index % 4 == 0
         )
     )
     {
-        std::cout << "Error: Invalid address for stack pointer. "
-            "To access data section, use labels instead of addresses.\n";
-        report_error();
+        report_error("Invalid address for stack pointer.");
+    }
+}
+
+
+void MIPSSimulator::check_address(int32_t address, int32_t size)
+{
+    if (size == 4 && m_memory.is_word_address(address))
+        return;
+
+    if (!m_memory.contains(address))
+    {
+        report_error("Address out of bounds.");
+    }
+
+    if (size == 4)
+    {
+        report_error("Address is not a multiple of 4.");
+    }
+    if (size == 2 && (address & 1) != 0)
+    {
+        report_error("Address is not a multiple of 2.");
     }
 }
 
 
-void MIPSSimulator::assert_label_allowed(const std::string &str)
+void MIPSSimulator::assert_label_allowed(std::string_view str)
 {
     //  Check that label size is at least one and the first value is not
     //  an integer.
     if (str.size() == 0 || ('0' <= str[0] && str[0] <= '9'))
     {
-        std::cout << "Error: Invalid label: Label begins with a number.\n";
-        report_error();
+        report_error("Invalid label: Label begins with a number.");
     }
 
-    for (int32_t i = 0; i < str.size(); i++)
+    for (size_t i = 0; i < str.size(); i++)
     {
         //  Check that only numbers and letters are used.
         if (!is_ascii_alphanumerical(str[i]))
         {
-            std::cout << "Error: Invalid label.\n";
-            report_error();
+            report_error("Invalid label.");
         }
     }
 }
@@ -1,47 +1,148 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
+#include <ostream>
+#include <iostream>
 #include <cstdint>
 
-#include <MemoryElement.hpp>
-#include <LabelTable.hpp>
+#include <GuestMemory.hpp>
+#include <GuestConsole.hpp>
+#include <SymbolTable.hpp>
+#include <SourceFile.hpp>
+#include <BinaryProgram.hpp>
+#include <Instruction.hpp>
+#include <SimulationError.hpp>
+#include <SimulationResult.hpp>
+#include <TraceRecorder.hpp>
+#include <ExecutionHistory.hpp>
+#include <ExecutionProfile.hpp>
+#include <PipelineModel.hpp>
+#include <CacheModel.hpp>
+#include <BranchPredictor.hpp>
+#include <HostStatistics.hpp>
 
-constexpr size_t STACK_SIZE{ 100 };
+// Execution engines that can be selected when creating the simulator
+constexpr int32_t ENGINE_INTERPRETER{ 0 };
+constexpr int32_t ENGINE_THREADED{ 1 };
+constexpr int32_t ENGINE_JIT{ 2 };
 
 /**
  * @brief Class for the MIPS Simulator.
  */
 class MIPSSimulator
 {
-    // Array to store names of registers
-    std::string m_registers[32];
-    // Array to store values of registers
-    int32_t m_register_values[32];
-    // Array to store names of instructions
-    std::string m_instruction_set[17];
-    // To store the Mode of execution
-    int32_t m_mode;
+    // Array to store values of registers, HI and LO last
+    int32_t m_register_values[REGISTER_COUNT];
+    // To store the execution engine used by run()
+    int32_t m_engine;
+    // Where display_state() and display_pair_statistics() write
+    std::ostream &m_output;
+    // Text of the state built by display_state(), reused between calls
+    std::string m_state_text;
+    // State of the loaded program, one of STATUS_*
+    int32_t m_status;
+    // Error that stopped the program, if m_status is STATUS_ERROR
+    std::string m_error;
+    int32_t m_error_line;
     // To store the input program
-    std::vector<std::string> m_input_program;
+    SourceFile m_input_program;
+    // Machine-code program, if one was loaded instead of assembly
+    BinaryProgram m_binary;
+    bool m_machine_code;
+    // Disassembly of the machine-code program, made when it is first shown
+    mutable SourceFile m_disassembly;
+    mutable bool m_disassembled;
+    // Address of line 0, which return addresses and jr count from
+    int32_t m_text_address;
+    // Value $gp starts with
+    int32_t m_global_pointer;
+    // To store the decoded form of every line of the input program
+    std::vector<Instruction> m_program;
     // To store the number of lines in the program
     int32_t m_number_of_instructions;
-    // To store the current instruction being worked with
-    std::string m_current_instruction;
+    // To store the part of the current line still to be parsed
+    std::string_view m_current_instruction;
     // To store the line number being worked with
     int32_t m_program_counter;
-    // To store the maximum length of the input program
-    int32_t m_max_length;
     // Flag to check if program halted
     int32_t m_halt_value;
+    // Number of instructions executed, by all engines
+    int64_t m_instruction_count;
     // To store register names, values, etc. for the instruction
     int32_t r[3];
-    // To store all the labels and addresses
-    std::vector<LabelTable> m_table_of_labels;
-    // To store all the memory elements
-    std::vector<MemoryElement> m_memory;
-    // Stack array
-    int32_t m_stack[STACK_SIZE];
+    // Whether to count pairs of consecutively executed operations
+    bool m_count_pairs;
+    // Whether to rewrite frequent pairs into superinstructions
+    bool m_fusion;
+    // Whether the pairs to fuse have been chosen
+    bool m_fusion_selected;
+    // Fusion candidates that are fused, most frequent first
+    std::vector<int32_t> m_fusion_order;
+    // Number of times each pair of operations was executed
+    int64_t m_pair_counts[OPERATION_COUNT][OPERATION_COUNT];
+    // Operation executed last, for counting pairs
+    int32_t m_previous_operation;
+    // Number of instructions dispatched by run_instruction(), counted while
+    // pairs are counted or fusion is enabled
+    int64_t m_dispatch_count;
+    // Number of superinstructions dispatched by run_instruction()
+    int64_t m_fused_dispatch_count;
+    // To store the line of every label in the text section, except main
+    SymbolTable m_labels;
+    // To store the address of every label in the data section
+    SymbolTable m_data_labels;
+    // Stack, data section and free memory, at their addresses
+    GuestMemory m_memory;
+    // Sizes of the stack and of the free memory used by the next load()
+    int32_t m_stack_size;
+    int32_t m_heap_size;
+    // First address after the memory sbrk has handed out
+    int32_t m_program_break;
+    // Output and input of the program's system calls
+    GuestConsole m_console;
+    // Value given to the exit system call, 0 for halt
+    int32_t m_exit_code;
+    // Line execution starts at
+    int32_t m_main_line;
+    // Directory of program images, empty if they are not used
+    std::string m_cache_directory;
+    // Whether to ignore existing program images and write new ones
+    bool m_rebuild_cache;
+    // Words of the data section before execution, kept for reset() and the
+    // program image
+    std::vector<int32_t> m_initial_data;
+    // Number of decoded lines in the program image that was loaded, -1 if
+    // the program was not loaded from an image
+    int32_t m_cached_lines;
+    // Execution trace written from load() until the program stops, if
+    // enabled
+    std::unique_ptr<TraceRecorder> m_trace;
+    std::string m_trace_path;
+    // Past states, for going back, if enabled
+    std::unique_ptr<ExecutionHistory> m_history;
+    // Where execution stood after the last instruction, before skipping
+    // blank and label lines, which is where going back returns to
+    int32_t m_history_line;
+    // Execution counts per line and branch, if enabled
+    std::unique_ptr<ExecutionProfile> m_profile;
+    // Pipeline timing of the executed instructions, if enabled
+    std::unique_ptr<PipelineModel> m_pipeline;
+    // L1 caches fed with the fetched and accessed addresses, if enabled
+    std::unique_ptr<CacheModel> m_instruction_cache;
+    std::unique_ptr<CacheModel> m_data_cache;
+    // Branch predictors fed with the executed branches and jumps, if enabled
+    std::unique_ptr<BranchPredictorSet> m_branch_predictors;
+    // Time spent in each phase of the simulator's own work, if enabled
+    std::unique_ptr<HostStatistics> m_statistics;
+    // Whether run() stops before each line, one flag per line
+    std::vector<uint8_t> m_breakpoints;
+    int32_t m_breakpoint_count;
+    // Hash of the source file, computed when a snapshot first needs it
+    uint64_t m_source_hash;
+    bool m_source_hashed;
 
     void add();
     void addi();
@@ -63,6 +164,101 @@ class MIPSSimulator
      * @brief Custom instruction for the simulator.
     */
     void halt();
+    /**
+     * @brief System call chosen by $v0, with the SPIM service numbers: print
+     *        integer (1), string (4) and character (11), read integer (5)
+     *        and character (12), sbrk (9), exit (10) and exit with the code
+     *        in $a0 (17).
+    */
+    void syscall();
+    void addu();
+    void subu();
+    void xorf();
+    void sltu();
+    void sllv();
+    void srlv();
+    void srav();
+    void sll();
+    void srl();
+    void sra();
+    void addiu();
+    void xori();
+    void sltiu();
+    void lui();
+    /**
+     * @brief Multiply and divide leave their results in HI and LO: the high
+     *        and low words of the product, or the remainder and quotient.
+    */
+    void mult();
+    void multu();
+    void div();
+    void divu();
+    void mfhi();
+    void mflo();
+    void mthi();
+    void mtlo();
+    void lb();
+    void lbu();
+    void lh();
+    void lhu();
+    void sb();
+    void sh();
+    void blez();
+    void bgtz();
+    void bltz();
+    void bgez();
+    /**
+     * @brief Calls leave the address of the line after the call in $ra, like
+     *        the program counter shown by display_state(), and jr goes back
+     *        to it. Line i is at 4 times i in assembly programs, and at its
+     *        own address in machine code.
+    */
+    void jal();
+    void jr();
+    void jalr();
+    void nop();
+
+    /**
+     * @brief Report an error if the instruction in r breaks the register
+     *        rules of has_valid_registers().
+     * @param operation
+    */
+    void assert_valid_registers(int32_t operation);
+
+    /**
+     * @brief Write the result of the instruction in r to r[0], with the
+     *        checks of add(): a value for $sp must point into the stack, and
+     *        registers must be used as has_valid_registers() allows.
+     *
+     * @param operation
+     * @param value
+    */
+    void write_result(int32_t operation, int32_t value);
+
+    /**
+     * @brief Branch to the line in r[2] if condition holds, for the branches
+     *        that compare r[0] with 0.
+     *
+     * @param operation
+     * @param condition
+    */
+    void branch_if(int32_t operation, bool condition);
+
+    /**
+     * @brief Continue at the line a return address points to, for jr and
+     *        jalr.
+     * @param address m_text_address plus 4 times the line.
+    */
+    void jump_to_address(int32_t address);
+
+    /**
+     * @brief Returns the instruction whose operands are in r.
+     * @param operation
+    */
+    Instruction current_instruction(int32_t operation) const
+    {
+        return Instruction{ operation, { r[0], r[1], r[2] } };
+    }
 
     /**
      * @brief Store label names and addresses and memory names and values from
@@ -70,6 +266,229 @@ class MIPSSimulator
     */
     void pre_process();
 
+    /**
+     * @brief Load the code, data section, symbols and entry point of the
+     *        machine-code program opened in m_binary, decoding every word.
+    */
+    void load_machine_code();
+
+    /**
+     * @brief Returns the text of the loaded program: the source, or the
+     *        disassembly of machine code, which is made the first time.
+    */
+    const SourceFile &program_text() const;
+
+    /**
+     * @brief Returns the contents of the loaded file, which identify the
+     *        program.
+    */
+    std::string_view program_contents() const;
+
+    /**
+     * @brief Load labels, data memory and decoded lines from the program
+     *        image of the input program, instead of running pre_process().
+     *
+     * @return False if images are not used or there is no valid image, in
+     *         which case nothing is loaded.
+    */
+    bool load_program_image();
+
+    /**
+     * @brief Save the program image of the input program, if lines were
+     *        decoded that the saved or loaded image did not have.
+    */
+    void save_program_image();
+
+    /**
+     * @brief Set registers to their values before execution.
+    */
+    void reset_registers();
+
+    /**
+     * @brief Set memory to its contents before execution: the data section
+     *        as declared, and 0 everywhere else.
+    */
+    void reset_memory();
+
+    /**
+     * @brief Check whether the program halted or ran past its last line,
+     *        once it cannot run any further.
+    */
+    void finish();
+
+    /**
+     * @brief Record an error as the state of the program.
+     * @param error
+    */
+    void fail(const SimulationError &error);
+
+    /**
+     * @brief Returns the state of the program.
+    */
+    SimulationResult result() const;
+
+    /**
+     * @brief Start the execution trace, if enabled, from the current state.
+    */
+    void begin_trace();
+
+    /**
+     * @brief Add what the instruction just executed changed to the trace.
+     * @param operation
+    */
+    void trace_instruction(int32_t operation);
+
+    /**
+     * @brief Returns the undo record of the instruction about to execute,
+     *        whose operands are in r.
+     * @param operation
+    */
+    UndoRecord make_undo_record(int32_t operation) const;
+
+    /**
+     * @brief Add a checkpoint of the current state to the history.
+    */
+    void save_checkpoint();
+
+    /**
+     * @brief Take back the last instruction executed, using the history.
+     * @return False if the history has no earlier instruction.
+    */
+    bool undo_instruction();
+
+    /**
+     * @brief Move to a breakpoint on the next instruction, or on a blank or
+     *        label line before it.
+     * @return False if there is no such breakpoint.
+    */
+    bool move_to_breakpoint();
+
+    /**
+     * @brief Returns the hash of the loaded source file, which identifies the
+     *        program in snapshots.
+    */
+    uint64_t source_hash();
+
+    /**
+     * @brief Returns true if run() only uses the interpreter, because an
+     *        enabled feature needs to see every instruction.
+    */
+    bool needs_interpreter() const;
+
+    /**
+     * @brief Count the branch or jump at m_program_counter as taken, if the
+     *        profile is enabled.
+    */
+    void count_taken()
+    {
+        if (m_profile != nullptr)
+            m_profile->count_taken(m_program_counter);
+    }
+
+    /**
+     * @brief Record where a call to step(), run() or rewind_to() left
+     *        execution, so that the profile does not count lines past it.
+    */
+    void leave_profile();
+
+    /**
+     * @brief Returns every label with its line, sorted by line, main
+     *        included.
+    */
+    std::vector<ProfileRegion> profile_regions() const;
+
+    /**
+     * @brief Returns the regions of memory the data cache counts accesses
+     *        to: the stack, every data label with its address, and the
+     *        free memory after the data section.
+    */
+    std::vector<ProfileRegion> data_regions() const;
+
+    /**
+     * @brief Allocate one instruction record per line of the input program.
+     *
+     * Records start out undecoded and are filled in by decode_instruction()
+     * the first time the line is reached, so that errors on lines which are
+     * never executed are still ignored.
+    */
+    void pre_decode();
+
+    /**
+     * @brief Returns the line holding .text, where the code starts.
+     *
+     * The program counter is left as it was.
+    */
+    int32_t find_text_line();
+
+    /**
+     * @brief Parse the line and store the result in its instruction record.
+     *
+     * @param line The line at which the instruction is located.
+    */
+    void decode_instruction(int32_t line);
+
+    /**
+     * @brief Run the decoded program with direct-threaded dispatch until
+     *        halt or the end of the program.
+     *
+     * Every record gets its own jump target, chosen once when the record is
+     * decoded, and handlers read their operands straight from the record.
+     * Records whose checks can only fail at run time (writes to $sp, invalid
+     * registers) are sent through execute_instruction() so that errors are
+     * reported exactly as in the interpreter.
+    */
+    void run_threaded();
+
+    /**
+     * @brief Run the program, translating lines that are reached often to
+     *        native code, until halt or the end of the program.
+     *
+     * Lines that are not translated yet, and lines the translator cannot
+     * handle, are executed with run_instruction().
+    */
+    void run_jit();
+
+    /**
+     * @brief Execute the line at m_program_counter, decoding it first if
+     *        needed, and move m_program_counter to the next line to execute.
+     *
+     * @return The ID of the operation executed.
+    */
+    int32_t run_instruction();
+
+    /**
+     * @brief Count the pairs formed by a dispatched operation, and choose
+     *        the pairs to fuse once the program has warmed up.
+     * @param operation
+    */
+    void count_dispatch(int32_t operation);
+
+    /**
+     * @brief Count the pair formed by operation and the operation executed
+     *        before it.
+     * @param operation
+    */
+    void count_pair(int32_t operation);
+
+    /**
+     * @brief Choose the fusion candidates seen most often so far and fuse
+     *        every decoded line where they occur.
+    */
+    void select_fusions();
+
+    /**
+     * @brief Rewrite the line into a superinstruction if it and the line
+     *        after it form one of the chosen pairs.
+     * @param line
+    */
+    void fuse_instruction(int32_t line);
+
+    /**
+     * @brief Execute the superinstruction at m_program_counter and move
+     *        m_program_counter past it.
+    */
+    void execute_fused();
+
     /**
      * @brief Read an instruction, crop out comments and set the ProgramCounter
      *        value.
@@ -87,10 +506,28 @@ class MIPSSimulator
     int32_t parse_instruction();
 
     /**
-     * @brief Display line number and instruction at which error occurred and
-     *        exit the program.
+     * @brief Stop the simulation with an error at the current line.
+     *
+     * @param message
+     * @throws SimulationError Always.
+     */
+    [[noreturn]] void report_error(std::string_view message);
+
+    /**
+     * @brief Stop the simulation with an error that is not tied to a line.
+     *
+     * @param message
+     * @throws SimulationError Always.
      */
-    void report_error();
+    [[noreturn]] void report_program_error(std::string_view message);
+
+    /**
+     * @brief Write formatted text to the output, like printf().
+     * @param format
+     * @param args
+    */
+    template <typename... Args>
+    void print(const char *format, Args... args);
 
     /**
      * @brief Call the appropriate operation function based on the operation
@@ -107,22 +544,29 @@ class MIPSSimulator
      * @param upper 
      * @param str 
     */
-    void only_spaces(int32_t lower, int32_t upper, std::string str);
+    void only_spaces(int32_t lower, int32_t upper, std::string_view str);
 
     /**
      * @brief Remove spaces starting from first elements till they exist
      *        continuously in str.
      * @param str TOOD
     */
-    void remove_spaces(std::string &str);
+    void remove_spaces(std::string_view &str);
 
     /**
-     * @brief Check that an stoi() on str would be valid, i.e., that str can be
-     *        converted to an integer.
+     * @brief Check that to_number() on str would be valid, i.e., that str can
+     *        be converted to an integer.
      *
      * @param str 
     */
-    void assert_number(const std::string &str);
+    void assert_number(std::string_view str);
+
+    /**
+     * @brief Convert a string already checked by assert_number().
+     * @param str
+     * @return
+    */
+    static int32_t to_number(std::string_view str);
 
     /**
      * @brief Find which register has been specified and the populate the value
@@ -134,9 +578,25 @@ class MIPSSimulator
 
     /**
      * @brief Find and return the label name.
-     * @return 
+     * @return A view into the current line.
+    */
+    std::string_view find_label();
+
+    /**
+     * @brief Find the only word in str, which may be surrounded by spaces.
+     * @param str
+     * @return A view into str.
     */
-    std::string find_label();
+    std::string_view find_word(std::string_view str);
+
+    /**
+     * @brief Find the name of the label ending at the ':' at label_index in
+     *        the current line.
+     *
+     * @param label_index
+     * @return A view into the current line, empty if there is no name.
+    */
+    std::string_view find_label_name(int32_t label_index);
 
     /**
      * @brief Check that first element is a ',' and to remove it.
@@ -144,30 +604,67 @@ class MIPSSimulator
     void assert_remove_comma();
 
     /**
-     * @brief Check that the offset for stack is valid and within bounds.
+     * @brief Check that a value written to $sp points to a word of the stack.
      * @param index 
     */
     void check_stack_bounds(int32_t index);
 
+    /**
+     * @brief Check that a word, halfword or byte can be loaded from or stored
+     *        to an address.
+     *
+     * @param address
+     * @param size 4, 2 or 1.
+    */
+    void check_address(int32_t address, int32_t size);
+
+    /**
+     * @brief Parse the offset and base register of loads and stores, in the
+     *        forms offset($reg), label($reg) and label, and populate r[1]
+     *        and r[2].
+    */
+    void parse_address();
+
+    /**
+     * @brief Find registers separated by commas, populate r[0] and on, and
+     *        check that nothing follows them.
+     * @param count
+    */
+    void parse_registers(int32_t count);
+
+    /**
+     * @brief Parse the values after .word or the size after .space and add
+     *        them to the data section.
+     *
+     * @param directive A view into the current line, from the directive on.
+    */
+    void parse_data(std::string_view directive);
+
     /**
      * @brief Check that the label name does not start with a number and does
      *        not contain special characters.
      *
      * @param str
      */
-    void assert_label_allowed(const std::string &str);
+    void assert_label_allowed(std::string_view str);
 
 public:
     /**
-     * @brief Create a new simulator for a basic MIPS processor.
+     * @brief Create a new simulator for a basic MIPS processor, with no
+     *        program loaded.
      *
-     * Initialize values for the simulator and pass the mode and the input
-     * file path.
+     * The simulator never writes to standard output, reads standard input or
+     * ends the process: errors are returned by load(), step() and run(), and
+     * the state is only printed on request.
      *
-     * @param mode TODO:
-     * @param fileName The relative path to the .s-file with instructions.
+     * @param engine The engine used by run(), one of ENGINE_*.
+     * @param output Where display_state() and display_pair_statistics()
+     *               write.
     */
-    MIPSSimulator(int32_t mode, const std::string &fileName);
+    explicit MIPSSimulator(
+        int32_t engine = ENGINE_INTERPRETER,
+        std::ostream &output = std::cout
+    );
 
     ~MIPSSimulator() = default;
 
@@ -178,14 +675,386 @@ public:
     MIPSSimulator& operator=(const MIPSSimulator&) = delete;
 
     /**
-     * @brief Run the simulator.
+     * @brief Count pairs of consecutively executed operations, for
+     *        display_pair_statistics().
+    */
+    void enable_pair_histogram();
+
+    /**
+     * @brief Fuse the most frequent pairs of operations into single
+     *        superinstructions once the program has warmed up.
+     *
+     * Only used by run() with the interpreter. step() executes a
+     * superinstruction as a single step.
+    */
+    void enable_fusion();
+
+    /**
+     * @brief Keep the preprocessed and decoded program in a directory, keyed
+     *        by a hash of the source, and reuse it in later loads.
+     *
+     * @param directory
+     * @param rebuild Whether to ignore the image already in the directory
+     *                and replace it.
+    */
+    void enable_cache(const std::string &directory, bool rebuild);
+
+    /**
+     * @brief Write a compact trace of every instruction executed, from the
+     *        next load() or reset() until the program stops.
+     *
+     * The trace is read with TraceReader. Tracing runs every instruction
+     * through the interpreter, without fusion.
+     *
+     * @param path
+    */
+    void enable_trace(const std::string &path);
+
+    /**
+     * @brief Keep past states from the next load() or reset() on, so that
+     *        execution can go back with rewind_to(), reverse_step() and
+     *        reverse_continue().
+     *
+     * Every instruction gets an undo record of what it overwrote, and the
+     * full state is saved every checkpoint_interval instructions. The oldest
+     * states are dropped when the history outgrows memory_limit. Keeping the
+     * history runs every instruction through the interpreter, without fusion.
+     *
+     * @param checkpoint_interval
+     * @param memory_limit In bytes.
     */
-    void execute();
+    void enable_history(int64_t checkpoint_interval, size_t memory_limit);
+
+    /**
+     * @brief Count how often every line and branch executes, from now until
+     *        the next load() or reset(), which start a new count, for
+     *        display_profile() and write_folded_profile().
+     *
+     * The count is kept by every engine, including translated code, and
+     * costs one increment per taken branch or jump. Instructions executed
+     * again by rewind_to() are counted again.
+    */
+    void enable_profile();
+
+    /**
+     * @brief Time the executed instructions on a five-stage pipeline, from
+     *        now until the next load() or reset(), for display_pipeline().
+     *
+     * The model needs every instruction, so it runs every instruction
+     * through the interpreter, without fusion. Instructions executed again
+     * by rewind_to() are timed again.
+     *
+     * @param config Forwarding paths and the stage branches are resolved in.
+    */
+    void enable_pipeline(const PipelineConfig &config);
+
+    /**
+     * @brief Simulate an L1 instruction cache, fed with the address of every
+     *        executed instruction, from now until the next load() or reset(),
+     *        for display_caches().
+     *
+     * Like the pipeline model, it runs every instruction through the
+     * interpreter, without fusion.
+     *
+     * @param config Valid geometry, see CacheModel::validate().
+    */
+    void enable_instruction_cache(const CacheConfig &config);
+
+    /**
+     * @brief Simulate an L1 data cache, fed with the address of every load
+     *        and store, from now until the next load() or reset(), for
+     *        display_caches().
+     *
+     * @param config Valid geometry, see CacheModel::validate().
+    */
+    void enable_data_cache(const CacheConfig &config);
+
+    /**
+     * @brief Predict every executed branch and jump with several
+     *        predictors, from now until the next load() or reset(), for
+     *        display_branch_prediction().
+     *
+     * Like the pipeline model, the predictors run every instruction through
+     * the interpreter, without fusion.
+     *
+     * @param configs Valid configurations, see BranchPredictor::validate().
+    */
+    void enable_branch_prediction(const std::vector<PredictorConfig> &configs);
+
+    /**
+     * @brief Time loading, pre-processing, running and displaying from now
+     *        on, and count hardware events while running where the host
+     *        allows it, for write_statistics().
+    */
+    void enable_statistics();
+
+    /**
+     * @brief Set the size of the stack and of the free memory after the data
+     *        section, from the next load() on.
+     *
+     * The stack starts at address 40000 and the data section right after it,
+     * unless an executable places its data section elsewhere, in which case
+     * the stack ends right below it. Sizes are rounded up to a multiple of 4.
+     *
+     * @param stack_size In bytes, DEFAULT_STACK_SIZE unless set.
+     * @param heap_size In bytes, DEFAULT_HEAP_SIZE unless set.
+    */
+    void set_memory_size(int32_t stack_size, int32_t heap_size);
+
+    /**
+     * @brief Set where the output of the program's system calls goes and
+     *        where their input comes from.
+     *
+     * Output is written when execution stops, or once a large block is
+     * collected. Until this is called, output goes to the stream given to
+     * the constructor and there is no input.
+     *
+     * @param output nullptr to discard output.
+     * @param input nullptr if there is no input.
+    */
+    void set_console(std::ostream *output, std::istream *input);
+
+    /**
+     * @brief Make run() stop before executing a line, or no longer stop
+     *        there.
+     *
+     * @param line
+     * @param enabled
+     * @return False if the line is not part of the loaded program.
+    */
+    bool set_breakpoint(int32_t line, bool enabled);
+
+    /**
+     * @brief Load a program, replacing the current one, and prepare it for
+     *        execution from main.
+     *
+     * Buffers of the previous program are reused where possible. Files
+     * ending in .bin, and ELF executables, hold machine code, which is
+     * loaded as BinaryProgram describes and starts at its entry point.
+     *
+     * @param file_name The relative path to the .s-file with instructions,
+     *                  or to the machine code.
+     * @return STATUS_RUNNING, or STATUS_ERROR if the file cannot be read or
+     *         preprocessed.
+    */
+    SimulationResult load(const std::string &file_name);
+
+    /**
+     * @brief Encode the loaded assembly program as MIPS32 machine code, and
+     *        write it as an ELF executable that load() runs with the same
+     *        results, as ProgramAssembler describes.
+     *
+     * Every line is decoded first, so a line that does not parse fails the
+     * assembly instead of stopping the program when reached. The code is
+     * linked at ProgramAssembler::TEXT_ADDRESS, and the data section at the
+     * address it has in this run.
+     *
+     * @param path
+     * @return STATUS_RUNNING, or STATUS_ERROR if the program failed to load
+     *         or is machine code, a line cannot be decoded or encoded, or
+     *         the file cannot be written.
+    */
+    SimulationResult assemble(const std::string &path);
+
+    /**
+     * @brief Decode every line of the code of the loaded assembly program
+     *        now, rather than when each line is first reached.
+     *
+     * A line that does not parse then fails here, even if it would never
+     * run. Machine code is already decoded by load(), and is left as it is.
+     *
+     * @return STATUS_RUNNING, or STATUS_ERROR if the program failed to load
+     *         or a line cannot be decoded. The program can still run after
+     *         a decoding error, up to the line that failed.
+    */
+    SimulationResult decode_program();
+
+    /**
+     * @brief Restart the loaded program, with registers and memory set back
+     *        to their values before execution.
+     *
+     * Lines decoded so far stay decoded.
+    */
+    void reset();
+
+    /**
+     * @brief Execute the next instruction, skipping blank lines.
+     *
+     * @return STATUS_RUNNING if the program can continue, STATUS_HALTED or
+     *         STATUS_ERROR otherwise. Once the program has stopped, the same
+     *         result is returned again.
+    */
+    SimulationResult step();
+
+    /**
+     * @brief Execute the program until halt, an error or a breakpoint, with
+     *        the engine chosen when creating the simulator.
+     *
+     * The line execution starts at never stops it, so that run() can
+     * continue from a breakpoint.
+     *
+     * @return STATUS_HALTED or STATUS_ERROR, or STATUS_RUNNING when stopped
+     *         at a breakpoint.
+    */
+    SimulationResult run();
+
+    /**
+     * @brief Go back to the state after a number of instructions.
+     *
+     * Nearby states are reached by undoing instructions, distant ones by
+     * restoring the closest earlier checkpoint and executing forward. A
+     * program that halted or failed can continue from the new state. An
+     * execution trace ends here.
+     *
+     * @param instruction_count
+     * @return False if the history is not enabled, or does not go back that
+     *         far, in which case nothing changes.
+    */
+    bool rewind_to(int64_t instruction_count);
+
+    /**
+     * @brief Take back the last instruction executed.
+     * @return False if there is no earlier state in the history.
+    */
+    bool reverse_step();
+
+    /**
+     * @brief Go back until reaching a line with a breakpoint, or the earliest
+     *        state in the history.
+     * @return False if there is no earlier state in the history.
+    */
+    bool reverse_continue();
+
+    /**
+     * @brief Save the complete machine state to a file, so that execution
+     *        can resume from it with restore_snapshot().
+     *
+     * @param path
+     * @return False if no program is loaded or the file cannot be written.
+    */
+    bool save_snapshot(const std::string &path);
+
+    /**
+     * @brief Resume from a state saved by save_snapshot().
+     *
+     * The same program must be loaded. The history starts again from the
+     * restored state, and so does the execution trace.
+     *
+     * @param path
+     * @return False if the file is not a valid snapshot of the loaded
+     *         program, in which case nothing changes.
+    */
+    bool restore_snapshot(const std::string &path);
+
+    /**
+     * @brief Returns the smallest instruction count rewind_to() can reach, or
+     *        -1 if there is no history.
+    */
+    int64_t earliest_instruction_count() const;
+
+    /**
+     * @brief Returns true if the program executed halt.
+    */
+    bool has_halted() const;
+
+    /**
+     * @brief Returns the code given to the exit system call, or 0.
+    */
+    int32_t exit_code() const;
+
+    /**
+     * @brief Returns the number of instructions executed so far.
+    */
+    int64_t instruction_count() const;
+
+    /**
+     * @brief Returns the line of the next instruction to execute.
+    */
+    int32_t program_counter() const;
+
+    /**
+     * @brief Returns the address of the next instruction to execute, as
+     *        display_state() shows it.
+    */
+    int32_t program_counter_address() const;
+
+    /**
+     * @brief Returns the value of a register.
+     * @param index From 0 to REGISTER_COUNT - 1, HI and LO last.
+    */
+    int32_t register_value(int32_t index) const;
+
+    /**
+     * @brief Returns guest memory, holding the stack, the data section and
+     *        the free memory after it.
+    */
+    const GuestMemory &memory() const;
+
+    /**
+     * @brief Returns the address of a label in the data section, or -1.
+     * @param label
+    */
+    int32_t data_address(std::string_view label) const;
+
+    /**
+     * @brief Returns a line of the loaded program, disassembled for machine
+     *        code.
+     * @param line
+    */
+    std::string_view source_line(int32_t line) const;
 
     /**
      * @brief Print the current state of the internals of the CPU.
     */
     void display_state();
+
+    /**
+     * @brief Print the most frequent pairs of operations and the number of
+     *        dispatches saved by fusion, if either was enabled.
+    */
+    void display_pair_statistics();
+
+    /**
+     * @brief Print the program annotated with execution counts, and the
+     *        labels and loops where most instructions executed, if the
+     *        profile is enabled.
+    */
+    void display_profile();
+
+    /**
+     * @brief Print the cycles, CPI and stalls of the pipeline, per line and
+     *        in total, if the pipeline model is enabled.
+    */
+    void display_pipeline();
+
+    /**
+     * @brief Print the hits and misses of the simulated caches, in total,
+     *        per label and per line, for those that are enabled.
+    */
+    void display_caches();
+
+    /**
+     * @brief Print the mispredictions of every predictor, in total and per
+     *        branch, if branch prediction is enabled.
+    */
+    void display_branch_prediction();
+
+    /**
+     * @brief Write the profile as folded stacks for flame graph tools, if it
+     *        is enabled.
+     *
+     * @param output
+     * @param root Name of the bottom frame of every stack.
+    */
+    void write_folded_profile(std::ostream &output, std::string_view root) const;
+
+    /**
+     * @brief Write the time spent in each phase, instructions executed,
+     *        nanoseconds per instruction and hardware counts as one line of
+     *        JSON, if statistics are enabled.
+     * @param output
+    */
+    void write_statistics(std::ostream &output);
 };
 
 
@@ -0,0 +1,157 @@
+#include <MappedFile.hpp>
+
+#include <fstream>
+#include <iterator>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile()
+    : m_data{}
+    , m_size{}
+    , m_mapped{}
+#if defined(_WIN32)
+    , m_file{}
+    , m_mapping{}
+#endif
+{
+}
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    // Files that cannot be mapped, such as pipes or empty files, are read
+    if (!map(path))
+    {
+        std::ifstream input_file{ path, std::ios::in | std::ios::binary };
+
+        if (!input_file)
+            return false;
+
+        m_buffer.assign(
+            std::istreambuf_iterator<char>{ input_file },
+            std::istreambuf_iterator<char>{}
+        );
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+
+    return true;
+}
+
+
+bool MappedFile::map(const std::string &path)
+{
+#if defined(_WIN32)
+    HANDLE file{
+        CreateFileA(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr
+        )
+    };
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping{
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+    };
+    const void *view{
+        mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr
+    };
+
+    if (view == nullptr)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file    = file;
+    m_mapping = mapping;
+    m_data    = static_cast<const char *>(view);
+    m_size    = static_cast<size_t>(size.QuadPart);
+#else
+    const int file{ ::open(path.c_str(), O_RDONLY) };
+
+    if (file == -1)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) == -1 || !S_ISREG(status.st_mode) || status.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    void *view{
+        mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0)
+    };
+    // The mapping stays valid after the descriptor is closed
+    ::close(file);
+
+    if (view == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<const char *>(view);
+    m_size = static_cast<size_t>(status.st_size);
+#endif
+
+    m_mapped = true;
+    return true;
+}
+
+
+void MappedFile::close()
+{
+    if (m_mapped)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+#else
+        munmap(const_cast<char *>(m_data), m_size);
+#endif
+    }
+
+    m_buffer.clear();
+    m_data   = nullptr;
+    m_size   = 0;
+    m_mapped = false;
+}
+
+
+std::string_view MappedFile::contents() const
+{
+    return { m_data, m_size };
+}
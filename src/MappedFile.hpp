@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/**
+ * @brief Read-only contents of a file.
+ *
+ * The file is memory mapped where possible and read into a single buffer
+ * otherwise, for example for pipes and empty files.
+ */
+class MappedFile
+{
+    // Contents of the file
+    const char *m_data;
+    size_t      m_size;
+    // Contents, when the file could not be mapped
+    std::string m_buffer;
+    // Whether m_data is a mapping that has to be released
+    bool m_mapped;
+#if defined(_WIN32)
+    void *m_file;
+    void *m_mapping;
+#endif
+
+    /**
+     * @brief Try to map the file into memory.
+     * @param path
+     * @return False if the file could not be mapped.
+    */
+    bool map(const std::string &path);
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Load a file, replacing the current contents.
+     *
+     * @param path
+     * @return False if the file does not exist or could not be read.
+    */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Release the contents.
+    */
+    void close();
+
+    /**
+     * @brief Returns the contents of the file.
+    */
+    std::string_view contents() const;
+};
@@ -1,9 +0,0 @@
-#include <MemoryElement.hpp>
-
-int32_t MemoryElement::sort_memory(
-	const MemoryElement &a,
-	const MemoryElement &b
-)
-{
-	return a.label < b.label;
-}
\ No newline at end of file
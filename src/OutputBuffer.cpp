@@ -0,0 +1,76 @@
+#include <OutputBuffer.hpp>
+
+#include <cstring>
+
+
+OutputBuffer::OutputBuffer(std::FILE *file, size_t capacity)
+    : m_file{ file }
+    , m_buffer(capacity)
+{
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+
+OutputBuffer::~OutputBuffer()
+{
+    sync();
+}
+
+
+bool OutputBuffer::write_pending()
+{
+    const size_t length{ static_cast<size_t>(pptr() - pbase()) };
+    const bool written{
+        length == 0 || std::fwrite(pbase(), 1, length, m_file) == length
+    };
+
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    return written;
+}
+
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type character)
+{
+    if (!write_pending())
+        return traits_type::eof();
+
+    if (traits_type::eq_int_type(character, traits_type::eof()))
+        return traits_type::not_eof(character);
+
+    *pptr() = traits_type::to_char_type(character);
+    pbump(1);
+    return character;
+}
+
+
+std::streamsize OutputBuffer::xsputn(const char *data, std::streamsize count)
+{
+    const std::streamsize space{ epptr() - pptr() };
+
+    if (count <= space)
+    {
+        std::memcpy(pptr(), data, count);
+        pbump(static_cast<int>(count));
+        return count;
+    }
+
+    // Blocks larger than the buffer are written straight through
+    if (!write_pending())
+        return 0;
+
+    if (count >= static_cast<std::streamsize>(m_buffer.size()))
+        return static_cast<std::streamsize>(std::fwrite(data, 1, count, m_file));
+
+    std::memcpy(pptr(), data, count);
+    pbump(static_cast<int>(count));
+    return count;
+}
+
+
+int OutputBuffer::sync()
+{
+    if (!write_pending())
+        return -1;
+
+    return std::fflush(m_file) == 0 ? 0 : -1;
+}
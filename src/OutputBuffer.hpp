@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdio>
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+/**
+ * @brief Stream buffer which collects output in one large block and hands
+ *        it to a C stream only when the block is full or on flush.
+ *
+ * State dumps are made of many short writes, so going through this buffer
+ * turns them into a few large writes.
+ */
+class OutputBuffer : public std::streambuf
+{
+    // Where the output goes
+    std::FILE *m_file;
+    // Output not written yet
+    std::vector<char> m_buffer;
+
+    /**
+     * @brief Write the pending output to the file.
+     * @return False if the file did not take all of it.
+    */
+    bool write_pending();
+
+protected:
+    int_type overflow(int_type character) override;
+    std::streamsize xsputn(const char *data, std::streamsize count) override;
+    int sync() override;
+
+public:
+    /**
+     * @brief Create a buffer writing to file.
+     *
+     * @param file
+     * @param capacity Size of the block in bytes.
+    */
+    explicit OutputBuffer(std::FILE *file, size_t capacity = 1 << 16);
+
+    ~OutputBuffer() override;
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+};
@@ -0,0 +1,122 @@
+#include <PerfCounters.hpp>
+
+#if MIPS_PERF_SUPPORTED
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#if MIPS_PERF_SUPPORTED
+namespace
+{
+
+// Generic hardware events, in the order of the PERF_* counters
+constexpr uint64_t PERF_EVENTS[PERF_COUNTER_COUNT]{
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES
+};
+
+/**
+ * @brief Layout of what read() returns for a counter opened with the
+ *        enabled and running times.
+ */
+struct PerfReading
+{
+    uint64_t value;
+    uint64_t time_enabled;
+    uint64_t time_running;
+};
+
+}
+#endif
+
+
+PerfCounters::PerfCounters()
+{
+    for (int32_t i{}; i < PERF_COUNTER_COUNT; i++)
+        m_descriptors[i] = -1;
+
+#if MIPS_PERF_SUPPORTED
+    for (int32_t i{}; i < PERF_COUNTER_COUNT; i++)
+    {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_EVENTS[i];
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format =
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // This thread, on any processor, in no group
+        m_descriptors[i] = static_cast<int>(
+            syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0)
+        );
+    }
+#endif
+}
+
+
+PerfCounters::~PerfCounters()
+{
+#if MIPS_PERF_SUPPORTED
+    for (const int descriptor : m_descriptors)
+        if (descriptor >= 0)
+            close(descriptor);
+#endif
+}
+
+
+bool PerfCounters::is_available(int32_t counter) const
+{
+    return m_descriptors[counter] >= 0;
+}
+
+
+void PerfCounters::start()
+{
+#if MIPS_PERF_SUPPORTED
+    for (const int descriptor : m_descriptors)
+        if (descriptor >= 0)
+            ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+
+void PerfCounters::stop()
+{
+#if MIPS_PERF_SUPPORTED
+    for (const int descriptor : m_descriptors)
+        if (descriptor >= 0)
+            ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+
+int64_t PerfCounters::read(int32_t counter) const
+{
+#if MIPS_PERF_SUPPORTED
+    PerfReading reading{};
+
+    if (m_descriptors[counter] < 0
+        || ::read(m_descriptors[counter], &reading, sizeof(reading)) != sizeof(reading))
+        return -1;
+
+    // Shared with other counters for part of the time
+    if (reading.time_running != 0 && reading.time_running < reading.time_enabled)
+        return static_cast<int64_t>(
+            static_cast<double>(reading.value) * reading.time_enabled / reading.time_running
+        );
+
+    return static_cast<int64_t>(reading.value);
+#else
+    return -1;
+#endif
+}
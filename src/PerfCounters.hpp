@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+//  Hardware counters are read through perf_event_open, which only Linux has
+#if defined(__linux__)
+#define MIPS_PERF_SUPPORTED 1
+#else
+#define MIPS_PERF_SUPPORTED 0
+#endif
+
+// Counters that are opened, in the order of PERF_COUNTER_NAMES
+constexpr int32_t PERF_CYCLES{ 0 };
+constexpr int32_t PERF_INSTRUCTIONS{ 1 };
+constexpr int32_t PERF_BRANCH_MISSES{ 2 };
+constexpr int32_t PERF_CACHE_MISSES{ 3 };
+constexpr int32_t PERF_COUNTER_COUNT{ 4 };
+
+// Names used when the counters are reported
+constexpr const char *PERF_COUNTER_NAMES[PERF_COUNTER_COUNT]{
+    "cycles",
+    "instructions",
+    "branch_misses",
+    "cache_misses"
+};
+
+/**
+ * @brief Hardware performance counters of the calling thread, counting user
+ *        space only, and only between start() and stop().
+ *
+ * Every counter is opened on its own, so that counters the processor or the
+ * kernel do not offer are simply missing. When the kernel shares the
+ * hardware between more counters than it has, values are scaled up to the
+ * whole time the counter was enabled.
+ */
+class PerfCounters
+{
+    // File descriptor of every counter, -1 if it could not be opened
+    int m_descriptors[PERF_COUNTER_COUNT];
+
+public:
+    /**
+     * @brief Open the counters, disabled.
+    */
+    PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * @brief Returns true if a counter could be opened.
+     * @param counter One of PERF_*.
+    */
+    bool is_available(int32_t counter) const;
+
+    /**
+     * @brief Start counting.
+    */
+    void start();
+
+    /**
+     * @brief Stop counting, keeping the counts so far.
+    */
+    void stop();
+
+    /**
+     * @brief Returns the count of a counter, or -1 if it is not available.
+     * @param counter One of PERF_*.
+    */
+    int64_t read(int32_t counter) const;
+};
@@ -0,0 +1,257 @@
+#include <PipelineModel.hpp>
+#include <ReportFormat.hpp>
+
+#include <algorithm>
+#include <string>
+
+
+namespace
+{
+
+// Names of the stages and the forwarding paths, as display() shows them
+constexpr const char *STAGE_NAMES[]{ "IF", "ID", "EX", "MEM", "WB" };
+constexpr const char *FORWARDING_NAMES[]{
+    "none",
+    "MEM/WB",
+    "EX/MEM and MEM/WB"
+};
+
+// Cycle no register was written in, far enough back to never stall
+constexpr int64_t NEVER_WRITTEN{ -16 };
+
+
+/**
+ * @brief Returns true for the transfers that read registers to pick the next
+ *        line, and so wait for them in the stage branches resolve in:
+ *        conditional branches, jr and jalr.
+ * @param operation
+*/
+bool resolves_in_branch_stage(int32_t operation)
+{
+    return is_conditional_branch(operation) || is_register_jump(operation);
+}
+
+}
+
+
+PipelineModel::PipelineModel(const PipelineConfig &config)
+    : m_config{ config }
+    , m_written{}
+    , m_loaded{}
+    , m_last_cycle{}
+    , m_fetch_cycle{}
+    , m_instructions{}
+    , m_branches{}
+    , m_taken{}
+{
+    reset(0);
+}
+
+
+void PipelineModel::reset(int32_t line_count)
+{
+    m_lines.assign(line_count, PipelineLine{});
+    std::fill(m_written, m_written + REGISTER_COUNT, NEVER_WRITTEN);
+    std::fill(m_loaded, m_loaded + REGISTER_COUNT, false);
+    // The first instruction is fetched in cycle 1, so it reaches EX in 3
+    m_last_cycle = STAGE_EX;
+    m_fetch_cycle = 0;
+    m_instructions = 0;
+    m_branches = 0;
+    m_taken = 0;
+}
+
+
+int64_t PipelineModel::register_file_cycle(int32_t reg) const
+{
+    // The register file is written in the first half of WB and read in the
+    // second half of ID, so a reader can be in ID while the writer is in WB
+    return m_written[reg] + STAGE_WB - STAGE_EX + 1;
+}
+
+
+int64_t PipelineModel::ready_cycle(int32_t reg, int32_t stage) const
+{
+    const int64_t written{ m_written[reg] };
+    const bool loaded{ m_loaded[reg] };
+    const int32_t forwarding{ m_config.forwarding };
+
+    if (stage == STAGE_EX && forwarding == FORWARD_FULL && !loaded)
+        return written + 1;
+    if (stage == STAGE_EX && forwarding != FORWARD_NONE)
+        return written + 2;
+    // Only ALU results are ready in time to forward to ID
+    if (stage == STAGE_ID && forwarding == FORWARD_FULL && !loaded)
+        return written + 2;
+    // Both results and loaded words reach MEM through MEM/WB
+    if (stage == STAGE_MEM && forwarding != FORWARD_NONE)
+        return written + 1;
+
+    return register_file_cycle(reg);
+}
+
+
+void PipelineModel::add(int32_t line, const Instruction &instruction, int32_t next_line)
+{
+    const int32_t operation{ instruction.operation };
+    PipelineLine &timing{ m_lines[line] };
+
+    const int64_t in_order{ m_last_cycle + 1 };
+    const int64_t fetched{ std::max(in_order, m_fetch_cycle) };
+    int64_t cycle{ fetched };
+    bool load_use{};
+
+    int32_t registers[2];
+    const int32_t count{ read_registers(instruction, registers) };
+    for (int32_t i{}; i < count; i++)
+    {
+        // $zero never changes
+        if (registers[i] == 0)
+            continue;
+
+        int32_t stage{ STAGE_EX };
+        if (resolves_in_branch_stage(operation) && m_config.branch_stage == STAGE_ID)
+            stage = STAGE_ID;
+        // The value to store is needed in MEM, the base in EX
+        else if (is_store(operation) && i == 0)
+            stage = STAGE_MEM;
+
+        const int64_t ready{ ready_cycle(registers[i], stage) };
+        if (ready > cycle)
+        {
+            cycle = ready;
+            load_use = m_loaded[registers[i]];
+        }
+    }
+
+    // Operands count as forwarded if they are not yet in the register file
+    // when the instruction finally reaches EX
+    for (int32_t i{}; i < count; i++)
+        if (registers[i] != 0 && cycle < register_file_cycle(registers[i]))
+            timing.forwarded++;
+
+    timing.executions++;
+    if (load_use)
+        timing.load_use_stalls += cycle - fetched;
+    else
+        timing.data_stalls += cycle - fetched;
+
+    const int32_t written{ written_register(instruction) };
+    if (written > 0)
+    {
+        m_written[written] = cycle;
+        m_loaded[written] = is_load(operation);
+    }
+    // mult and div write both HI and LO, and system calls $v0
+    if (is_multiply_divide(operation))
+    {
+        m_written[REGISTER_HI] = m_written[REGISTER_LO] = cycle;
+        m_loaded[REGISTER_HI] = m_loaded[REGISTER_LO] = false;
+    }
+    if (operation == OPERATION_SYSCALL)
+    {
+        m_written[2] = cycle;
+        m_loaded[2] = false;
+    }
+
+    // Instructions fetched after a branch or jump until it is resolved are
+    // flushed, one per stage between IF and the resolving stage
+    if (is_jump(operation))
+    {
+        const bool taken{ next_line != line + 1 };
+        const int32_t penalty{
+            operation == OPERATION_J || operation == OPERATION_JAL ? STAGE_ID : m_config.branch_stage
+        };
+
+        m_branches++;
+        if (taken)
+        {
+            m_taken++;
+            timing.branch_penalty += penalty;
+            m_fetch_cycle = cycle + 1 + penalty;
+        }
+    }
+
+    m_last_cycle = cycle;
+    m_instructions++;
+}
+
+
+int64_t PipelineModel::instructions() const
+{
+    return m_instructions;
+}
+
+
+int64_t PipelineModel::cycles() const
+{
+    return m_instructions > 0 ? m_last_cycle + STAGE_WB - STAGE_EX : 0;
+}
+
+
+const std::vector<PipelineLine> &PipelineModel::lines() const
+{
+    return m_lines;
+}
+
+
+void PipelineModel::display(
+    std::ostream &output,
+    const SourceFile &source,
+    const std::vector<Instruction> &program
+) const
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+    const int64_t cycles{ this->cycles() };
+
+    output
+        << "Pipeline timing of " << m_instructions << " instructions: "
+        << cycles << " cycles, CPI " << ratio(cycles, m_instructions) << '\n'
+        << "Forwarding: " << FORWARDING_NAMES[m_config.forwarding]
+        << ", branches resolved in " << STAGE_NAMES[m_config.branch_stage] << "\n\n";
+    output << "       Count      Cycles   CPI        Data    Load-use      Branch   Line  Source\n";
+
+    PipelineLine total{};
+    for (int32_t line{}; line < line_count; line++)
+    {
+        const PipelineLine &timing{ m_lines[line] };
+        const int64_t line_cycles{
+            timing.executions + timing.data_stalls + timing.load_use_stalls + timing.branch_penalty
+        };
+
+        if (program[line].operation >= 0)
+        {
+            print_column(output, timing.executions, 12);
+            print_column(output, line_cycles, 12);
+            print_column(output, ratio(line_cycles, timing.executions), 6);
+            print_column(output, timing.data_stalls, 12);
+            print_column(output, timing.load_use_stalls, 12);
+            print_column(output, timing.branch_penalty, 12);
+        } else
+            output << std::string(12 * 5 + 6, ' ');
+
+        print_column(output, line + 1, 7);
+        output << "  " << source[line] << '\n';
+
+        total.data_stalls += timing.data_stalls;
+        total.load_use_stalls += timing.load_use_stalls;
+        total.branch_penalty += timing.branch_penalty;
+        total.forwarded += timing.forwarded;
+    }
+
+    // Filling and draining the pipeline costs the cycles of the stages
+    // after IF, once
+    output << "\nCycles\n";
+    print_column(output, m_instructions, 12);
+    output << "  instructions\n";
+    print_column(output, m_instructions > 0 ? STAGE_WB : 0, 12);
+    output << "  filling the pipeline\n";
+    print_column(output, total.data_stalls, 12);
+    output << "  data hazard stalls\n";
+    print_column(output, total.load_use_stalls, 12);
+    output << "  load-use stalls\n";
+    print_column(output, total.branch_penalty, 12);
+    output << "  branch penalties, " << m_taken << " of " << m_branches << " branches and jumps taken\n";
+    print_column(output, total.forwarded, 12);
+    output << "  operands forwarded\n";
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <Instruction.hpp>
+#include <SourceFile.hpp>
+
+// Stages of the pipeline, in order
+constexpr int32_t STAGE_IF{ 0 };
+constexpr int32_t STAGE_ID{ 1 };
+constexpr int32_t STAGE_EX{ 2 };
+constexpr int32_t STAGE_MEM{ 3 };
+constexpr int32_t STAGE_WB{ 4 };
+
+// Forwarding paths of the pipeline
+// None, results are only read from the register file
+constexpr int32_t FORWARD_NONE{ 0 };
+// From the MEM/WB latch to the ALU and to stores in MEM
+constexpr int32_t FORWARD_MEM{ 1 };
+// From the EX/MEM latch as well, to the ALU and to branches resolved in ID
+constexpr int32_t FORWARD_FULL{ 2 };
+
+/**
+ * @brief Design point of the pipeline.
+ */
+struct PipelineConfig
+{
+    // One of FORWARD_*
+    int32_t forwarding{ FORWARD_FULL };
+    // Stage taken branches and jr are resolved in: STAGE_ID, STAGE_EX or
+    // STAGE_MEM
+    int32_t branch_stage{ STAGE_ID };
+};
+
+/**
+ * @brief Cycles spent on one line of the program.
+ */
+struct PipelineLine
+{
+    int64_t executions;
+    // Stalls waiting for a result that was not computed yet, or not yet
+    // written back without forwarding, and for the result of a load
+    int64_t data_stalls;
+    int64_t load_use_stalls;
+    // Cycles lost refetching after the branch or jump on this line
+    int64_t branch_penalty;
+    // Operands that were forwarded rather than read from the register file
+    int64_t forwarded;
+};
+
+/**
+ * @brief Timing of a classic in-order five-stage pipeline, IF, ID, EX, MEM
+ *        and WB, running the instructions the simulator executes.
+ *
+ * Only timing is modelled: the simulator executes each instruction, and
+ * add() then finds the first cycle it can enter EX in. That is the cycle
+ * after the previous instruction, unless
+ *
+ *   - an operand is not ready: ALU results exist at the end of EX and loaded
+ *     words at the end of MEM. Without a forwarding path they are read from
+ *     the register file in ID, in the cycle they are written back in WB.
+ *     Branches resolved in ID need their operands there, and stores need
+ *     the value to store in MEM;
+ *   - the previous instruction redirected fetch: jumps are known in ID, and
+ *     taken branches, jr and jalr in the configured stage. Fetch continues
+ *     with the next line until then, so the instructions fetched since are
+ *     flushed, one per stage after IF.
+ *
+ * mult and div take one cycle in EX and write HI and LO like any result.
+ */
+class PipelineModel
+{
+    PipelineConfig m_config;
+    // Timing of every line
+    std::vector<PipelineLine> m_lines;
+    // EX cycle of the last instruction that wrote each register, and
+    // whether it was a load
+    int64_t m_written[REGISTER_COUNT];
+    bool m_loaded[REGISTER_COUNT];
+    // EX cycle of the last instruction, and the earliest EX cycle of the
+    // next one, after a branch or jump
+    int64_t m_last_cycle;
+    int64_t m_fetch_cycle;
+    int64_t m_instructions;
+    // Branches, and those that were taken, jumps included
+    int64_t m_branches;
+    int64_t m_taken;
+
+    /**
+     * @brief Returns the first EX cycle of an instruction that finds a
+     *        register in the register file.
+     * @param reg
+    */
+    int64_t register_file_cycle(int32_t reg) const;
+
+    /**
+     * @brief Returns the first EX cycle of an instruction that can read a
+     *        register, through the register file or a forwarding path.
+     *
+     * @param reg
+     * @param stage Stage the value is needed in: STAGE_ID, STAGE_EX or
+     *              STAGE_MEM.
+    */
+    int64_t ready_cycle(int32_t reg, int32_t stage) const;
+
+public:
+    explicit PipelineModel(const PipelineConfig &config);
+
+    /**
+     * @brief Forget all timing and size the model for a program.
+     * @param line_count
+    */
+    void reset(int32_t line_count);
+
+    /**
+     * @brief Add an executed instruction to the pipeline.
+     *
+     * @param line
+     * @param instruction Not a superinstruction.
+     * @param next_line Line executed next, to tell whether a branch was
+     *                  taken.
+    */
+    void add(int32_t line, const Instruction &instruction, int32_t next_line);
+
+    /**
+     * @brief Returns the number of instructions added.
+    */
+    int64_t instructions() const;
+
+    /**
+     * @brief Returns the cycles taken until the last instruction left WB.
+    */
+    int64_t cycles() const;
+
+    /**
+     * @brief Returns the timing of every line.
+    */
+    const std::vector<PipelineLine> &lines() const;
+
+    /**
+     * @brief Print the design point, the cycles and CPI, the source annotated
+     *        with the cycles and stalls of every line, and the totals.
+     *
+     * @param output
+     * @param source
+     * @param program
+    */
+    void display(
+        std::ostream &output,
+        const SourceFile &source,
+        const std::vector<Instruction> &program
+    ) const;
+};
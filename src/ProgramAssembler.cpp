@@ -0,0 +1,564 @@
+#include <ProgramAssembler.hpp>
+
+#include <fstream>
+
+#include <ElfFormat.hpp>
+
+
+namespace
+{
+
+// Sections of the executable, in the order of their headers
+constexpr uint16_t SECTION_TEXT{ 1 };
+constexpr uint16_t SECTION_DATA{ 2 };
+constexpr uint16_t SECTION_SYMBOLS{ 3 };
+constexpr uint16_t SECTION_NAMES{ 4 };
+constexpr uint16_t SECTION_SECTION_NAMES{ 5 };
+constexpr uint16_t SECTION_COUNT{ 6 };
+
+// Names of the sections, at the offsets given in SECTION_NAME_OFFSETS
+constexpr char SECTION_NAMES_TEXT[]{ "\0.text\0.data\0.symtab\0.strtab\0.shstrtab" };
+constexpr uint32_t SECTION_NAME_OFFSETS[SECTION_COUNT]{ 0, 1, 7, 13, 21, 29 };
+
+
+/**
+ * @brief Returns true if a value fits in a sign-extended 16-bit immediate.
+ * @param value
+*/
+bool fits_signed(int32_t value)
+{
+    return -32'768 <= value && value <= 32'767;
+}
+
+
+/**
+ * @brief Returns true if a value fits in a zero-extended 16-bit immediate.
+ * @param value
+*/
+bool fits_unsigned(int32_t value)
+{
+    return 0 <= value && value <= 65'535;
+}
+
+
+/**
+ * @brief Returns an R-format word of the SPECIAL opcode.
+ * @param function
+ * @param rs
+ * @param rt
+ * @param rd
+ * @param shift
+*/
+uint32_t r_format(uint32_t function, int32_t rs, int32_t rt, int32_t rd, int32_t shift = 0)
+{
+    return static_cast<uint32_t>(rs) << 21 | static_cast<uint32_t>(rt) << 16
+        | static_cast<uint32_t>(rd) << 11 | static_cast<uint32_t>(shift & 31) << 6 | function;
+}
+
+
+/**
+ * @brief Returns an I-format word, keeping the low 16 bits of the immediate.
+ * @param opcode
+ * @param rs
+ * @param rt
+ * @param immediate
+*/
+uint32_t i_format(uint32_t opcode, int32_t rs, int32_t rt, int32_t immediate)
+{
+    return opcode << 26 | static_cast<uint32_t>(rs) << 21 | static_cast<uint32_t>(rt) << 16
+        | (static_cast<uint32_t>(immediate) & 0xFFFF);
+}
+
+
+/**
+ * @brief Returns the function field of an R-format operation with registers
+ *        rd, rs and rt, or 0 if the operation is not one.
+ * @param operation
+*/
+uint32_t register_function(int32_t operation)
+{
+    switch (operation)
+    {
+    case OPERATION_ADD: return 0x20;
+    case OPERATION_SUB: return 0x22;
+    case OPERATION_AND: return 0x24;
+    case OPERATION_OR: return 0x25;
+    case OPERATION_NOR: return 0x27;
+    case OPERATION_SLT: return 0x2A;
+    case OPERATION_ADDU: return 0x21;
+    case OPERATION_SUBU: return 0x23;
+    case OPERATION_XOR: return 0x26;
+    case OPERATION_SLTU: return 0x2B;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Returns the opcode of an I-format arithmetic, logical or memory
+ *        operation, or 0 if the operation is not one.
+ * @param operation
+*/
+uint32_t immediate_opcode(int32_t operation)
+{
+    switch (operation)
+    {
+    case OPERATION_ADDI: return 0x08;
+    case OPERATION_ANDI: return 0x0C;
+    case OPERATION_ORI: return 0x0D;
+    case OPERATION_SLTI: return 0x0A;
+    case OPERATION_ADDIU: return 0x09;
+    case OPERATION_XORI: return 0x0E;
+    case OPERATION_SLTIU: return 0x0B;
+    case OPERATION_LW: return 0x23;
+    case OPERATION_SW: return 0x2B;
+    case OPERATION_LB: return 0x20;
+    case OPERATION_LBU: return 0x24;
+    case OPERATION_LH: return 0x21;
+    case OPERATION_LHU: return 0x25;
+    case OPERATION_SB: return 0x28;
+    case OPERATION_SH: return 0x29;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Returns the function field of the R-format operation an immediate
+ *        operation is expanded to, when its immediate is built in $at.
+ * @param operation
+*/
+uint32_t expanded_function(int32_t operation)
+{
+    switch (operation)
+    {
+    case OPERATION_ADDI: return 0x20;
+    case OPERATION_ANDI: return 0x24;
+    case OPERATION_ORI: return 0x25;
+    case OPERATION_SLTI: return 0x2A;
+    case OPERATION_ADDIU: return 0x21;
+    case OPERATION_XORI: return 0x26;
+    }
+    return 0x2B;
+}
+
+
+/**
+ * @brief Returns true for the immediates that are sign-extended.
+ * @param operation
+*/
+bool is_signed_immediate(int32_t operation)
+{
+    return operation == OPERATION_ADDI || operation == OPERATION_SLTI
+        || operation == OPERATION_ADDIU || operation == OPERATION_SLTIU;
+}
+
+
+/**
+ * @brief Returns true for the immediates that are zero-extended.
+ * @param operation
+*/
+bool is_unsigned_immediate(int32_t operation)
+{
+    return operation == OPERATION_ANDI || operation == OPERATION_ORI || operation == OPERATION_XORI;
+}
+
+
+/**
+ * @brief Store a big-endian halfword.
+ * @param image
+ * @param offset
+ * @param value
+*/
+void put_halfword(std::string &image, size_t offset, uint32_t value)
+{
+    image[offset] = static_cast<char>(value >> 8);
+    image[offset + 1] = static_cast<char>(value);
+}
+
+
+/**
+ * @brief Store a big-endian word.
+ * @param image
+ * @param offset
+ * @param value
+*/
+void put_word(std::string &image, size_t offset, uint32_t value)
+{
+    image[offset] = static_cast<char>(value >> 24);
+    image[offset + 1] = static_cast<char>(value >> 16);
+    image[offset + 2] = static_cast<char>(value >> 8);
+    image[offset + 3] = static_cast<char>(value);
+}
+
+
+/**
+ * @brief Store a section header.
+ * @param image
+ * @param offset
+ * @param index One of SECTION_*.
+ * @param type
+ * @param flags
+ * @param address
+ * @param position Offset of the section in the file.
+ * @param size
+ * @param link
+ * @param entry_size
+*/
+void put_section(
+    std::string &image,
+    size_t offset,
+    uint16_t index,
+    uint32_t type,
+    uint32_t flags,
+    uint32_t address,
+    size_t position,
+    size_t size,
+    uint32_t link = 0,
+    uint32_t entry_size = 0
+)
+{
+    put_word(image, offset, SECTION_NAME_OFFSETS[index]);
+    put_word(image, offset + 4, type);
+    put_word(image, offset + 8, flags);
+    put_word(image, offset + 12, address);
+    put_word(image, offset + 16, static_cast<uint32_t>(position));
+    put_word(image, offset + 20, static_cast<uint32_t>(size));
+    put_word(image, offset + 24, link);
+    // Every symbol is global, so the first global one is right after the
+    // null symbol
+    put_word(image, offset + 28, type == SECTION_SYMBOL_TABLE ? 1 : 0);
+    put_word(image, offset + 32, type == SECTION_STRING_TABLE ? 1 : 4);
+    put_word(image, offset + 36, entry_size);
+}
+
+
+/**
+ * @brief Returns an offset rounded up to a multiple of 4.
+ * @param offset
+*/
+size_t align(size_t offset)
+{
+    return (offset + 3) & ~size_t{ 3 };
+}
+
+}
+
+
+ProgramAssembler::ProgramAssembler()
+    : m_entry_address{}
+    , m_data_address{}
+{
+}
+
+
+int32_t ProgramAssembler::encoded_size(const Instruction &instruction)
+{
+    const int32_t operation{ instruction.operation };
+    const int32_t immediate{ instruction.r[2] };
+
+    if (operation < 0)
+        return 0;
+
+    // lui $at, ori $at and the instruction, which reads $at
+    if (is_signed_immediate(operation))
+        return fits_signed(immediate) ? 1 : 3;
+    if (is_unsigned_immediate(operation))
+        return fits_unsigned(immediate) ? 1 : 3;
+
+    // lui $at, addu $at with the base unless it is $zero, and the access
+    // through $at
+    if (is_memory_access(operation) && !fits_signed(immediate))
+        return instruction.r[1] == 0 ? 2 : 3;
+
+    return 1;
+}
+
+
+const char *ProgramAssembler::encode(int32_t line, const Instruction &instruction)
+{
+    const int32_t operation{ instruction.operation };
+    const int32_t *r{ instruction.r };
+    const uint32_t address{ m_line_addresses[line] };
+
+    // Labels and blank lines
+    if (operation < 0)
+        return nullptr;
+
+    if (register_function(operation) != 0)
+    {
+        m_text.push_back(r_format(register_function(operation), r[1], r[2], r[0]));
+        return nullptr;
+    }
+
+    if (is_signed_immediate(operation) || is_unsigned_immediate(operation))
+    {
+        if (encoded_size(instruction) == 1)
+        {
+            m_text.push_back(i_format(immediate_opcode(operation), r[1], r[0], r[2]));
+            return nullptr;
+        }
+
+        const uint32_t value{ static_cast<uint32_t>(r[2]) };
+        m_text.push_back(i_format(0x0F, 0, ASSEMBLER_REGISTER, static_cast<int32_t>(value >> 16)));
+        m_text.push_back(i_format(0x0D, ASSEMBLER_REGISTER, ASSEMBLER_REGISTER, static_cast<int32_t>(value)));
+        m_text.push_back(r_format(expanded_function(operation), r[1], ASSEMBLER_REGISTER, r[0]));
+        return nullptr;
+    }
+
+    if (is_memory_access(operation))
+    {
+        if (encoded_size(instruction) == 1)
+        {
+            m_text.push_back(i_format(immediate_opcode(operation), r[1], r[0], r[2]));
+            return nullptr;
+        }
+
+        // The low half is sign-extended, so the high half makes up for it
+        const int32_t upper{ static_cast<int32_t>((int64_t{ r[2] } + 0x8000) >> 16) };
+        const int32_t lower{ static_cast<int16_t>(r[2] & 0xFFFF) };
+        m_text.push_back(i_format(0x0F, 0, ASSEMBLER_REGISTER, upper));
+        if (r[1] != 0)
+            m_text.push_back(r_format(0x21, ASSEMBLER_REGISTER, r[1], ASSEMBLER_REGISTER));
+        m_text.push_back(i_format(immediate_opcode(operation), ASSEMBLER_REGISTER, r[0], lower));
+        return nullptr;
+    }
+
+    switch (operation)
+    {
+    case OPERATION_MUL:
+        m_text.push_back(0x1Cu << 26 | r_format(0x02, r[1], r[2], r[0]));
+        return nullptr;
+    case OPERATION_BEQ:
+    case OPERATION_BNE:
+    case OPERATION_BLEZ:
+    case OPERATION_BGTZ:
+    case OPERATION_BLTZ:
+    case OPERATION_BGEZ:
+    {
+        // Without delay slots, branches are relative to the next word
+        const int32_t offset{
+            static_cast<int32_t>(m_line_addresses[r[2]] - address - 4) / 4
+        };
+        if (!fits_signed(offset))
+            return "Branch target is too far away to encode.";
+
+        if (operation == OPERATION_BEQ || operation == OPERATION_BNE)
+            m_text.push_back(i_format(operation == OPERATION_BEQ ? 0x04 : 0x05, r[0], r[1], offset));
+        else if (operation == OPERATION_BLEZ || operation == OPERATION_BGTZ)
+            m_text.push_back(i_format(operation == OPERATION_BLEZ ? 0x06 : 0x07, r[0], 0, offset));
+        else
+            m_text.push_back(i_format(0x01, r[0], operation == OPERATION_BLTZ ? 0 : 1, offset));
+        return nullptr;
+    }
+    case OPERATION_J:
+    case OPERATION_JAL:
+    {
+        // Jumps keep the top four bits of the address of the next word
+        const uint32_t jump_target{ m_line_addresses[r[0]] };
+        if (((address + 4) & 0xF000'0000u) != (jump_target & 0xF000'0000u))
+            return "Jump target is too far away to encode.";
+        m_text.push_back((operation == OPERATION_J ? 0x02u : 0x03u) << 26 | (jump_target >> 2 & 0x03FF'FFFFu));
+        return nullptr;
+    }
+    // halt is encoded as break, which stops the program the same way
+    case OPERATION_HALT: m_text.push_back(r_format(0x0D, 0, 0, 0)); return nullptr;
+    case OPERATION_SYSCALL: m_text.push_back(r_format(0x0C, 0, 0, 0)); return nullptr;
+    case OPERATION_SLLV: m_text.push_back(r_format(0x04, r[2], r[1], r[0])); return nullptr;
+    case OPERATION_SRLV: m_text.push_back(r_format(0x06, r[2], r[1], r[0])); return nullptr;
+    case OPERATION_SRAV: m_text.push_back(r_format(0x07, r[2], r[1], r[0])); return nullptr;
+    case OPERATION_SLL: m_text.push_back(r_format(0x00, 0, r[1], r[0], r[2])); return nullptr;
+    case OPERATION_SRL: m_text.push_back(r_format(0x02, 0, r[1], r[0], r[2])); return nullptr;
+    case OPERATION_SRA: m_text.push_back(r_format(0x03, 0, r[1], r[0], r[2])); return nullptr;
+    case OPERATION_LUI: m_text.push_back(i_format(0x0F, 0, r[0], r[2])); return nullptr;
+    case OPERATION_MULT: m_text.push_back(r_format(0x18, r[0], r[1], 0)); return nullptr;
+    case OPERATION_MULTU: m_text.push_back(r_format(0x19, r[0], r[1], 0)); return nullptr;
+    case OPERATION_DIV: m_text.push_back(r_format(0x1A, r[0], r[1], 0)); return nullptr;
+    case OPERATION_DIVU: m_text.push_back(r_format(0x1B, r[0], r[1], 0)); return nullptr;
+    case OPERATION_MFHI: m_text.push_back(r_format(0x10, 0, 0, r[0])); return nullptr;
+    case OPERATION_MFLO: m_text.push_back(r_format(0x12, 0, 0, r[0])); return nullptr;
+    case OPERATION_MTHI: m_text.push_back(r_format(0x11, r[0], 0, 0)); return nullptr;
+    case OPERATION_MTLO: m_text.push_back(r_format(0x13, r[0], 0, 0)); return nullptr;
+    case OPERATION_JR: m_text.push_back(r_format(0x08, r[0], 0, 0)); return nullptr;
+    case OPERATION_JALR: m_text.push_back(r_format(0x09, r[0], 0, 31)); return nullptr;
+    case OPERATION_NOP: m_text.push_back(0); return nullptr;
+    }
+
+    return "Instruction cannot be encoded.";
+}
+
+
+void ProgramAssembler::add_symbol(std::string_view name, uint32_t address, uint8_t type, uint16_t section)
+{
+    m_symbols.push_back(Symbol{ static_cast<uint32_t>(m_names.size()), address, type, section });
+    m_names.append(name);
+    m_names += '\0';
+}
+
+
+const char *ProgramAssembler::assemble(
+    const std::vector<Instruction> &program,
+    int32_t main_line,
+    const SymbolTable &labels,
+    int32_t &error_line
+)
+{
+    const int32_t line_count{ static_cast<int32_t>(program.size()) };
+
+    m_text.clear();
+    m_data.clear();
+    m_data_address = 0;
+    m_symbols.clear();
+    m_names.assign(1, '\0');
+
+    // Addresses first, since branches and jumps may go forward
+    m_line_addresses.resize(program.size() + 1);
+    uint32_t address{ TEXT_ADDRESS };
+    for (int32_t line{}; line < line_count; line++)
+    {
+        m_line_addresses[line] = address;
+        address += 4 * static_cast<uint32_t>(encoded_size(program[line]));
+    }
+    m_line_addresses[line_count] = address;
+
+    m_text.reserve((address - TEXT_ADDRESS) / 4);
+    for (int32_t line{}; line < line_count; line++)
+    {
+        const char *error{ encode(line, program[line]) };
+        if (error != nullptr)
+        {
+            error_line = line;
+            return error;
+        }
+    }
+
+    m_entry_address = m_line_addresses[main_line];
+    add_symbol("main", m_entry_address, SYMBOL_FUNCTION, SECTION_TEXT);
+
+    labels.for_each(
+        [this](std::string_view name, int32_t line)
+        {
+            add_symbol(name, m_line_addresses[line], SYMBOL_FUNCTION, SECTION_TEXT);
+        }
+    );
+
+    return nullptr;
+}
+
+
+void ProgramAssembler::set_data(
+    int32_t address,
+    const std::vector<int32_t> &data,
+    const SymbolTable &data_labels,
+    int32_t global_pointer
+)
+{
+    m_data_address = static_cast<uint32_t>(address);
+    m_data = data;
+
+    data_labels.for_each(
+        [this](std::string_view name, int32_t label_address)
+        {
+            add_symbol(name, static_cast<uint32_t>(label_address), SYMBOL_OBJECT, SECTION_DATA);
+        }
+    );
+    add_symbol("_gp", static_cast<uint32_t>(global_pointer), SYMBOL_NO_TYPE, SECTION_ABSOLUTE);
+}
+
+
+const std::vector<uint32_t> &ProgramAssembler::text() const
+{
+    return m_text;
+}
+
+
+bool ProgramAssembler::write(const std::string &path) const
+{
+    // Headers, code, data, symbols and names, then the section headers
+    const size_t segment_count{ m_data.empty() ? 1u : 2u };
+    const size_t text_offset{ ELF_HEADER_SIZE + segment_count * PROGRAM_HEADER_SIZE };
+    const size_t text_size{ 4 * m_text.size() };
+    const size_t data_offset{ text_offset + text_size };
+    const size_t data_size{ 4 * m_data.size() };
+    const size_t symbols_offset{ data_offset + data_size };
+    const size_t symbols_size{ SYMBOL_SIZE * (m_symbols.size() + 1) };
+    const size_t names_offset{ symbols_offset + symbols_size };
+    const size_t section_names_offset{ names_offset + m_names.size() };
+    const size_t sections_offset{ align(section_names_offset + sizeof(SECTION_NAMES_TEXT)) };
+
+    std::string image(sections_offset + SECTION_HEADER_SIZE * SECTION_COUNT, '\0');
+
+    image.replace(0, sizeof(ELF_MAGIC), ELF_MAGIC, sizeof(ELF_MAGIC));
+    image[4] = static_cast<char>(ELF_CLASS_32);
+    image[5] = static_cast<char>(ELF_DATA_BIG_ENDIAN);
+    image[6] = static_cast<char>(ELF_CURRENT_VERSION);
+    put_halfword(image, 16, ELF_TYPE_EXECUTABLE);
+    put_halfword(image, 18, ELF_MACHINE_MIPS);
+    put_word(image, 20, ELF_CURRENT_VERSION);
+    put_word(image, 24, m_entry_address);
+    put_word(image, 28, ELF_HEADER_SIZE);
+    put_word(image, 32, static_cast<uint32_t>(sections_offset));
+    put_word(image, 36, ELF_FLAGS_MIPS32);
+    put_halfword(image, 40, ELF_HEADER_SIZE);
+    put_halfword(image, 42, PROGRAM_HEADER_SIZE);
+    put_halfword(image, 44, static_cast<uint32_t>(segment_count));
+    put_halfword(image, 46, SECTION_HEADER_SIZE);
+    put_halfword(image, 48, SECTION_COUNT);
+    put_halfword(image, 50, SECTION_SECTION_NAMES);
+
+    // One segment for the code and one for the data section, if any
+    for (size_t segment{}; segment < segment_count; segment++)
+    {
+        const size_t header{ ELF_HEADER_SIZE + segment * PROGRAM_HEADER_SIZE };
+        const bool text{ segment == 0 };
+
+        put_word(image, header, SEGMENT_LOAD);
+        put_word(image, header + 4, static_cast<uint32_t>(text ? text_offset : data_offset));
+        put_word(image, header + 8, text ? TEXT_ADDRESS : m_data_address);
+        put_word(image, header + 12, text ? TEXT_ADDRESS : m_data_address);
+        put_word(image, header + 16, static_cast<uint32_t>(text ? text_size : data_size));
+        put_word(image, header + 20, static_cast<uint32_t>(text ? text_size : data_size));
+        put_word(image, header + 24, SEGMENT_READABLE | (text ? SEGMENT_EXECUTABLE : SEGMENT_WRITABLE));
+        put_word(image, header + 28, 4);
+    }
+
+    for (size_t i{}; i < m_text.size(); i++)
+        put_word(image, text_offset + 4 * i, m_text[i]);
+    for (size_t i{}; i < m_data.size(); i++)
+        put_word(image, data_offset + 4 * i, static_cast<uint32_t>(m_data[i]));
+
+    // The first symbol is the null symbol
+    for (size_t i{}; i < m_symbols.size(); i++)
+    {
+        const size_t symbol{ symbols_offset + SYMBOL_SIZE * (i + 1) };
+        put_word(image, symbol, m_symbols[i].name);
+        put_word(image, symbol + 4, m_symbols[i].address);
+        image[symbol + 12] = static_cast<char>(SYMBOL_GLOBAL << 4 | m_symbols[i].type);
+        put_halfword(image, symbol + 14, m_symbols[i].section);
+    }
+
+    image.replace(names_offset, m_names.size(), m_names);
+    image.replace(section_names_offset, sizeof(SECTION_NAMES_TEXT), SECTION_NAMES_TEXT, sizeof(SECTION_NAMES_TEXT));
+
+    // The first section header is the null section
+    put_section(image, sections_offset + SECTION_HEADER_SIZE * SECTION_TEXT, SECTION_TEXT,
+        SECTION_PROGRAM_BITS, SECTION_ALLOCATE | SECTION_EXECUTE, TEXT_ADDRESS, text_offset, text_size);
+    put_section(image, sections_offset + SECTION_HEADER_SIZE * SECTION_DATA, SECTION_DATA,
+        SECTION_PROGRAM_BITS, SECTION_ALLOCATE | SECTION_WRITE, m_data_address, data_offset, data_size);
+    put_section(image, sections_offset + SECTION_HEADER_SIZE * SECTION_SYMBOLS, SECTION_SYMBOLS,
+        SECTION_SYMBOL_TABLE, 0, 0, symbols_offset, symbols_size, SECTION_NAMES, SYMBOL_SIZE);
+    put_section(image, sections_offset + SECTION_HEADER_SIZE * SECTION_NAMES, SECTION_NAMES,
+        SECTION_STRING_TABLE, 0, 0, names_offset, m_names.size());
+    put_section(image, sections_offset + SECTION_HEADER_SIZE * SECTION_SECTION_NAMES, SECTION_SECTION_NAMES,
+        SECTION_STRING_TABLE, 0, 0, section_names_offset, sizeof(SECTION_NAMES_TEXT));
+
+    std::ofstream output_file{
+        path,
+        std::ios::out | std::ios::binary | std::ios::trunc
+    };
+
+    output_file.write(image.data(), static_cast<std::streamsize>(image.size()));
+    output_file.close();
+
+    return !output_file.fail();
+}
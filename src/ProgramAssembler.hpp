@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <Instruction.hpp>
+#include <SymbolTable.hpp>
+
+/**
+ * @brief Assembler back end: encodes decoded programs as MIPS32 machine code
+ *        and writes them as statically linked big-endian ELF executables,
+ *        which BinaryProgram loads back.
+ *
+ * Every instruction becomes its standard R, I or J-format word, with no
+ * delay slots, as BinaryProgram runs branches without them. Labels and
+ * blank lines take no space, so a label has the address of the next
+ * instruction. Immediates and offsets that do not fit in 16 bits are built
+ * in $at, which programs may not use otherwise, and BinaryProgram runs each
+ * such sequence as the single instruction it stands for.
+ */
+class ProgramAssembler
+{
+    // A symbol to write, named by its offset in m_names
+    struct Symbol
+    {
+        uint32_t name;
+        uint32_t address;
+        uint8_t type;
+        uint16_t section;
+    };
+
+    // Encoded instructions, in host byte order
+    std::vector<uint32_t> m_text;
+    // Address of the first word of every line, then of the end of the code
+    std::vector<uint32_t> m_line_addresses;
+    uint32_t m_entry_address;
+    // Address of the data section and its words, in host byte order
+    uint32_t m_data_address;
+    std::vector<int32_t> m_data;
+    // Symbol table and the names it points into, starting with an empty name
+    std::vector<Symbol> m_symbols;
+    std::string m_names;
+
+    /**
+     * @brief Returns the number of words an instruction is encoded in.
+     * @param instruction
+    */
+    static int32_t encoded_size(const Instruction &instruction);
+
+    /**
+     * @brief Append the words of the instruction at a line to the code.
+     *
+     * @param line
+     * @param instruction
+     * @return nullptr, or why the instruction cannot be encoded.
+    */
+    const char *encode(int32_t line, const Instruction &instruction);
+
+    /**
+     * @brief Add a global symbol.
+     * @param name
+     * @param address
+     * @param type One of SYMBOL_*.
+     * @param section Index of its section header, or SECTION_ABSOLUTE.
+    */
+    void add_symbol(std::string_view name, uint32_t address, uint8_t type, uint16_t section);
+
+public:
+    // Address the code is linked at, the usual start of MIPS executables
+    static constexpr uint32_t TEXT_ADDRESS{ 0x0040'0000 };
+
+    ProgramAssembler();
+
+    /**
+     * @brief Encode a program, replacing the previous one.
+     *
+     * @param program Record of every line, none of them undecoded or
+     *                superinstructions.
+     * @param main_line Line execution starts at.
+     * @param labels Line of every code label but main.
+     * @param error_line Set to the line that cannot be encoded, if any.
+     * @return nullptr, or why the program cannot be encoded.
+    */
+    const char *assemble(
+        const std::vector<Instruction> &program,
+        int32_t main_line,
+        const SymbolTable &labels,
+        int32_t &error_line
+    );
+
+    /**
+     * @brief Set the data section of the program encoded by assemble(), and
+     *        add its labels to the symbols.
+     *
+     * @param address
+     * @param data Words of the data section.
+     * @param data_labels Address of every data label.
+     * @param global_pointer Value $gp starts with, written as _gp.
+    */
+    void set_data(
+        int32_t address,
+        const std::vector<int32_t> &data,
+        const SymbolTable &data_labels,
+        int32_t global_pointer
+    );
+
+    /**
+     * @brief Returns the encoded instruction words.
+    */
+    const std::vector<uint32_t> &text() const;
+
+    /**
+     * @brief Write the program as an ELF executable, with a symbol table.
+     *
+     * @param path
+     * @return False if the file cannot be written.
+    */
+    bool write(const std::string &path) const;
+};
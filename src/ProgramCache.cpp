@@ -0,0 +1,357 @@
+#include <ProgramCache.hpp>
+#include <MappedFile.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+
+namespace
+{
+
+constexpr char PROGRAM_IMAGE_MAGIC[8]{ 'M', 'I', 'P', 'S', 'I', 'M', 'G', '\0' };
+// Written in native byte order, so images from other hosts are rejected
+constexpr uint32_t BYTE_ORDER_MARK{ 0x0102'0304 };
+
+/**
+ * @brief Fixed part at the start of every image.
+ */
+struct ImageHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t record_size;
+    // Address of the data section the records refer to
+    int32_t  data_address;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint64_t payload_hash;
+    uint64_t payload_size;
+};
+
+
+/**
+ * @brief Appends values to an image in native byte order.
+ */
+class ImageWriter
+{
+    std::string &m_buffer;
+
+public:
+    explicit ImageWriter(std::string &buffer)
+        : m_buffer{ buffer }
+    {
+    }
+
+    template <typename T>
+    void write(const T &value)
+    {
+        m_buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void write_string(std::string_view value)
+    {
+        write(static_cast<uint32_t>(value.size()));
+        m_buffer.append(value);
+    }
+};
+
+
+/**
+ * @brief Reads values from an image, failing instead of reading past its end.
+ */
+class ImageReader
+{
+    std::string_view m_data;
+    bool m_failed;
+
+public:
+    explicit ImageReader(std::string_view data)
+        : m_data{ data }
+        , m_failed{}
+    {
+    }
+
+    bool failed() const
+    {
+        return m_failed;
+    }
+
+    template <typename T>
+    T read()
+    {
+        T value{};
+
+        if (m_data.size() < sizeof(T))
+            m_failed = true;
+        else
+        {
+            std::memcpy(&value, m_data.data(), sizeof(T));
+            m_data.remove_prefix(sizeof(T));
+        }
+
+        return value;
+    }
+
+    std::string_view read_string()
+    {
+        const uint32_t size{ read<uint32_t>() };
+
+        if (m_failed || m_data.size() < size)
+        {
+            m_failed = true;
+            return {};
+        }
+
+        const std::string_view value{ m_data.substr(0, size) };
+        m_data.remove_prefix(size);
+        return value;
+    }
+
+    std::string_view read_bytes(size_t size)
+    {
+        if (m_data.size() < size)
+        {
+            m_failed = true;
+            return {};
+        }
+
+        const std::string_view value{ m_data.substr(0, size) };
+        m_data.remove_prefix(size);
+        return value;
+    }
+};
+
+}
+
+
+ProgramCache::ProgramCache(const std::string &directory)
+    : m_directory{ directory }
+{
+}
+
+
+uint64_t ProgramCache::hash(std::string_view source)
+{
+    uint64_t hash{ 0xCBF2'9CE4'8422'2325u };
+
+    for (const char character : source)
+        hash = (hash ^ static_cast<uint8_t>(character)) * 0x0000'0100'0000'01B3u;
+
+    return hash;
+}
+
+
+std::string ProgramCache::image_path(uint64_t source_hash) const
+{
+    static const char *const digits{ "0123456789abcdef" };
+
+    std::string name(16, '0');
+    uint64_t value{ source_hash };
+    for (int32_t i{ 15 }; i >= 0; i--, value >>= 4)
+        name[i] = digits[value & 0xF];
+
+    return (std::filesystem::path{ m_directory } / (name + ".img")).string();
+}
+
+
+bool ProgramCache::load(
+    std::string_view source,
+    int32_t data_address,
+    int32_t &main_line,
+    std::vector<Instruction> &program,
+    SymbolTable &labels,
+    SymbolTable &data_labels,
+    std::vector<int32_t> &data
+) const
+{
+    const uint64_t source_hash{ hash(source) };
+    MappedFile file;
+
+    if (!file.open(image_path(source_hash)))
+        return false;
+
+    ImageReader reader{ file.contents() };
+    const ImageHeader header{ reader.read<ImageHeader>() };
+
+    if (
+        reader.failed()
+        ||
+        std::memcmp(header.magic, PROGRAM_IMAGE_MAGIC, sizeof(header.magic)) != 0
+        ||
+        header.version != PROGRAM_IMAGE_VERSION
+        ||
+        header.byte_order != BYTE_ORDER_MARK
+        ||
+        header.record_size != sizeof(Instruction)
+        ||
+        header.data_address != data_address
+        ||
+        header.source_size != source.size()
+        ||
+        header.source_hash != source_hash
+    )
+        return false;
+
+    // Reject truncated or damaged images before trusting any record
+    const std::string_view payload{ reader.read_bytes(header.payload_size) };
+    if (reader.failed() || hash(payload) != header.payload_hash)
+        return false;
+
+    reader = ImageReader{ payload };
+    main_line = reader.read<int32_t>();
+    const int32_t line_count{ reader.read<int32_t>() };
+    const int32_t label_count{ reader.read<int32_t>() };
+    const int32_t data_label_count{ reader.read<int32_t>() };
+    const int32_t data_count{ reader.read<int32_t>() };
+
+    if (
+        reader.failed()
+        ||
+        line_count < 0
+        ||
+        label_count < 0
+        ||
+        data_label_count < 0
+        ||
+        data_count < 0
+    )
+        return false;
+
+    const std::string_view records{
+        reader.read_bytes(static_cast<size_t>(line_count) * sizeof(Instruction))
+    };
+    if (reader.failed())
+        return false;
+
+    program.resize(line_count);
+    std::memcpy(program.data(), records.data(), records.size());
+
+    labels.clear();
+    for (int32_t i{}; i < label_count; i++)
+    {
+        const int32_t line{ reader.read<int32_t>() };
+        const std::string_view name{ reader.read_string() };
+
+        if (reader.failed() || !labels.insert(name, line))
+            return false;
+    }
+
+    data_labels.clear();
+    for (int32_t i{}; i < data_label_count; i++)
+    {
+        const int32_t address{ reader.read<int32_t>() };
+        const std::string_view name{ reader.read_string() };
+
+        if (reader.failed() || !data_labels.insert(name, address))
+            return false;
+    }
+
+    const std::string_view words{
+        reader.read_bytes(static_cast<size_t>(data_count) * sizeof(int32_t))
+    };
+    if (reader.failed())
+        return false;
+
+    data.resize(data_count);
+    std::memcpy(data.data(), words.data(), words.size());
+    return true;
+}
+
+
+bool ProgramCache::save(
+    std::string_view source,
+    int32_t data_address,
+    int32_t main_line,
+    const std::vector<Instruction> &program,
+    const SymbolTable &labels,
+    const SymbolTable &data_labels,
+    const std::vector<int32_t> &data
+) const
+{
+    std::string payload;
+    ImageWriter payload_writer{ payload };
+
+    payload_writer.write(main_line);
+    payload_writer.write(static_cast<int32_t>(program.size()));
+    payload_writer.write(static_cast<int32_t>(labels.size()));
+    payload_writer.write(static_cast<int32_t>(data_labels.size()));
+    payload_writer.write(static_cast<int32_t>(data.size()));
+
+    for (const Instruction &instruction : program)
+        payload_writer.write(instruction);
+
+    labels.for_each(
+        [&payload_writer](std::string_view name, int32_t line)
+        {
+            payload_writer.write(line);
+            payload_writer.write_string(name);
+        }
+    );
+
+    data_labels.for_each(
+        [&payload_writer](std::string_view name, int32_t address)
+        {
+            payload_writer.write(address);
+            payload_writer.write_string(name);
+        }
+    );
+
+    for (const int32_t value : data)
+        payload_writer.write(value);
+
+    const uint64_t source_hash{ hash(source) };
+    ImageHeader header{};
+    std::memcpy(header.magic, PROGRAM_IMAGE_MAGIC, sizeof(header.magic));
+    header.version      = PROGRAM_IMAGE_VERSION;
+    header.byte_order   = BYTE_ORDER_MARK;
+    header.record_size  = sizeof(Instruction);
+    header.data_address = data_address;
+    header.source_hash  = source_hash;
+    header.source_size  = source.size();
+    header.payload_hash = hash(payload);
+    header.payload_size = payload.size();
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error)
+        return false;
+
+    // Write next to the image and rename, so that readers never see a
+    // partial file
+    const std::string path{ image_path(source_hash) };
+    const std::string temporary_path{
+        path + '.' + std::to_string(
+            std::chrono::steady_clock::now().time_since_epoch().count()
+        )
+    };
+
+    {
+        std::ofstream output_file{
+            temporary_path,
+            std::ios::out | std::ios::binary | std::ios::trunc
+        };
+
+        output_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        output_file.write(payload.data(), payload.size());
+
+        if (!output_file)
+        {
+            output_file.close();
+            std::filesystem::remove(temporary_path, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include <Instruction.hpp>
+#include <SymbolTable.hpp>
+
+// Version of the program image format, changed whenever the layout or the
+// meaning of decoded records changes
+constexpr uint32_t PROGRAM_IMAGE_VERSION{ 2 };
+
+/**
+ * @brief Directory of program images, named after a hash of their source.
+ *
+ * Images are binary files with a versioned header that repeats the hash and
+ * size of the source, so a stale or foreign file is never used. They are
+ * memory mapped when loaded and written to a temporary file which is then
+ * renamed, so concurrent runs never see a partial image.
+ */
+class ProgramCache
+{
+    // Directory holding the images
+    std::string m_directory;
+
+    /**
+     * @brief Returns the path of the image for a source.
+     * @param source_hash The hash of the source.
+    */
+    std::string image_path(uint64_t source_hash) const;
+
+public:
+    /**
+     * @brief Create a cache in a directory, which is created when the first
+     *        image is saved.
+     * @param directory
+    */
+    explicit ProgramCache(const std::string &directory);
+
+    /**
+     * @brief Load the image of a source file.
+     *
+     * Decoded records hold the addresses of data labels, so an image is only
+     * used with the data section at the address it was saved with.
+     *
+     * @param source The contents of the source file.
+     * @param data_address Address of the data section.
+     * @param main_line Line execution starts at.
+     * @param program One record per source line.
+     * @param labels Line of every label in the text section, except main.
+     * @param data_labels Address of every label in the data section.
+     * @param data Words of the data section.
+     * @return False if there is no valid image for this source, in which
+     *         case the outputs may have been partly filled in.
+    */
+    bool load(
+        std::string_view source,
+        int32_t data_address,
+        int32_t &main_line,
+        std::vector<Instruction> &program,
+        SymbolTable &labels,
+        SymbolTable &data_labels,
+        std::vector<int32_t> &data
+    ) const;
+
+    /**
+     * @brief Save the image of a source file, replacing any previous one.
+     *
+     * Records may be OPERATION_UNDECODED, but must not be superinstructions.
+     *
+     * @param source The contents of the source file.
+     * @param data_address
+     * @param main_line
+     * @param program
+     * @param labels
+     * @param data_labels
+     * @param data
+     * @return False if the image could not be written.
+    */
+    bool save(
+        std::string_view source,
+        int32_t data_address,
+        int32_t main_line,
+        const std::vector<Instruction> &program,
+        const SymbolTable &labels,
+        const SymbolTable &data_labels,
+        const std::vector<int32_t> &data
+    ) const;
+
+    /**
+     * @brief Returns the 64-bit FNV-1a hash of a source file.
+     * @param source
+    */
+    static uint64_t hash(std::string_view source);
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Columns of the profile, pipeline, cache and predictor reports. Numbers
+// and percentages are right-aligned, and percentages and ratios have two
+// decimals in every report.
+
+
+/**
+ * @brief Print text right-aligned in a column of width characters.
+ * @param output
+ * @param text
+ * @param width
+*/
+inline void print_column(std::ostream &output, std::string_view text, int32_t width)
+{
+    const int32_t padding{ width - static_cast<int32_t>(text.size()) };
+    output << std::string(std::max(padding, 0), ' ') << text;
+}
+
+
+/**
+ * @brief Print a number right-aligned in a column of width characters.
+ * @param output
+ * @param value
+ * @param width
+*/
+inline void print_column(std::ostream &output, int64_t value, int32_t width)
+{
+    print_column(output, std::to_string(value), width);
+}
+
+
+/**
+ * @brief Format a ratio with two decimals, or 0.00 if the denominator is 0.
+ * @param numerator
+ * @param denominator
+*/
+inline std::string ratio(int64_t numerator, int64_t denominator)
+{
+    char text[32];
+    std::snprintf(
+        text,
+        sizeof(text),
+        "%.2f",
+        denominator > 0 ? static_cast<double>(numerator) / denominator : 0.0
+    );
+    return text;
+}
+
+
+/**
+ * @brief Format part of total as a percentage with two decimals, or 0.00%
+ *        if total is 0.
+ * @param part
+ * @param total
+*/
+inline std::string percentage(int64_t part, int64_t total)
+{
+    char text[32];
+    std::snprintf(
+        text,
+        sizeof(text),
+        "%.2f%%",
+        total > 0 ? 100.0 * static_cast<double>(part) / total : 0.0
+    );
+    return text;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief Error in the simulated program, thrown once the error has been
+ *        reported on the output of the simulator.
+ */
+class SimulationError : public std::runtime_error
+{
+    // Line the error was found at, -1 for errors not tied to a line
+    int32_t m_line;
+
+public:
+    SimulationError(const std::string &message, int32_t line)
+        : std::runtime_error{ message }
+        , m_line{ line }
+    {
+    }
+
+    /**
+     * @brief Returns the line the error was found at, or -1.
+    */
+    int32_t line() const
+    {
+        return m_line;
+    }
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// States of a loaded program
+// The program can be stepped or run further
+constexpr int32_t STATUS_RUNNING{ 0 };
+// The program executed halt
+constexpr int32_t STATUS_HALTED{ 1 };
+// The program could not be loaded or stopped at an error
+constexpr int32_t STATUS_ERROR{ 2 };
+
+/**
+ * @brief Outcome of loading, stepping or running a program.
+ */
+class SimulationResult
+{
+public:
+    // One of STATUS_*
+    int32_t status;
+    // Error message, empty unless status is STATUS_ERROR
+    std::string error;
+    // Line of the error, -1 if it is not tied to a line
+    int32_t error_line;
+};
@@ -0,0 +1,110 @@
+#include <Snapshot.hpp>
+#include <ProgramCache.hpp>
+
+#include <cstring>
+#include <fstream>
+
+
+namespace
+{
+
+constexpr char SNAPSHOT_MAGIC[8]{ 'M', 'I', 'P', 'S', 'S', 'N', 'P', '\0' };
+// Written in native byte order, so snapshots from other hosts are rejected
+constexpr uint32_t BYTE_ORDER_MARK{ 0x0102'0304 };
+
+/**
+ * @brief Returns the size of the payload described by a header.
+ * @param header
+*/
+size_t payload_size(const SnapshotHeader &header)
+{
+    return sizeof(int32_t) * REGISTER_COUNT + static_cast<size_t>(header.memory_size);
+}
+
+}
+
+
+Snapshot::Snapshot()
+    : m_header{}
+    , m_payload{}
+{
+}
+
+
+bool Snapshot::save(
+    const std::string &path,
+    SnapshotHeader header,
+    const int32_t *registers,
+    const int32_t *memory
+)
+{
+    std::string payload;
+    payload.reserve(payload_size(header));
+    payload.append(reinterpret_cast<const char *>(registers), sizeof(int32_t) * REGISTER_COUNT);
+    payload.append(reinterpret_cast<const char *>(memory), header.memory_size);
+
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version      = SNAPSHOT_VERSION;
+    header.byte_order   = BYTE_ORDER_MARK;
+    header.payload_hash = ProgramCache::hash(payload);
+
+    std::ofstream output_file{
+        path,
+        std::ios::out | std::ios::binary | std::ios::trunc
+    };
+
+    output_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output_file.write(payload.data(), payload.size());
+    output_file.close();
+
+    return !output_file.fail();
+}
+
+
+bool Snapshot::open(const std::string &path)
+{
+    if (!m_file.open(path))
+        return false;
+
+    const std::string_view contents{ m_file.contents() };
+    if (contents.size() < sizeof(SnapshotHeader))
+        return false;
+
+    std::memcpy(&m_header, contents.data(), sizeof(m_header));
+
+    if (
+        std::memcmp(m_header.magic, SNAPSHOT_MAGIC, sizeof(m_header.magic)) != 0
+        ||
+        m_header.version != SNAPSHOT_VERSION
+        ||
+        m_header.byte_order != BYTE_ORDER_MARK
+        ||
+        contents.size() - sizeof(SnapshotHeader) != payload_size(m_header)
+    )
+        return false;
+
+    const std::string_view payload{ contents.substr(sizeof(SnapshotHeader)) };
+    if (ProgramCache::hash(payload) != m_header.payload_hash)
+        return false;
+
+    m_payload = payload.data();
+    return true;
+}
+
+
+const SnapshotHeader &Snapshot::header() const
+{
+    return m_header;
+}
+
+
+void Snapshot::copy_registers(int32_t *registers) const
+{
+    std::memcpy(registers, m_payload, sizeof(int32_t) * REGISTER_COUNT);
+}
+
+
+void Snapshot::copy_memory(int32_t *memory) const
+{
+    std::memcpy(memory, m_payload + sizeof(int32_t) * REGISTER_COUNT, m_header.memory_size);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <MappedFile.hpp>
+#include <Instruction.hpp>
+
+// Version of the snapshot format, changed whenever the layout changes
+constexpr uint32_t SNAPSHOT_VERSION{ 4 };
+
+/**
+ * @brief Fixed part at the start of every snapshot. The payload after it
+ *        holds the REGISTER_COUNT registers, HI and LO included, and every
+ *        word of guest memory, as int32_t in native byte order.
+ */
+struct SnapshotHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    // Identity of the program the state belongs to
+    uint64_t source_hash;
+    uint64_t source_size;
+    int64_t  instruction_count;
+    int32_t  program_counter;
+    int32_t  halt_value;
+    // Layout of guest memory, sizes in bytes
+    uint32_t stack_size;
+    uint32_t memory_size;
+    int32_t  program_break;
+    int32_t  exit_code;
+    uint64_t payload_hash;
+};
+
+/**
+ * @brief Complete machine state of a program, saved to a binary file so that
+ *        execution can resume from it later.
+ *
+ * The payload is laid out like the simulator's own arrays, so restoring a
+ * snapshot maps the file and copies the arrays back.
+ */
+class Snapshot
+{
+    MappedFile m_file;
+    SnapshotHeader m_header;
+    // Start of the payload in the mapped file
+    const char *m_payload;
+
+public:
+    Snapshot();
+
+    /**
+     * @brief Write a snapshot, replacing the file.
+     *
+     * @param path
+     * @param header Every field but magic, version, byte order and payload
+     *               hash, which are filled in here.
+     * @param registers The REGISTER_COUNT registers.
+     * @param memory header.memory_size bytes of guest memory.
+     * @return False if the file could not be written.
+    */
+    static bool save(
+        const std::string &path,
+        SnapshotHeader header,
+        const int32_t *registers,
+        const int32_t *memory
+    );
+
+    /**
+     * @brief Open a snapshot and check it.
+     *
+     * @param path
+     * @return False if the file cannot be read, was written by another
+     *         version or kind of host, or is damaged.
+    */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Returns the header of the open snapshot.
+    */
+    const SnapshotHeader &header() const;
+
+    /**
+     * @brief Copy the REGISTER_COUNT registers.
+     * @param registers
+    */
+    void copy_registers(int32_t *registers) const;
+
+    /**
+     * @brief Copy guest memory.
+     * @param memory Room for header().memory_size bytes.
+    */
+    void copy_memory(int32_t *memory) const;
+};
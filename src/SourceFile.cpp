@@ -0,0 +1,82 @@
+#include <SourceFile.hpp>
+
+#include <cstring>
+#include <utility>
+
+
+bool SourceFile::open(const std::string &path)
+{
+    m_text.clear();
+
+    if (!m_file.open(path))
+        return false;
+
+    index_lines();
+    return true;
+}
+
+
+void SourceFile::assign(std::string text)
+{
+    m_file.close();
+    m_text = std::move(text);
+    index_lines();
+}
+
+
+void SourceFile::index_lines()
+{
+    const std::string_view data{ contents() };
+
+    m_line_starts.clear();
+
+    size_t start{};
+    while (start < data.size())
+    {
+        m_line_starts.push_back(start);
+
+        const void *end{
+            std::memchr(data.data() + start, '\n', data.size() - start)
+        };
+        if (end == nullptr)
+        {
+            start = data.size();
+            break;
+        }
+
+        start = static_cast<const char *>(end) - data.data() + 1;
+    }
+
+    m_line_starts.push_back(start);
+}
+
+
+int32_t SourceFile::size() const
+{
+    return static_cast<int32_t>(m_line_starts.size()) - 1;
+}
+
+
+std::string_view SourceFile::operator[](int32_t line) const
+{
+    const char *data{ contents().data() };
+    const size_t start{ m_line_starts[line] };
+    size_t end{ m_line_starts[line + 1] };
+
+    // Drop the line break, with the carriage return of CRLF files
+    if (end > start && data[end - 1] == '\n')
+        end--;
+    if (end > start && data[end - 1] == '\r')
+        end--;
+
+    return { data + start, end - start };
+}
+
+
+std::string_view SourceFile::contents() const
+{
+    if (!m_text.empty())
+        return m_text;
+
+    return m_file.contents();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <MappedFile.hpp>
+
+/**
+ * @brief Read-only view of a source file, split into lines.
+ *
+ * Lines are views into the mapped file, found through an index of line
+ * start offsets, so loading does not allocate per line. Text generated in
+ * memory, such as a disassembly, can be split into lines the same way.
+ */
+class SourceFile
+{
+    // Contents of the file
+    MappedFile m_file;
+    // Contents given to assign(), used instead of the file
+    std::string m_text;
+    // Offset of the start of every line, plus one past the end of the file
+    std::vector<size_t> m_line_starts;
+
+    /**
+     * @brief Build m_line_starts from the contents of the file.
+    */
+    void index_lines();
+
+public:
+    SourceFile() = default;
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    /**
+     * @brief Load a file, replacing the current contents.
+     *
+     * @param path
+     * @return False if the file does not exist or could not be read.
+    */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Use text held in memory, replacing the current contents.
+     * @param text
+    */
+    void assign(std::string text);
+
+    /**
+     * @brief Returns the number of lines.
+    */
+    int32_t size() const;
+
+    /**
+     * @brief Returns a line, without its line break.
+     * @param line
+    */
+    std::string_view operator[](int32_t line) const;
+
+    /**
+     * @brief Returns the whole file.
+    */
+    std::string_view contents() const;
+};
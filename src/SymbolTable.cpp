@@ -0,0 +1,36 @@
+#include <SymbolTable.hpp>
+
+
+bool SymbolTable::insert(std::string_view name, int32_t value)
+{
+    if (m_index.find(name) != m_index.end())
+        return false;
+
+    const std::string &interned{ m_names.emplace_back(name) };
+    m_index.emplace(interned, value);
+    return true;
+}
+
+
+int32_t SymbolTable::find(std::string_view name) const
+{
+    const auto symbol{ m_index.find(name) };
+
+    if (symbol == m_index.end())
+        return -1;
+
+    return symbol->second;
+}
+
+
+void SymbolTable::clear()
+{
+    m_index.clear();
+    m_names.clear();
+}
+
+
+size_t SymbolTable::size() const
+{
+    return m_index.size();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * @brief Hash table from symbol names to values, such as the line of a code
+ *        label or the slot of a data label.
+ *
+ * Every name is stored once and looked up through string views, so lookups
+ * do not copy the name.
+ */
+class SymbolTable
+{
+    // Interned names, which the keys of m_index point into
+    std::deque<std::string> m_names;
+    // Value of every name
+    std::unordered_map<std::string_view, int32_t> m_index;
+
+public:
+    /**
+     * @brief Add a symbol.
+     *
+     * @param name
+     * @param value
+     * @return False if the name is already in the table.
+    */
+    bool insert(std::string_view name, int32_t value);
+
+    /**
+     * @brief Find the value of a symbol.
+     *
+     * @param name
+     * @return The value, or -1 if the name is not in the table.
+    */
+    int32_t find(std::string_view name) const;
+
+    /**
+     * @brief Remove all symbols.
+    */
+    void clear();
+
+    /**
+     * @brief Returns the number of symbols.
+    */
+    size_t size() const;
+
+    /**
+     * @brief Call function with the name and value of every symbol, in the
+     *        order they were added.
+     * @param function
+    */
+    template <typename Function>
+    void for_each(Function function) const
+    {
+        for (const std::string &name : m_names)
+            function(std::string_view{ name }, m_index.find(name)->second);
+    }
+};
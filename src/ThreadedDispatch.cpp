@@ -0,0 +1,505 @@
+#include <MIPSSimulator.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+namespace
+{
+
+/**
+ * @brief Handlers of the threaded engine. Each decoded record is mapped to
+ *        exactly one of these.
+ */
+enum Handler : uint8_t
+{
+    H_UNDECODED,
+    H_SKIP,
+    H_ADD,
+    H_SUB,
+    H_MUL,
+    H_AND,
+    H_OR,
+    H_NOR,
+    H_SLT,
+    H_ADDI,
+    H_ANDI,
+    H_ORI,
+    H_SLTI,
+    H_LW,
+    H_SW,
+    H_BEQ,
+    H_BNE,
+    H_J,
+    H_HALT,
+    H_XOR,
+    H_SLL,
+    H_SRL,
+    H_SRA,
+    H_LUI,
+    H_JAL,
+    H_JR,
+    H_SLOW,
+    H_END
+};
+
+
+/**
+ * @brief Choose the handler for a decoded record.
+ *
+ * Register checks only depend on the register numbers, so they are done once
+ * here. Anything that would fail them, or that writes $sp and therefore needs
+ * the stack bounds check, goes to H_SLOW.
+ *
+ * @param instruction
+ * @return
+*/
+Handler select_handler(const Instruction &instruction)
+{
+    const int32_t *r{ instruction.r };
+
+    if (!has_valid_registers(instruction))
+        return H_SLOW;
+
+    switch (instruction.operation)
+    {
+    case OPERATION_UNDECODED:
+        return H_UNDECODED;
+    case OPERATION_BLANK:
+    case OPERATION_LABEL:
+        return H_SKIP;
+
+    // R-format
+    case OPERATION_ADD:
+    case OPERATION_SUB:
+    case OPERATION_MUL:
+    case OPERATION_AND:
+    case OPERATION_OR:
+    case OPERATION_NOR:
+    case OPERATION_SLT:
+        if (r[0] == 29)
+            return H_SLOW;
+        return static_cast<Handler>(H_ADD + instruction.operation - OPERATION_ADD);
+
+    // I-format
+    case OPERATION_ADDI:
+    case OPERATION_ANDI:
+    case OPERATION_ORI:
+    case OPERATION_SLTI:
+        if (r[0] == 29)
+            return H_SLOW;
+        return static_cast<Handler>(H_ADDI + instruction.operation - OPERATION_ADDI);
+
+    case OPERATION_LW:
+        if (r[0] == 29)
+            return H_SLOW;
+        return H_LW;
+    case OPERATION_SW:
+        return H_SW;
+
+    case OPERATION_BEQ:
+        return H_BEQ;
+    case OPERATION_BNE:
+        return H_BNE;
+    case OPERATION_J:
+        return H_J;
+    case OPERATION_HALT:
+        return H_HALT;
+
+    // addu, subu and addiu compute the same as add, sub and addi
+    case OPERATION_ADDU:
+    case OPERATION_SUBU:
+        if (r[0] == 29)
+            return H_SLOW;
+        return static_cast<Handler>(H_ADD + instruction.operation - OPERATION_ADDU);
+    case OPERATION_ADDIU:
+        if (r[0] == 29)
+            return H_SLOW;
+        return H_ADDI;
+
+    case OPERATION_XOR:
+        if (r[0] == 29)
+            return H_SLOW;
+        return H_XOR;
+
+    // sll, srl, sra
+    case OPERATION_SLL:
+    case OPERATION_SRL:
+    case OPERATION_SRA:
+        if (r[0] == 29)
+            return H_SLOW;
+        return static_cast<Handler>(H_SLL + instruction.operation - OPERATION_SLL);
+
+    case OPERATION_LUI:
+        if (r[0] == 29)
+            return H_SLOW;
+        return H_LUI;
+
+    case OPERATION_JAL:
+        return H_JAL;
+    case OPERATION_JR:
+        return H_JR;
+    default:
+        return H_SLOW;
+    }
+}
+
+}
+
+
+void MIPSSimulator::run_threaded()
+{
+    //  With GCC and Clang every handler is a label and every record stores
+    //  the address of its handler, so each handler ends in its own indirect
+    //  jump. Other compilers get the same handlers inside a switch.
+#if defined(__GNUC__)
+    static const void *const table[]{
+        &&H_UNDECODED, &&H_SKIP,
+        &&H_ADD, &&H_SUB, &&H_MUL, &&H_AND, &&H_OR, &&H_NOR, &&H_SLT,
+        &&H_ADDI, &&H_ANDI, &&H_ORI, &&H_SLTI,
+        &&H_LW, &&H_SW,
+        &&H_BEQ, &&H_BNE, &&H_J, &&H_HALT,
+        &&H_XOR, &&H_SLL, &&H_SRL, &&H_SRA, &&H_LUI,
+        &&H_JAL, &&H_JR,
+        &&H_SLOW, &&H_END
+    };
+
+#define TARGET(handler) table[handler]
+#define HANDLER(handler) handler:
+#define DISPATCH() goto *targets[pc]
+#define BEGIN_DISPATCH() DISPATCH();
+#define END_DISPATCH()
+
+    std::vector<const void *> targets(m_number_of_instructions + 1);
+#else
+#define TARGET(handler) handler
+#define HANDLER(handler) case handler:
+#define DISPATCH() continue
+#define BEGIN_DISPATCH() for (;;) switch (targets[pc]) {
+#define END_DISPATCH() }
+
+    std::vector<Handler> targets(m_number_of_instructions + 1);
+#endif
+
+    for (int32_t i{}; i < m_number_of_instructions; i++)
+        targets[i] = TARGET(select_handler(m_program[i]));
+    // Running past the last line ends execution
+    targets[m_number_of_instructions] = TARGET(H_END);
+
+    const Instruction *code{ m_program.data() };
+    int32_t *regs{ m_register_values };
+    int32_t *words{ m_memory.words() };
+    const uint32_t word_count{ m_memory.word_count() };
+    const int32_t memory_base{ m_memory.stack_address() };
+    const int32_t text_address{ m_text_address };
+    int32_t pc{ m_program_counter };
+    // Kept in a local, and stored before anything that can throw
+    int64_t executed{ m_instruction_count };
+    // Taken branch counters of the profile, if it is enabled
+    int64_t *taken{ m_profile != nullptr ? m_profile->taken_counts() : nullptr };
+
+    BEGIN_DISPATCH()
+
+    HANDLER(H_UNDECODED)
+    {
+        m_program_counter = pc;
+        m_instruction_count = executed;
+        decode_instruction(pc);
+        targets[pc] = TARGET(select_handler(code[pc]));
+        DISPATCH();
+    }
+
+    HANDLER(H_SKIP)
+    {
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_ADD)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] + regs[r[2]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_SUB)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] - regs[r[2]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_MUL)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] * regs[r[2]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_AND)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] & regs[r[2]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_OR)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] | regs[r[2]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_NOR)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = ~(regs[r[1]] | regs[r[2]]);
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_SLT)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] < regs[r[2]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_ADDI)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] + r[2];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_ANDI)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] & r[2];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_ORI)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] | r[2];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_SLTI)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] < r[2];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_LW)
+    {
+        const int32_t *r{ code[pc].r };
+        const uint32_t index{ GuestMemory::word_index(regs[r[1]] + r[2], memory_base) };
+        if (index >= word_count)
+            goto slow;
+        regs[r[0]] = words[index];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_SW)
+    {
+        const int32_t *r{ code[pc].r };
+        const uint32_t index{ GuestMemory::word_index(regs[r[1]] + r[2], memory_base) };
+        if (index >= word_count)
+            goto slow;
+        words[index] = regs[r[0]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_BEQ)
+    {
+        const int32_t *r{ code[pc].r };
+        executed++;
+        if (regs[r[0]] == regs[r[1]])
+        {
+            if (taken != nullptr)
+                taken[pc]++;
+            pc = r[2];
+        } else
+        {
+            pc++;
+        }
+        DISPATCH();
+    }
+
+    HANDLER(H_BNE)
+    {
+        const int32_t *r{ code[pc].r };
+        executed++;
+        if (regs[r[0]] != regs[r[1]])
+        {
+            if (taken != nullptr)
+                taken[pc]++;
+            pc = r[2];
+        } else
+        {
+            pc++;
+        }
+        DISPATCH();
+    }
+
+    HANDLER(H_J)
+    {
+        executed++;
+        if (taken != nullptr)
+            taken[pc]++;
+        pc = code[pc].r[0];
+        DISPATCH();
+    }
+
+    HANDLER(H_HALT)
+    {
+        m_halt_value = 1;
+        executed++;
+        pc++;
+        goto finished;
+    }
+
+    HANDLER(H_XOR)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] ^ regs[r[2]];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_SLL)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = static_cast<int32_t>(static_cast<uint32_t>(regs[r[1]]) << r[2]);
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_SRL)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = static_cast<int32_t>(static_cast<uint32_t>(regs[r[1]]) >> r[2]);
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_SRA)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = regs[r[1]] >> r[2];
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_LUI)
+    {
+        const int32_t *r{ code[pc].r };
+        regs[r[0]] = static_cast<int32_t>(static_cast<uint32_t>(r[2]) << 16);
+        executed++;
+        pc++;
+        DISPATCH();
+    }
+
+    HANDLER(H_JAL)
+    {
+        executed++;
+        regs[31] = text_address + 4 * (pc + 1);
+        if (taken != nullptr)
+            taken[pc]++;
+        pc = code[pc].r[0];
+        DISPATCH();
+    }
+
+    HANDLER(H_JR)
+    {
+        const uint32_t offset{
+            static_cast<uint32_t>(regs[code[pc].r[0]]) - static_cast<uint32_t>(text_address)
+        };
+
+        // The interpreter reports invalid addresses, and tells the profile
+        // where execution arrives
+        if ((offset & 3) != 0
+            || offset / 4 > static_cast<uint32_t>(m_number_of_instructions)
+            || taken != nullptr)
+            goto slow;
+
+        executed++;
+        pc = static_cast<int32_t>(offset / 4);
+        DISPATCH();
+    }
+
+    HANDLER(H_SLOW)
+    {
+    slow:
+        // Same steps as one iteration of the loop in execute()
+        const Instruction &current{ code[pc] };
+        m_program_counter = pc;
+        r[0] = current.r[0];
+        r[1] = current.r[1];
+        r[2] = current.r[2];
+        m_instruction_count = executed;
+        execute_instruction(current.operation);
+
+        if (current.operation >= 0)
+            executed++;
+
+        if (!is_jump(current.operation))
+            m_program_counter++;
+
+        pc = m_program_counter;
+
+        // The exit system call halts here
+        if (m_halt_value != 0)
+            goto finished;
+        DISPATCH();
+    }
+
+    HANDLER(H_END)
+    {
+        goto finished;
+    }
+
+    END_DISPATCH()
+
+finished:
+    m_program_counter = pc;
+    m_instruction_count = executed;
+
+#undef TARGET
+#undef HANDLER
+#undef DISPATCH
+#undef BEGIN_DISPATCH
+#undef END_DISPATCH
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+//  Execution traces start with a header holding the initial state:
+//
+//      magic, version, byte order mark          char[8], uint32, uint32
+//      register count                           uint32
+//      stack size, data size, memory size       uint32 each, in bytes
+//      memory address, address of line 0        int32 each
+//      initial program counter                  int32
+//      registers                                int32 each
+//      data labels                              uint32 count, then for each
+//                                               int32 address, uint32
+//                                               length, label
+//      memory, as runs of non-zero words        uint32 first word, uint32
+//                                               length, int32 each, ended
+//                                               by a run of length 0
+//
+//  followed by one record per executed instruction. A record is a tag byte,
+//  then the change of the program counter unless TRACE_SEQUENTIAL is set,
+//  then the index of the memory word written, if any, then the change of the
+//  value written, or the changes of HI and LO. Changes and indices are
+//  LEB128 varints, and changes are zigzag encoded so that small negative
+//  ones stay short.
+
+constexpr char TRACE_MAGIC[8]{ 'M', 'I', 'P', 'S', 'T', 'R', 'C', '\0' };
+// Version of the trace format, changed whenever the layout changes
+constexpr uint32_t TRACE_VERSION{ 4 };
+// Written in native byte order, so traces from other hosts are rejected
+constexpr uint32_t TRACE_BYTE_ORDER_MARK{ 0x0102'0304 };
+
+// What a record writes, in the two low bits of the tag
+constexpr uint8_t TRACE_WRITE_NONE{ 0 };
+constexpr uint8_t TRACE_WRITE_REGISTER{ 1 };
+constexpr uint8_t TRACE_WRITE_MEMORY{ 2 };
+constexpr uint8_t TRACE_WRITE_HI_LO{ 3 };
+constexpr uint8_t TRACE_WRITE_MASK{ 3 };
+// Set in the tag when the program counter moved to the next line
+constexpr uint8_t TRACE_SEQUENTIAL{ 4 };
+// The register written is kept in the upper five bits of the tag, so HI and
+// LO, which do not fit, are written with TRACE_WRITE_HI_LO
+constexpr int32_t TRACE_REGISTER_SHIFT{ 3 };
+
+// Largest possible record: the tag and three 5-byte varints
+constexpr size_t TRACE_MAX_RECORD_SIZE{ 16 };
+
+
+/**
+ * @brief Map a signed change to an unsigned one, with small magnitudes
+ *        giving small values.
+ * @param value
+ * @return
+*/
+constexpr uint32_t zigzag_encode(int32_t value)
+{
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+
+/**
+ * @brief Inverse of zigzag_encode().
+ * @param value
+ * @return
+*/
+constexpr int32_t zigzag_decode(uint32_t value)
+{
+    return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+
+/**
+ * @brief Write a LEB128 varint.
+ * @param output Room for at least 5 bytes.
+ * @param value
+ * @return The position after the varint.
+*/
+inline uint8_t *put_varint(uint8_t *output, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *output++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+
+    *output++ = static_cast<uint8_t>(value);
+    return output;
+}
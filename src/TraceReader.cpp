@@ -0,0 +1,406 @@
+#include <TraceReader.hpp>
+#include <TraceFormat.hpp>
+#include <GuestMemory.hpp>
+#include <Lexer.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+
+namespace
+{
+
+/**
+ * @brief Reads the header of a trace, failing instead of reading past its
+ *        end.
+ */
+class HeaderReader
+{
+    std::string_view m_data;
+    size_t m_position;
+    bool m_failed;
+
+public:
+    explicit HeaderReader(std::string_view data)
+        : m_data{ data }
+        , m_position{}
+        , m_failed{}
+    {
+    }
+
+    bool failed() const
+    {
+        return m_failed;
+    }
+
+    size_t position() const
+    {
+        return m_position;
+    }
+
+    template <typename T>
+    T read()
+    {
+        T value{};
+
+        if (m_failed || m_data.size() - m_position < sizeof(T))
+        {
+            m_failed = true;
+            return value;
+        }
+
+        std::memcpy(&value, m_data.data() + m_position, sizeof(T));
+        m_position += sizeof(T);
+        return value;
+    }
+
+    std::string read_string()
+    {
+        const uint32_t length{ read<uint32_t>() };
+
+        if (m_failed || m_data.size() - m_position < length)
+        {
+            m_failed = true;
+            return {};
+        }
+
+        std::string value{ m_data.substr(m_position, length) };
+        m_position += length;
+        return value;
+    }
+};
+
+
+/**
+ * @brief Write formatted text to a stream, like printf().
+ * @param output
+ * @param format
+ * @param args
+*/
+template <typename... Args>
+void print(std::ostream &output, const char *format, Args... args)
+{
+    char line[256];
+    const int32_t length{ std::snprintf(line, sizeof(line), format, args...) };
+
+    if (length > 0)
+        output.write(line, std::min<int32_t>(length, sizeof(line) - 1));
+}
+
+}
+
+
+TraceReader::TraceReader()
+    : m_records{}
+    , m_position{}
+    , m_corrupt{}
+    , m_initial_program_counter{}
+    , m_initial_registers{}
+    , m_stack_size{}
+    , m_data_size{}
+    , m_memory_address{}
+    , m_text_address{}
+    , m_step{}
+    , m_program_counter{}
+    , m_registers{}
+{
+}
+
+
+bool TraceReader::open(const std::string &path)
+{
+    if (!m_file.open(path))
+        return false;
+
+    m_data = m_file.contents();
+    HeaderReader header{ m_data };
+
+    char magic[sizeof(TRACE_MAGIC)];
+    for (char &character : magic)
+        character = header.read<char>();
+
+    if (header.failed()
+        || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0
+        || header.read<uint32_t>() != TRACE_VERSION
+        || header.read<uint32_t>() != TRACE_BYTE_ORDER_MARK
+        || header.read<uint32_t>() != REGISTER_COUNT)
+        return false;
+
+    m_stack_size = header.read<uint32_t>();
+    m_data_size = header.read<uint32_t>();
+    const uint32_t memory_size{ header.read<uint32_t>() };
+    m_memory_address = header.read<int32_t>();
+    m_text_address = header.read<int32_t>();
+    m_initial_program_counter = header.read<int32_t>();
+
+    if (header.failed()
+        || memory_size % 4 != 0
+        || memory_size > MAX_MEMORY_SIZE
+        || static_cast<uint64_t>(m_stack_size) + m_data_size > memory_size)
+        return false;
+
+    for (int32_t &value : m_initial_registers)
+        value = header.read<int32_t>();
+
+    // Every label takes at least 8 bytes, which bounds their number
+    const uint32_t label_count{ header.read<uint32_t>() };
+    if (header.failed() || label_count > m_data.size() / 8)
+        return false;
+
+    m_labels.resize(label_count);
+    m_label_addresses.resize(label_count);
+    for (uint32_t i{}; i < label_count; i++)
+    {
+        m_label_addresses[i] = header.read<int32_t>();
+        m_labels[i] = header.read_string();
+    }
+
+    m_initial_memory.assign(memory_size / 4, 0);
+    for (;;)
+    {
+        const uint32_t first{ header.read<uint32_t>() };
+        const uint32_t length{ header.read<uint32_t>() };
+
+        if (header.failed() || first > m_initial_memory.size()
+            || length > m_initial_memory.size() - first)
+            return false;
+
+        if (length == 0)
+            break;
+
+        for (uint32_t i{ first }; i < first + length; i++)
+            m_initial_memory[i] = header.read<int32_t>();
+    }
+
+    if (header.failed())
+        return false;
+
+    m_records = header.position();
+    rewind();
+    return true;
+}
+
+
+void TraceReader::rewind()
+{
+    m_position = m_records;
+    m_corrupt = false;
+    m_step = 0;
+    m_program_counter = m_initial_program_counter;
+    std::copy(m_initial_registers, m_initial_registers + REGISTER_COUNT, m_registers);
+    m_memory = m_initial_memory;
+}
+
+
+bool TraceReader::read_varint(uint32_t &value)
+{
+    value = 0;
+
+    for (int32_t shift{}; shift < 35; shift += 7)
+    {
+        if (m_position >= m_data.size())
+            return false;
+
+        const uint8_t byte{ static_cast<uint8_t>(m_data.data()[m_position++]) };
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+
+bool TraceReader::apply_record()
+{
+    if (m_position >= m_data.size())
+        return false;
+
+    const size_t start{ m_position };
+    const uint8_t tag{ static_cast<uint8_t>(m_data.data()[m_position++]) };
+    const uint8_t write{ static_cast<uint8_t>(tag & TRACE_WRITE_MASK) };
+    uint32_t change{ 1 };
+    uint32_t index{ static_cast<uint32_t>(tag >> TRACE_REGISTER_SHIFT) };
+    uint32_t value_change{};
+
+    bool valid{ (tag & TRACE_SEQUENTIAL) != 0 || read_varint(change) };
+    if ((tag & TRACE_SEQUENTIAL) == 0)
+        change = zigzag_decode(change);
+
+    if (write == TRACE_WRITE_MEMORY)
+        valid = valid && index == 0 && read_varint(index);
+
+    if (write != TRACE_WRITE_NONE)
+        valid = valid && read_varint(value_change);
+
+    // LO changes after the change of HI
+    uint32_t low_change{};
+    if (write == TRACE_WRITE_HI_LO)
+        valid = valid && read_varint(low_change);
+
+    if (write == TRACE_WRITE_MEMORY)
+        valid = valid && index < m_memory.size();
+    else if (write != TRACE_WRITE_REGISTER)
+        valid = valid && index == 0;
+
+    if (!valid)
+    {
+        m_position = start;
+        m_corrupt = true;
+        return false;
+    }
+
+    // Changes wrap around like the values they apply to
+    const auto apply{
+        [](int32_t &value, uint32_t value_change)
+        {
+            value = static_cast<int32_t>(
+                static_cast<uint32_t>(value) + static_cast<uint32_t>(zigzag_decode(value_change))
+            );
+        }
+    };
+
+    if (write == TRACE_WRITE_REGISTER)
+        apply(m_registers[index], value_change);
+    else if (write == TRACE_WRITE_MEMORY)
+        apply(m_memory[index], value_change);
+    else if (write == TRACE_WRITE_HI_LO)
+    {
+        apply(m_registers[REGISTER_HI], value_change);
+        apply(m_registers[REGISTER_LO], low_change);
+    }
+
+    m_program_counter = static_cast<int32_t>(static_cast<uint32_t>(m_program_counter) + change);
+    m_step++;
+    return true;
+}
+
+
+bool TraceReader::seek(int64_t step)
+{
+    if (step < m_step)
+        rewind();
+
+    while (m_step < step)
+        if (!apply_record())
+            return false;
+
+    return true;
+}
+
+
+void TraceReader::seek_end()
+{
+    while (apply_record())
+        ;
+}
+
+
+bool TraceReader::is_corrupt() const
+{
+    return m_corrupt;
+}
+
+
+int64_t TraceReader::step() const
+{
+    return m_step;
+}
+
+
+int32_t TraceReader::program_counter() const
+{
+    return m_program_counter;
+}
+
+
+int32_t TraceReader::register_value(int32_t index) const
+{
+    return m_registers[index];
+}
+
+
+const std::vector<int32_t> &TraceReader::memory() const
+{
+    return m_memory;
+}
+
+
+const std::vector<std::string> &TraceReader::labels() const
+{
+    return m_labels;
+}
+
+
+const std::vector<int32_t> &TraceReader::label_addresses() const
+{
+    return m_label_addresses;
+}
+
+
+void TraceReader::display_state(std::ostream &output) const
+{
+    output << "\nStep: " << m_step << '\n';
+    output << "\nProgram Counter: " << m_text_address + 4 * m_program_counter << "\n\n";
+    output << "Registers:\n\n";
+
+    print(output, "%11s%12s\t\t%10s%12s\n", "Register", "Value", "Register", "Value");
+
+    for (int32_t i{}; i < 16; i++)
+        print(
+            output,
+            "%6s[%2d]:%12d\t\t%5s[%2d]:%12d\n",
+            REGISTER_NAMES[i],
+            i,
+            m_registers[i],
+            REGISTER_NAMES[i + 16],
+            i + 16,
+            m_registers[i + 16]
+        );
+
+    print(
+        output,
+        "%10s:%12d\t\t%9s:%12d\n",
+        "hi",
+        m_registers[REGISTER_HI],
+        "lo",
+        m_registers[REGISTER_LO]
+    );
+
+    const size_t stack_words{ m_stack_size / 4 };
+    const size_t data_end{ stack_words + m_data_size / 4 };
+
+    // Only the stack words in use
+    output << "\nStack:\n";
+    for (size_t i{}; i < stack_words; i++)
+        if (m_memory[i] != 0)
+            print(output, "%7zx:%12d\n", m_memory_address + 4 * i, m_memory[i]);
+
+    // Every word of the data section, with the label it starts
+    output << "\nMemory:\n";
+    size_t label{};
+    for (size_t i{ stack_words }; i < data_end; i++)
+    {
+        const int32_t address{ static_cast<int32_t>(m_memory_address + 4 * i) };
+
+        output << std::hex << address << std::dec << ' ';
+        while (label < m_labels.size() && m_label_addresses[label] <= address)
+        {
+            if (m_label_addresses[label] == address)
+                output << m_labels[label] << ": ";
+            label++;
+        }
+        output << m_memory[i] << '\n';
+    }
+
+    // Only the free words in use
+    output << "\nHeap:\n";
+    for (size_t i{ data_end }; i < m_memory.size(); i++)
+        if (m_memory[i] != 0)
+            print(output, "%7zx:%12d\n", m_memory_address + 4 * i, m_memory[i]);
+
+    output << '\n';
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <MappedFile.hpp>
+#include <Instruction.hpp>
+
+/**
+ * @brief Reconstructs the state of the simulator at any step of a trace
+ *        written by TraceRecorder.
+ *
+ * Records only hold changes, so the state is rebuilt by applying them in
+ * order from the initial state in the header. Moving backwards starts again
+ * from the header.
+ */
+class TraceReader
+{
+    MappedFile m_file;
+    std::string_view m_data;
+    // Offset of the first record, and of the next record to apply
+    size_t m_records;
+    size_t m_position;
+    // Set when a record is cut short or refers to something that does not
+    // exist
+    bool m_corrupt;
+
+    // Initial state, from the header
+    int32_t m_initial_program_counter;
+    int32_t m_initial_registers[REGISTER_COUNT];
+    std::vector<int32_t> m_initial_memory;
+    // Layout of memory, sizes in bytes
+    uint32_t m_stack_size;
+    uint32_t m_data_size;
+    // Address of the first word of memory and of the first line
+    int32_t m_memory_address;
+    int32_t m_text_address;
+    // Labels of the data section and their addresses, in address order
+    std::vector<std::string> m_labels;
+    std::vector<int32_t> m_label_addresses;
+
+    // State after m_step instructions
+    int64_t m_step;
+    int32_t m_program_counter;
+    int32_t m_registers[REGISTER_COUNT];
+    std::vector<int32_t> m_memory;
+
+    /**
+     * @brief Read a varint at m_position.
+     * @param value
+     * @return False if the trace ends before the varint does.
+    */
+    bool read_varint(uint32_t &value);
+
+    /**
+     * @brief Apply the record at m_position.
+     * @return False at the end of the trace or on a corrupt record.
+    */
+    bool apply_record();
+
+    /**
+     * @brief Go back to the initial state.
+    */
+    void rewind();
+
+public:
+    TraceReader();
+
+    /**
+     * @brief Open a trace and go to its initial state.
+     *
+     * @param path
+     * @return False if the file cannot be read or is not a trace written by
+     *         this version on this kind of host.
+    */
+    bool open(const std::string &path);
+
+    /**
+     * @brief Go to the state after a number of instructions.
+     *
+     * @param step
+     * @return False if the trace ends before that step, in which case the
+     *         state is the one at its end.
+    */
+    bool seek(int64_t step);
+
+    /**
+     * @brief Go to the state after the last instruction of the trace.
+    */
+    void seek_end();
+
+    /**
+     * @brief Returns true if a damaged record stopped seek().
+    */
+    bool is_corrupt() const;
+
+    /**
+     * @brief Returns the number of instructions executed to reach the current
+     *        state.
+    */
+    int64_t step() const;
+
+    /**
+     * @brief Returns the line of the next instruction to execute.
+    */
+    int32_t program_counter() const;
+
+    /**
+     * @brief Returns the value of a register.
+     * @param index From 0 to REGISTER_COUNT - 1, HI and LO last.
+    */
+    int32_t register_value(int32_t index) const;
+
+    /**
+     * @brief Returns every word of guest memory, from its lowest address up.
+    */
+    const std::vector<int32_t> &memory() const;
+
+    /**
+     * @brief Returns the labels of the data section, in address order.
+    */
+    const std::vector<std::string> &labels() const;
+
+    /**
+     * @brief Returns the address of every label returned by labels().
+    */
+    const std::vector<int32_t> &label_addresses() const;
+
+    /**
+     * @brief Print the current state.
+     * @param output
+    */
+    void display_state(std::ostream &output) const;
+};
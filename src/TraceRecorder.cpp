@@ -0,0 +1,203 @@
+#include <TraceRecorder.hpp>
+
+#include <cstring>
+
+
+namespace
+{
+
+// Size of each of the two blocks of records
+constexpr size_t TRACE_BLOCK_SIZE{ 1 << 20 };
+
+
+/**
+ * @brief Append a value to a header in native byte order.
+ * @param header
+ * @param value
+*/
+template <typename T>
+void append(std::vector<uint8_t> &header, const T &value)
+{
+    const uint8_t *bytes{ reinterpret_cast<const uint8_t *>(&value) };
+    header.insert(header.end(), bytes, bytes + sizeof(T));
+}
+
+}
+
+
+TraceRecorder::TraceRecorder()
+    : m_file{}
+    , m_active{}
+    , m_pending{}
+    , m_pending_size{}
+    , m_cursor{}
+    , m_limit{}
+    , m_program_counter{}
+    , m_registers{}
+    , m_stopping{}
+    , m_failed{}
+{
+}
+
+
+TraceRecorder::~TraceRecorder()
+{
+    end();
+}
+
+
+bool TraceRecorder::begin(
+    const std::string &path,
+    int32_t program_counter,
+    int32_t text_address,
+    const int32_t *registers,
+    const GuestMemory &memory,
+    const SymbolTable &data_labels
+)
+{
+    end();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (m_file == nullptr)
+        return false;
+
+    m_path = path;
+    m_program_counter = program_counter;
+    std::memcpy(m_registers, registers, sizeof(m_registers));
+    m_memory.assign(memory.words(), memory.words() + memory.word_count());
+
+    // The header is small, so it is written here rather than by the thread
+    std::vector<uint8_t> header;
+    header.insert(header.end(), TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC));
+    append(header, TRACE_VERSION);
+    append(header, TRACE_BYTE_ORDER_MARK);
+    append(header, static_cast<uint32_t>(REGISTER_COUNT));
+    append(header, static_cast<uint32_t>(memory.stack_size()));
+    append(header, static_cast<uint32_t>(memory.data_size()));
+    append(header, 4 * memory.word_count());
+    append(header, memory.stack_address());
+    append(header, text_address);
+    append(header, program_counter);
+
+    for (int32_t i{}; i < REGISTER_COUNT; i++)
+        append(header, registers[i]);
+
+    append(header, static_cast<uint32_t>(data_labels.size()));
+    data_labels.for_each(
+        [&header](std::string_view name, int32_t address)
+        {
+            append(header, address);
+            append(header, static_cast<uint32_t>(name.size()));
+            header.insert(header.end(), name.begin(), name.end());
+        }
+    );
+
+    // Most of memory is usually 0, so only runs of other words are stored
+    const uint32_t word_count{ memory.word_count() };
+    for (uint32_t first{}; first < word_count; )
+    {
+        if (m_memory[first] == 0)
+        {
+            first++;
+            continue;
+        }
+
+        uint32_t end{ first };
+        while (end < word_count && m_memory[end] != 0)
+            end++;
+
+        append(header, first);
+        append(header, end - first);
+        for (uint32_t i{ first }; i < end; i++)
+            append(header, m_memory[i]);
+
+        first = end;
+    }
+    append(header, word_count);
+    append(header, static_cast<uint32_t>(0));
+
+    m_failed = std::fwrite(header.data(), 1, header.size(), m_file) != header.size();
+
+    for (std::vector<uint8_t> &block : m_blocks)
+        block.resize(TRACE_BLOCK_SIZE);
+
+    m_active = 0;
+    m_pending_size = 0;
+    m_cursor = m_blocks[0].data();
+    m_limit = m_cursor + TRACE_BLOCK_SIZE - TRACE_MAX_RECORD_SIZE;
+    m_stopping = false;
+    m_writer = std::thread{ &TraceRecorder::write_blocks, this };
+    return true;
+}
+
+
+bool TraceRecorder::end()
+{
+    if (m_file == nullptr)
+        return true;
+
+    submit_block();
+
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_writer.join();
+
+    if (std::fclose(m_file) != 0)
+        m_failed = true;
+
+    m_file = nullptr;
+    return !m_failed;
+}
+
+
+void TraceRecorder::submit_block()
+{
+    uint8_t *block{ m_blocks[m_active].data() };
+    const size_t size{ static_cast<size_t>(m_cursor - block) };
+
+    if (size == 0)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock{ m_mutex };
+        m_condition.wait(lock, [this] { return m_pending_size == 0; });
+        m_pending = m_active;
+        m_pending_size = size;
+    }
+    m_condition.notify_all();
+
+    m_active ^= 1;
+    m_cursor = m_blocks[m_active].data();
+    m_limit = m_cursor + TRACE_BLOCK_SIZE - TRACE_MAX_RECORD_SIZE;
+}
+
+
+void TraceRecorder::write_blocks()
+{
+    std::unique_lock<std::mutex> lock{ m_mutex };
+
+    for (;;)
+    {
+        m_condition.wait(lock, [this] { return m_pending_size != 0 || m_stopping; });
+
+        // Stopping is only requested after the last block was submitted
+        if (m_pending_size == 0)
+            return;
+
+        const uint8_t *block{ m_blocks[m_pending].data() };
+        const size_t size{ m_pending_size };
+
+        lock.unlock();
+        const bool written{ std::fwrite(block, 1, size, m_file) == size };
+        lock.lock();
+
+        if (!written)
+            m_failed = true;
+
+        m_pending_size = 0;
+        m_condition.notify_all();
+    }
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GuestMemory.hpp>
+#include <Instruction.hpp>
+#include <SymbolTable.hpp>
+#include <TraceFormat.hpp>
+
+/**
+ * @brief Writes a compact execution trace, with one record per instruction
+ *        holding only what the instruction changed.
+ *
+ * Records are appended to one of two blocks while a writer thread writes the
+ * other one to the file, so recording only waits when the disk falls behind.
+ * The values last recorded are kept to encode every write as a change.
+ */
+class TraceRecorder
+{
+    // Trace being written, or nullptr
+    std::FILE *m_file;
+    std::string m_path;
+
+    // Blocks of records. The simulator fills m_blocks[m_active], and the
+    // writer thread writes m_blocks[m_pending] while m_pending_size != 0.
+    std::vector<uint8_t> m_blocks[2];
+    int32_t m_active;
+    int32_t m_pending;
+    size_t  m_pending_size;
+    // Next free byte of the active block, and where the block is full
+    uint8_t *m_cursor;
+    uint8_t *m_limit;
+
+    // State as of the last record
+    int32_t m_program_counter;
+    int32_t m_registers[REGISTER_COUNT];
+    std::vector<int32_t> m_memory;
+
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+    bool m_failed;
+
+    /**
+     * @brief Loop of the writer thread.
+    */
+    void write_blocks();
+
+    /**
+     * @brief Hand the active block to the writer thread, once it is done with
+     *        the previous one, and continue in the other block.
+    */
+    void submit_block();
+
+    /**
+     * @brief Start a record.
+     * @param program_counter Line of the next instruction.
+     * @param write One of TRACE_WRITE_*, with extra bits for the tag.
+     * @return Where the rest of the record goes.
+    */
+    uint8_t *begin_record(int32_t program_counter, uint8_t write)
+    {
+        const int32_t change{
+            static_cast<int32_t>(static_cast<uint32_t>(program_counter) - m_program_counter)
+        };
+        m_program_counter = program_counter;
+
+        uint8_t *output{ m_cursor };
+
+        if (change == 1)
+        {
+            *output++ = write | TRACE_SEQUENTIAL;
+            return output;
+        }
+
+        *output++ = write;
+        return put_varint(output, zigzag_encode(change));
+    }
+
+    /**
+     * @brief Finish a record.
+     * @param output The position after the record.
+    */
+    void end_record(uint8_t *output)
+    {
+        m_cursor = output;
+
+        if (m_cursor >= m_limit)
+            submit_block();
+    }
+
+    /**
+     * @brief Returns the change from old_value to value, zigzag encoded.
+    */
+    static uint32_t encode_change(int32_t old_value, int32_t value)
+    {
+        return zigzag_encode(
+            static_cast<int32_t>(static_cast<uint32_t>(value) - static_cast<uint32_t>(old_value))
+        );
+    }
+
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /**
+     * @brief Start a trace, replacing the file, with its initial state.
+     *
+     * @param path
+     * @param program_counter
+     * @param text_address Address of the first line.
+     * @param registers The REGISTER_COUNT registers.
+     * @param memory
+     * @param data_labels Address of every label in the data section.
+     * @return False if the file could not be created.
+    */
+    bool begin(
+        const std::string &path,
+        int32_t program_counter,
+        int32_t text_address,
+        const int32_t *registers,
+        const GuestMemory &memory,
+        const SymbolTable &data_labels
+    );
+
+    /**
+     * @brief Write the remaining records and close the file.
+     * @return False if any part of the trace could not be written.
+    */
+    bool end();
+
+    /**
+     * @brief Returns true while a trace is being written.
+    */
+    bool is_recording() const
+    {
+        return m_file != nullptr;
+    }
+
+    /**
+     * @brief Record an instruction that wrote no register or memory.
+     * @param program_counter Line of the next instruction.
+    */
+    void record_step(int32_t program_counter)
+    {
+        end_record(begin_record(program_counter, TRACE_WRITE_NONE));
+    }
+
+    /**
+     * @brief Record an instruction that wrote a register.
+     * @param program_counter Line of the next instruction.
+     * @param index Below 32.
+     * @param value
+    */
+    void record_register(int32_t program_counter, int32_t index, int32_t value)
+    {
+        uint8_t *output{
+            begin_record(
+                program_counter,
+                static_cast<uint8_t>(TRACE_WRITE_REGISTER | index << TRACE_REGISTER_SHIFT)
+            )
+        };
+        output = put_varint(output, encode_change(m_registers[index], value));
+        m_registers[index] = value;
+        end_record(output);
+    }
+
+    /**
+     * @brief Record an instruction that wrote HI, LO or both.
+     * @param program_counter Line of the next instruction.
+     * @param hi
+     * @param lo
+    */
+    void record_hi_lo(int32_t program_counter, int32_t hi, int32_t lo)
+    {
+        uint8_t *output{ begin_record(program_counter, TRACE_WRITE_HI_LO) };
+        output = put_varint(output, encode_change(m_registers[REGISTER_HI], hi));
+        output = put_varint(output, encode_change(m_registers[REGISTER_LO], lo));
+        m_registers[REGISTER_HI] = hi;
+        m_registers[REGISTER_LO] = lo;
+        end_record(output);
+    }
+
+    /**
+     * @brief Record an instruction that wrote a memory word.
+     * @param program_counter Line of the next instruction.
+     * @param index Index of the word, from the lowest address of memory.
+     * @param value
+    */
+    void record_memory(int32_t program_counter, uint32_t index, int32_t value)
+    {
+        uint8_t *output{ begin_record(program_counter, TRACE_WRITE_MEMORY) };
+        output = put_varint(output, index);
+        output = put_varint(output, encode_change(m_memory[index], value));
+        m_memory[index] = value;
+        end_record(output);
+    }
+};
@@ -0,0 +1,116 @@
+#include <WorkStealingPool.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+/**
+ * @brief Tasks of one thread, which other threads may take from.
+ */
+class TaskQueue
+{
+public:
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+};
+
+}
+
+
+WorkStealingPool::WorkStealingPool(int32_t thread_count)
+    : m_thread_count{ std::max(thread_count, 1) }
+{
+}
+
+
+void WorkStealingPool::run(
+    size_t task_count,
+    const std::function<void(size_t, size_t)> &task
+)
+{
+    const size_t thread_count{
+        std::min(static_cast<size_t>(m_thread_count), std::max<size_t>(task_count, 1))
+    };
+    std::vector<TaskQueue> queues(thread_count);
+
+    // Give every thread a contiguous range
+    for (size_t i{}; i < task_count; i++)
+        queues[i * thread_count / task_count].tasks.push_back(i);
+
+    std::exception_ptr first_error;
+    std::mutex error_mutex;
+
+    auto worker = [&](size_t self)
+    {
+        for (;;)
+        {
+            size_t index{};
+            bool found{};
+
+            // Own tasks first, newest first
+            {
+                std::lock_guard<std::mutex> lock{ queues[self].mutex };
+                if (!queues[self].tasks.empty())
+                {
+                    index = queues[self].tasks.back();
+                    queues[self].tasks.pop_back();
+                    found = true;
+                }
+            }
+
+            // Then the oldest task of any other thread
+            for (size_t i{ 1 }; !found && i < thread_count; i++)
+            {
+                TaskQueue &victim{ queues[(self + i) % thread_count] };
+                std::lock_guard<std::mutex> lock{ victim.mutex };
+                if (!victim.tasks.empty())
+                {
+                    index = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    found = true;
+                }
+            }
+
+            // No task is ever added, so there is nothing left to do
+            if (!found)
+                return;
+
+            try
+            {
+                task(index, self);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock{ error_mutex };
+                if (!first_error)
+                    first_error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i{ 1 }; i < thread_count; i++)
+        threads.emplace_back(worker, i);
+
+    // The calling thread works too
+    worker(0);
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    if (first_error)
+        std::rethrow_exception(first_error);
+}
+
+
+int32_t WorkStealingPool::thread_count() const
+{
+    return m_thread_count;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Runs independent tasks on a fixed number of threads.
+ *
+ * Every thread starts with its own contiguous range of tasks, which it works
+ * through from the back. A thread that runs out takes tasks from the front of
+ * the ranges of the others, so that threads that drew long tasks do not hold
+ * up the rest.
+ */
+class WorkStealingPool
+{
+    // Number of threads tasks are run on
+    int32_t m_thread_count;
+
+public:
+    /**
+     * @brief Create a pool.
+     * @param thread_count At least 1.
+    */
+    explicit WorkStealingPool(int32_t thread_count);
+
+    /**
+     * @brief Run task(0) to task(task_count - 1) and wait for all of them.
+     *
+     * @param task_count
+     * @param task Called once per index, from any thread, with the index of
+     *             the task and the index of the thread, which is less than
+     *             the number of threads.
+     * @throws The first exception thrown by a task, once all threads stopped.
+    */
+    void run(
+        size_t task_count,
+        const std::function<void(size_t, size_t)> &task
+    );
+
+    /**
+     * @brief Returns the number of threads tasks are run on.
+    */
+    int32_t thread_count() const;
+};